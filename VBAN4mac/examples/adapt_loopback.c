@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <vban4mac/stream.h>
+#include "../src/net_util.h"
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+#define PACKET_FRAMES 256
+#define AMPLITUDE 8000
+#define REPORT_INTERVAL_MS 250
+#define HOLD_MS 3000
+#define BUCKET_DEPTH 4096           // Bytes the bottleneck can absorb at once
+#define MAX_STEP 2000               // Largest sample step allowed while formats switch without loss
+
+// Lower rungs: half rate, then mono, then quarter rate at 8 bits
+static const vban_format_t ladder[] = {
+    { 24000, 2, 16 },
+    { 24000, 1, 16 },
+    { 12000, 1, 8 },
+};
+
+// Forwarder between sender and receiver standing in for a congested link:
+// a token bucket of capacity bytes per second of stream time, dropping
+// what doesn't fit. Loss reports travel back through it unlimited.
+typedef struct {
+    int socket;
+    struct sockaddr_storage sender_addr;
+    socklen_t sender_len;
+    struct sockaddr_storage receiver_addr;
+    socklen_t receiver_len;
+    double tokens;
+    uint64_t forwarded;
+    uint64_t dropped;
+} bottleneck_t;
+
+static void bottleneck_run(bottleneck_t* link, double capacity, double dt) {
+    uint8_t packet[VBAN_HEADER_SIZE + VBAN_MAX_PACKET_SIZE];
+    struct sockaddr_storage from;
+    socklen_t from_len;
+
+    link->tokens += capacity * dt;
+    if (capacity <= 0 || link->tokens > BUCKET_DEPTH) link->tokens = BUCKET_DEPTH;
+    for (;;) {
+        from_len = sizeof(from);
+        ssize_t len = recvfrom(link->socket, packet, sizeof(packet), MSG_DONTWAIT, (struct sockaddr*)&from, &from_len);
+        if (len < 0) break;
+
+        if (net_addr_equal(&from, &link->receiver_addr) &&
+            ((struct sockaddr_in*)&from)->sin_port == ((struct sockaddr_in*)&link->receiver_addr)->sin_port) {
+            if (link->sender_len) {
+                sendto(link->socket, packet, len, 0, (struct sockaddr*)&link->sender_addr, link->sender_len);
+            }
+            continue;
+        }
+
+        memcpy(&link->sender_addr, &from, from_len);
+        link->sender_len = from_len;
+        if (capacity > 0 && link->tokens < len) {
+            link->dropped++;
+            continue;
+        }
+        if (capacity > 0) link->tokens -= len;
+        sendto(link->socket, packet, len, 0, (struct sockaddr*)&link->receiver_addr, link->receiver_len);
+        link->forwarded++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    double capacity_kbps = 640;     // Fits the third rung but not the second
+    double clean_s = 4, congested_s = 10, recover_s = 12;
+    uint16_t base_port = 7500;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:C:r:k:p:")) != -1) {
+        switch (opt) {
+            case 'c':
+                clean_s = atof(optarg);
+                break;
+            case 'C':
+                congested_s = atof(optarg);
+                break;
+            case 'r':
+                recover_s = atof(optarg);
+                break;
+            case 'k':
+                capacity_kbps = atof(optarg);
+                break;
+            case 'p':
+                base_port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-c clean_s] [-C congested_s] [-r recover_s] [-k capacity_kbps] [-p base_port]\n",
+                       argv[0]);
+                printf("Streams a stereo tone over loopback through a forwarder that limits the\n");
+                printf("link to capacity_kbps for the congested stretch. The receiver reports\n");
+                printf("its loss, the sender steps down its ladder until the stream fits and back\n");
+                printf("up once the link recovers. Runs in stream time, as fast as possible.\n");
+                return 1;
+        }
+    }
+
+    bottleneck_t link = {0};
+    struct sockaddr_storage link_addr;
+    socklen_t link_len;
+    net_parse_addr("127.0.0.1", (uint16_t)(base_port + 1), AF_INET, &link_addr, &link_len);
+    net_parse_addr("127.0.0.1", base_port, AF_INET, &link.receiver_addr, &link.receiver_len);
+    link.socket = net_open_udp_socket(AF_INET, &link_addr, link_len);
+    if (link.socket < 0) return 1;
+
+    vban_receiver_config_t rx_config = {0};
+    rx_config.bind_ip = "127.0.0.1";
+    rx_config.port = base_port;
+    rx_config.stream_name = "Program";
+    rx_config.channels = CHANNELS;
+    rx_config.sample_rate = SAMPLE_RATE;
+    rx_config.report_interval_ms = REPORT_INTERVAL_MS;
+    rx_config.buffer_frames = 8192;
+
+    vban_sender_config_t tx_config = {0};
+    tx_config.remote_ip = "127.0.0.1";
+    tx_config.port = (uint16_t)(base_port + 1);
+    tx_config.stream_name = "Program";
+    tx_config.sample_rate = SAMPLE_RATE;
+    tx_config.channels = CHANNELS;
+    tx_config.frames_per_packet = PACKET_FRAMES;
+    tx_config.adapt.ladder = ladder;
+    tx_config.adapt.levels = sizeof(ladder) / sizeof(ladder[0]);
+    tx_config.adapt.hold_ms = HOLD_MS;
+
+    vban_receiver_t* receiver = vban_receiver_create(&rx_config);
+    vban_sender_t* sender = vban_sender_create(&tx_config);
+    if (!receiver || !sender) {
+        fprintf(stderr, "Failed to create the stream\n");
+        return 1;
+    }
+
+    const double dt = (double)PACKET_FRAMES / SAMPLE_RATE;
+    long rounds = (long)((clean_s + congested_s + recover_s) / dt);
+    long congested_from = (long)(clean_s / dt), congested_to = (long)((clean_s + congested_s) / dt);
+    long rounds_per_second = (long)(1.0 / dt);
+
+    int16_t period[PACKET_FRAMES * CHANNELS];
+    int16_t out[PACKET_FRAMES * CHANNELS * 8];
+    uint64_t phase = 0, frames_out = 0, accepted = 0, dropped_before = 0;
+    int16_t previous[CHANNELS] = {0};
+    int have_previous = 0, max_level = 0, level_at_congestion_end = 0, max_step = 0;
+    uint64_t recovery_drops = 0;
+
+    printf("%6s %6s %10s %10s\n", "Time", "Rung", "Loss %", "Dropped");
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < PACKET_FRAMES; i++, phase++) {
+            period[i * CHANNELS] = (int16_t)(AMPLITUDE * sin(2 * M_PI * 440.0 * phase / SAMPLE_RATE));
+            period[i * CHANNELS + 1] = (int16_t)(AMPLITUDE * sin(2 * M_PI * 330.0 * phase / SAMPLE_RATE));
+        }
+        if (vban_sender_push(sender, period, PACKET_FRAMES) < 0) {
+            fprintf(stderr, "Send failed\n");
+            return 1;
+        }
+
+        int congested = r >= congested_from && r < congested_to;
+        bottleneck_run(&link, congested ? capacity_kbps * 1000 / 8 : 0, dt);
+
+        int packets = vban_receiver_process(receiver, 0);
+        if (packets > 0) accepted += (uint64_t)packets;
+        size_t available = vban_receiver_available(receiver);
+        if (available > PACKET_FRAMES * 8) available = PACKET_FRAMES * 8;
+        size_t frames = vban_receiver_pull(receiver, out, available);
+        frames_out += frames;
+
+        // Once the link is clear again, every rung change must be click-free
+        int settled = r >= congested_to + rounds_per_second / 2;
+        for (size_t f = 0; f < frames; f++) {
+            for (int c = 0; c < CHANNELS; c++) {
+                int step = abs(out[f * CHANNELS + c] - previous[c]);
+                if (settled && have_previous && step > max_step) max_step = step;
+                previous[c] = out[f * CHANNELS + c];
+            }
+            have_previous = 1;
+        }
+
+        vban_sender_stats_t stats;
+        vban_sender_get_stats(sender, &stats);
+        if (stats.quality_level > max_level) max_level = stats.quality_level;
+        if (r == congested_to - 1) level_at_congestion_end = stats.quality_level;
+        if (settled) recovery_drops = link.dropped - dropped_before;
+        if (r == congested_to) dropped_before = link.dropped;
+        if ((r + 1) % rounds_per_second == 0) {
+            printf("%5lds %6d %10.2f %10llu%s\n", (r + 1) / rounds_per_second, stats.quality_level,
+                   stats.reported_loss_pct, (unsigned long long)link.dropped, congested ? "  congested" : "");
+        }
+    }
+
+    vban_sender_stats_t stats;
+    vban_sender_get_stats(sender, &stats);
+    printf("\n%llu packets sent, %llu forwarded, %llu accepted, %llu rung changes\n",
+           (unsigned long long)stats.packets_sent, (unsigned long long)link.forwarded,
+           (unsigned long long)accepted, (unsigned long long)stats.quality_changes);
+    printf("Rung at the end of congestion: %d, final rung: %d, largest step after recovery: %d\n",
+           level_at_congestion_end, stats.quality_level, max_step);
+
+    int failed = 0;
+    if (max_level == 0 || level_at_congestion_end == 0) {
+        printf("FAILED: the sender never stepped down\n");
+        failed = 1;
+    }
+    if (stats.quality_level != 0) {
+        printf("FAILED: the sender didn't recover the configured format\n");
+        failed = 1;
+    }
+    if (frames_out != accepted * PACKET_FRAMES) {
+        printf("FAILED: %llu frames decoded from %llu packets\n", (unsigned long long)frames_out,
+               (unsigned long long)accepted);
+        failed = 1;
+    }
+    if (recovery_drops != 0 || max_step > MAX_STEP) {
+        printf("FAILED: switching rungs wasn't seamless\n");
+        failed = 1;
+    }
+
+    vban_sender_destroy(sender);
+    vban_receiver_destroy(receiver);
+    close(link.socket);
+    return failed;
+}
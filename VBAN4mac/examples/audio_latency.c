@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <vban4mac/vban.h>
+#include "../src/audio.h"
+
+#define PACKET_FRAMES 256           // Bridge packet size
+#define SEND_TICK_FRAMES 96         // Send timer period (2 ms) at 48 kHz
+
+static double frames_to_ms(double frames, int sample_rate) {
+    return sample_rate > 0 ? frames * 1000.0 / sample_rate : 0.0;
+}
+
+// Misses and scheduling anomalies of one callback, with its
+// durations in eighths of the period
+static void print_deadlines(const char* name, const vban_callback_deadline_stats_t* stats) {
+    if (stats->callbacks == 0) return;
+    printf("\n%s callback deadlines (period %.0f us):\n", name, stats->period_us);
+    printf("  Misses %llu, late %llu, early %llu of %llu\n", (unsigned long long)stats->deadline_misses,
+           (unsigned long long)stats->late_callbacks, (unsigned long long)stats->early_callbacks,
+           (unsigned long long)stats->callbacks);
+    for (int i = 0; i < VBAN_CALLBACK_HISTOGRAM_BUCKETS; i++) {
+        if (stats->histogram[i] == 0) continue;
+        if (i == VBAN_CALLBACK_HISTOGRAM_BUCKETS - 1) {
+            printf("  >= %2d/8 period  %llu\n", i, (unsigned long long)stats->histogram[i]);
+        } else {
+            printf("  %2d-%2d/8 period  %llu\n", i, i + 1, (unsigned long long)stats->histogram[i]);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int seconds = 10;
+    uint16_t port = 6985;
+    const char* input_ports = NULL;
+    const char* output_ports = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:p:i:o:")) != -1) {
+        switch (opt) {
+            case 'd':
+                seconds = atoi(optarg);
+                break;
+            case 'p':
+                port = (uint16_t)atoi(optarg);
+                break;
+            case 'i':
+                input_ports = optarg;
+                break;
+            case 'o':
+                output_ports = optarg;
+                break;
+            default:
+                printf("Usage: %s [-d seconds] [-p port] [-i jack_capture_ports] [-o jack_playback_ports]\n", argv[0]);
+                printf("Runs the bridge looped back to itself over 127.0.0.1 on the default audio\n");
+                printf("backend (CoreAudio, or JACK in JACK=1 builds), then reports the device\n");
+                printf("period, callback timing and the end-to-end latency budget. With JACK,\n");
+                printf("-i/-o connect the bridge's ports, e.g. -i system:capture_1 -o system:playback_\n");
+                return 1;
+        }
+    }
+
+    vban_options_t options = {0};
+    options.remote_ip = "127.0.0.1";
+    options.stream_name = "LatencyBench";
+    options.port = port;
+    vban_handle_t vban = vban_init_with_options(&options);
+    if (!vban) {
+        fprintf(stderr, "Failed to start the bridge\n");
+        return 1;
+    }
+
+#ifdef VBAN_JACK
+    if ((input_ports && audio_connect_input(input_ports) != noErr) ||
+        (output_ports && audio_connect_output(output_ports) != noErr)) {
+        vban_cleanup(vban);
+        return 1;
+    }
+#else
+    if (input_ports || output_ports) {
+        printf("-i/-o only apply to JACK builds, using the default devices\n");
+    }
+#endif
+
+    sleep(seconds);
+
+    vban_audio_stats_t audio;
+    vban_jitter_stats_t jitter;
+    if (vban_get_audio_stats(vban, &audio) != 0 || vban_get_jitter_stats(vban, &jitter) != 0) {
+        fprintf(stderr, "Failed to read statistics\n");
+        vban_cleanup(vban);
+        return 1;
+    }
+
+#ifdef VBAN_JACK
+    const char* backend = "JACK";
+#else
+    const char* backend = "CoreAudio";
+#endif
+    int rate = audio.sample_rate;
+
+    printf("Backend:              %s\n", backend);
+    printf("Sample rate:          %d Hz\n", rate);
+    printf("Period:               %d frames (%.2f ms)\n", audio.period_frames, frames_to_ms(audio.period_frames, rate));
+    printf("Output callbacks:     %llu\n", (unsigned long long)audio.callbacks);
+    printf("Callback time:        %.1f us mean, %.1f us max\n", audio.mean_callback_us, audio.max_callback_us);
+    printf("Period jitter:        %.1f us max\n", audio.max_period_jitter_us);
+    printf("Packets received:     %llu (jitter %.3f ms)\n", (unsigned long long)jitter.packets, jitter.jitter_ms);
+    print_deadlines("Render", &audio.render);
+    print_deadlines("Capture", &audio.capture);
+
+    // Worst case from microphone to speaker through the loopback
+    double stages[] = {
+        audio.input_latency_frames,
+        audio.period_frames,
+        PACKET_FRAMES,
+        SEND_TICK_FRAMES,
+        jitter.target_frames,
+        audio.period_frames,
+        audio.output_latency_frames,
+    };
+    const char* names[] = {
+        "Capture latency", "Capture period", "Packetization", "Send timer",
+        "Playout buffer", "Render period", "Playback latency",
+    };
+    double total = 0;
+    printf("\nLatency budget:\n");
+    for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+        printf("  %-20s %6.0f frames %7.2f ms\n", names[i], stages[i], frames_to_ms(stages[i], rate));
+        total += stages[i];
+    }
+    printf("  %-20s %6.0f frames %7.2f ms\n", "Total", total, frames_to_ms(total, rate));
+
+    vban_cleanup(vban);
+    return 0;
+}
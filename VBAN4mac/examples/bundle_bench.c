@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <vban4mac/stream.h>
+#include <vban4mac/bundle.h>
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 256           // One mono mic stream, 187.5 packets per second
+#define ROUND_FRAMES 256            // Audio each source captures per round
+#define MAX_CHUNK 480
+#define PULL_FRAMES 4096
+
+// Capture block sizes, so sources deliver out of step with each other
+static const size_t chunk_sizes[] = { 32, 100, 256, 441, 480 };
+#define NUM_CHUNK_SIZES (sizeof(chunk_sizes) / sizeof(chunk_sizes[0]))
+
+typedef struct {
+    uint64_t packets_sent;
+    uint64_t packets_received;
+    uint64_t frames_checked;        // Received frames compared, over all channels
+    uint64_t mismatches;
+    uint64_t frames_padded;
+    uint64_t realignments;
+    int64_t phase;                  // Last mic: bundled frames ahead of its captured frames at the end
+    double cpu_seconds;
+} bench_result_t;
+
+// What goes wrong with the last mic of a bundled run
+typedef struct {
+    long stall_round;               // Stops capturing from this round (-1 = never)
+    long resume_round;              // and starts again from this one
+    double drift;                   // Fraction of each round's frames its slower clock doesn't capture
+} bench_fault_t;
+
+// Sample f of mic s, distinct per mic so a swapped channel shows up
+static int16_t mic_sample(int s, uint64_t f) {
+    return (int16_t)((int)((f * 31 + (uint64_t)s * 977) % 60001) - 30000);
+}
+
+static double cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Compare received frames of one mic against what it captured
+static void check_frames(bench_result_t* result, int s, uint64_t* next, const int16_t* frames, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (frames[i] != mic_sample(s, (*next)++)) result->mismatches++;
+    }
+    result->frames_checked += count;
+}
+
+// Compare received frames of the last mic, which was padded: silence in
+// place of its audio is padding, anything else must be its next sample
+static void check_padded(bench_result_t* result, int s, uint64_t* position, uint64_t* next, const int16_t* frames,
+                         size_t count) {
+    for (size_t i = 0; i < count; i++, (*position)++) {
+        if (frames[i] == 0 && mic_sample(s, *next) != 0) continue;
+        if (frames[i] != mic_sample(s, (*next)++)) result->mismatches++;
+        result->phase = (int64_t)*position - (int64_t)(*next - 1);
+        result->frames_checked++;
+    }
+}
+
+// Capture: each mic pushes its own block sizes until it has caught up with
+// the round. Returns the chunk to push next, or 0 once the mic is done.
+static size_t next_chunk(int s, uint64_t captured, uint64_t round_end, int* chunk_index) {
+    if (captured >= round_end) return 0;
+    size_t chunk = chunk_sizes[(s + *chunk_index) % NUM_CHUNK_SIZES];
+    (*chunk_index)++;
+    return chunk;
+}
+
+// One sender and receiver per mic, the way separate mic streams are sent today
+static int run_separate(int num_mics, long rounds, uint16_t base_port, bench_result_t* result) {
+    vban_sender_t** senders = calloc(num_mics, sizeof(vban_sender_t*));
+    vban_receiver_t** receivers = calloc(num_mics, sizeof(vban_receiver_t*));
+    struct pollfd* fds = calloc(num_mics, sizeof(struct pollfd));
+    uint64_t* captured = calloc(num_mics, sizeof(uint64_t));
+    uint64_t* checked = calloc(num_mics, sizeof(uint64_t));
+    int* chunk_index = calloc(num_mics, sizeof(int));
+    int status = (senders && receivers && fds && captured && checked && chunk_index) ? 0 : -1;
+
+    char name[16];
+    for (int s = 0; s < num_mics && status == 0; s++) {
+        snprintf(name, sizeof(name), "Mic%d", s);
+
+        vban_receiver_config_t rx_config = {0};
+        rx_config.bind_ip = "127.0.0.1";
+        rx_config.port = (uint16_t)(base_port + s);
+        rx_config.remote_ip = "127.0.0.1";
+        rx_config.stream_name = name;
+        rx_config.channels = 1;
+
+        vban_sender_config_t tx_config = {0};
+        tx_config.remote_ip = "127.0.0.1";
+        tx_config.port = (uint16_t)(base_port + s);
+        tx_config.stream_name = name;
+        tx_config.sample_rate = SAMPLE_RATE;
+        tx_config.channels = 1;
+        tx_config.frames_per_packet = PACKET_FRAMES;
+
+        receivers[s] = vban_receiver_create(&rx_config);
+        senders[s] = vban_sender_create(&tx_config);
+        if (!receivers[s] || !senders[s]) {
+            status = -1;
+            break;
+        }
+        fds[s].fd = vban_receiver_fd(receivers[s]);
+        fds[s].events = POLLIN;
+    }
+
+    if (status == 0) {
+        int16_t block[MAX_CHUNK];
+        int16_t playout[PULL_FRAMES];
+        double cpu_start = cpu_seconds();
+        for (long r = 0; r <= rounds && status == 0; r++) {
+            uint64_t round_end = (uint64_t)r * ROUND_FRAMES;
+            for (int s = 0; s < num_mics && r < rounds; s++) {
+                size_t chunk;
+                while ((chunk = next_chunk(s, captured[s], round_end + ROUND_FRAMES, &chunk_index[s])) > 0) {
+                    for (size_t i = 0; i < chunk; i++) block[i] = mic_sample(s, captured[s] + i);
+                    captured[s] += chunk;
+                    if (vban_sender_push(senders[s], block, chunk) < 0) {
+                        fprintf(stderr, "Send failed\n");
+                        status = -1;
+                        break;
+                    }
+                }
+            }
+
+            // After the last round, wait for the tail still in flight
+            if (poll(fds, num_mics, r < rounds ? 0 : 50) <= 0) continue;
+            for (int s = 0; s < num_mics; s++) {
+                if (!(fds[s].revents & POLLIN)) continue;
+                int accepted = vban_receiver_process(receivers[s], 0);
+                if (accepted > 0) result->packets_received += (uint64_t)accepted;
+                size_t frames;
+                while ((frames = vban_receiver_available(receivers[s])) > 0) {
+                    if (frames > PULL_FRAMES) frames = PULL_FRAMES;
+                    frames = vban_receiver_pull(receivers[s], playout, frames);
+                    if (frames == 0) break;
+                    check_frames(result, s, &checked[s], playout, frames);
+                }
+            }
+        }
+        result->cpu_seconds = cpu_seconds() - cpu_start;
+
+        for (int s = 0; s < num_mics; s++) {
+            vban_sender_stats_t tx;
+            vban_sender_get_stats(senders[s], &tx);
+            result->packets_sent += tx.packets_sent;
+        }
+    }
+
+    for (int s = 0; s < num_mics && senders && receivers; s++) {
+        vban_sender_destroy(senders[s]);
+        vban_receiver_destroy(receivers[s]);
+    }
+    free(senders);
+    free(receivers);
+    free(fds);
+    free(captured);
+    free(checked);
+    free(chunk_index);
+    return status;
+}
+
+// All mics through one bundler and unbundler, the last one with fault
+static int run_bundled(int num_mics, long rounds, const bench_fault_t* fault, uint16_t port, bench_result_t* result) {
+    vban_bundler_config_t tx_config = {0};
+    tx_config.sender.remote_ip = "127.0.0.1";
+    tx_config.sender.port = port;
+    tx_config.sender.stream_name = "Mics";
+    tx_config.sender.sample_rate = SAMPLE_RATE;
+    tx_config.sender.channels = num_mics;
+
+    vban_receiver_config_t rx_config = {0};
+    rx_config.bind_ip = "127.0.0.1";
+    rx_config.port = port;
+    rx_config.remote_ip = "127.0.0.1";
+    rx_config.stream_name = "Mics";
+    rx_config.channels = num_mics;
+
+    vban_unbundler_t* unbundler = vban_unbundler_create(&rx_config);
+    vban_bundler_t* bundler = vban_bundler_create(&tx_config);
+    uint64_t* captured = calloc(num_mics, sizeof(uint64_t));
+    uint64_t* checked = calloc(num_mics, sizeof(uint64_t));
+    int* chunk_index = calloc(num_mics, sizeof(int));
+    int status = (unbundler && bundler && captured && checked && chunk_index) ? 0 : -1;
+    int faulty = fault->stall_round >= 0 || fault->drift > 0;
+    uint64_t position = 0;          // Frames of the last mic's output seen
+
+    if (status == 0) {
+        int16_t block[MAX_CHUNK];
+        int16_t playout[PULL_FRAMES];
+        struct pollfd fd = { vban_unbundler_fd(unbundler), POLLIN, 0 };
+        double cpu_start = cpu_seconds();
+        for (long r = 0; r <= rounds && status == 0; r++) {
+            uint64_t round_end = (uint64_t)r * ROUND_FRAMES;
+            for (int s = 0; s < num_mics && r < rounds; s++) {
+                uint64_t capture_end = round_end + ROUND_FRAMES;
+                if (s == num_mics - 1) {
+                    // A stalled mic captures nothing while stalled; a slow one falls behind
+                    if (fault->stall_round >= 0 && r >= fault->stall_round) {
+                        if (r < fault->resume_round) continue;
+                        capture_end -= (uint64_t)(fault->resume_round - fault->stall_round) * ROUND_FRAMES;
+                    }
+                    capture_end = (uint64_t)(capture_end * (1.0 - fault->drift));
+                }
+                size_t chunk;
+                while ((chunk = next_chunk(s, captured[s], capture_end, &chunk_index[s])) > 0) {
+                    for (size_t i = 0; i < chunk; i++) block[i] = mic_sample(s, captured[s] + i);
+                    captured[s] += chunk;
+                    if (vban_bundler_push(bundler, s, block, chunk) < 0) {
+                        fprintf(stderr, "Send failed\n");
+                        status = -1;
+                        break;
+                    }
+                }
+            }
+
+            if (poll(&fd, 1, r < rounds ? 0 : 50) <= 0) continue;
+            int accepted = vban_unbundler_process(unbundler, 0);
+            if (accepted > 0) result->packets_received += (uint64_t)accepted;
+            for (int s = 0; s < num_mics; s++) {
+                size_t frames;
+                while ((frames = vban_unbundler_available(unbundler, s)) > 0) {
+                    if (frames > PULL_FRAMES) frames = PULL_FRAMES;
+                    frames = vban_unbundler_pull(unbundler, s, playout, frames);
+                    if (frames == 0) break;
+
+                    if (s == num_mics - 1 && faulty) {
+                        check_padded(result, s, &position, &checked[s], playout, frames);
+                    } else {
+                        check_frames(result, s, &checked[s], playout, frames);
+                    }
+                }
+            }
+        }
+        result->cpu_seconds = cpu_seconds() - cpu_start;
+
+        vban_bundler_stats_t stats;
+        vban_bundler_get_stats(bundler, &stats);
+        result->packets_sent = stats.packets_sent;
+        result->frames_padded = stats.frames_padded;
+        result->realignments = stats.realignments;
+    }
+
+    vban_bundler_destroy(bundler);
+    vban_unbundler_destroy(unbundler);
+    free(captured);
+    free(checked);
+    free(chunk_index);
+    return status;
+}
+
+static void print_result(const char* label, const bench_result_t* result, double seconds) {
+    printf("%-10s %10llu %10.1f %10llu %12llu %10llu %10llu %8llu %8.3f %8.2f\n", label,
+           (unsigned long long)result->packets_sent, result->packets_sent / seconds,
+           (unsigned long long)result->packets_received, (unsigned long long)result->frames_checked,
+           (unsigned long long)result->mismatches, (unsigned long long)result->frames_padded,
+           (unsigned long long)result->realignments, result->cpu_seconds, 100.0 * result->cpu_seconds / seconds);
+}
+
+int main(int argc, char* argv[]) {
+    int num_mics = 32;
+    double seconds = 10.0;
+    uint16_t base_port = 7300;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:d:p:")) != -1) {
+        switch (opt) {
+            case 'm':
+                num_mics = atoi(optarg);
+                break;
+            case 'd':
+                seconds = atof(optarg);
+                break;
+            case 'p':
+                base_port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-m mics] [-d seconds] [-p base_port]\n", argv[0]);
+                printf("Sends mono mics over loopback as separate streams and bundled into one\n");
+                printf("multichannel stream, checks every channel arrives intact, and compares\n");
+                printf("packets and CPU time. Two more runs stall one mic for a while, and run\n");
+                printf("one on a slower clock, checking that it is padded and put back in phase.\n");
+                printf("Audio is generated as fast as possible; CPU %% is relative to one core\n");
+                printf("playing the same audio in real time.\n");
+                return 1;
+        }
+    }
+    if (num_mics < 2 || num_mics > VBAN_BUNDLE_MAX_SOURCES || seconds <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    long rounds = (long)(seconds * SAMPLE_RATE / ROUND_FRAMES);
+    double audio_seconds = (double)rounds * ROUND_FRAMES / SAMPLE_RATE;
+    int bundle_frames = VBAN_MAX_PACKET_SIZE / (num_mics * (int)sizeof(int16_t));
+    if (bundle_frames > 256) bundle_frames = 256;
+    printf("%d mics, %.1f s of audio each, %d frames per separate packet, %d per bundled packet\n\n",
+           num_mics, audio_seconds, PACKET_FRAMES, bundle_frames);
+    printf("%-10s %10s %10s %10s %12s %10s %10s %8s %8s %8s\n", "Mode", "Sent", "Pkt/s", "Received",
+           "Checked", "Mismatch", "Padded", "Realign", "CPU s", "CPU %");
+
+    // The last mic stalls for a quarter of the run, or runs 0.5% slow
+    bench_fault_t none = { -1, -1, 0 };
+    bench_fault_t stall = { rounds / 2, rounds * 3 / 4, 0 };
+    bench_fault_t drift = { -1, -1, 0.005 };
+    bench_result_t separate = {0}, bundled = {0}, stalled = {0}, drifting = {0};
+    if (run_separate(num_mics, rounds, base_port, &separate) != 0 ||
+        run_bundled(num_mics, rounds, &none, base_port, &bundled) != 0 ||
+        run_bundled(num_mics, rounds, &stall, base_port, &stalled) != 0 ||
+        run_bundled(num_mics, rounds, &drift, base_port, &drifting) != 0) {
+        fprintf(stderr, "Failed to run the benchmark\n");
+        return 1;
+    }
+    print_result("separate", &separate, audio_seconds);
+    print_result("bundled", &bundled, audio_seconds);
+    print_result("stalled", &stalled, audio_seconds);
+    print_result("drifting", &drifting, audio_seconds);
+
+    // Once it resumes, the stalled mic's audio lines up with the others
+    // again, give or take a capture round and block
+    int64_t stall_frames = (int64_t)(stall.resume_round - stall.stall_round) * ROUND_FRAMES;
+    int64_t phase_error = stalled.phase - stall_frames;
+    printf("\nStalled mic resumed %lld frames off its capture time\n", (long long)phase_error);
+
+    printf("\nPackets saved: %.1f%%, CPU saved: %.1f%%\n",
+           100.0 * (1.0 - (double)bundled.packets_sent / separate.packets_sent),
+           100.0 * (1.0 - bundled.cpu_seconds / separate.cpu_seconds));
+
+    // Loopback drops nothing: every channel must arrive whole and in place,
+    // a stalled mic must not hold the others back and must come back in
+    // phase, and a slow one must slip back into phase
+    uint64_t expected = (uint64_t)num_mics * rounds * ROUND_FRAMES;
+    uint64_t stall_expected = (uint64_t)(num_mics - 1) * rounds * ROUND_FRAMES;
+    int failed = 0;
+    if (separate.mismatches || bundled.mismatches || stalled.mismatches || drifting.mismatches) failed = 1;
+    uint64_t held = (uint64_t)num_mics * MAX_CHUNK;    // Captured past the slowest mic, never sent
+    if (bundled.packets_received != bundled.packets_sent || bundled.frames_checked < expected - held) failed = 1;
+    if (stalled.frames_checked < stall_expected * 3 / 4 || stalled.frames_padded == 0) failed = 1;
+    if (stalled.realignments == 0 || llabs(phase_error) > ROUND_FRAMES + MAX_CHUNK) failed = 1;
+    if (drifting.frames_checked < stall_expected * 3 / 4 || drifting.realignments == 0) failed = 1;
+    if (failed) {
+        printf("FAILED: channels did not arrive intact\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include "../src/stretch.h"
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+#define BLOCK_FRAMES 256            // Render period, and what the network delivers per period
+#define TARGET_FRAMES 960           // 20 ms playout target
+#define MAX_STEP_RATIO 1.25         // Largest sample step allowed, relative to the signal's own
+#define MAX_PITCH_ERROR 0.01
+#define MAX_LEVEL_ERROR 0.10
+
+// Offline check of latency catch-up: audio is produced and rendered one
+// block at a time, as the bridge would, with the playout buffer either
+// holding too much (after a stall and burst) or too little (after the
+// target was raised). The output must stay continuous, keep its pitch and
+// level, and reach the target within a few drain windows.
+//
+// Left is a 440 Hz tone, for pitch; right is an A-C# third.
+
+typedef struct {
+    const char* name;
+    long prefill;                   // Frames buffered at the start, beyond the target
+    long raise_to;                  // Target after one second, 0 to keep it
+} scenario_t;
+
+static double signal_at(long n, int channel) {
+    double t = (double)n / SAMPLE_RATE;
+    if (channel == 0) return 0.5 * sin(2 * M_PI * 440.0 * t);
+    return 0.3 * sin(2 * M_PI * 440.0 * t) + 0.3 * sin(2 * M_PI * 554.37 * t);
+}
+
+static void produce(audio_buffer_t* ring, long* produced, long frames) {
+    vban_sample_t block[BLOCK_FRAMES * CHANNELS];
+    while (frames > 0) {
+        long n = frames < BLOCK_FRAMES ? frames : BLOCK_FRAMES;
+        for (long i = 0; i < n; i++) {
+            for (int c = 0; c < CHANNELS; c++) {
+                double v = signal_at(*produced + i, c);
+#ifdef VBAN_SAMPLE_INT16
+                block[i * CHANNELS + c] = (vban_sample_t)lrint(v * 32767.0);
+#else
+                block[i * CHANNELS + c] = (vban_sample_t)v;
+#endif
+            }
+        }
+        audio_buffer_write(ring, block, (size_t)n * CHANNELS);
+        *produced += n;
+        frames -= n;
+    }
+}
+
+static double to_double(vban_sample_t v) {
+#ifdef VBAN_SAMPLE_INT16
+    return v / 32767.0;
+#else
+    return v;
+#endif
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int run(const scenario_t* sc, const vban_catchup_config_t* config, double seconds) {
+    audio_buffer_t ring;
+    stretch_t st;
+    if (audio_buffer_create(&ring, (size_t)SAMPLE_RATE * CHANNELS * 2, sizeof(vban_sample_t)) != 0 ||
+        stretch_init(&st, CHANNELS, SAMPLE_RATE, config) != 0) {
+        fprintf(stderr, "Failed to allocate\n");
+        return 1;
+    }
+
+    long produced = 0;
+    long target = TARGET_FRAMES;
+    produce(&ring, &produced, target + BLOCK_FRAMES + sc->prefill);
+
+    long blocks = (long)(seconds * SAMPLE_RATE / BLOCK_FRAMES);
+    vban_sample_t left[BLOCK_FRAMES], right[BLOCK_FRAMES];
+    vban_sample_t* const out[CHANNELS] = { left, right };
+    double previous[CHANNELS] = { 0, 0 };
+    double max_step[CHANNELS] = { 0, 0 };
+    double sum_sq = 0, min_rms = INFINITY, max_rms = 0;
+    long rms_frames = 0, crossings = 0, crossing_frames = 0, underruns = 0;
+    long settled_block = -1, changed_block = 0;
+    int64_t max_ns = 0, total_ns = 0;
+
+    for (long b = 0; b < blocks; b++) {
+        if (sc->raise_to && b == SAMPLE_RATE / BLOCK_FRAMES) {
+            target = sc->raise_to;
+            changed_block = b;
+            settled_block = -1;
+        }
+
+        int64_t start = now_ns();
+        size_t got = stretch_render(&st, &ring, out, BLOCK_FRAMES, (size_t)(target + BLOCK_FRAMES));
+        int64_t elapsed = now_ns() - start;
+        total_ns += elapsed;
+        if (elapsed > max_ns) max_ns = elapsed;
+        if (got != BLOCK_FRAMES) underruns++;
+        produce(&ring, &produced, BLOCK_FRAMES);
+
+        for (size_t i = 0; i < got; i++) {
+            for (int c = 0; c < CHANNELS; c++) {
+                double v = to_double(out[c][i]);
+                if (b > 0 || i > 0) {
+                    double step = fabs(v - previous[c]);
+                    if (step > max_step[c]) max_step[c] = step;
+                }
+                if (c == 0) {
+                    if (previous[0] < 0 && v >= 0) crossings++;
+                    sum_sq += v * v;
+                    if (++rms_frames == SAMPLE_RATE / 100) {
+                        double rms = sqrt(sum_sq / rms_frames);
+                        if (rms < min_rms) min_rms = rms;
+                        if (rms > max_rms) max_rms = rms;
+                        sum_sq = 0;
+                        rms_frames = 0;
+                    }
+                }
+                previous[c] = v;
+            }
+        }
+        crossing_frames += (long)got;
+
+        long buffered = (long)(audio_buffer_available(&ring) / CHANNELS + stretch_buffered(&st));
+        if (settled_block < 0 && labs(buffered - target - BLOCK_FRAMES) < st.hop) settled_block = b;
+    }
+
+    // What dropping the oldest samples would have done instead: one jump of
+    // prefill frames in the middle of the waveform
+    double drop_step = 0;
+    if (sc->prefill > 0) {
+        for (int c = 0; c < CHANNELS; c++) {
+            double step = fabs(signal_at(1000 + sc->prefill, c) - signal_at(999, c));
+            if (step > drop_step) drop_step = step;
+        }
+    }
+    double signal_step[CHANNELS] = { 0, 0 };
+    for (long n = 1; n < SAMPLE_RATE / 20; n++) {
+        for (int c = 0; c < CHANNELS; c++) {
+            double step = fabs(signal_at(n, c) - signal_at(n - 1, c));
+            if (step > signal_step[c]) signal_step[c] = step;
+        }
+    }
+
+    double pitch = (double)crossings * SAMPLE_RATE / crossing_frames;
+    double nominal_rms = 0.5 / sqrt(2.0);
+    double settle_s = settled_block < 0 ? -1 : (double)(settled_block - changed_block) * BLOCK_FRAMES / SAMPLE_RATE;
+    uint64_t compressed = atomic_load(&st.frames_compressed), expanded = atomic_load(&st.frames_expanded);
+
+    printf("%s\n", sc->name);
+    printf("  settled on the target after %.2f s, %llu frames compressed, %llu expanded, %ld underruns\n", settle_s,
+           (unsigned long long)compressed, (unsigned long long)expanded, underruns);
+    printf("  largest step %.4f / %.4f (signal's own %.4f / %.4f)", max_step[0], max_step[1], signal_step[0],
+           signal_step[1]);
+    if (drop_step > 0) printf(", dropping the excess instead: %.4f", drop_step);
+    printf("\n  pitch %.2f Hz, 10 ms RMS %.3f-%.3f (nominal %.3f)\n", pitch, min_rms, max_rms, nominal_rms);
+    printf("  render %.1f us mean, %.1f us max per %d-frame block\n", total_ns / 1000.0 / blocks, max_ns / 1000.0,
+           BLOCK_FRAMES);
+
+    // Full speed (half of it when slowing down) for the excess, then the
+    // proportional tail of a few drain windows
+    double excess_s = (double)(sc->prefill + (sc->raise_to ? sc->raise_to - TARGET_FRAMES : 0)) / SAMPLE_RATE;
+    double speed = config->max_speed_pct / 100.0 * (sc->raise_to ? 0.5 : 1.0);
+    double settle_limit = excess_s / speed + 3.0 * config->window_ms / 1000.0 + 1.0;
+
+    int failed = 0;
+    if (settled_block < 0 || settle_s > settle_limit) {
+        printf("  FAILED: the buffer didn't reach the target\n");
+        failed = 1;
+    }
+    for (int c = 0; c < CHANNELS; c++) {
+        if (max_step[c] > signal_step[c] * MAX_STEP_RATIO) {
+            printf("  FAILED: discontinuity on channel %d\n", c + 1);
+            failed = 1;
+        }
+    }
+    if (fabs(pitch - 440.0) / 440.0 > MAX_PITCH_ERROR) {
+        printf("  FAILED: pitch changed\n");
+        failed = 1;
+    }
+    if (min_rms < nominal_rms * (1 - MAX_LEVEL_ERROR) || max_rms > nominal_rms * (1 + MAX_LEVEL_ERROR)) {
+        printf("  FAILED: level changed\n");
+        failed = 1;
+    }
+    if (underruns > 0) {
+        printf("  FAILED: underruns\n");
+        failed = 1;
+    }
+
+    stretch_destroy(&st);
+    audio_buffer_destroy(&ring);
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    vban_catchup_config_t config = { 10, 1000 };
+    double seconds = 8;
+    int excess_ms = 100;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:w:e:s:")) != -1) {
+        switch (opt) {
+            case 'm':
+                config.max_speed_pct = atoi(optarg);
+                break;
+            case 'w':
+                config.window_ms = atoi(optarg);
+                break;
+            case 'e':
+                excess_ms = atoi(optarg);
+                break;
+            case 's':
+                seconds = atof(optarg);
+                break;
+            default:
+                printf("Usage: %s [-m max_speed_pct] [-w window_ms] [-e excess_ms] [-s seconds]\n", argv[0]);
+                printf("Renders a tone and a chord through the latency catch-up stage offline, once\n");
+                printf("with excess_ms too much buffered and once after the playout target is\n");
+                printf("raised by as much, and checks continuity, pitch, level and settling time.\n");
+                return 1;
+        }
+    }
+
+    long excess = (long)excess_ms * SAMPLE_RATE / 1000;
+    const scenario_t scenarios[] = {
+        { "Catch-up after a burst", excess, 0 },
+        { "Rebuild after a target increase", 0, TARGET_FRAMES + excess },
+    };
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        failed |= run(&scenarios[i], &config, seconds);
+    }
+    return failed;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include "../src/sample.h"
+
+#define SAMPLE_RATE 48000
+#define PERIOD_SAMPLES 512          // One device period, 256 stereo frames
+#define GAIN 0.8f
+
+// Per-sample conversion work of the bridge pipeline, both directions, with
+// a number of gain stages on each side:
+//
+//   int16 pipeline:   capture float->int16, each stage int16->float->int16,
+//                     packet as is, render int16->float
+//   float pipeline:   capture as is, each stage in float, encode
+//                     float->int16, decode int16->float, render as is
+//
+// The int16 pipeline converts 2 + 4 * stages times per sample round trip,
+// the float pipeline twice whatever the number of stages.
+
+static float dev_in[PERIOD_SAMPLES];
+static float dev_out[PERIOD_SAMPLES];
+static int16_t ring16[PERIOD_SAMPLES];
+static int16_t packet[PERIOD_SAMPLES];
+static float ringf[PERIOD_SAMPLES];
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void gain_float(float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] *= GAIN;
+}
+
+// A gain stage on int16 buffers has to convert in and out around the math
+static void gain_int16(int16_t* x, size_t n) {
+    float tmp[PERIOD_SAMPLES];
+    sample_int16_to_float(x, n, tmp);
+    gain_float(tmp, n);
+    sample_float_to_int16(tmp, n, x);
+}
+
+static void period_int16(int stages) {
+    sample_float_to_int16(dev_in, PERIOD_SAMPLES, ring16);
+    for (int s = 0; s < stages; s++) gain_int16(ring16, PERIOD_SAMPLES);
+    memcpy(packet, ring16, sizeof(packet));
+
+    memcpy(ring16, packet, sizeof(packet));
+    for (int s = 0; s < stages; s++) gain_int16(ring16, PERIOD_SAMPLES);
+    sample_int16_to_float(ring16, PERIOD_SAMPLES, dev_out);
+}
+
+static void period_float(int stages) {
+    memcpy(ringf, dev_in, sizeof(ringf));
+    for (int s = 0; s < stages; s++) gain_float(ringf, PERIOD_SAMPLES);
+    sample_float_to_int16(ringf, PERIOD_SAMPLES, packet);
+
+    sample_int16_to_float(packet, PERIOD_SAMPLES, ringf);
+    for (int s = 0; s < stages; s++) gain_float(ringf, PERIOD_SAMPLES);
+    memcpy(dev_out, ringf, sizeof(dev_out));
+}
+
+// Nanoseconds per sample over the whole run, best of a few repetitions
+static double run(void (*period)(int), int stages, long periods, double* checksum) {
+    double best = 0;
+    for (int rep = 0; rep < 3; rep++) {
+        int64_t start = now_ns();
+        for (long p = 0; p < periods; p++) {
+            dev_in[p % PERIOD_SAMPLES] = (float)(p % 997) / 997.0f - 0.5f;  // Keep the input live
+            period(stages);
+            *checksum += dev_out[p % PERIOD_SAMPLES];
+        }
+        double ns = (double)(now_ns() - start) / ((double)periods * PERIOD_SAMPLES);
+        if (rep == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// Saturation, rounding and an exact int16 round trip
+static int check_conversions(void) {
+    const float in[] = { 1.5f, -1.5f, 1.0f, -1.0f, 0.5f / 32768.0f, -0.5f / 32768.0f, 1.4f / 32768.0f, NAN };
+    const int16_t expected[] = { 32767, -32768, 32767, -32768, 1, -1, 1, 32767 };
+    int16_t out[8];
+    int failed = 0;
+
+    sample_float_to_int16(in, 8, out);
+    for (int i = 0; i < 8; i++) {
+        if (out[i] != expected[i]) {
+            printf("FAILED: %g converted to %d, expected %d\n", in[i], out[i], expected[i]);
+            failed = 1;
+        }
+    }
+
+    static int16_t all[65536], back[65536];
+    static float f[65536];
+    for (int i = 0; i < 65536; i++) all[i] = (int16_t)(i - 32768);
+    sample_int16_to_float(all, 65536, f);
+    sample_float_to_int16(f, 65536, back);
+    if (memcmp(all, back, sizeof(all)) != 0) {
+        printf("FAILED: int16 -> float -> int16 is not exact\n");
+        failed = 1;
+    }
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 60;
+    int max_stages = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:g:")) != -1) {
+        switch (opt) {
+            case 's':
+                seconds = atof(optarg);
+                break;
+            case 'g':
+                max_stages = atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-s seconds] [-g max_stages]\n", argv[0]);
+                printf("Times the per-sample conversion work of a bridge round trip (capture,\n");
+                printf("packet, render) on seconds of stereo audio, with 0 to max_stages gain\n");
+                printf("stages per direction, for int16 and float32 internal buffers.\n");
+                return 1;
+        }
+    }
+
+    int failed = check_conversions();
+    long periods = (long)(seconds * SAMPLE_RATE * 2 / PERIOD_SAMPLES);
+    if (periods < 1) periods = 1;
+    double checksum = 0;
+
+    printf("%6s %12s %10s %12s %10s %8s\n", "Stages", "int16 conv", "ns/sample", "float conv", "ns/sample",
+           "Speedup");
+    for (int stages = 0; stages <= max_stages; stages++) {
+        double ns16 = run(period_int16, stages, periods, &checksum);
+        double nsf = run(period_float, stages, periods, &checksum);
+        printf("%6d %12d %10.3f %12d %10.3f %7.2fx\n", stages, 2 + 4 * stages, ns16, 2, nsf, ns16 / nsf);
+    }
+    printf("\n(checksum %.3f)\n", checksum);
+    return failed;
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <getopt.h>
+#include <stdatomic.h>
+#include <vban4mac/dsp.h>
+#include "../src/dsp_pool.h"
+#include "../src/packet.h"
+#include "../src/sample.h"
+
+#define CHANNELS 2
+#define PACKET_FRAMES 256
+
+typedef struct {
+    dsp_stream_t* dsp;
+    uint32_t expected;              // Next packet index to be delivered
+    uint64_t order_errors;
+    int64_t* submit_ns;             // Submit time of each packet
+    int64_t max_latency_ns;
+    atomic_uint_fast64_t delivered;
+} bench_stream_t;
+
+static int stages = 16;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Synthetic per-packet workload: a cascade of low-pass biquads per channel
+static void biquad_cascade(void* user, vban_sample_t* samples, size_t frames, int channels) {
+    (void)user;
+    const float b0 = 0.0675f, b1 = 0.135f, b2 = 0.0675f, a1 = -1.143f, a2 = 0.4128f;
+
+    for (int c = 0; c < channels; c++) {
+        for (int s = 0; s < stages; s++) {
+            float x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+            for (size_t i = 0; i < frames; i++) {
+                float x = samples[i * channels + c];
+                float y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+                x2 = x1;
+                x1 = x;
+                y2 = y1;
+                y1 = y;
+#ifdef VBAN_SAMPLE_INT16
+                if (y > 32767.0f) y = 32767.0f;
+                if (y < -32768.0f) y = -32768.0f;
+#endif
+                samples[i * channels + c] = (vban_sample_t)y;
+            }
+        }
+    }
+}
+
+static void on_block(void* user, const dsp_block_t* block) {
+    bench_stream_t* stream = (bench_stream_t*)user;
+    uint32_t index = vban_header_frame(&block->header);
+
+    if (index != stream->expected) stream->order_errors++;
+    stream->expected = index + 1;
+
+    int64_t latency = now_ns() - stream->submit_ns[index];
+    if (latency > stream->max_latency_ns) stream->max_latency_ns = latency;
+    atomic_fetch_add_explicit(&stream->delivered, 1, memory_order_release);
+}
+
+typedef struct {
+    double packets_per_second;
+    double max_latency_ms;
+    uint64_t order_errors;
+} bench_result_t;
+
+// Fill a block with packet p of a stream and submit it
+static void submit_packet(bench_stream_t* stream, dsp_block_t* block, vban_header_t* header, int p) {
+    vban_header_set_frame(header, (uint32_t)p);
+    block->header = *header;
+    block->samples = PACKET_FRAMES * CHANNELS;
+    int16_t wire[PACKET_FRAMES * CHANNELS];
+    for (size_t i = 0; i < block->samples; i++) {
+        wire[i] = (int16_t)((i * 7919 + p) & 0x3fff);
+    }
+    sample_from_int16(wire, block->samples, block->data);
+    stream->submit_ns[p] = now_ns();
+    dsp_stream_submit(stream->dsp, block);
+}
+
+static int run(int threads, int num_streams, int packets, bench_result_t* result) {
+    vban_dsp_pool_t* pool = vban_dsp_pool_create(threads);
+    bench_stream_t* streams = calloc(num_streams, sizeof(bench_stream_t));
+    if (!pool || !streams) return -1;
+
+    for (int s = 0; s < num_streams; s++) {
+        streams[s].submit_ns = calloc(packets, sizeof(int64_t));
+        streams[s].dsp = dsp_stream_create(pool, biquad_cascade, NULL, on_block, &streams[s]);
+        if (!streams[s].submit_ns || !streams[s].dsp) return -1;
+    }
+
+    vban_header_t header;
+    vban_header_init(&header, "Bench", 3, PACKET_FRAMES, CHANNELS, VBAN_DATATYPE_INT16);
+    int64_t start = now_ns();
+
+    // Feed the streams round-robin as a receive stage would, waiting for a
+    // free block when a stream's window is full
+    for (int p = 0; p < packets; p++) {
+        for (int s = 0; s < num_streams; s++) {
+            dsp_block_t* block;
+            while (!(block = dsp_stream_acquire(streams[s].dsp))) sched_yield();
+            submit_packet(&streams[s], block, &header, p);
+        }
+    }
+
+    for (int s = 0; s < num_streams; s++) {
+        while (atomic_load_explicit(&streams[s].delivered, memory_order_acquire) < (uint64_t)packets) {
+            sched_yield();
+        }
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    result->packets_per_second = (double)packets * num_streams / elapsed;
+    result->max_latency_ms = 0;
+    result->order_errors = 0;
+    for (int s = 0; s < num_streams; s++) {
+        if (streams[s].max_latency_ns / 1e6 > result->max_latency_ms) {
+            result->max_latency_ms = streams[s].max_latency_ns / 1e6;
+        }
+        result->order_errors += streams[s].order_errors;
+        dsp_stream_destroy(streams[s].dsp);
+        free(streams[s].submit_ns);
+    }
+    free(streams);
+    vban_dsp_pool_destroy(pool);
+    return 0;
+}
+
+// Destroy a pool while every stream has a full window in flight, then
+// keep submitting: nothing may be lost or misordered, and destroying the
+// streams afterwards must not wait for workers that are gone
+// @return Packets delivered out of those submitted, -1 on error
+static int run_teardown(int num_streams, int* submitted) {
+    const int packets = VBAN_DSP_WINDOW + 4;
+    vban_dsp_pool_t* pool = vban_dsp_pool_create(2);
+    bench_stream_t* streams = calloc(num_streams, sizeof(bench_stream_t));
+    if (!pool || !streams) return -1;
+
+    vban_header_t header;
+    vban_header_init(&header, "Bench", 3, PACKET_FRAMES, CHANNELS, VBAN_DATATYPE_INT16);
+    for (int s = 0; s < num_streams; s++) {
+        streams[s].submit_ns = calloc(packets, sizeof(int64_t));
+        streams[s].dsp = dsp_stream_create(pool, biquad_cascade, NULL, on_block, &streams[s]);
+        if (!streams[s].submit_ns || !streams[s].dsp) return -1;
+        for (int p = 0; p < VBAN_DSP_WINDOW; p++) {
+            submit_packet(&streams[s], dsp_stream_acquire(streams[s].dsp), &header, p);
+        }
+    }
+    vban_dsp_pool_destroy(pool);
+
+    int delivered = 0;
+    *submitted = num_streams * packets;
+    for (int s = 0; s < num_streams; s++) {
+        for (int p = VBAN_DSP_WINDOW; p < packets; p++) {
+            dsp_block_t* block = dsp_stream_acquire(streams[s].dsp);
+            if (block) submit_packet(&streams[s], block, &header, p);
+        }
+        dsp_stream_destroy(streams[s].dsp);
+        if (streams[s].order_errors == 0) delivered += (int)atomic_load(&streams[s].delivered);
+        free(streams[s].submit_ns);
+    }
+    free(streams);
+    return delivered;
+}
+
+int main(int argc, char* argv[]) {
+    int num_streams = 8;
+    int packets = 2000;
+    const char* thread_counts = "1,2,4,8";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:t:w:")) != -1) {
+        switch (opt) {
+            case 's':
+                num_streams = atoi(optarg);
+                break;
+            case 'n':
+                packets = atoi(optarg);
+                break;
+            case 't':
+                thread_counts = optarg;
+                break;
+            case 'w':
+                stages = atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-s streams] [-n packets] [-t thread_counts] [-w biquad_stages]\n", argv[0]);
+                printf("Pushes packets of %d stereo frames for several streams through DSP pools\n", PACKET_FRAMES);
+                printf("of different sizes, running a biquad cascade on each, and reports\n");
+                printf("throughput, worst submit-to-output latency and out-of-order deliveries.\n");
+                return 1;
+        }
+    }
+    if (num_streams < 1 || packets < 1 || stages < 1) {
+        fprintf(stderr, "Streams, packets and stages must be positive\n");
+        return 1;
+    }
+
+    printf("%-8s %14s %9s %16s %12s\n", "Threads", "Packets/s", "Speedup", "Max latency ms", "Misordered");
+
+    double baseline = 0;
+    uint64_t misordered = 0;
+    char* list = strdup(thread_counts);
+    char* saveptr = NULL;
+    for (char* item = strtok_r(list, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        int threads = atoi(item);
+        bench_result_t result;
+        if (threads < 1 || run(threads, num_streams, packets, &result) != 0) {
+            fprintf(stderr, "Benchmark failed for %s threads\n", item);
+            free(list);
+            return 1;
+        }
+        if (baseline == 0) baseline = result.packets_per_second;
+        misordered += result.order_errors;
+        printf("%-8d %14.0f %8.2fx %16.2f %12llu\n", threads, result.packets_per_second,
+               result.packets_per_second / baseline, result.max_latency_ms,
+               (unsigned long long)result.order_errors);
+    }
+
+    free(list);
+
+    int submitted = 0;
+    int delivered = run_teardown(num_streams, &submitted);
+    printf("\nPool destroyed with full windows in flight: %d of %d packets delivered in order\n",
+           delivered < 0 ? 0 : delivered, submitted);
+    return misordered == 0 && delivered == submitted ? 0 : 1;
+}
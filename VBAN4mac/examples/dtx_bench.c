@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <vban4mac/stream.h>
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 256           // One mono talkback packet, 187.5 per second
+#define SINE_PERIOD 109             // ~440 Hz at 48 kHz
+#define SPEECH_AMPLITUDE 8192       // -12 dBFS
+#define NOISE_AMPLITUDE 8           // Idle channel noise floor, about -72 dBFS
+#define NOISE_LENGTH 4093           // Prime, so streams don't line up with the sine
+
+// One talkback stream: alternating talk spurts and pauses
+typedef struct {
+    vban_sender_t* sender;
+    vban_receiver_t* receiver;
+    unsigned seed;
+    int talking;
+    long remaining;                 // Packets left in the current spurt or pause
+    uint64_t phase;
+} fleet_stream_t;
+
+typedef struct {
+    uint64_t packets_sent;
+    uint64_t packets_suppressed;
+    uint64_t packets_received;
+    uint64_t lost_packets;
+    uint64_t silent_packets;
+    double cpu_seconds;
+} fleet_result_t;
+
+static int16_t sine_table[SINE_PERIOD];
+static int16_t noise_table[NOISE_LENGTH];
+
+static double cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Spurts of 1-3 s, with pauses sized so the stream talks for activity of the time
+static long next_segment(fleet_stream_t* stream, double activity) {
+    double packets_per_second = (double)SAMPLE_RATE / PACKET_FRAMES;
+    double talk = 1.0 + 2.0 * rand_r(&stream->seed) / RAND_MAX;
+    double seconds = stream->talking ? talk : talk * (1.0 - activity) / activity;
+    return (long)(seconds * packets_per_second) + 1;
+}
+
+static void synth_packet(fleet_stream_t* stream, double activity, int16_t* out) {
+    if (stream->remaining-- <= 0) {
+        stream->talking = !stream->talking;
+        stream->remaining = next_segment(stream, activity);
+    }
+    for (int i = 0; i < PACKET_FRAMES; i++) {
+        int speech = stream->talking ? sine_table[stream->phase % SINE_PERIOD] : 0;
+        out[i] = (int16_t)(speech + noise_table[stream->phase % NOISE_LENGTH]);
+        stream->phase++;
+    }
+}
+
+static int run_fleet(int num_streams, double seconds, double activity, const vban_dtx_config_t* dtx,
+                     uint16_t base_port, fleet_result_t* result) {
+    fleet_stream_t* streams = calloc(num_streams, sizeof(fleet_stream_t));
+    struct pollfd* fds = calloc(num_streams, sizeof(struct pollfd));
+    if (!streams || !fds) {
+        free(streams);
+        free(fds);
+        return -1;
+    }
+
+    int status = 0;
+    char name[16];
+    for (int i = 0; i < num_streams && status == 0; i++) {
+        snprintf(name, sizeof(name), "Talk%d", i);
+
+        vban_receiver_config_t rx_config = {0};
+        rx_config.bind_ip = "127.0.0.1";
+        rx_config.port = (uint16_t)(base_port + i);
+        rx_config.remote_ip = "127.0.0.1";
+        rx_config.stream_name = name;
+        rx_config.channels = 1;
+
+        vban_sender_config_t tx_config = {0};
+        tx_config.remote_ip = "127.0.0.1";
+        tx_config.port = (uint16_t)(base_port + i);
+        tx_config.stream_name = name;
+        tx_config.sample_rate = SAMPLE_RATE;
+        tx_config.channels = 1;
+        tx_config.frames_per_packet = PACKET_FRAMES;
+        if (dtx) tx_config.dtx = *dtx;
+
+        streams[i].receiver = vban_receiver_create(&rx_config);
+        streams[i].sender = vban_sender_create(&tx_config);
+        streams[i].seed = 1234u + (unsigned)i;  // Same talk pattern in every run
+        streams[i].phase = (uint64_t)i * 997;
+        streams[i].talking = rand_r(&streams[i].seed) % 100 < activity * 100;
+        streams[i].remaining = next_segment(&streams[i], activity) * (rand_r(&streams[i].seed) % 100) / 100;
+        if (!streams[i].receiver || !streams[i].sender) {
+            status = -1;
+            break;
+        }
+        fds[i].fd = vban_receiver_fd(streams[i].receiver);
+        fds[i].events = POLLIN;
+    }
+
+    if (status == 0) {
+        int16_t packet[PACKET_FRAMES];
+        int16_t playout[PACKET_FRAMES * 4];
+        long rounds = (long)(seconds * SAMPLE_RATE / PACKET_FRAMES);
+
+        // Every stream produces one packet per round; then, as a listener's
+        // event loop would, only the receivers with datagrams waiting run
+        double cpu_start = cpu_seconds();
+        for (long r = 0; r < rounds && status == 0; r++) {
+            for (int i = 0; i < num_streams; i++) {
+                synth_packet(&streams[i], activity, packet);
+                if (vban_sender_push(streams[i].sender, packet, PACKET_FRAMES) < 0) {
+                    fprintf(stderr, "Send failed\n");
+                    status = -1;
+                    break;
+                }
+            }
+            if (status != 0 || poll(fds, num_streams, 0) <= 0) continue;
+            for (int i = 0; i < num_streams; i++) {
+                if (!(fds[i].revents & POLLIN)) continue;
+                int accepted = vban_receiver_process(streams[i].receiver, 0);
+                if (accepted > 0) result->packets_received += (uint64_t)accepted;
+                size_t frames = vban_receiver_available(streams[i].receiver);
+                if (frames > sizeof(playout) / sizeof(playout[0])) frames = sizeof(playout) / sizeof(playout[0]);
+                vban_receiver_pull(streams[i].receiver, playout, frames);
+            }
+        }
+        result->cpu_seconds = cpu_seconds() - cpu_start;
+
+        for (int i = 0; i < num_streams; i++) {
+            vban_sender_stats_t tx;
+            vban_jitter_stats_t rx;
+            vban_sender_get_stats(streams[i].sender, &tx);
+            vban_receiver_get_jitter_stats(streams[i].receiver, &rx);
+            result->packets_sent += tx.packets_sent;
+            result->packets_suppressed += tx.packets_suppressed;
+            result->lost_packets += rx.lost_packets;
+            result->silent_packets += rx.silent_packets;
+        }
+    }
+
+    for (int i = 0; i < num_streams; i++) {
+        vban_sender_destroy(streams[i].sender);
+        vban_receiver_destroy(streams[i].receiver);
+    }
+    free(streams);
+    free(fds);
+    return status;
+}
+
+static void print_result(const char* label, const fleet_result_t* result, int num_streams, double seconds) {
+    double stream_seconds = num_streams * seconds;
+    printf("%-10s %10llu %10.1f %10llu %8llu %10llu %10.3f %10.2f\n", label,
+           (unsigned long long)result->packets_sent, result->packets_sent / stream_seconds,
+           (unsigned long long)result->packets_received, (unsigned long long)result->lost_packets,
+           (unsigned long long)result->silent_packets, result->cpu_seconds,
+           100.0 * result->cpu_seconds / seconds);
+}
+
+int main(int argc, char* argv[]) {
+    int num_streams = 64;
+    double seconds = 30.0;
+    double activity = 0.1;
+    vban_dtx_config_t dtx = { -50, 0, 0 };
+    uint16_t base_port = 7100;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:d:a:t:g:k:p:")) != -1) {
+        switch (opt) {
+            case 's':
+                num_streams = atoi(optarg);
+                break;
+            case 'd':
+                seconds = atof(optarg);
+                break;
+            case 'a':
+                activity = atof(optarg) / 100.0;
+                break;
+            case 't':
+                dtx.threshold_db = atoi(optarg);
+                break;
+            case 'g':
+                dtx.hangover_ms = atoi(optarg);
+                break;
+            case 'k':
+                dtx.keepalive_ms = atoi(optarg);
+                break;
+            case 'p':
+                base_port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-s streams] [-d seconds] [-a talk_percent] [-t threshold_db]\n"
+                       "       [-g hangover_ms] [-k keepalive_ms] [-p base_port]\n", argv[0]);
+                printf("Simulates a fleet of mono talkback streams over loopback, each talking\n");
+                printf("for talk_percent of the time, and compares packets and CPU time with\n");
+                printf("and without silence suppression. Audio is generated as fast as possible;\n");
+                printf("CPU %% is relative to one core playing the same audio in real time.\n");
+                return 1;
+        }
+    }
+    if (num_streams < 1 || seconds <= 0 || activity <= 0 || activity > 1) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    for (int i = 0; i < SINE_PERIOD; i++) {
+        sine_table[i] = (int16_t)(sin(2.0 * M_PI * i / SINE_PERIOD) * SPEECH_AMPLITUDE);
+    }
+    unsigned seed = 42;
+    for (int i = 0; i < NOISE_LENGTH; i++) {
+        noise_table[i] = (int16_t)(rand_r(&seed) % (2 * NOISE_AMPLITUDE + 1) - NOISE_AMPLITUDE);
+    }
+
+    printf("%d streams, %.0f s of audio each, talking %.0f%% of the time, threshold %d dBFS\n\n",
+           num_streams, seconds, activity * 100, dtx.threshold_db);
+    printf("%-10s %10s %10s %10s %8s %10s %10s %10s\n", "Mode", "Sent", "Pkt/s/str", "Received",
+           "Lost", "Silent", "CPU s", "CPU %");
+
+    fleet_result_t plain = {0}, suppressed = {0};
+    if (run_fleet(num_streams, seconds, activity, NULL, base_port, &plain) != 0 ||
+        run_fleet(num_streams, seconds, activity, &dtx, base_port, &suppressed) != 0) {
+        fprintf(stderr, "Failed to run the fleet\n");
+        return 1;
+    }
+    print_result("always", &plain, num_streams, seconds);
+    print_result("dtx", &suppressed, num_streams, seconds);
+
+    printf("\nPackets saved: %.1f%%, CPU saved: %.1f%%\n",
+           100.0 * (1.0 - (double)suppressed.packets_sent / plain.packets_sent),
+           100.0 * (1.0 - suppressed.cpu_seconds / plain.cpu_seconds));
+
+    // Loopback drops nothing, so every gap must have been read as silence
+    if (suppressed.lost_packets != 0 || suppressed.packets_received != suppressed.packets_sent) {
+        printf("FAILED: gaps were taken as loss\n");
+        return 1;
+    }
+    return 0;
+}
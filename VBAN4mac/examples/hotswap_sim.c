@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include "../src/device_swap.h"
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+#define NET_FRAMES 256              // Network delivery, and capture sending, per 5.3 ms
+#define MAX_PERIOD 1024
+#define AMPLITUDE 0.5
+#define MAX_STEP_RATIO 1.25         // Largest sample step allowed, relative to the signal's own
+#define MAX_PHASE_ERROR 0.02        // Radians between a played frame and the stream frame it should be
+
+// Device hot swap on a simulated clock: two devices with their own periods
+// call back at the times real hardware would, the network keeps filling
+// the playout ring, and a switch is requested partway through. Every frame
+// either device plays must be the right frame of the stream, scaled by a
+// fade gain, with no step larger than the signal's own; the capture side
+// must keep feeding the sender without a gap or a click.
+//
+// The stream is a quadrature pair with a little vibrato: left is
+// A cos(phase(n)), right A sin(phase(n)), so the magnitude of a played
+// frame is its gain and its angle says which stream frame it is.
+
+typedef struct {
+    const char* name;
+    int capture;                    // Switch the input instead of the output
+    int periods[2];                 // Frames per callback of the old and new device
+    int start_ms;                   // From starting the new device to its first callback
+    int unplug;                     // The old device dies instead of being switched away from
+} scenario_t;
+
+typedef struct {
+    int period;
+    long next;                      // Sample clock time of the next callback, -1 when stopped
+    long frames;                    // Frames output or captured so far
+    long played;                    // Stream frames played
+    double previous[CHANNELS];
+    double max_step;
+    double max_gain;
+    double max_phase_error;
+    long silent_callbacks;          // Callbacks while it owned the stream but had nothing to play
+} sim_device_t;
+
+typedef struct {
+    audio_buffer_t ring;           // Playout or capture ring
+    long written;                   // Stream frames into the ring
+    long read;                      // Stream frames out of the ring
+} sim_stream_t;
+
+static double phase_at(long n) {
+    double t = (double)n / SAMPLE_RATE;
+    return 2 * M_PI * 440.0 * t + 3.0 * sin(2 * M_PI * 7.0 * t);
+}
+
+static vban_sample_t to_sample(double v) {
+#ifdef VBAN_SAMPLE_INT16
+    return (vban_sample_t)lrint(v * 32767.0);
+#else
+    return (vban_sample_t)v;
+#endif
+}
+
+static double to_double(vban_sample_t v) {
+#ifdef VBAN_SAMPLE_INT16
+    return v / 32767.0;
+#else
+    return v;
+#endif
+}
+
+static double wrap(double a) {
+    return a - 2 * M_PI * floor((a + M_PI) / (2 * M_PI));
+}
+
+static size_t render_ring(void* user, vban_sample_t* const* out, size_t frames) {
+    sim_stream_t* stream = user;
+    if (audio_buffer_read_planar(&stream->ring, (void* const*)out, CHANNELS, frames) != frames) return 0;
+    stream->read += (long)frames;
+    return frames;
+}
+
+static void push_stream(sim_stream_t* stream, long frames) {
+    vban_sample_t block[NET_FRAMES * CHANNELS];
+    while (frames > 0) {
+        long n = frames < NET_FRAMES ? frames : NET_FRAMES;
+        for (long i = 0; i < n; i++) {
+            double phase = phase_at(stream->written + i);
+            block[i * CHANNELS] = to_sample(AMPLITUDE * cos(phase));
+            block[i * CHANNELS + 1] = to_sample(AMPLITUDE * sin(phase));
+        }
+        audio_buffer_write(&stream->ring, block, (size_t)n * CHANNELS);
+        stream->written += n;
+        frames -= n;
+    }
+}
+
+// Continuity of everything a device outputs, and for stream frames (index
+// >= 0) that they are the right ones at no more than full level
+static void check_frame(sim_device_t* dev, double left, double right, long index) {
+    double v[CHANNELS] = { left, right };
+    if (dev->frames > 0) {
+        for (int c = 0; c < CHANNELS; c++) {
+            double step = fabs(v[c] - dev->previous[c]);
+            if (step > dev->max_step) dev->max_step = step;
+        }
+    }
+    memcpy(dev->previous, v, sizeof(v));
+    dev->frames++;
+
+    if (index < 0) return;
+    double gain = hypot(left, right) / AMPLITUDE;
+    if (gain > dev->max_gain) dev->max_gain = gain;
+    if (gain > 0.05) {
+        double error = fabs(wrap(atan2(right, left) - phase_at(index)));
+        if (error > dev->max_phase_error) dev->max_phase_error = error;
+    }
+}
+
+static int run(const scenario_t* sc, int fade_ms, double seconds) {
+    device_swap_t sw;
+    sim_stream_t stream = {0};
+    if (device_swap_init(&sw, CHANNELS, SAMPLE_RATE, fade_ms, MAX_PERIOD) != 0 ||
+        audio_buffer_create(&stream.ring, (size_t)SAMPLE_RATE * CHANNELS, sizeof(vban_sample_t)) != 0) {
+        fprintf(stderr, "Failed to allocate\n");
+        return 1;
+    }
+
+    sim_device_t devs[2];
+    memset(devs, 0, sizeof(devs));
+    for (int d = 0; d < 2; d++) devs[d].period = sc->periods[d];
+    devs[0].next = 0;
+    devs[1].next = -1;
+
+    long end = (long)(seconds * SAMPLE_RATE);
+    long switch_at = end / 2;
+    long detect = (long)SAMPLE_RATE * 50 / 1000;    // Unplug noticed by the control thread
+    long start_delay = (long)SAMPLE_RATE * sc->start_ms / 1000;
+    long next_net = 0, begun = -1, live = -1, done = -1;
+
+    // Output: 20 ms of playout buffer to start with. Capture: the sender
+    // takes a packet once one has been captured.
+    if (!sc->capture) push_stream(&stream, SAMPLE_RATE / 50);
+
+    // Stream frames the new device will take from the tee: the old
+    // device's, in the order it played them
+    long tee_next = -1;
+    long junction = -1;             // First captured frame from the new device
+    long capture_underruns = 0;
+    sim_device_t sent = {0};
+
+    vban_sample_t left[MAX_PERIOD], right[MAX_PERIOD];
+    vban_sample_t* const out[CHANNELS] = { left, right };
+    vban_sample_t in[MAX_PERIOD * CHANNELS];
+    vban_sample_t packet[NET_FRAMES * CHANNELS];
+
+    for (;;) {
+        // Next event on the sample clock
+        long now = next_net;
+        int who = -1;
+        for (int d = 0; d < 2; d++) {
+            if (devs[d].next >= 0 && devs[d].next < now) {
+                now = devs[d].next;
+                who = d;
+            }
+        }
+        long control = begun < 0 ? switch_at + (sc->unplug ? detect : 0) : -1;
+        if (control >= 0 && control <= now) {
+            now = control;
+            who = 2;
+        }
+        if (now >= end) break;
+
+        if (who == 2) {
+            // Control thread: bring up the new device, then hand over (or,
+            // with the old device gone, cut over to it)
+            int slot = device_swap_begin(&sw);
+            devs[slot].next = now + start_delay;
+            if (sc->unplug) device_swap_cut(&sw);
+            begun = now;
+            continue;
+        }
+
+        if (who < 0) {
+            // Network delivers a packet, or the sender takes one
+            if (!sc->capture) {
+                push_stream(&stream, NET_FRAMES);
+            } else if (audio_buffer_read(&stream.ring, packet, NET_FRAMES * CHANNELS) == NET_FRAMES * CHANNELS) {
+                for (int i = 0; i < NET_FRAMES; i++) {
+                    check_frame(&sent, to_double(packet[i * CHANNELS]), to_double(packet[i * CHANNELS + 1]), -1);
+                    // An unplugged microphone stops dead; what matters is
+                    // that the new one comes in without a click
+                    if (sc->unplug && (junction < 0 || stream.read <= junction)) sent.max_step = 0;
+                    stream.read++;
+                }
+            } else if (stream.written > 0) {
+                // Nothing to send: the receiving end hears silence
+                for (int i = 0; i < NET_FRAMES; i++) check_frame(&sent, 0.0, 0.0, -1);
+                capture_underruns++;
+            }
+            next_net += NET_FRAMES;
+            continue;
+        }
+
+        sim_device_t* dev = &devs[who];
+        dev->next += dev->period;
+        if (sc->unplug && who == 0 && now >= switch_at) {
+            dev->next = -1;          // Unplugged
+            continue;
+        }
+
+        int state = atomic_load(&sw.state);
+        int owner = device_swap_active(&sw);
+        if (live < 0 && begun >= 0 && who == 1) {
+            live = now;
+            junction = stream.written;
+        }
+
+        if (sc->capture) {
+            // Both devices hear the same source, at the time they capture it
+            for (int i = 0; i < dev->period; i++) {
+                double phase = phase_at(now + i);
+                in[i * CHANNELS] = to_sample(AMPLITUDE * cos(phase));
+                in[i * CHANNELS + 1] = to_sample(AMPLITUDE * sin(phase));
+            }
+            size_t before = audio_buffer_available(&stream.ring);
+            device_swap_capture(&sw, who, in, (size_t)dev->period, &stream.ring);
+            stream.written += (long)(audio_buffer_available(&stream.ring) - before) / CHANNELS;
+            dev->frames += dev->period;
+        } else {
+            long read = stream.read;
+            size_t played = device_swap_render(&sw, who, out, (size_t)dev->period, render_ring, &stream);
+            long from_ring = stream.read - read;
+            long from_tee = (long)played - from_ring;
+
+            // The old device tees everything it plays while fading
+            if (who == owner && state == DEVICE_SWAP_FADING && tee_next < 0) tee_next = read;
+            if (from_tee > 0 && tee_next < 0) tee_next = read;
+
+            for (int i = 0; i < dev->period; i++) {
+                long index = -1;
+                if (i < from_tee) {
+                    index = tee_next++;
+                } else if (i < (long)played) {
+                    index = read + (i - from_tee);
+                }
+                check_frame(dev, to_double(left[i]), to_double(right[i]), index);
+            }
+            dev->played += (long)played;
+            if (who == device_swap_active(&sw) && played < (size_t)dev->period && now > 0) dev->silent_callbacks++;
+        }
+
+        if (done < 0 && begun >= 0 && !device_swap_busy(&sw)) done = now;
+    }
+
+    double signal_step = 0;
+    for (long n = 1; n < SAMPLE_RATE / 10; n++) {
+        double step = fabs(AMPLITUDE * (cos(phase_at(n)) - cos(phase_at(n - 1))));
+        if (step > signal_step) signal_step = step;
+        step = fabs(AMPLITUDE * (sin(phase_at(n)) - sin(phase_at(n - 1))));
+        if (step > signal_step) signal_step = step;
+    }
+
+    printf("%s\n", sc->name);
+    int failed = 0;
+    if (done < 0) {
+        printf("  FAILED: the handover didn't finish\n");
+        failed = 1;
+    } else {
+        printf("  handover done %.1f ms after the switch began, %.1f ms after the new device came up\n",
+               (done - begun) * 1000.0 / SAMPLE_RATE, live < 0 ? 0 : (done - live) * 1000.0 / SAMPLE_RATE);
+    }
+
+    if (sc->capture) {
+        printf("  sent stream: largest step %.4f (signal's own %.4f), %ld packets short\n", sent.max_step, signal_step,
+               capture_underruns);
+        if (sent.max_step > signal_step * M_SQRT2 * MAX_STEP_RATIO) {
+            printf("  FAILED: discontinuity in the sent stream\n");
+            failed = 1;
+        }
+        long outage = sc->unplug ? (live - switch_at) / NET_FRAMES + 1 : 0;
+        if (capture_underruns > outage + 2) {
+            printf("  FAILED: gap in the sent stream\n");
+            failed = 1;
+        }
+    } else {
+        for (int d = 0; d < 2; d++) {
+            const sim_device_t* dev = &devs[d];
+            printf("  %s device (%d-frame period): %ld stream frames, largest step %.4f (signal's own %.4f), "
+                   "phase error %.4f, peak gain %.3f\n", d == 0 ? "old" : "new", dev->period, dev->played,
+                   dev->max_step, signal_step, dev->max_phase_error, dev->max_gain);
+            if (dev->max_step > signal_step * MAX_STEP_RATIO) {
+                printf("  FAILED: discontinuity on the %s device\n", d == 0 ? "old" : "new");
+                failed = 1;
+            }
+            if (dev->max_phase_error > MAX_PHASE_ERROR || dev->max_gain > 1.01) {
+                printf("  FAILED: the %s device played the wrong frames\n", d == 0 ? "old" : "new");
+                failed = 1;
+            }
+        }
+        if (devs[1].silent_callbacks > 0) {
+            printf("  FAILED: the new device ran dry %ld times\n", devs[1].silent_callbacks);
+            failed = 1;
+        }
+        // Nothing lost: the new device carries on to the end of the stream
+        long behind = stream.written - stream.read;
+        printf("  %ld frames buffered at the end\n", behind);
+        if (!sc->unplug && behind > SAMPLE_RATE / 50 + NET_FRAMES + MAX_PERIOD) {
+            printf("  FAILED: the handover added latency\n");
+            failed = 1;
+        }
+    }
+
+    device_swap_destroy(&sw);
+    audio_buffer_destroy(&stream.ring);
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    int fade_ms = 10;
+    double seconds = 2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:s:")) != -1) {
+        switch (opt) {
+            case 'f':
+                fade_ms = atoi(optarg);
+                break;
+            case 's':
+                seconds = atof(optarg);
+                break;
+            default:
+                printf("Usage: %s [-f fade_ms] [-s seconds]\n", argv[0]);
+                printf("Switches audio devices mid-stream on a simulated clock, for output and\n");
+                printf("capture and after an unplug, and checks that no frame is lost, repeated\n");
+                printf("or clicks on either device.\n");
+                return 1;
+        }
+    }
+
+    const scenario_t scenarios[] = {
+        { "Output to a device with a longer period", 0, { 256, 480 }, 40, 0 },
+        { "Output to a device with a shorter period", 0, { 512, 128 }, 15, 0 },
+        { "Output after the device is unplugged", 0, { 256, 256 }, 40, 1 },
+        { "Capture to another device", 1, { 256, 480 }, 40, 0 },
+        { "Capture after the device is unplugged", 1, { 480, 256 }, 40, 1 },
+    };
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        failed |= run(&scenarios[i], fade_ms, seconds);
+    }
+    return failed;
+}
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <vban4mac/stream.h>
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 256           // 5.3 ms per packet
+#define DRAIN_MS 400                // Longer than any profile's delay, to collect what is held
+#define MAX_PACKETS 65536
+
+typedef struct {
+    const char* name;
+    vban_impair_config_t config;
+    int timing_dependent;           // Rate-limit drops follow arrival times, not just the seed
+} profile_t;
+
+typedef struct {
+    uint32_t frames[MAX_PACKETS];   // nuFrame of each delivered packet, in delivery order
+    size_t count;
+    int sent;
+    vban_impair_stats_t impair;
+    vban_jitter_stats_t jitter;
+} run_t;
+
+static void record_packet(void* user, const vban_header_t* header, size_t frames) {
+    (void)frames;
+    run_t* run = (run_t*)user;
+    if (run->count < MAX_PACKETS) run->frames[run->count++] = header->nuFrame;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Stream in real time through a receiver with the profile's impairment
+static int run_profile(const profile_t* profile, unsigned seed, double seconds, uint16_t port, run_t* run) {
+    memset(run, 0, sizeof(*run));
+
+    vban_receiver_config_t rx_config = {0};
+    rx_config.bind_ip = "127.0.0.1";
+    rx_config.port = port;
+    rx_config.remote_ip = "127.0.0.1";
+    rx_config.stream_name = "Impair";
+    rx_config.channels = 1;
+    rx_config.on_packet = record_packet;
+    rx_config.user = run;
+    rx_config.impair = profile->config;
+    rx_config.impair.seed = seed;
+
+    vban_sender_config_t tx_config = {0};
+    tx_config.remote_ip = "127.0.0.1";
+    tx_config.port = port;
+    tx_config.stream_name = "Impair";
+    tx_config.sample_rate = SAMPLE_RATE;
+    tx_config.channels = 1;
+    tx_config.frames_per_packet = PACKET_FRAMES;
+
+    vban_receiver_t* receiver = vban_receiver_create(&rx_config);
+    vban_sender_t* sender = vban_sender_create(&tx_config);
+    if (!receiver || !sender) {
+        fprintf(stderr, "Failed to create sender/receiver\n");
+        vban_receiver_destroy(receiver);
+        vban_sender_destroy(sender);
+        return -1;
+    }
+
+    int16_t block[PACKET_FRAMES];
+    int16_t out[4096];
+    int packets = (int)(seconds * SAMPLE_RATE / PACKET_FRAMES);
+    double interval_ms = 1000.0 * PACKET_FRAMES / SAMPLE_RATE;
+    double start = now_ms();
+
+    for (int p = 0; p < packets; p++) {
+        for (int i = 0; i < PACKET_FRAMES; i++) {
+            block[i] = (int16_t)(8000.0 * sin(2.0 * M_PI * 440.0 * (p * PACKET_FRAMES + i) / SAMPLE_RATE));
+        }
+        if (vban_sender_push(sender, block, PACKET_FRAMES) > 0) run->sent++;
+
+        // Receive until the next packet is due
+        double next = start + (p + 1) * interval_ms;
+        double wait;
+        while ((wait = next - now_ms()) > 0) {
+            vban_receiver_process(receiver, (int)ceil(wait));
+            while (vban_receiver_pull(receiver, out, 4096) > 0) {}
+        }
+    }
+
+    // Collect what the simulated link still holds
+    double end = now_ms() + DRAIN_MS;
+    double wait;
+    while ((wait = end - now_ms()) > 0) {
+        vban_receiver_process(receiver, (int)ceil(wait));
+        while (vban_receiver_pull(receiver, out, 4096) > 0) {}
+    }
+
+    vban_receiver_get_impair_stats(receiver, &run->impair);
+    vban_receiver_get_jitter_stats(receiver, &run->jitter);
+    vban_sender_destroy(sender);
+    vban_receiver_destroy(receiver);
+    return 0;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Delivered packets that came after a later one, and the longest run of
+// packets never delivered (nuFrame counts packets)
+static void summarize(const run_t* run, size_t* late, size_t* longest_gap) {
+    *late = 0;
+    *longest_gap = 0;
+    uint32_t newest = 0;
+    for (size_t i = 0; i < run->count; i++) {
+        if (i > 0 && run->frames[i] < newest) (*late)++;
+        if (run->frames[i] > newest) newest = run->frames[i];
+    }
+    if (run->count == 0) {
+        *longest_gap = (size_t)run->sent;
+        return;
+    }
+
+    uint32_t* sorted = malloc(run->count * sizeof(uint32_t));
+    if (!sorted) return;
+    memcpy(sorted, run->frames, run->count * sizeof(uint32_t));
+    qsort(sorted, run->count, sizeof(uint32_t), compare_u32);
+    uint32_t expected = 0;
+    for (size_t i = 0; i < run->count; i++) {
+        if (sorted[i] > expected && sorted[i] - expected > *longest_gap) *longest_gap = sorted[i] - expected;
+        if (sorted[i] >= expected) expected = sorted[i] + 1;
+    }
+    if ((size_t)run->sent > expected && (size_t)run->sent - expected > *longest_gap) {
+        *longest_gap = (size_t)run->sent - expected;
+    }
+    free(sorted);
+}
+
+// Same fate for every packet: the seeded decisions, and which packets were
+// delivered how often (only the counts for links whose drops depend on
+// timing). Delivery order can differ where two packets' simulated arrivals
+// are closer than the sender's own timing varies between runs.
+static int same_run(const run_t* a, const run_t* b, int timing_dependent) {
+    if (a->impair.lost_random != b->impair.lost_random || a->impair.lost_burst != b->impair.lost_burst ||
+        a->impair.reordered != b->impair.reordered || a->impair.duplicated != b->impair.duplicated) {
+        return 0;
+    }
+    if (timing_dependent) return 1;
+    if (a->count != b->count) return 0;
+
+    uint32_t* sorted = malloc(2 * a->count * sizeof(uint32_t) + 1);
+    if (!sorted) return 0;
+    memcpy(sorted, a->frames, a->count * sizeof(uint32_t));
+    memcpy(sorted + a->count, b->frames, b->count * sizeof(uint32_t));
+    qsort(sorted, a->count, sizeof(uint32_t), compare_u32);
+    qsort(sorted + a->count, b->count, sizeof(uint32_t), compare_u32);
+    int same = memcmp(sorted, sorted + a->count, a->count * sizeof(uint32_t)) == 0;
+    free(sorted);
+    return same;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 1.0;
+    unsigned seed = 1;
+    uint16_t port = 6996;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:p:")) != -1) {
+        switch (opt) {
+            case 's':
+                seconds = atof(optarg);
+                break;
+            case 'r':
+                seed = (unsigned)atoi(optarg);
+                break;
+            case 'p':
+                port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-s seconds] [-r seed] [-p port]\n", argv[0]);
+                printf("Streams over loopback through the receiver's simulated network impairment,\n");
+                printf("once per profile and twice with the same seed, and checks both runs match.\n");
+                return 1;
+        }
+    }
+    if (seconds <= 0 || seconds * SAMPLE_RATE / PACKET_FRAMES > MAX_PACKETS / 2) {
+        fprintf(stderr, "Invalid duration\n");
+        return 1;
+    }
+
+    profile_t profiles[] = {
+        { "Clean", { 0 }, 0 },
+        { "2% random loss", { .loss_pct = 2.0 }, 0 },
+        { "Loss bursts", { .burst_enter_pct = 1.0, .burst_exit_pct = 25.0 }, 0 },
+        { "20 ms +- 8 ms normal", { .delay_ms = 20, .jitter_ms = 8, .jitter_dist = VBAN_JITTER_NORMAL }, 0 },
+        { "10 ms + 5 ms Pareto", { .delay_ms = 10, .jitter_ms = 5, .jitter_dist = VBAN_JITTER_PARETO }, 0 },
+        { "5% reorder, 2% dup", { .reorder_pct = 5.0, .duplicate_pct = 2.0 }, 0 },
+        { "640 kbit/s link", { .rate_kbps = 640 }, 1 },
+    };
+    int num_profiles = (int)(sizeof(profiles) / sizeof(profiles[0]));
+
+    run_t* first = malloc(sizeof(run_t));
+    run_t* second = malloc(sizeof(run_t));
+    if (!first || !second) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("%.1f s per run, seed %u\n\n", seconds, seed);
+    printf("%-22s %6s %9s %17s %5s %5s %4s %8s %7s %7s\n", "Profile", "Sent", "Delivered",
+           "Lost rnd/bst/que", "Dup", "Late", "Gap", "Jitter", "Target", "Repeat");
+    int failures = 0;
+    for (int i = 0; i < num_profiles; i++) {
+        if (run_profile(&profiles[i], seed, seconds, port, first) != 0 ||
+            run_profile(&profiles[i], seed, seconds, port, second) != 0) {
+            return 1;
+        }
+        size_t late, gap;
+        summarize(first, &late, &gap);
+        int same = same_run(first, second, profiles[i].timing_dependent);
+        if (!same) failures++;
+
+        char lost[32];
+        snprintf(lost, sizeof(lost), "%llu/%llu/%llu", (unsigned long long)first->impair.lost_random,
+                 (unsigned long long)first->impair.lost_burst, (unsigned long long)first->impair.lost_queue);
+        printf("%-22s %6d %9zu %17s %5llu %5zu %4zu %6.2fms %7u %7s\n", profiles[i].name, first->sent,
+               first->count, lost, (unsigned long long)first->impair.duplicated, late, gap,
+               first->jitter.jitter_ms, first->jitter.target_frames, same ? "yes" : "NO");
+    }
+
+    free(first);
+    free(second);
+    return failures == 0 ? 0 : 1;
+}
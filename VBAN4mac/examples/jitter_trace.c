@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vban4mac/types.h>
+#include "../src/jitter.h"
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 240           // 5 ms, so send times are whole nanoseconds
+#define INTERVAL_NS 5000000LL
+#define TRACE_PACKETS 400
+#define STEP_AT 380                 // Packet where the step trace's delay jumps
+#define STEP_NS 10000000LL          // 10 ms
+#define TOLERANCE_MS 1e-9
+
+// Arrival time of each packet of a trace, in ns since the first was sent
+typedef int64_t trace_t[TRACE_PACKETS];
+
+static void trace_constant(trace_t arrival) {
+    for (int i = 0; i < TRACE_PACKETS; i++) {
+        arrival[i] = i * INTERVAL_NS + 3000000;
+    }
+}
+
+// Transit times drawn from a fixed generator, between 1 and 9 ms, so
+// packets never overtake each other
+static void trace_random(trace_t arrival) {
+    uint32_t state = 12345;
+    for (int i = 0; i < TRACE_PACKETS; i++) {
+        state = state * 1664525u + 1013904223u;
+        arrival[i] = i * INTERVAL_NS + 1000000 + (int64_t)(state >> 8) % 8000000;
+    }
+}
+
+// 2 ms transit that rises to 12 ms at STEP_AT and stays there
+static void trace_step(trace_t arrival) {
+    for (int i = 0; i < TRACE_PACKETS; i++) {
+        arrival[i] = i * INTERVAL_NS + 2000000 + (i >= STEP_AT ? STEP_NS : 0);
+    }
+}
+
+// Interarrival jitter as RFC 3550 appendix A.8 computes it, in ms
+static double rfc3550_jitter_ms(const trace_t arrival) {
+    double jitter = 0;
+    int64_t last_transit = arrival[0];
+    for (int i = 1; i < TRACE_PACKETS; i++) {
+        int64_t transit = arrival[i] - i * INTERVAL_NS;
+        int64_t d = transit - last_transit;
+        last_transit = transit;
+        if (d < 0) d = -d;
+        jitter += (1.0 / 16.0) * ((double)d - jitter);
+    }
+    return jitter / 1e6;
+}
+
+static void run_trace(const trace_t arrival, vban_jitter_stats_t* stats) {
+    jitter_estimator_t jitter;
+    jitter_init(&jitter);
+    for (int i = 0; i < TRACE_PACKETS; i++) {
+        jitter_update(&jitter, arrival[i], (uint32_t)i, PACKET_FRAMES, SAMPLE_RATE, 0);
+    }
+    jitter_get_stats(&jitter, stats);
+}
+
+// Report one expected value against what the estimator published
+static int expect(const char* trace, const char* what, double got, double want, double tolerance) {
+    int ok = fabs(got - want) <= tolerance;
+    printf("  %-10s %-14s %14.9f %14.9f  %s\n", trace, what, got, want, ok ? "ok" : "WRONG");
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    static trace_t arrival;
+    vban_jitter_stats_t stats;
+    int failures = 0;
+    const double interval_ms = INTERVAL_NS / 1e6;
+
+    printf("%d packets of %d frames at %d Hz per trace\n\n", TRACE_PACKETS, PACKET_FRAMES, SAMPLE_RATE);
+    printf("  %-10s %-14s %14s %14s\n", "Trace", "Statistic", "Estimator", "Expected");
+
+    // Constant transit: no jitter, and a playout target of two packets
+    trace_constant(arrival);
+    run_trace(arrival, &stats);
+    failures += expect("constant", "jitter ms", stats.jitter_ms, 0, TOLERANCE_MS);
+    failures += expect("constant", "max gap ms", stats.max_gap_ms, interval_ms, TOLERANCE_MS);
+    failures += expect("constant", "target frames", stats.target_frames, 2 * PACKET_FRAMES, 0);
+    failures += expect("constant", "bursts", stats.bursts, 0, 0);
+    failures += expect("constant", "lost", (double)stats.lost_packets, 0, 0);
+
+    // Random transit: the same J as the RFC's own code
+    trace_random(arrival);
+    run_trace(arrival, &stats);
+    failures += expect("rfc3550", "jitter ms", stats.jitter_ms, rfc3550_jitter_ms(arrival), TOLERANCE_MS);
+    failures += expect("rfc3550", "packets", (double)stats.packets, TRACE_PACKETS, 0);
+
+    // One 10 ms step: J jumps by a 16th of it, then decays by 15/16 a
+    // packet. The gap at the step is the longest, and the target covers
+    // it as it decays by 0.999 a packet.
+    trace_step(arrival);
+    run_trace(arrival, &stats);
+    int after_step = TRACE_PACKETS - 1 - STEP_AT;
+    double step_jitter_ms = STEP_NS / 1e6 / 16.0 * pow(15.0 / 16.0, after_step);
+    double step_gap_ms = interval_ms + STEP_NS / 1e6;
+    double step_target = ceil((step_gap_ms * pow(0.999, after_step) + interval_ms) * SAMPLE_RATE / 1e3);
+    failures += expect("step", "jitter ms", stats.jitter_ms, step_jitter_ms, TOLERANCE_MS);
+    failures += expect("step", "max gap ms", stats.max_gap_ms, step_gap_ms, TOLERANCE_MS);
+    failures += expect("step", "target frames", stats.target_frames, step_target, 1);
+    failures += expect("step", "bursts", stats.bursts, 0, 0);
+    failures += expect("step", "lost", (double)stats.lost_packets, 0, 0);
+
+    // The step trace also matches the RFC's own code
+    failures += expect("step", "rfc3550 ms", stats.jitter_ms, rfc3550_jitter_ms(arrival), TOLERANCE_MS);
+
+    printf("\n%s\n", failures == 0 ? "All traces match" : "Estimator output differs from the expected values");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <vban4mac/stream.h>
+#include "../src/event_loop.h"
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 256
+#define PACKET_INTERVAL_US (PACKET_FRAMES * 1000000LL / SAMPLE_RATE)
+
+typedef struct {
+    vban_sender_t* sender;
+    vban_receiver_t* receiver;
+    pthread_t rx_thread;
+    pthread_t tx_thread;
+    event_source_t* rx_source;
+    event_source_t* tx_source;
+    event_loop_t* loop;
+    uint64_t packets;
+} bench_stream_t;
+
+static int16_t silence[PACKET_FRAMES * 2];
+static atomic_int running;
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void drain(bench_stream_t* stream, int timeout_ms) {
+    int16_t out[PACKET_FRAMES * 2 * 4];
+    int packets = vban_receiver_process(stream->receiver, timeout_ms);
+    if (packets > 0) stream->packets += packets;
+    size_t available = vban_receiver_available(stream->receiver);
+    while (available > 0) {
+        size_t frames = available < PACKET_FRAMES * 4 ? available : PACKET_FRAMES * 4;
+        vban_receiver_pull(stream->receiver, out, frames);
+        available -= frames;
+    }
+}
+
+// Thread-per-stream model: a blocking receive thread and a polling send thread
+static void* rx_thread(void* arg) {
+    bench_stream_t* stream = (bench_stream_t*)arg;
+    while (atomic_load(&running)) {
+        drain(stream, 100);
+    }
+    return NULL;
+}
+
+static void* tx_thread(void* arg) {
+    bench_stream_t* stream = (bench_stream_t*)arg;
+    int64_t next = now_us();
+    while (atomic_load(&running)) {
+        if (now_us() >= next) {
+            vban_sender_push(stream->sender, silence, PACKET_FRAMES);
+            next += PACKET_INTERVAL_US;
+        } else {
+            usleep(1000);
+        }
+    }
+    return NULL;
+}
+
+// Event loop model: readiness and timer callbacks on a few shared threads
+static void on_readable(void* arg) {
+    drain((bench_stream_t*)arg, 0);
+}
+
+static void on_send(void* arg) {
+    bench_stream_t* stream = (bench_stream_t*)arg;
+    vban_sender_push(stream->sender, silence, PACKET_FRAMES);
+}
+
+typedef struct {
+    double cpu_seconds;
+    long context_switches;
+    uint64_t packets;
+} bench_result_t;
+
+static int run(int num_streams, int loop_threads, int seconds, uint16_t base_port, bench_result_t* result) {
+    bench_stream_t* streams = calloc(num_streams, sizeof(bench_stream_t));
+    event_loop_t* loops[16] = {0};
+    if (!streams) return -1;
+
+    for (int i = 0; i < num_streams; i++) {
+        vban_receiver_config_t rx_config = {0};
+        rx_config.bind_ip = "127.0.0.1";
+        rx_config.port = (uint16_t)(base_port + i);
+        rx_config.stream_name = "Bench";
+        rx_config.channels = 2;
+
+        vban_sender_config_t tx_config = {0};
+        tx_config.remote_ip = "127.0.0.1";
+        tx_config.port = rx_config.port;
+        tx_config.stream_name = "Bench";
+        tx_config.sample_rate = SAMPLE_RATE;
+        tx_config.channels = 2;
+        tx_config.frames_per_packet = PACKET_FRAMES;
+
+        streams[i].receiver = vban_receiver_create(&rx_config);
+        streams[i].sender = vban_sender_create(&tx_config);
+        if (!streams[i].receiver || !streams[i].sender) {
+            fprintf(stderr, "Failed to create stream %d\n", i);
+            return -1;
+        }
+    }
+
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    atomic_store(&running, 1);
+
+    if (loop_threads == 0) {
+        for (int i = 0; i < num_streams; i++) {
+            pthread_create(&streams[i].rx_thread, NULL, rx_thread, &streams[i]);
+            pthread_create(&streams[i].tx_thread, NULL, tx_thread, &streams[i]);
+        }
+    } else {
+        for (int l = 0; l < loop_threads; l++) loops[l] = event_loop_create();
+        for (int i = 0; i < num_streams; i++) {
+            streams[i].loop = loops[i % loop_threads];
+            streams[i].rx_source = event_loop_add_fd(streams[i].loop, vban_receiver_fd(streams[i].receiver),
+                                                     on_readable, &streams[i]);
+            streams[i].tx_source = event_loop_add_timer(streams[i].loop, PACKET_INTERVAL_US, on_send, &streams[i]);
+        }
+    }
+
+    sleep(seconds);
+    atomic_store(&running, 0);
+
+    if (loop_threads == 0) {
+        for (int i = 0; i < num_streams; i++) {
+            pthread_join(streams[i].rx_thread, NULL);
+            pthread_join(streams[i].tx_thread, NULL);
+        }
+    } else {
+        for (int i = 0; i < num_streams; i++) {
+            event_loop_remove(streams[i].loop, streams[i].rx_source);
+            event_loop_remove(streams[i].loop, streams[i].tx_source);
+        }
+        for (int l = 0; l < loop_threads; l++) event_loop_destroy(loops[l]);
+    }
+
+    getrusage(RUSAGE_SELF, &after);
+    result->cpu_seconds = (after.ru_utime.tv_sec - before.ru_utime.tv_sec) +
+                          (after.ru_utime.tv_usec - before.ru_utime.tv_usec) / 1e6 +
+                          (after.ru_stime.tv_sec - before.ru_stime.tv_sec) +
+                          (after.ru_stime.tv_usec - before.ru_stime.tv_usec) / 1e6;
+    result->context_switches = (after.ru_nvcsw - before.ru_nvcsw) + (after.ru_nivcsw - before.ru_nivcsw);
+    result->packets = 0;
+
+    for (int i = 0; i < num_streams; i++) {
+        result->packets += streams[i].packets;
+        vban_sender_destroy(streams[i].sender);
+        vban_receiver_destroy(streams[i].receiver);
+    }
+    free(streams);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int seconds = 3;
+    int loop_threads = 1;
+    uint16_t base_port = 7000;
+    const char* counts = "10,100,500";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:t:p:s:")) != -1) {
+        switch (opt) {
+            case 'd':
+                seconds = atoi(optarg);
+                break;
+            case 't':
+                loop_threads = atoi(optarg);
+                break;
+            case 'p':
+                base_port = (uint16_t)atoi(optarg);
+                break;
+            case 's':
+                counts = optarg;
+                break;
+            default:
+                printf("Usage: %s [-d seconds] [-t loop_threads] [-p base_port] [-s stream_counts]\n", argv[0]);
+                printf("Runs real-time stereo streams over loopback, first with a receive and a\n");
+                printf("send thread per stream, then on event loop threads, and compares CPU\n");
+                printf("time and context switches. Stream counts default to 10,100,500.\n");
+                return 1;
+        }
+    }
+    if (loop_threads < 1 || loop_threads > 16) {
+        fprintf(stderr, "Loop threads must be 1-16\n");
+        return 1;
+    }
+
+    // Two sockets per stream
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    printf("%-8s %-18s %10s %14s %12s\n", "Streams", "Model", "CPU %", "Switches/s", "Packets/s");
+
+    char* list = strdup(counts);
+    char* saveptr = NULL;
+    for (char* item = strtok_r(list, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        int num_streams = atoi(item);
+        for (int model = 0; model < 2; model++) {
+            bench_result_t result;
+            int threads = model == 0 ? 0 : loop_threads;
+            if (num_streams < 1 || run(num_streams, threads, seconds, base_port, &result) != 0) {
+                free(list);
+                return 1;
+            }
+
+            char name[32];
+            if (threads == 0) {
+                snprintf(name, sizeof(name), "%d threads", num_streams * 2);
+            } else {
+                snprintf(name, sizeof(name), "%d event loop%s", threads, threads > 1 ? "s" : "");
+            }
+            printf("%-8d %-18s %10.1f %14.0f %12.0f\n", num_streams, name,
+                   100.0 * result.cpu_seconds / seconds, (double)result.context_switches / seconds,
+                   (double)result.packets / seconds);
+        }
+    }
+
+    free(list);
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/utsname.h>
+#include <vban4mac/stream.h>
+#include "../src/buffer.h"
+#include "../src/packet.h"
+
+#define PACKET_FRAMES 256
+#define CHANNELS 2
+#define PACKET_SAMPLES (PACKET_FRAMES * CHANNELS)
+#define PACKET_BYTES (PACKET_SAMPLES * sizeof(int16_t))
+#define MIN_RUN_NS 50000000LL       // Calibrate each case to at least 50 ms
+#define REPEATS 5                   // Report the best of this many runs
+#define SINK_PORT 6999              // Nothing listens here; sends still go through the stack
+
+typedef struct {
+    const char* name;
+    const char* description;
+    size_t bytes_per_op;
+    void (*run)(size_t iterations);
+} bench_case_t;
+
+typedef struct {
+    size_t iterations;
+    double ns_per_op;
+    double bytes_per_second;
+} bench_result_t;
+
+static volatile uint64_t sink;      // Keeps results observable to the optimizer
+static vban_header_t packet_header;
+static uint8_t datagram[VBAN_HEADER_SIZE + PACKET_BYTES];
+static int16_t samples_in[PACKET_SAMPLES];
+static int16_t samples_out[PACKET_SAMPLES];
+static int16_t planar_left[PACKET_FRAMES];
+static int16_t planar_right[PACKET_FRAMES];
+static audio_buffer_t ring;
+static vban_sender_t* sender;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline int16_t le16_to_host(int16_t v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return (int16_t)__builtin_bswap16((uint16_t)v);
+#else
+    return v;
+#endif
+}
+
+// Full header construction per packet, for comparison with patching a template
+static void bench_header_build(size_t iterations) {
+    vban_header_t header;
+    for (size_t i = 0; i < iterations; i++) {
+        vban_header_init(&header, "Stream1", 3, PACKET_FRAMES, CHANNELS, VBAN_DATATYPE_INT16);
+        vban_header_set_frame(&header, (uint32_t)i);
+        sink += header.format_nbs + header.nuFrame;
+    }
+}
+
+// Only the frame counter patched into a prebuilt header
+static void bench_header_patch(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        vban_header_set_frame(&packet_header, (uint32_t)i);
+        sink += packet_header.nuFrame;
+    }
+}
+
+// The checks every receive path runs on an incoming datagram
+static void bench_header_parse(size_t iterations) {
+    const vban_header_t* header = (const vban_header_t*)datagram;
+    for (size_t i = 0; i < iterations; i++) {
+        ssize_t samples = vban_header_check_audio(header, sizeof(datagram));
+        int match = strncmp(header->streamname, "Stream1", sizeof(header->streamname)) == 0;
+        sink += (uint64_t)samples + match + vban_header_frame(header) +
+                (uint64_t)vban_sample_rate_from_index(header->format_SR);
+    }
+}
+
+// Little-endian wire samples to host order (a copy on little-endian hosts)
+static void bench_convert_le(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t s = 0; s < PACKET_SAMPLES; s++) {
+            samples_out[s] = le16_to_host(samples_in[s]);
+        }
+        sink += (uint16_t)samples_out[i % PACKET_SAMPLES];
+    }
+}
+
+// Unconditional 16-bit byteswap, the conversion cost on big-endian hosts
+static void bench_byteswap(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        for (size_t s = 0; s < PACKET_SAMPLES; s++) {
+            samples_out[s] = (int16_t)__builtin_bswap16((uint16_t)samples_in[s]);
+        }
+        sink += (uint16_t)samples_out[i % PACKET_SAMPLES];
+    }
+}
+
+// Decode into the ring in place (reserve, convert, commit), as the receive
+// paths and audio_process_input do, then consume it as the render callback does
+static void bench_ring_decode(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        audio_buffer_span_t span;
+        size_t total = audio_buffer_reserve(&ring, PACKET_SAMPLES, &span);
+        int16_t* first = (int16_t*)span.ptr[0];
+        int16_t* second = (int16_t*)span.ptr[1];
+        for (size_t s = 0; s < span.len[0]; s++) first[s] = le16_to_host(samples_in[s]);
+        for (size_t s = 0; s < span.len[1]; s++) second[s] = le16_to_host(samples_in[span.len[0] + s]);
+        audio_buffer_commit(&ring, total);
+        sink += audio_buffer_read(&ring, samples_out, PACKET_SAMPLES);
+    }
+}
+
+// Copying add (audio_buffer_add) followed by an interleaved read
+static void bench_ring_write_read(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        audio_buffer_write(&ring, samples_in, PACKET_SAMPLES);
+        sink += audio_buffer_read(&ring, samples_out, PACKET_SAMPLES);
+    }
+}
+
+// Copying add followed by the render callback's deinterleaving dequeue
+static void bench_ring_write_planar(size_t iterations) {
+    void* const planes[CHANNELS] = { planar_left, planar_right };
+    for (size_t i = 0; i < iterations; i++) {
+        audio_buffer_write(&ring, samples_in, PACKET_SAMPLES);
+        sink += audio_buffer_read_planar(&ring, planes, CHANNELS, PACKET_FRAMES);
+    }
+}
+
+// One packet through vban_sender_push, including the sendmsg syscall
+static void bench_packetize(size_t iterations) {
+    for (size_t i = 0; i < iterations; i++) {
+        sink += (uint64_t)vban_sender_push(sender, samples_in, PACKET_FRAMES);
+    }
+}
+
+static const bench_case_t cases[] = {
+    { "header_build", "vban_header_init + nuFrame per packet", VBAN_HEADER_SIZE, bench_header_build },
+    { "header_patch", "nuFrame patch into a prebuilt header", VBAN_HEADER_SIZE, bench_header_patch },
+    { "header_parse", "magic/format/length/name checks on receive", VBAN_HEADER_SIZE, bench_header_parse },
+    { "convert_le16", "wire to host order, 256 stereo frames", PACKET_BYTES, bench_convert_le },
+    { "byteswap16", "forced byteswap, 256 stereo frames", PACKET_BYTES, bench_byteswap },
+    { "ring_decode", "reserve/convert/commit + read", PACKET_BYTES, bench_ring_decode },
+    { "ring_write_read", "audio_buffer_write + interleaved read", PACKET_BYTES, bench_ring_write_read },
+    { "ring_write_planar", "audio_buffer_write + planar render dequeue", PACKET_BYTES, bench_ring_write_planar },
+    { "packetize_send", "vban_sender_push of one packet over loopback", PACKET_BYTES, bench_packetize },
+};
+
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+static void run_case(const bench_case_t* bench, bench_result_t* result) {
+    // Grow the iteration count until one run takes long enough to time
+    size_t iterations = 1;
+    int64_t elapsed;
+    for (;;) {
+        int64_t start = now_ns();
+        bench->run(iterations);
+        elapsed = now_ns() - start;
+        if (elapsed >= MIN_RUN_NS) break;
+        iterations *= elapsed < MIN_RUN_NS / 16 ? 8 : 2;
+    }
+
+    for (int r = 1; r < REPEATS; r++) {
+        int64_t start = now_ns();
+        bench->run(iterations);
+        int64_t t = now_ns() - start;
+        if (t < elapsed) elapsed = t;
+    }
+
+    result->iterations = iterations;
+    result->ns_per_op = (double)elapsed / iterations;
+    result->bytes_per_second = bench->bytes_per_op * 1e9 / result->ns_per_op;
+}
+
+static void write_json(FILE* out, const bench_result_t* results, const int* selected) {
+    struct utsname host;
+    uname(&host);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"host\": \"%s %s %s\",\n", host.sysname, host.release, host.machine);
+#ifdef __VERSION__
+    fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+    fprintf(out, "  \"benchmarks\": [");
+    const char* separator = "\n";
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        if (!selected[i]) continue;
+        fprintf(out, "%s    {\"name\": \"%s\", \"bytes_per_op\": %zu, \"iterations\": %zu, "
+                "\"ns_per_op\": %.3f, \"bytes_per_second\": %.0f}",
+                separator, cases[i].name, cases[i].bytes_per_op, results[i].iterations,
+                results[i].ns_per_op, results[i].bytes_per_second);
+        separator = ",\n";
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* filter = NULL;
+    const char* json_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:o:l")) != -1) {
+        switch (opt) {
+            case 'f':
+                filter = optarg;
+                break;
+            case 'o':
+                json_path = optarg;
+                break;
+            case 'l':
+                for (size_t i = 0; i < NUM_CASES; i++) {
+                    printf("%-18s %s\n", cases[i].name, cases[i].description);
+                }
+                return 0;
+            default:
+                printf("Usage: %s [-f name_filter] [-o results.json] [-l]\n", argv[0]);
+                printf("Times the library's per-packet primitives and reports ns/op and bytes/s.\n");
+                printf("-o also writes the results as JSON (\"-\" for stdout), -l lists the cases.\n");
+                return 1;
+        }
+    }
+
+    // Fixtures: one valid stereo datagram, a prebuilt header, a ring and a sender
+    for (size_t s = 0; s < PACKET_SAMPLES; s++) samples_in[s] = (int16_t)(s * 131);
+    vban_header_init(&packet_header, "Stream1", 3, PACKET_FRAMES, CHANNELS, VBAN_DATATYPE_INT16);
+    memcpy(datagram, &packet_header, VBAN_HEADER_SIZE);
+    memcpy(datagram + VBAN_HEADER_SIZE, samples_in, PACKET_BYTES);
+
+    vban_sender_config_t tx_config = {0};
+    tx_config.remote_ip = "127.0.0.1";
+    tx_config.port = SINK_PORT;
+    tx_config.stream_name = "Stream1";
+    tx_config.sample_rate = 48000;
+    tx_config.channels = CHANNELS;
+    tx_config.frames_per_packet = PACKET_FRAMES;
+    sender = vban_sender_create(&tx_config);
+    if (!sender || audio_buffer_create(&ring, PACKET_SAMPLES * 8, sizeof(int16_t)) != 0) {
+        fprintf(stderr, "Failed to set up benchmarks\n");
+        return 1;
+    }
+
+    bench_result_t results[NUM_CASES];
+    int selected[NUM_CASES];
+    FILE* table = (json_path && strcmp(json_path, "-") == 0) ? stderr : stdout;
+
+    fprintf(table, "%-18s %12s %12s %14s\n", "Benchmark", "Iterations", "ns/op", "MB/s");
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        selected[i] = !filter || strstr(cases[i].name, filter) != NULL;
+        if (!selected[i]) continue;
+        run_case(&cases[i], &results[i]);
+        fprintf(table, "%-18s %12zu %12.2f %14.1f\n", cases[i].name, results[i].iterations,
+                results[i].ns_per_op, results[i].bytes_per_second / 1e6);
+    }
+
+    int status = 0;
+    if (json_path) {
+        FILE* out = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!out) {
+            perror("Failed to write results");
+            status = 1;
+        } else {
+            write_json(out, results, selected);
+            if (out != stdout) fclose(out);
+        }
+    }
+
+    vban_sender_destroy(sender);
+    audio_buffer_destroy(&ring);
+    return status;
+}
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <vban4mac/stream.h>
+#include <vban4mac/pacer.h>
+#include "../src/net_util.h"
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 256
+#define MAX_DESTINATIONS 16
+#define BURST_GAP_NS 50000          // Arrivals closer than this belong to one burst
+
+typedef struct {
+    int sockets[MAX_DESTINATIONS];
+    int num_sockets;
+    int64_t* arrivals;
+    size_t count;
+    size_t capacity;
+    atomic_int running;
+} capture_t;
+
+typedef struct {
+    size_t packets;
+    size_t bursts;
+    size_t max_burst;
+    size_t packets_in_bursts;       // Packets that arrived with another one right behind or ahead
+    vban_pacer_stats_t pacer;
+} run_result_t;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadline_ns) {
+    int64_t remaining = deadline_ns - now_ns();
+    if (remaining <= 0) return;
+    struct timespec ts = { remaining / 1000000000LL, remaining % 1000000000LL };
+    nanosleep(&ts, NULL);
+}
+
+// Record the kernel receive time of every datagram on the destinations,
+// standing in for the NIC queue all streams share
+static void* capture_thread(void* arg) {
+    capture_t* capture = (capture_t*)arg;
+    struct pollfd fds[MAX_DESTINATIONS];
+    for (int i = 0; i < capture->num_sockets; i++) {
+        fds[i].fd = capture->sockets[i];
+        fds[i].events = POLLIN;
+    }
+
+    uint8_t packet[VBAN_HEADER_SIZE + VBAN_MAX_PACKET_SIZE];
+    char control[NET_TIMESTAMP_CONTROL_SIZE];
+    while (atomic_load(&capture->running)) {
+        if (poll(fds, capture->num_sockets, 100) <= 0) continue;
+        for (int i = 0; i < capture->num_sockets; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            for (;;) {
+                struct iovec iov = { packet, sizeof(packet) };
+                struct msghdr msg = {0};
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                if (recvmsg(fds[i].fd, &msg, MSG_DONTWAIT) < 0) break;
+                if (capture->count < capture->capacity) {
+                    capture->arrivals[capture->count++] = net_rx_timestamp_ns(&msg);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+static int compare_ns(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void count_bursts(int64_t* arrivals, size_t count, run_result_t* result) {
+    qsort(arrivals, count, sizeof(int64_t), compare_ns);
+    result->packets = count;
+    size_t burst = 1;
+    for (size_t i = 1; i <= count; i++) {
+        if (i < count && arrivals[i] - arrivals[i - 1] < BURST_GAP_NS) {
+            burst++;
+            continue;
+        }
+        if (count == 0) break;
+        result->bursts++;
+        if (burst > result->max_burst) result->max_burst = burst;
+        if (burst > 1) result->packets_in_bursts += burst;
+        burst = 1;
+    }
+}
+
+static int run(int num_streams, int num_dests, double seconds, int period_frames, uint16_t base_port,
+               int paced, run_result_t* result) {
+    capture_t capture = {0};
+    capture.capacity = (size_t)(num_streams * (seconds + 1) * SAMPLE_RATE / PACKET_FRAMES);
+    capture.arrivals = calloc(capture.capacity, sizeof(int64_t));
+    if (!capture.arrivals) return -1;
+
+    int status = 0;
+    for (int d = 0; d < num_dests; d++) {
+        struct sockaddr_storage addr;
+        socklen_t len;
+        net_parse_addr("127.0.0.1", (uint16_t)(base_port + d), AF_INET, &addr, &len);
+        capture.sockets[d] = net_open_udp_socket(AF_INET, &addr, len);
+        if (capture.sockets[d] < 0) {
+            status = -1;
+            break;
+        }
+        net_enable_rx_timestamps(capture.sockets[d]);
+        int size = 4 << 20;
+        setsockopt(capture.sockets[d], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        capture.num_sockets++;
+    }
+
+    vban_pacer_t* pacer = paced ? vban_pacer_create(NULL) : NULL;
+    if (paced && !pacer) status = -1;
+
+    vban_sender_t** senders = calloc(num_streams, sizeof(vban_sender_t*));
+    char name[16];
+    for (int i = 0; i < num_streams && status == 0 && senders; i++) {
+        snprintf(name, sizeof(name), "Mic%d", i);
+        vban_sender_config_t config = {0};
+        config.remote_ip = "127.0.0.1";
+        config.port = (uint16_t)(base_port + i % num_dests);
+        config.stream_name = name;
+        config.sample_rate = SAMPLE_RATE;
+        config.channels = 1;
+        config.frames_per_packet = PACKET_FRAMES;
+        config.pacer = pacer;
+        senders[i] = vban_sender_create(&config);
+        if (!senders[i]) status = -1;
+    }
+    if (!senders) status = -1;
+
+    pthread_t thread;
+    atomic_init(&capture.running, 1);
+    if (status == 0 && pthread_create(&thread, NULL, capture_thread, &capture) != 0) status = -1;
+
+    if (status == 0) {
+        // One device period fires every stream's capture callback at once
+        int16_t* period = calloc(period_frames, sizeof(int16_t));
+        int64_t period_ns = (int64_t)period_frames * 1000000000LL / SAMPLE_RATE;
+        long periods = (long)(seconds * SAMPLE_RATE / period_frames);
+        int64_t next = now_ns();
+        for (long p = 0; p < periods && period; p++) {
+            for (int i = 0; i < num_streams; i++) {
+                period[0] = (int16_t)p;
+                vban_sender_push(senders[i], period, period_frames);
+            }
+            next += period_ns;
+            sleep_until(next);
+        }
+        free(period);
+
+        sleep_until(now_ns() + 100000000LL);  // Let the pacer and the capture drain
+        atomic_store(&capture.running, 0);
+        pthread_join(thread, NULL);
+        if (pacer) vban_pacer_get_stats(pacer, &result->pacer);
+        count_bursts(capture.arrivals, capture.count, result);
+    }
+
+    for (int i = 0; senders && i < num_streams; i++) vban_sender_destroy(senders[i]);
+    free(senders);
+    vban_pacer_destroy(pacer);
+    for (int d = 0; d < capture.num_sockets; d++) close(capture.sockets[d]);
+    free(capture.arrivals);
+    return status;
+}
+
+static void print_result(const char* label, const run_result_t* result) {
+    printf("%-10s %10zu %10zu %10.2f %10zu %11.1f%%\n", label, result->packets, result->bursts,
+           result->bursts ? (double)result->packets / result->bursts : 0.0, result->max_burst,
+           result->packets ? 100.0 * result->packets_in_bursts / result->packets : 0.0);
+}
+
+int main(int argc, char* argv[]) {
+    int num_streams = 32;
+    int num_dests = 2;
+    double seconds = 5.0;
+    int period_frames = 256;
+    uint16_t base_port = 7300;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:d:f:p:")) != -1) {
+        switch (opt) {
+            case 's':
+                num_streams = atoi(optarg);
+                break;
+            case 'n':
+                num_dests = atoi(optarg);
+                break;
+            case 'd':
+                seconds = atof(optarg);
+                break;
+            case 'f':
+                period_frames = atoi(optarg);
+                break;
+            case 'p':
+                base_port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-s streams] [-n destinations] [-d seconds] [-f period_frames] [-p base_port]\n",
+                       argv[0]);
+                printf("Pushes one device period to every mono sender at once, as capture\n");
+                printf("callbacks on one device do, and measures the bursts arriving over\n");
+                printf("loopback with and without the host-wide pacer. A burst is a run of\n");
+                printf("datagrams less than %d us apart.\n", BURST_GAP_NS / 1000);
+                return 1;
+        }
+    }
+    if (num_streams < 1 || num_streams > VBAN_PACER_MAX_STREAMS || num_dests < 1 ||
+        num_dests > MAX_DESTINATIONS || seconds <= 0 || period_frames < 1) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    printf("%d streams to %d destinations, %d-frame device period, %.0f s\n\n", num_streams, num_dests,
+           period_frames, seconds);
+    printf("%-10s %10s %10s %10s %10s %12s\n", "Mode", "Packets", "Bursts", "Mean size", "Max size",
+           "In bursts");
+
+    run_result_t direct = {0}, paced = {0};
+    if (run(num_streams, num_dests, seconds, period_frames, base_port, 0, &direct) != 0 ||
+        run(num_streams, num_dests, seconds, period_frames, base_port, 1, &paced) != 0) {
+        fprintf(stderr, "Failed to run the streams\n");
+        return 1;
+    }
+    print_result("direct", &direct);
+    print_result("paced", &paced);
+
+    const vban_pacer_stats_t* stats = &paced.pacer;
+    printf("\nPacing delay: mean %.2f ms, max %.2f ms; %llu dropped, %llu send errors\n",
+           stats->packets_paced ? stats->delay_total_ns / 1e6 / stats->packets_paced : 0.0,
+           stats->delay_max_ns / 1e6, (unsigned long long)stats->packets_dropped,
+           (unsigned long long)stats->send_errors);
+
+    if (paced.max_burst >= direct.max_burst && direct.max_burst > 1) {
+        printf("FAILED: pacing did not reduce the largest burst\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <vban4mac/playout.h>
+#include "../src/packet.h"
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 256
+#define PULL_FRAMES 128             // Output device period
+#define NUM_STREAMS 4
+#define BASE_DELAY_NS 2000000LL     // Network delay shared by every stream
+#define SIGNAL_KEY 40503u           // Odd, so the signal can be inverted back to a frame index
+#define CHECK_INTERVAL 4800         // Output frames between alignment checks
+#define MAX_SKEW_FRAMES 2           // Pass bound, the residue of estimating offsets from jittered arrivals
+
+// How one synthetic stream reaches the receiver
+typedef struct {
+    const char* description;
+    double start_s;                 // When the sender starts, on the capture timeline
+    double jitter_ms;               // Uniform extra delay per packet
+    double loss;                    // Packet loss probability
+    int stall_every;                // Packets between stalls, 0 for none
+    double stall_ms;                // Stall length; the queued packets then arrive in a burst
+} stream_profile_t;
+
+typedef struct {
+    int stream;
+    int64_t arrival_ns;
+    vban_header_t header;
+    int16_t samples[PACKET_FRAMES];
+} sim_packet_t;
+
+static const stream_profile_t profiles[NUM_STREAMS] = {
+    { "steady",            0.00, 0.3, 0.00,   0,  0.0 },
+    { "late join, jitter", 0.70, 4.0, 0.00,   0,  0.0 },
+    { "lossy",             0.20, 1.5, 0.02,   0,  0.0 },
+    { "bursty",            1.30, 0.8, 0.00, 300, 35.0 },
+};
+
+static uint16_t signal_inverse;
+
+// Every capture frame has a distinct sample value (modulo 65536 frames),
+// so a played sample tells which capture frame it came from
+static int16_t signal_at(int64_t frame) {
+    return (int16_t)(uint16_t)((uint64_t)frame * SIGNAL_KEY);
+}
+
+static int64_t signal_frame(int16_t sample) {
+    return (uint16_t)((uint16_t)sample * signal_inverse);
+}
+
+static int compare_arrival(const void* a, const void* b) {
+    const sim_packet_t* pa = (const sim_packet_t*)a;
+    const sim_packet_t* pb = (const sim_packet_t*)b;
+    return (pa->arrival_ns > pb->arrival_ns) - (pa->arrival_ns < pb->arrival_ns);
+}
+
+static void header_init(vban_header_t* header, int stream, uint32_t index) {
+    char name[16];
+    snprintf(name, sizeof(name), "Mic%d", stream);
+    vban_header_init(header, name, vban_sample_rate_index(SAMPLE_RATE), PACKET_FRAMES, 1, VBAN_DATATYPE_INT16);
+    vban_header_set_frame(header, index);
+}
+
+// Build every stream's packets with arrival times, sorted by arrival
+static sim_packet_t* simulate_network(double seconds, unsigned seed, size_t* count) {
+    size_t per_stream = (size_t)(seconds * SAMPLE_RATE / PACKET_FRAMES);
+    sim_packet_t* packets = calloc(per_stream * NUM_STREAMS, sizeof(sim_packet_t));
+    if (!packets) return NULL;
+
+    size_t n = 0;
+    for (int s = 0; s < NUM_STREAMS; s++) {
+        const stream_profile_t* p = &profiles[s];
+        uint32_t first_index = (uint32_t)rand_r(&seed);   // Unrelated counter origins
+        int64_t start_frame = (int64_t)(p->start_s * SAMPLE_RATE);
+        int64_t stall_until = 0;
+
+        for (size_t k = 0; start_frame + (int64_t)(k + 1) * PACKET_FRAMES <= (int64_t)(seconds * SAMPLE_RATE); k++) {
+            int64_t capture = start_frame + (int64_t)k * PACKET_FRAMES;
+            int64_t sent_ns = (capture + PACKET_FRAMES) * 1000000000LL / SAMPLE_RATE;
+            if (rand_r(&seed) < p->loss * RAND_MAX) continue;
+
+            int64_t arrival = sent_ns + BASE_DELAY_NS +
+                              (int64_t)(p->jitter_ms * 1e6 * rand_r(&seed) / RAND_MAX);
+            if (p->stall_every && k % p->stall_every == 0) {
+                stall_until = sent_ns + BASE_DELAY_NS + (int64_t)(p->stall_ms * 1e6);
+            }
+            if (arrival < stall_until) arrival = stall_until;
+
+            sim_packet_t* packet = &packets[n++];
+            packet->stream = s;
+            packet->arrival_ns = arrival;
+            header_init(&packet->header, s, first_index + (uint32_t)k);
+            for (int i = 0; i < PACKET_FRAMES; i++) {
+                packet->samples[i] = signal_at(capture + i);
+            }
+        }
+    }
+
+    qsort(packets, n, sizeof(sim_packet_t), compare_arrival);
+    *count = n;
+    return packets;
+}
+
+// Play the packets out, either all in one group or each stream in its own,
+// and record every stream's output
+static int run_playout(const sim_packet_t* packets, size_t count, int grouped,
+                       int16_t* const* recorded, size_t total_frames, vban_playout_member_stats_t* stats) {
+    vban_playout_group_config_t config = {0};
+    config.sample_rate = SAMPLE_RATE;
+
+    vban_playout_group_t* groups[NUM_STREAMS] = {0};
+    int members[NUM_STREAMS];
+    for (int s = 0; s < NUM_STREAMS; s++) {
+        if (!grouped || s == 0) {
+            groups[s] = vban_playout_group_create(&config);
+        } else {
+            groups[s] = groups[0];
+        }
+        if (!groups[s] || (members[s] = vban_playout_group_add(groups[s], 1, SAMPLE_RATE)) < 0) {
+            fprintf(stderr, "Failed to create playout group\n");
+            return -1;
+        }
+    }
+
+    // The simulated clock starts at the first capture frame; the output
+    // device pulls one period at a time
+    size_t next = 0;
+    for (size_t frame = 0; frame + PULL_FRAMES <= total_frames; frame += PULL_FRAMES) {
+        int64_t now_ns = (int64_t)frame * 1000000000LL / SAMPLE_RATE;
+        while (next < count && packets[next].arrival_ns <= now_ns) {
+            const sim_packet_t* packet = &packets[next++];
+            int s = packet->stream;
+            vban_playout_group_push(groups[s], members[s], &packet->header, packet->samples, packet->arrival_ns);
+        }
+
+        if (grouped) {
+            int16_t* out[NUM_STREAMS];
+            for (int s = 0; s < NUM_STREAMS; s++) out[s] = recorded[s] + frame;
+            vban_playout_group_pull(groups[0], now_ns, out, PULL_FRAMES);
+        } else {
+            for (int s = 0; s < NUM_STREAMS; s++) {
+                int16_t* out[1] = { recorded[s] + frame };
+                vban_playout_group_pull(groups[s], now_ns, out, PULL_FRAMES);
+            }
+        }
+    }
+
+    for (int s = 0; s < NUM_STREAMS; s++) {
+        vban_playout_group_get_stats(groups[s], members[s], &stats[s]);
+    }
+    for (int s = 0; s < NUM_STREAMS; s++) {
+        if (!grouped || s == 0) vban_playout_group_destroy(groups[s]);
+    }
+    return 0;
+}
+
+// Push one steady packet of stream 0 captured at frame k * PACKET_FRAMES
+static int push_steady(vban_playout_group_t* group, int member, uint32_t k, int64_t delay_ns) {
+    vban_header_t header;
+    int16_t samples[PACKET_FRAMES] = {0};
+    header_init(&header, 0, k);
+    int64_t sent_ns = (int64_t)(k + 1) * PACKET_FRAMES * 1000000000LL / SAMPLE_RATE;
+    return vban_playout_group_push(group, member, &header, samples, sent_ns + BASE_DELAY_NS + delay_ns);
+}
+
+// Members leave and rejoin, and a stream at another rate is refused
+// @return Number of failed checks
+static int check_membership(void) {
+    vban_playout_group_config_t config = {0};
+    config.sample_rate = SAMPLE_RATE;
+    vban_playout_group_t* group = vban_playout_group_create(&config);
+    if (!group) return 1;
+
+    int failures = 0;
+    int first = vban_playout_group_add(group, 1, SAMPLE_RATE);
+    int second = vban_playout_group_add(group, 1, 0);
+    failures += first != 0 || second != 1;
+    failures += vban_playout_group_add(group, 1, 44100) != -1;
+
+    // A packet at another rate is refused and counted
+    vban_header_t header;
+    int16_t samples[PACKET_FRAMES] = {0};
+    vban_header_init(&header, "Mic1", vban_sample_rate_index(44100), PACKET_FRAMES, 1, VBAN_DATATYPE_INT16);
+    vban_playout_member_stats_t stats;
+    failures += vban_playout_group_push(group, second, &header, samples, 1000000) != -1;
+    failures += vban_playout_group_get_stats(group, second, &stats) != 0 || stats.packets_rejected != 1;
+
+    // A removed member takes no packets, is skipped by pulls and its index is reused
+    failures += push_steady(group, first, 0, 0) != 0;
+    failures += vban_playout_group_remove(group, first) != 0;
+    failures += vban_playout_group_remove(group, first) != -1;
+    failures += push_steady(group, first, 1, 0) != -1;
+    failures += vban_playout_group_get_stats(group, first, &stats) != -1;
+    int16_t out_second[PULL_FRAMES];
+    int16_t* out[2] = { NULL, out_second };
+    failures += vban_playout_group_pull(group, 0, out, PULL_FRAMES) != 0;
+    failures += vban_playout_group_add(group, 1, SAMPLE_RATE) != first;
+
+    vban_playout_group_destroy(group);
+    printf("Membership: remove, rejoin and rate checks %s\n", failures ? "FAILED" : "ok");
+    return failures;
+}
+
+// A stall raises the automatic target; once the stream is steady again it
+// has to come back down
+// @return Number of failed checks
+static int check_target_decay(double seconds) {
+    vban_playout_group_config_t config = {0};
+    config.sample_rate = SAMPLE_RATE;
+    vban_playout_group_t* group = vban_playout_group_create(&config);
+    int member = group ? vban_playout_group_add(group, 1, SAMPLE_RATE) : -1;
+    if (member < 0) {
+        vban_playout_group_destroy(group);
+        return 1;
+    }
+
+    const uint32_t stall_at = SAMPLE_RATE / PACKET_FRAMES;  // One second in
+    const int64_t stall_ns = 60000000LL;
+    uint32_t peak = 0, target = 0;
+    uint32_t next = 0;
+    int16_t buffer[PULL_FRAMES];
+    int16_t* out[1] = { buffer };
+    vban_playout_member_stats_t stats;
+    for (size_t frame = 0; frame + PULL_FRAMES <= (size_t)(seconds * SAMPLE_RATE); frame += PULL_FRAMES) {
+        int64_t now_ns = (int64_t)frame * 1000000000LL / SAMPLE_RATE;
+        for (;;) {
+            // Packets held by the stall arrive together when it ends
+            int64_t sent_ns = (int64_t)(next + 1) * PACKET_FRAMES * 1000000000LL / SAMPLE_RATE;
+            int64_t stall_end = (int64_t)(stall_at + 1) * PACKET_FRAMES * 1000000000LL / SAMPLE_RATE + stall_ns;
+            int64_t delay = next >= stall_at && sent_ns < stall_end ? stall_end - sent_ns : 0;
+            if (sent_ns + BASE_DELAY_NS + delay > now_ns) break;
+            push_steady(group, member, next++, delay);
+        }
+        vban_playout_group_pull(group, now_ns, out, PULL_FRAMES);
+        vban_playout_group_get_stats(group, member, &stats);
+        target = stats.target_frames;
+        if (target > peak) peak = target;
+    }
+    vban_playout_group_destroy(group);
+
+    int failed = !(peak > 0 && target < peak);
+    printf("Target after a %lld ms stall: peak %u frames, %u at the end, %s\n", (long long)(stall_ns / 1000000),
+           peak, target, failed ? "FAILED to decay" : "decayed");
+    return failed;
+}
+
+// Capture frame played at an output position, if two consecutive samples agree
+static int played_frame(const int16_t* out, size_t pos, int64_t* frame) {
+    int64_t a = signal_frame(out[pos]);
+    int64_t b = signal_frame(out[pos + 1]);
+    if (((a + 1) & 0xFFFF) != b) return 0;
+    *frame = a;
+    return 1;
+}
+
+// Largest capture-frame difference to stream 0 seen at the check points
+static void measure_skew(int16_t* const* recorded, size_t total_frames, size_t from_frame, int64_t* max_skew,
+                         int* checks) {
+    for (int s = 0; s < NUM_STREAMS; s++) {
+        max_skew[s] = 0;
+        checks[s] = 0;
+    }
+    for (size_t pos = from_frame; pos + 1 < total_frames; pos += CHECK_INTERVAL) {
+        int64_t reference;
+        if (!played_frame(recorded[0], pos, &reference)) continue;
+        for (int s = 1; s < NUM_STREAMS; s++) {
+            int64_t frame;
+            if (!played_frame(recorded[s], pos, &frame)) continue;
+            int64_t skew = (int16_t)(uint16_t)(frame - reference);  // Nearest, modulo the signal period
+            if (llabs(skew) > llabs(max_skew[s])) max_skew[s] = skew;
+            checks[s]++;
+        }
+    }
+}
+
+static void print_report(const char* title, const int64_t* max_skew, const int* checks,
+                         const vban_playout_member_stats_t* stats) {
+    printf("%s\n", title);
+    printf("  %-20s %10s %10s %8s %10s %8s %6s\n", "Stream", "Max skew", "(ms)", "Checks", "Latency", "Late", "Slips");
+    for (int s = 0; s < NUM_STREAMS; s++) {
+        printf("  %-20s %10lld %10.2f %8d %10u %8llu %6llu\n", profiles[s].description,
+               (long long)max_skew[s], max_skew[s] * 1000.0 / SAMPLE_RATE, s == 0 ? 0 : checks[s],
+               stats[s].target_frames, (unsigned long long)stats[s].packets_late,
+               (unsigned long long)stats[s].slips);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 20.0;
+    unsigned seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:s:")) != -1) {
+        switch (opt) {
+            case 'd':
+                seconds = atof(optarg);
+                break;
+            case 's':
+                seed = (unsigned)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-d seconds] [-s seed]\n", argv[0]);
+                printf("Offline check of grouped playout: four synthetic captures of the same\n");
+                printf("signal reach the receiver with different start times, jitter, loss and\n");
+                printf("bursts. They are played out once with independent buffers and once as a\n");
+                printf("group, and the skew between the played streams is measured in frames.\n");
+                return 1;
+        }
+    }
+    if (seconds < 5) {
+        fprintf(stderr, "Need at least 5 seconds\n");
+        return 1;
+    }
+
+    // Inverse of SIGNAL_KEY modulo 2^16 (Newton iteration)
+    uint16_t inverse = SIGNAL_KEY;
+    for (int i = 0; i < 4; i++) inverse = (uint16_t)(inverse * (2 - SIGNAL_KEY * inverse));
+    signal_inverse = inverse;
+
+    size_t count;
+    sim_packet_t* packets = simulate_network(seconds, seed, &count);
+    size_t total_frames = (size_t)(seconds * SAMPLE_RATE) + SAMPLE_RATE / 2;
+    int16_t* recorded[NUM_STREAMS];
+    for (int s = 0; s < NUM_STREAMS; s++) {
+        recorded[s] = calloc(total_frames, sizeof(int16_t));
+        if (!recorded[s]) return 1;
+    }
+    if (!packets) return 1;
+
+    // Compare once the arrival offsets of every stream have settled
+    size_t settle = (size_t)((profiles[3].start_s + 4.0) * SAMPLE_RATE);
+    vban_playout_member_stats_t stats[NUM_STREAMS];
+    int64_t independent_skew[NUM_STREAMS], grouped_skew[NUM_STREAMS];
+    int checks[NUM_STREAMS];
+
+    printf("%zu packets over %.0f s, %d streams\n\n", count, seconds, NUM_STREAMS);
+    if (run_playout(packets, count, 0, recorded, total_frames, stats) != 0) return 1;
+    measure_skew(recorded, total_frames, settle, independent_skew, checks);
+    print_report("Independent buffers", independent_skew, checks, stats);
+
+    for (int s = 0; s < NUM_STREAMS; s++) memset(recorded[s], 0, total_frames * sizeof(int16_t));
+    if (run_playout(packets, count, 1, recorded, total_frames, stats) != 0) return 1;
+    measure_skew(recorded, total_frames, settle, grouped_skew, checks);
+    print_report("\nPlayout group", grouped_skew, checks, stats);
+
+    int64_t worst = 0;
+    for (int s = 1; s < NUM_STREAMS; s++) {
+        if (llabs(grouped_skew[s]) > worst) worst = llabs(grouped_skew[s]);
+    }
+    printf("\nWorst grouped skew: %lld frames\n\n", (long long)worst);
+
+    int failures = check_membership();
+    failures += check_target_decay(seconds);
+
+    for (int s = 0; s < NUM_STREAMS; s++) free(recorded[s]);
+    free(packets);
+    return worst <= MAX_SKEW_FRAMES && failures == 0 ? 0 : 1;
+}
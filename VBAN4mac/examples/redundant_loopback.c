@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <vban4mac/stream.h>
+
+#define SAMPLE_RATE 48000
+#define PACKET_FRAMES 256           // 5.3 ms per packet
+#define DRAIN_MS 200                // Longer than any path's delay
+#define MAX_PACKETS 65536
+
+typedef struct {
+    const char* name;
+    vban_impair_config_t path_a;
+    vban_impair_config_t path_b;
+    int may_lose;                   // Both paths can drop the same packet
+} scenario_t;
+
+typedef struct {
+    uint8_t seen[MAX_PACKETS];      // Copies played per nuFrame
+    uint32_t newest;
+    size_t played;
+    size_t out_of_order;            // Played after a later packet
+    int sent;
+    vban_redundancy_stats_t merge;
+} run_t;
+
+static void record_packet(void* user, const vban_header_t* header, size_t frames) {
+    (void)frames;
+    run_t* run = (run_t*)user;
+    uint32_t index = header->nuFrame;
+    if (index >= MAX_PACKETS) return;
+    if (run->played > 0 && index < run->newest) run->out_of_order++;
+    if (index > run->newest) run->newest = index;
+    run->seen[index]++;
+    run->played++;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Stream in real time from a redundant sender to a receiver on both paths,
+// each path impaired on its own
+static int run_scenario(const scenario_t* scenario, unsigned seed, double seconds, uint16_t port, run_t* run) {
+    memset(run, 0, sizeof(*run));
+
+    vban_receiver_config_t rx_config = {0};
+    rx_config.bind_ip = "127.0.0.1";
+    rx_config.port = port;
+    rx_config.remote_ip = "127.0.0.1";
+    rx_config.stream_name = "Redundant";
+    rx_config.channels = 1;
+    rx_config.on_packet = record_packet;
+    rx_config.user = run;
+    rx_config.impair = scenario->path_a;
+    rx_config.impair.seed = seed;
+    rx_config.redundant_port = (uint16_t)(port + 1);
+    rx_config.redundant_impair = scenario->path_b;
+    rx_config.redundant_impair.seed = seed;
+
+    vban_sender_config_t tx_config = {0};
+    tx_config.remote_ip = "127.0.0.1";
+    tx_config.port = port;
+    tx_config.redundant_ip = "127.0.0.1";
+    tx_config.redundant_port = (uint16_t)(port + 1);
+    tx_config.stream_name = "Redundant";
+    tx_config.sample_rate = SAMPLE_RATE;
+    tx_config.channels = 1;
+    tx_config.frames_per_packet = PACKET_FRAMES;
+
+    vban_receiver_t* receiver = vban_receiver_create(&rx_config);
+    vban_sender_t* sender = vban_sender_create(&tx_config);
+    if (!receiver || !sender) {
+        fprintf(stderr, "Failed to create sender/receiver\n");
+        vban_receiver_destroy(receiver);
+        vban_sender_destroy(sender);
+        return -1;
+    }
+
+    int16_t block[PACKET_FRAMES];
+    int16_t out[4096];
+    int packets = (int)(seconds * SAMPLE_RATE / PACKET_FRAMES);
+    double interval_ms = 1000.0 * PACKET_FRAMES / SAMPLE_RATE;
+    double start = now_ms();
+
+    for (int p = 0; p < packets; p++) {
+        for (int i = 0; i < PACKET_FRAMES; i++) {
+            block[i] = (int16_t)(8000.0 * sin(2.0 * M_PI * 440.0 * (p * PACKET_FRAMES + i) / SAMPLE_RATE));
+        }
+        if (vban_sender_push(sender, block, PACKET_FRAMES) > 0) run->sent++;
+
+        // Receive from both paths until the next packet is due
+        double next = start + (p + 1) * interval_ms;
+        double wait;
+        while ((wait = next - now_ms()) > 0) {
+            vban_receiver_process(receiver, (int)ceil(wait));
+            while (vban_receiver_pull(receiver, out, 4096) > 0) {}
+        }
+    }
+
+    double end = now_ms() + DRAIN_MS;
+    double wait;
+    while ((wait = end - now_ms()) > 0) {
+        vban_receiver_process(receiver, (int)ceil(wait));
+        while (vban_receiver_pull(receiver, out, 4096) > 0) {}
+    }
+
+    vban_receiver_get_redundancy_stats(receiver, &run->merge);
+    vban_sender_destroy(sender);
+    vban_receiver_destroy(receiver);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 2.0;
+    unsigned seed = 1;
+    uint16_t port = 6996;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:p:")) != -1) {
+        switch (opt) {
+            case 's':
+                seconds = atof(optarg);
+                break;
+            case 'r':
+                seed = (unsigned)atoi(optarg);
+                break;
+            case 'p':
+                port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-s seconds] [-r seed] [-p port]\n", argv[0]);
+                printf("Streams over loopback on two paths (port and port + 1), dropping packets\n");
+                printf("on one or both with the receiver's simulated impairment, and checks that\n");
+                printf("every packet is played exactly once, in order, while either path still\n");
+                printf("delivers it.\n");
+                return 1;
+        }
+    }
+    if (seconds <= 0 || seconds * SAMPLE_RATE / PACKET_FRAMES > MAX_PACKETS) {
+        fprintf(stderr, "Invalid duration\n");
+        return 1;
+    }
+
+    // A dead path drops everything; a flapping one goes down for about 20
+    // packets (100 ms) at a time
+    vban_impair_config_t clean = { 0 };
+    vban_impair_config_t dead = { .loss_pct = 100.0 };
+    vban_impair_config_t flapping = { .burst_enter_pct = 2.0, .burst_exit_pct = 5.0 };
+    vban_impair_config_t lossy = { .loss_pct = 5.0 };
+    vban_impair_config_t slow = { .delay_ms = 15 };
+    vban_impair_config_t slow_flapping = { .burst_enter_pct = 2.0, .burst_exit_pct = 5.0, .delay_ms = 15 };
+
+    scenario_t scenarios[] = {
+        { "Both clean", clean, clean, 0 },
+        { "A dead", dead, clean, 0 },
+        { "B dead", clean, dead, 0 },
+        { "A flapping", flapping, clean, 0 },
+        { "A flapping, B +15 ms", flapping, slow, 0 },
+        { "B flapping +15 ms", clean, slow_flapping, 0 },
+        { "5% loss on each", lossy, lossy, 1 },
+    };
+    int num_scenarios = (int)(sizeof(scenarios) / sizeof(scenarios[0]));
+
+    run_t* run = malloc(sizeof(run_t));
+    if (!run) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("%.1f s per run, seed %u\n\n", seconds, seed);
+    printf("%-22s %6s %6s %5s %7s %7s %6s %5s %5s %6s %5s %5s\n", "Scenario", "Sent", "Played", "Lost", "From A",
+           "From B", "Dups", "Late", "Held", "Missed", "Order", "Pass");
+    int failures = 0;
+    for (int i = 0; i < num_scenarios; i++) {
+        if (run_scenario(&scenarios[i], seed, seconds, port, run) != 0) return 1;
+
+        size_t unique = 0, replayed = 0;
+        for (int p = 0; p < run->sent; p++) {
+            if (run->seen[p] > 0) unique++;
+            if (run->seen[p] > 1) replayed++;
+        }
+        size_t lost = (size_t)run->sent - unique;
+
+        // Every packet played once and in order; with a path that delivers
+        // everything, none lost
+        int pass = replayed == 0 && run->out_of_order == 0 && (scenarios[i].may_lose || lost == 0);
+        if (!pass) failures++;
+        printf("%-22s %6d %6zu %5zu %7llu %7llu %6llu %5llu %5llu %6llu %5zu %5s\n", scenarios[i].name,
+               run->sent, run->played, lost, (unsigned long long)run->merge.packets[0],
+               (unsigned long long)run->merge.packets[1], (unsigned long long)run->merge.duplicates,
+               (unsigned long long)run->merge.late, (unsigned long long)run->merge.reordered,
+               (unsigned long long)run->merge.missed, run->out_of_order, pass ? "yes" : "NO");
+    }
+
+    printf("\nHeld counts packets that waited for a gap before them to fill from the slower\n");
+    printf("path, Missed the copies that came after the hold gave up, Order packets played\n");
+    printf("after a later one, which must be none.\n");
+    free(run);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <vban4mac/relay.h>
+#include <vban4mac/stream.h>
+
+#define SAMPLE_RATE 48000
+#define BURST_PACKETS 64
+
+static double now_seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void count_packet(void* user, const vban_header_t* header, size_t frames) {
+    (void)header;
+    (void)frames;
+    (*(uint64_t*)user)++;
+}
+
+typedef struct {
+    int channels;
+    int bursts;
+    int num_routes;
+    uint16_t port;
+} bench_config_t;
+
+typedef struct {
+    int io_uring;
+    uint64_t sent;
+    uint64_t delivered;
+    vban_relay_stats_t stats;
+    double relay_cpu;
+    double elapsed;
+} bench_result_t;
+
+// Relay bursts through one backend
+// @return 0 on success, -1 if setup failed
+static int run(const bench_config_t* bench, int use_sockets, bench_result_t* result) {
+    memset(result, 0, sizeof(*result));
+
+    vban_relay_config_t relay_config = {0};
+    relay_config.bind_ip = "127.0.0.1";
+    relay_config.port = bench->port;
+    relay_config.use_sockets = use_sockets;
+    vban_relay_t* relay = vban_relay_create(&relay_config);
+    if (!relay) return -1;
+
+    // One sink per route, each receiving its own renamed copy of the stream
+    vban_receiver_t* sinks[VBAN_RELAY_MAX_ROUTES];
+    uint64_t sink_packets[VBAN_RELAY_MAX_ROUTES] = {0};
+    char names[VBAN_RELAY_MAX_ROUTES][16];
+    for (int r = 0; r < bench->num_routes; r++) {
+        snprintf(names[r], sizeof(names[r]), "Relayed%d", r);
+
+        vban_relay_route_t route = {0};
+        route.stream_name = "Bench";
+        route.remote_ip = "127.0.0.1";
+        route.port = (uint16_t)(bench->port + 1 + r);
+        route.rename = names[r];
+        route.renumber = 1;
+
+        vban_receiver_config_t sink_config = {0};
+        sink_config.bind_ip = "127.0.0.1";
+        sink_config.port = route.port;
+        sink_config.stream_name = names[r];
+        sink_config.channels = bench->channels;
+        sink_config.buffer_frames = 65536;
+        sink_config.on_packet = count_packet;
+        sink_config.user = &sink_packets[r];
+
+        sinks[r] = vban_receiver_create(&sink_config);
+        if (!sinks[r] || vban_relay_add_route(relay, &route) != 0) return -1;
+    }
+
+    vban_sender_config_t tx_config = {0};
+    tx_config.remote_ip = "127.0.0.1";
+    tx_config.port = bench->port;
+    tx_config.stream_name = "Bench";
+    tx_config.sample_rate = SAMPLE_RATE;
+    tx_config.channels = bench->channels;
+    vban_sender_t* sender = vban_sender_create(&tx_config);
+    if (!sender) return -1;
+
+    // Frames for a burst of full packets
+    size_t frames_per_packet = VBAN_MAX_PACKET_SIZE / (bench->channels * sizeof(int16_t));
+    if (frames_per_packet > VBAN_PROTOCOL_MAXNBS) frames_per_packet = VBAN_PROTOCOL_MAXNBS;
+    size_t burst_frames = BURST_PACKETS * frames_per_packet;
+    int16_t* block = calloc(burst_frames * bench->channels, sizeof(int16_t));
+    if (!block) return -1;
+
+    double start = now_seconds(CLOCK_MONOTONIC);
+
+    for (int b = 0; b < bench->bursts; b++) {
+        // Keep the bursts small enough that the socket buffers never drop
+        result->sent += vban_sender_push(sender, block, burst_frames);
+
+        // Relay CPU time is this thread's: io_uring runs the receives and
+        // the sends (which complete inline on UDP) here, not in a worker
+        double t0 = now_seconds(CLOCK_THREAD_CPUTIME_ID);
+        vban_relay_process(relay, 0);
+        result->relay_cpu += now_seconds(CLOCK_THREAD_CPUTIME_ID) - t0;
+
+        for (int r = 0; r < bench->num_routes; r++) {
+            vban_receiver_process(sinks[r], 0);
+            size_t available = vban_receiver_available(sinks[r]);
+            vban_receiver_pull(sinks[r], block, available < burst_frames ? available : burst_frames);
+        }
+    }
+
+    result->elapsed = now_seconds(CLOCK_MONOTONIC) - start;
+    vban_relay_get_stats(relay, &result->stats);
+    result->io_uring = result->stats.io_uring;
+    for (int r = 0; r < bench->num_routes; r++) result->delivered += sink_packets[r];
+
+    free(block);
+    vban_sender_destroy(sender);
+    for (int r = 0; r < bench->num_routes; r++) vban_receiver_destroy(sinks[r]);
+    vban_relay_destroy(relay);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    bench_config_t bench = { 2, 20000, 1, 6992 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:r:p:")) != -1) {
+        switch (opt) {
+            case 'c':
+                bench.channels = atoi(optarg);
+                break;
+            case 'n':
+                bench.bursts = atoi(optarg);
+                break;
+            case 'r':
+                bench.num_routes = atoi(optarg);
+                break;
+            case 'p':
+                bench.port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-c channels] [-n bursts] [-r routes] [-p port]\n", argv[0]);
+                printf("Sends bursts of %d packets over loopback through a relay that renames\n", BURST_PACKETS);
+                printf("the stream for each route, and reports forwarded packets per second of\n");
+                printf("relay CPU time, with recvmmsg/sendmmsg and (in a URING=1 build) io_uring.\n");
+                printf("Uses ports port .. port+routes.\n");
+                return 1;
+        }
+    }
+    if (bench.num_routes < 1 || bench.num_routes > VBAN_RELAY_MAX_ROUTES) {
+        fprintf(stderr, "Routes must be 1-%d\n", VBAN_RELAY_MAX_ROUTES);
+        return 1;
+    }
+
+    bench_result_t results[2];
+    int runs = 0;
+    if (run(&bench, 1, &results[runs++]) != 0) return 1;
+    // Without io_uring support this is a second socket run, which isn't reported
+    if (run(&bench, 0, &results[runs]) != 0) return 1;
+    if (results[runs].io_uring) runs++;
+
+    printf("Channels: %d, routes: %d, %d bursts of %d packets\n\n", bench.channels, bench.num_routes, bench.bursts,
+           BURST_PACKETS);
+    printf("%-18s %10s %10s %10s %12s %10s %8s\n", "Backend", "Sent", "Forwarded", "Delivered", "Packets/s", "CPU ns/pkt",
+           "Wall s");
+    int failed = 0;
+    for (int i = 0; i < runs; i++) {
+        const bench_result_t* res = &results[i];
+        printf("%-18s %10llu %10llu %10llu %12.0f %10.0f %8.2f\n", res->io_uring ? "io_uring" : "recvmmsg/sendmmsg",
+               (unsigned long long)res->sent, (unsigned long long)res->stats.forwarded,
+               (unsigned long long)res->delivered, res->stats.forwarded / res->relay_cpu,
+               res->relay_cpu * 1e9 / res->stats.forwarded, res->elapsed);
+        if (res->stats.send_errors > 0) {
+            printf("  %llu send errors\n", (unsigned long long)res->stats.send_errors);
+        }
+        if (res->delivered != res->sent * bench.num_routes) failed = 1;
+    }
+    return failed;
+}
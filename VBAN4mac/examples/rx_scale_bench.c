@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <vban4mac/stream.h>
+#include "../src/network.h"
+#include "../src/net_util.h"
+
+#define SAMPLE_RATE 48000
+#define FRAMES_PER_PACKET 256
+#define BURST_PACKETS 8
+#define MAX_STREAMS NETWORK_MAX_WORKER_STREAMS
+#define MAX_SENDERS 16
+
+static double now_seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    int streams;
+    int max_workers;
+    double seconds;
+    uint16_t port;
+} bench_config_t;
+
+typedef struct {
+    int workers;
+    uint64_t sent;
+    uint64_t received;
+    double elapsed;
+    double rx_cpu;
+    int streams_per_worker[VBAN_MAX_RX_WORKERS];
+    int steering_ok;
+} bench_result_t;
+
+// One sender thread's share of the streams
+typedef struct {
+    vban_sender_t* senders[MAX_STREAMS];
+    int count;
+    atomic_int* stop;
+    uint64_t sent;
+    double cpu;
+} sender_thread_t;
+
+static void* send_streams(void* arg) {
+    sender_thread_t* thread = (sender_thread_t*)arg;
+    static int16_t block[BURST_PACKETS * FRAMES_PER_PACKET];
+
+    double t0 = now_seconds(CLOCK_THREAD_CPUTIME_ID);
+    while (!atomic_load(thread->stop)) {
+        for (int i = 0; i < thread->count; i++) {
+            int sent = vban_sender_push(thread->senders[i], block, BURST_PACKETS * FRAMES_PER_PACKET);
+            if (sent > 0) thread->sent += sent;
+        }
+    }
+    thread->cpu = now_seconds(CLOCK_THREAD_CPUTIME_ID) - t0;
+    return NULL;
+}
+
+// Receive every stream on one port with a number of workers
+// @return 0 on success, -1 if setup failed
+static int run(const bench_config_t* bench, int workers, bench_result_t* result) {
+    memset(result, 0, sizeof(*result));
+    result->workers = workers;
+
+    vban_context_t* contexts[MAX_STREAMS] = {0};
+    audio_buffer_t rings[MAX_STREAMS];
+    vban_sender_t* senders[MAX_STREAMS] = {0};
+    int status = 0;
+
+    for (int s = 0; s < bench->streams && status == 0; s++) {
+        vban_context_t* ctx = calloc(1, sizeof(vban_context_t));
+        if (!ctx || audio_buffer_create(&rings[s], 65536, sizeof(vban_sample_t)) != 0) {
+            free(ctx);
+            status = -1;
+            break;
+        }
+        contexts[s] = ctx;
+        ctx->rx_ring = &rings[s];
+        snprintf(ctx->streamname, sizeof(ctx->streamname), "Mic%d", s + 1);
+        if (network_init_with_options(ctx, "127.0.0.1", "127.0.0.1", bench->port, workers) != 0 ||
+            network_start(ctx, workers) != 0) {
+            status = -1;
+            break;
+        }
+        result->streams_per_worker[ctx->rx_worker->index]++;
+
+        vban_sender_config_t tx_config = {0};
+        tx_config.remote_ip = "127.0.0.1";
+        tx_config.port = bench->port;
+        tx_config.stream_name = ctx->streamname;
+        tx_config.sample_rate = SAMPLE_RATE;
+        tx_config.channels = 1;
+        tx_config.frames_per_packet = FRAMES_PER_PACKET;
+        senders[s] = vban_sender_create(&tx_config);
+        if (!senders[s]) status = -1;
+    }
+
+    if (status == 0) {
+        // As many sender threads as workers, so the senders keep up
+        int num_threads = workers < bench->streams ? workers : bench->streams;
+        if (num_threads > MAX_SENDERS) num_threads = MAX_SENDERS;
+        sender_thread_t threads[MAX_SENDERS];
+        pthread_t ids[MAX_SENDERS];
+        atomic_int stop = 0;
+        memset(threads, 0, sizeof(threads));
+        for (int s = 0; s < bench->streams; s++) {
+            sender_thread_t* thread = &threads[s % num_threads];
+            thread->senders[thread->count++] = senders[s];
+        }
+
+        double start = now_seconds(CLOCK_MONOTONIC);
+        double cpu_start = now_seconds(CLOCK_PROCESS_CPUTIME_ID);
+        for (int t = 0; t < num_threads; t++) {
+            threads[t].stop = &stop;
+            pthread_create(&ids[t], NULL, send_streams, &threads[t]);
+        }
+        usleep((useconds_t)(bench->seconds * 1e6));
+        atomic_store(&stop, 1);
+        double sender_cpu = 0;
+        for (int t = 0; t < num_threads; t++) {
+            pthread_join(ids[t], NULL);
+            result->sent += threads[t].sent;
+            sender_cpu += threads[t].cpu;
+        }
+        usleep(20000);  // Let the workers drain the socket buffers
+
+        result->elapsed = now_seconds(CLOCK_MONOTONIC) - start;
+        result->rx_cpu = now_seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start - sender_cpu;
+
+        // Every packet of a stream must have been decoded by the worker the
+        // steering program sends it to, which is where it was registered
+        network_rx_port_t* port = contexts[0]->rx_port;
+        uint64_t expected[VBAN_MAX_RX_WORKERS] = {0};
+        result->steering_ok = 1;
+        for (int s = 0; s < bench->streams; s++) {
+            uint64_t received = atomic_load(&contexts[s]->packets_received);
+            result->received += received;
+            expected[contexts[s]->rx_worker->index] += received;
+            if (received == 0) result->steering_ok = 0;
+        }
+        for (int w = 0; w < port->num_workers; w++) {
+            if (atomic_load(&port->workers[w].packets) != expected[w]) result->steering_ok = 0;
+        }
+    }
+
+    for (int s = 0; s < bench->streams; s++) {
+        if (senders[s]) vban_sender_destroy(senders[s]);
+        if (contexts[s]) {
+            network_stop(contexts[s]);
+            network_cleanup(contexts[s]);
+            audio_buffer_destroy(&rings[s]);
+            free(contexts[s]);
+        }
+    }
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    bench_config_t bench = { 16, 4, 2.0, 6994 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:w:d:p:")) != -1) {
+        switch (opt) {
+            case 's':
+                bench.streams = atoi(optarg);
+                break;
+            case 'w':
+                bench.max_workers = atoi(optarg);
+                break;
+            case 'd':
+                bench.seconds = atof(optarg);
+                break;
+            case 'p':
+                bench.port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-s streams] [-w max_workers] [-d seconds] [-p port]\n", argv[0]);
+                printf("Blasts mono streams over loopback at one port and receives them with\n");
+                printf("1, 2, 4 ... max_workers receive workers, one context per stream, reporting\n");
+                printf("decoded packets per second and receive CPU time per packet. Checks that\n");
+                printf("every stream is decoded only by the worker it is steered to.\n");
+                return 1;
+        }
+    }
+    if (bench.streams < 1 || bench.streams > MAX_STREAMS) {
+        fprintf(stderr, "Streams must be 1-%d\n", MAX_STREAMS);
+        return 1;
+    }
+    if (bench.max_workers < 1 || bench.max_workers > VBAN_MAX_RX_WORKERS) {
+        fprintf(stderr, "Workers must be 1-%d\n", VBAN_MAX_RX_WORKERS);
+        return 1;
+    }
+#ifndef __linux__
+    if (bench.max_workers > 1) {
+        printf("Multiple receive workers need Linux, measuring 1\n");
+        bench.max_workers = 1;
+    }
+#endif
+
+    // Run everything first: stopping the contexts prints as it goes
+    bench_result_t results[VBAN_MAX_RX_WORKERS];
+    int runs = 0;
+    for (int workers = 1; workers <= bench.max_workers; workers *= 2) {
+        if (run(&bench, workers, &results[runs++]) != 0) return 1;
+    }
+
+    printf("\nStreams: %d, %d frames per packet, %.1f s per run, %ld CPUs online\n\n", bench.streams,
+           FRAMES_PER_PACKET, bench.seconds, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-8s %-24s %10s %10s %12s %12s %8s\n", "Workers", "Streams per worker", "Sent", "Received",
+           "Packets/s", "CPU ns/pkt", "Loss %");
+    int failed = 0;
+    for (int i = 0; i < runs; i++) {
+        const bench_result_t* res = &results[i];
+        char spread[64] = "";
+        for (int w = 0; w < res->workers && strlen(spread) < sizeof(spread) - 8; w++) {
+            snprintf(spread + strlen(spread), sizeof(spread) - strlen(spread), w ? " %d" : "%d",
+                     res->streams_per_worker[w]);
+        }
+        double loss = res->sent ? 100.0 * (double)(res->sent - res->received) / res->sent : 0;
+        printf("%-8d %-24s %10llu %10llu %12.0f %12.0f %8.1f\n", res->workers, spread,
+               (unsigned long long)res->sent, (unsigned long long)res->received, res->received / res->elapsed,
+               res->received ? res->rx_cpu * 1e9 / res->received : 0, loss);
+        if (!res->steering_ok) {
+            printf("  A stream went unreceived or was decoded off its steered worker\n");
+            failed = 1;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <vban4mac/shm_ring.h>
+
+#define SHM_NAME "/vban-fanout"
+#define SAMPLE_RATE 48000
+#define BLOCK_FRAMES 256
+#define DEFAULT_SPEED 20.0          // Multiple of real time the writer is paced at
+#define DEFAULT_MIN_VERIFIED 99.0   // Percent of written frames every reader must verify
+
+typedef struct {
+    pthread_t thread;
+    int channels;
+    uint64_t total_frames;
+    uint64_t frames_read;
+    uint64_t torn_reads;
+    uint64_t overruns;
+    uint64_t mismatches;
+} reader_stats_t;
+
+static atomic_int readers_ready;
+
+// Every sample encodes its own position so readers can verify in place
+static int16_t synth_sample(uint64_t frame, int channel, int channels) {
+    return (int16_t)(frame * channels + channel);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* reader_thread(void* arg) {
+    reader_stats_t* stats = (reader_stats_t*)arg;
+    vban_shm_reader_t* reader = vban_shm_reader_open(SHM_NAME);
+    atomic_fetch_add(&readers_ready, 1);
+    if (!reader) return NULL;
+
+    while (vban_shm_reader_position(reader) < stats->total_frames) {
+        vban_shm_span_t span;
+        size_t frames = vban_shm_reader_peek(reader, &span, 4096);
+        if (frames == 0) {
+            sched_yield();  // Nothing new yet, let the writer run
+            continue;
+        }
+
+        // Verify in place against the position the span starts at
+        uint64_t frame = vban_shm_reader_position(reader);
+        uint64_t bad = 0;
+        for (int part = 0; part < 2; part++) {
+            for (size_t i = 0; i < span.frames[part]; i++, frame++) {
+                for (int ch = 0; ch < stats->channels; ch++) {
+                    if (span.ptr[part][i * stats->channels + ch] != synth_sample(frame, ch, stats->channels)) {
+                        bad++;
+                    }
+                }
+            }
+        }
+
+        if (vban_shm_reader_release(reader, frames) != 0) {
+            // Overwritten while being read, so the comparison is meaningless
+            stats->torn_reads++;
+        } else {
+            stats->mismatches += bad;
+            stats->frames_read += frames;
+        }
+    }
+
+    stats->overruns = vban_shm_reader_overruns(reader);
+    vban_shm_reader_close(reader);
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int channels = 2;
+    int num_readers = 8;
+    uint64_t total_frames = 4800000;
+    size_t capacity = 16384;
+    double speed = DEFAULT_SPEED;
+    double min_verified = DEFAULT_MIN_VERIFIED;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:r:n:f:x:m:")) != -1) {
+        switch (opt) {
+            case 'c':
+                channels = atoi(optarg);
+                break;
+            case 'r':
+                num_readers = atoi(optarg);
+                break;
+            case 'n':
+                total_frames = strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                capacity = (size_t)atoi(optarg);
+                break;
+            case 'x':
+                speed = atof(optarg);
+                break;
+            case 'm':
+                min_verified = atof(optarg);
+                break;
+            default:
+                printf("Usage: %s [-c channels] [-r readers] [-n frames] [-f ring_frames] [-x speed] [-m percent]\n",
+                       argv[0]);
+                printf("Writes synthetic audio into a shared-memory ring while several readers\n");
+                printf("verify it in place, and reports throughput. The writer is paced at %.0fx\n", DEFAULT_SPEED);
+                printf("real time, or as fast as it can with -x 0. The run fails on any mismatch,\n");
+                printf("or if a reader verifies less than -m percent (default %.0f) of the frames\n",
+                       DEFAULT_MIN_VERIFIED);
+                printf("written; an unpaced writer laps readers that share its CPUs, so lower it.\n");
+                return 1;
+        }
+    }
+    if (channels < 1 || num_readers < 1) {
+        fprintf(stderr, "Need at least one channel and one reader\n");
+        return 1;
+    }
+
+    vban_shm_writer_t* writer = vban_shm_writer_create(SHM_NAME, "Fanout", SAMPLE_RATE, channels, capacity);
+    if (!writer) return 1;
+
+    reader_stats_t* readers = calloc(num_readers, sizeof(reader_stats_t));
+    int16_t* block = malloc(BLOCK_FRAMES * channels * sizeof(int16_t));
+    if (!readers || !block) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (int r = 0; r < num_readers; r++) {
+        readers[r].channels = channels;
+        readers[r].total_frames = total_frames;
+        pthread_create(&readers[r].thread, NULL, reader_thread, &readers[r]);
+    }
+    while (atomic_load(&readers_ready) < num_readers) {
+        // Readers start at the live cursor, so wait until they are all attached
+    }
+
+    double start = now_seconds();
+    for (uint64_t frame = 0; frame < total_frames; ) {
+        size_t frames = BLOCK_FRAMES;
+        if (frames > total_frames - frame) frames = (size_t)(total_frames - frame);
+        for (size_t i = 0; i < frames; i++) {
+            for (int ch = 0; ch < channels; ch++) {
+                block[i * channels + ch] = synth_sample(frame + i, ch, channels);
+            }
+        }
+        vban_shm_writer_append(writer, block, frames * channels);
+        vban_shm_writer_commit(writer);
+        frame += frames;
+
+        if (speed > 0.0) {
+            double ahead = frame / (SAMPLE_RATE * speed) - (now_seconds() - start);
+            if (ahead > 0.0) {
+                struct timespec ts = { (time_t)ahead, (long)((ahead - (time_t)ahead) * 1e9) };
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+    double write_elapsed = now_seconds() - start;
+
+    uint64_t frames_read = 0, torn_reads = 0, overruns = 0, mismatches = 0;
+    double worst_verified = 100.0;
+    for (int r = 0; r < num_readers; r++) {
+        pthread_join(readers[r].thread, NULL);
+        double verified = total_frames ? 100.0 * readers[r].frames_read / total_frames : 100.0;
+        if (verified < worst_verified) worst_verified = verified;
+        frames_read += readers[r].frames_read;
+        torn_reads += readers[r].torn_reads;
+        overruns += readers[r].overruns;
+        mismatches += readers[r].mismatches;
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("Channels:          %d\n", channels);
+    printf("Readers:           %d\n", num_readers);
+    printf("Ring frames:       %zu\n", capacity);
+    printf("Writer:            %.2f Mframes/s\n", total_frames / write_elapsed / 1e6);
+    printf("Readers:           %.2f Mframes/s verified in total, %.1f%% of frames written\n",
+           frames_read / elapsed / 1e6, 100.0 * frames_read / ((double)total_frames * num_readers));
+    printf("Worst reader:      %.1f%% of frames verified, at least %.1f%% required\n", worst_verified,
+           min_verified);
+    printf("Overruns:          %llu (%llu torn reads)\n", (unsigned long long)overruns,
+           (unsigned long long)torn_reads);
+    printf("Sample mismatches: %llu\n", (unsigned long long)mismatches);
+
+    free(block);
+    free(readers);
+    vban_shm_writer_destroy(writer);
+    return mismatches == 0 && frames_read > 0 && worst_verified >= min_verified ? 0 : 1;
+}
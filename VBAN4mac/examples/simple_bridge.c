@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <signal.h>
 #include <unistd.h>
+#ifndef VBAN_JACK
 #include <CoreAudio/CoreAudio.h>
+#endif
 #include <vban4mac/vban.h>
 #include <vban4mac/types.h>
 #include <vban4mac/config.h>
@@ -12,6 +14,7 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <ctype.h>
 
 static volatile sig_atomic_t running = 1;
 
@@ -98,9 +101,10 @@ int main(int argc, char* argv[]) {
     int verbose = 0;
     int opt;
     char* config_file = NULL;
+    char* trace_file = NULL;
 
     // Parse command line options
-    while ((opt = getopt(argc, argv, "vc:")) != -1) {
+    while ((opt = getopt(argc, argv, "vc:t:")) != -1) {
         switch (opt) {
             case 'v':
                 verbose = 1;
@@ -108,11 +112,15 @@ int main(int argc, char* argv[]) {
             case 'c':
                 config_file = optarg;
                 break;
+            case 't':
+                trace_file = optarg;
+                break;
             default:
-                printf("Usage: %s [-v] -c <config_file>\n", argv[0]);
+                printf("Usage: %s [-v] [-t <trace_file>] -c <config_file>\n", argv[0]);
                 printf("Options:\n");
                 printf("  -v            Verbose mode (no daemonization)\n");
                 printf("  -c <file>     Configuration file\n");
+                printf("  -t <file>     Write a Chrome trace (requires TRACE=1 build)\n");
                 return 1;
         }
     }
@@ -162,6 +170,13 @@ int main(int argc, char* argv[]) {
     signal(SIGHUP, handle_signal);
     signal(SIGINT, handle_signal);
 
+#ifdef VBAN_JACK
+    // With JACK, the device settings name the ports to connect to
+    if (!config.input_device[0] || !config.output_device[0]) {
+        syslog(LOG_ERR, "Configure input_device and output_device as JACK port names");
+        goto cleanup;
+    }
+#else
     // Get devices from config
     AudioDeviceID inputDevice = 0, outputDevice = 0;
     
@@ -188,14 +203,38 @@ int main(int argc, char* argv[]) {
         syslog(LOG_ERR, "No output device configured");
         goto cleanup;
     }
+#endif
 
     // Initialize VBAN
-    vban_handle_t vban = vban_init_with_port(config.remote_ip, config.stream_name, config.port);
+    vban_options_t options = {0};
+    options.remote_ip = config.remote_ip;
+    options.stream_name = config.stream_name;
+    options.port = config.port;
+    options.bind_ip = config.bind_ip;
+    options.rx_workers = config.rx_workers;
+    options.event_threads = config.event_threads;
+    options.shm_name = config.shm_name[0] ? config.shm_name : NULL;
+    options.dtx.threshold_db = config.silence_threshold_db;
+    options.dtx.hangover_ms = config.silence_hangover_ms;
+    options.dtx.keepalive_ms = config.keepalive_ms;
+    options.catchup.max_speed_pct = config.catchup_max_pct;
+    options.catchup.window_ms = config.catchup_window_ms;
+    options.input_channels = config.input_channels;
+    options.output_channels = config.output_channels;
+    vban_handle_t vban = vban_init_with_options(&options);
     if (!vban) {
         syslog(LOG_ERR, "Failed to initialize VBAN");
         goto cleanup;
     }
 
+#ifdef VBAN_JACK
+    if (audio_connect_input(config.input_device) != noErr ||
+        audio_connect_output(config.output_device) != noErr) {
+        syslog(LOG_ERR, "Failed to connect JACK ports");
+        vban_cleanup(vban);
+        goto cleanup;
+    }
+#else
     // Set input and output devices
     if (audio_set_input_device(inputDevice) != noErr) {
         syslog(LOG_ERR, "Failed to set input device");
@@ -208,10 +247,15 @@ int main(int argc, char* argv[]) {
         vban_cleanup(vban);
         goto cleanup;
     }
+#endif
 
     syslog(LOG_INFO, "VBAN bridge started - IP: %s, Stream: %s, Port: %u",
            config.remote_ip, config.stream_name, config.port);
 
+    if (trace_file && vban_trace_start(trace_file) != 0) {
+        syslog(LOG_WARNING, "Failed to start trace export to %s", trace_file);
+    }
+
     // Main loop
     while (running && vban_is_running(vban)) {
         sleep(1);
@@ -219,6 +263,7 @@ int main(int argc, char* argv[]) {
 
     // Cleanup
     syslog(LOG_INFO, "VBAN bridge stopping...");
+    vban_trace_stop();
     vban_cleanup(vban);
     syslog(LOG_INFO, "VBAN bridge stopped");
 
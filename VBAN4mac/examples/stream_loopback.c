@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <vban4mac/stream.h>
+
+#define SAMPLE_RATE 48000
+#define BLOCK_FRAMES 480  // 10 ms, deliberately not a multiple of the packet size
+#define SINE_PERIOD 128   // 375 Hz at 48 kHz
+
+static int16_t sine_table[SINE_PERIOD];
+
+// Synthetic 375 Hz sine, phase-shifted per channel
+static int16_t synth_sample(uint64_t frame, int channel) {
+    return sine_table[(frame + channel * 16) % SINE_PERIOD];
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void count_packet(void* user, const vban_header_t* header, size_t frames) {
+    (void)header;
+    (void)frames;
+    (*(uint64_t*)user)++;
+}
+
+int main(int argc, char* argv[]) {
+    int channels = 2;
+    int blocks = 20000;
+    uint16_t port = 6990;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:p:")) != -1) {
+        switch (opt) {
+            case 'c':
+                channels = atoi(optarg);
+                break;
+            case 'n':
+                blocks = atoi(optarg);
+                break;
+            case 'p':
+                port = (uint16_t)atoi(optarg);
+                break;
+            default:
+                printf("Usage: %s [-c channels] [-n blocks] [-p port]\n", argv[0]);
+                printf("Streams synthetic audio through a sender and receiver over loopback\n");
+                printf("as fast as possible, verifies it and reports throughput.\n");
+                return 1;
+        }
+    }
+
+    for (int i = 0; i < SINE_PERIOD; i++) {
+        sine_table[i] = (int16_t)(sin(2.0 * M_PI * i / SINE_PERIOD) * 16383.0);
+    }
+
+    uint64_t packets_received = 0;
+
+    vban_receiver_config_t rx_config = {0};
+    rx_config.bind_ip = "127.0.0.1";
+    rx_config.port = port;
+    rx_config.remote_ip = "127.0.0.1";
+    rx_config.stream_name = "Loopback";
+    rx_config.channels = channels;
+    rx_config.on_packet = count_packet;
+    rx_config.user = &packets_received;
+
+    vban_sender_config_t tx_config = {0};
+    tx_config.remote_ip = "127.0.0.1";
+    tx_config.port = port;
+    tx_config.stream_name = "Loopback";
+    tx_config.sample_rate = SAMPLE_RATE;
+    tx_config.channels = channels;
+
+    vban_receiver_t* receiver = vban_receiver_create(&rx_config);
+    vban_sender_t* sender = vban_sender_create(&tx_config);
+    if (!receiver || !sender) {
+        fprintf(stderr, "Failed to create sender/receiver\n");
+        vban_receiver_destroy(receiver);
+        vban_sender_destroy(sender);
+        return 1;
+    }
+
+    int16_t* block = malloc(BLOCK_FRAMES * channels * sizeof(int16_t));
+    int16_t* out = malloc(4096 * channels * sizeof(int16_t));
+    if (!block || !out) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    uint64_t frames_sent = 0, frames_pulled = 0, mismatches = 0;
+    int packets_sent = 0;
+    double start = now_seconds();
+
+    for (int b = 0; b < blocks; b++) {
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            for (int ch = 0; ch < channels; ch++) {
+                block[i * channels + ch] = synth_sample(frames_sent + i, ch);
+            }
+        }
+        int sent = vban_sender_push(sender, block, BLOCK_FRAMES);
+        if (sent < 0) {
+            fprintf(stderr, "Send failed\n");
+            break;
+        }
+        packets_sent += sent;
+        frames_sent += BLOCK_FRAMES;
+
+        // Drain whatever has arrived and check it against the generator
+        vban_receiver_process(receiver, 0);
+        size_t available = vban_receiver_available(receiver);
+        if (available > 4096) available = 4096;
+        size_t frames = vban_receiver_pull(receiver, out, available);
+        for (size_t i = 0; i < frames; i++) {
+            for (int ch = 0; ch < channels; ch++) {
+                if (out[i * channels + ch] != synth_sample(frames_pulled + i, ch)) mismatches++;
+            }
+        }
+        frames_pulled += frames;
+    }
+
+    double elapsed = now_seconds() - start;
+
+    vban_jitter_stats_t jitter;
+    vban_receiver_get_jitter_stats(receiver, &jitter);
+
+    printf("Channels:          %d\n", channels);
+    printf("Packets sent:      %d\n", packets_sent);
+    printf("Packets received:  %llu\n", (unsigned long long)packets_received);
+    printf("Frames pulled:     %llu of %llu\n", (unsigned long long)frames_pulled,
+           (unsigned long long)frames_sent);
+    printf("Sample mismatches: %llu\n", (unsigned long long)mismatches);
+    printf("Throughput:        %.0f packets/s, %.2f Mframes/s (%.0fx real time)\n",
+           packets_sent / elapsed, frames_pulled / elapsed / 1e6,
+           frames_pulled / elapsed / SAMPLE_RATE);
+    printf("Arrival jitter:    %.3f ms (max gap %.2f ms, %u bursts of up to %u packets)\n",
+           jitter.jitter_ms, jitter.max_gap_ms, jitter.bursts, jitter.max_burst_packets);
+
+    free(block);
+    free(out);
+    vban_sender_destroy(sender);
+    vban_receiver_destroy(receiver);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#include <vban4mac/relay.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+    (void)sig;  // Unused parameter
+    running = 0;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [-b bind_ip] [-p port] [-s source_ip] -r route [-r route ...]\n", program);
+    printf("Forwards VBAN datagrams without decoding them. A route is a comma-separated\n");
+    printf("list of: to=ip (required), port=n, stream=name (default: every stream),\n");
+    printf("rename=name, renumber\n");
+    printf("Example: %s -r stream=Mic1,to=10.0.1.20 -r stream=Mic1,to=10.0.2.20,rename=Mic1B\n", program);
+}
+
+// Parse "to=10.0.0.5,port=6980,stream=Mic1,rename=Mic1B,renumber" in place
+static int parse_route(char* spec, vban_relay_route_t* route) {
+    memset(route, 0, sizeof(*route));
+
+    char* saveptr = NULL;
+    for (char* item = strtok_r(spec, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        char* value = strchr(item, '=');
+        if (value) *value++ = '\0';
+
+        if (strcmp(item, "to") == 0 && value)
+            route->remote_ip = value;
+        else if (strcmp(item, "port") == 0 && value)
+            route->port = (uint16_t)atoi(value);
+        else if (strcmp(item, "stream") == 0 && value)
+            route->stream_name = value;
+        else if (strcmp(item, "rename") == 0 && value)
+            route->rename = value;
+        else if (strcmp(item, "renumber") == 0)
+            route->renumber = 1;
+        else {
+            fprintf(stderr, "Unknown route option: %s\n", item);
+            return -1;
+        }
+    }
+
+    return route->remote_ip ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    vban_relay_config_t config = {0};
+    vban_relay_route_t routes[VBAN_RELAY_MAX_ROUTES];
+    int num_routes = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:p:s:r:h")) != -1) {
+        switch (opt) {
+            case 'b':
+                config.bind_ip = optarg;
+                break;
+            case 'p':
+                config.port = (uint16_t)atoi(optarg);
+                break;
+            case 's':
+                config.source_ip = optarg;
+                break;
+            case 'r':
+                if (num_routes >= VBAN_RELAY_MAX_ROUTES || parse_route(optarg, &routes[num_routes]) != 0) {
+                    fprintf(stderr, "Invalid route\n");
+                    return 1;
+                }
+                num_routes++;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (num_routes == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    vban_relay_t* relay = vban_relay_create(&config);
+    if (!relay) return 1;
+    for (int i = 0; i < num_routes; i++) {
+        if (vban_relay_add_route(relay, &routes[i]) != 0) {
+            vban_relay_destroy(relay);
+            return 1;
+        }
+    }
+
+    signal(SIGTERM, handle_signal);
+    signal(SIGHUP, handle_signal);
+    signal(SIGINT, handle_signal);
+
+    vban_relay_stats_t initial;
+    vban_relay_get_stats(relay, &initial);
+    printf("VBAN relay started with %d route(s)%s\n", num_routes, initial.io_uring ? " on io_uring" : "");
+
+    time_t last_report = time(NULL);
+    while (running) {
+        if (vban_relay_process(relay, 500) < 0) {
+            perror("Relay receive failed");
+            break;
+        }
+
+        time_t now = time(NULL);
+        if (now - last_report >= 10) {
+            vban_relay_stats_t stats;
+            vban_relay_get_stats(relay, &stats);
+            printf("Received %llu, forwarded %llu, unmatched %llu, send errors %llu\n",
+                   (unsigned long long)stats.received, (unsigned long long)stats.forwarded,
+                   (unsigned long long)stats.unmatched, (unsigned long long)stats.send_errors);
+            last_report = now;
+        }
+    }
+
+    printf("VBAN relay stopped\n");
+    vban_relay_destroy(relay);
+    return 0;
+}
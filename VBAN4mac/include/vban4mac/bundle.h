@@ -0,0 +1,122 @@
+#ifndef VBAN4MAC_BUNDLE_H
+#define VBAN4MAC_BUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+#include "stream.h"
+
+// Bundling of mono capture sources (e.g. one per mic) into a single
+// multichannel VBAN stream, one channel per source, and the receiving side
+// that splits it back into one mono output per channel. One stream of N
+// channels needs one header, send and receive per packet where N mono
+// streams need N, and packets carry as many frames as fit in a datagram.
+//
+// Sources push whatever block sizes their capture delivers, from any
+// thread. Frames go out once every source has delivered them, so the
+// channels of a bundled frame were captured together. A source that falls
+// more than max_skew_frames behind the others is padded with silence so a
+// stalled mic, or one that hasn't started yet, doesn't hold the rest back.
+// When it delivers again, it is padded up to the leading source's newest
+// frame, so its audio is back in phase with the others to within one
+// capture block rather than max_skew_frames late.
+//
+// Sources are not resampled, so they should run off one clock. A source on
+// a slower clock falls behind a little with every block, holding the whole
+// bundle back, until it is max_skew_frames behind: it is then padded and
+// realigned, a slip of up to max_skew_frames of silence. A source on a
+// faster clock makes the others slip the same way. The slips are counted
+// in realignments.
+
+#define VBAN_BUNDLE_MAX_SOURCES 256
+
+typedef struct vban_bundler_t vban_bundler_t;
+typedef struct vban_unbundler_t vban_unbundler_t;
+
+typedef struct {
+    vban_sender_config_t sender;  // Destination and format; channels is the number of sources
+    size_t max_skew_frames;       // Lag behind the leading source before padding (0 = 1024)
+} vban_bundler_config_t;
+
+typedef struct {
+    uint64_t frames_sent;         // Bundled frames
+    uint64_t packets_sent;
+    uint64_t frames_padded;       // Source frames filled with silence after falling behind, over all sources
+    uint64_t realignments;        // Padded sources put back in phase when they delivered again, including clock slips
+} vban_bundler_stats_t;
+
+/**
+ * Create a bundler and its sender
+ * @param config Destination, stream format and alignment tolerance
+ * @return Bundler or NULL on error
+ */
+vban_bundler_t* vban_bundler_create(const vban_bundler_config_t* config);
+
+/**
+ * Add captured frames from one source and send every packet all sources
+ * have now delivered. Safe to call from several threads.
+ * @param bundler The bundler
+ * @param source Source index, its channel in the stream
+ * @param frames Mono host-order samples
+ * @param num_frames Number of frames
+ * @return Number of packets sent, negative value on error
+ */
+int vban_bundler_push(vban_bundler_t* bundler, int source, const int16_t* frames, size_t num_frames);
+
+/**
+ * Frames and packets sent, and how often sources had to be padded
+ */
+void vban_bundler_get_stats(vban_bundler_t* bundler, vban_bundler_stats_t* stats);
+
+/**
+ * Destroy a bundler (frames not yet delivered by every source are discarded)
+ */
+void vban_bundler_destroy(vban_bundler_t* bundler);
+
+/**
+ * Create an unbundler and its receiver
+ * @param config Receiver settings; channels is the number of outputs
+ * @return Unbundler or NULL on error
+ */
+vban_unbundler_t* vban_unbundler_create(const vban_receiver_config_t* config);
+
+/**
+ * Socket to wait on in the caller's own poll/epoll loop
+ */
+int vban_unbundler_fd(const vban_unbundler_t* unbundler);
+
+/**
+ * Receive pending packets and split their channels into the outputs
+ * @param unbundler The unbundler
+ * @param timeout_ms How long to wait for the first datagram (0 = don't wait, -1 = forever)
+ * @return Number of packets accepted, negative value on error
+ */
+int vban_unbundler_process(vban_unbundler_t* unbundler, int timeout_ms);
+
+/**
+ * Number of frames ready to pull from one output
+ */
+size_t vban_unbundler_available(vban_unbundler_t* unbundler, int output);
+
+/**
+ * Copy one output's buffered frames into the caller's buffer, filling what
+ * is missing with silence. Outputs can be pulled from different threads.
+ * @param unbundler The unbundler
+ * @param output Output index, the channel in the stream
+ * @param out Mono destination of num_frames samples
+ * @param num_frames Number of frames wanted
+ * @return Number of frames that came from the network
+ */
+size_t vban_unbundler_pull(vban_unbundler_t* unbundler, int output, int16_t* out, size_t num_frames);
+
+/**
+ * The underlying receiver, for its jitter and impairment statistics
+ */
+vban_receiver_t* vban_unbundler_receiver(vban_unbundler_t* unbundler);
+
+/**
+ * Destroy an unbundler and its receiver
+ */
+void vban_unbundler_destroy(vban_unbundler_t* unbundler);
+
+#endif /* VBAN4MAC_BUNDLE_H */
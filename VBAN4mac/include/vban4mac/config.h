@@ -1,14 +1,28 @@
 #ifndef VBAN4MAC_CONFIG_H
 #define VBAN4MAC_CONFIG_H
 
+#include <stdint.h>
+#ifndef VBAN_JACK
 #include <CoreAudio/CoreAudio.h>
+#endif
 
 typedef struct {
     char remote_ip[64];
     char stream_name[64];
     uint16_t port;
+    char bind_ip[64];
+    int rx_workers;
+    int event_threads;
+    char shm_name[64];
+    int silence_threshold_db;
+    int silence_hangover_ms;
+    int keepalive_ms;
     char input_device[128];
     char output_device[128];
+    int catchup_max_pct;
+    int catchup_window_ms;
+    int input_channels;
+    int output_channels;
 } vban_config_t;
 
 /**
@@ -19,6 +33,7 @@ typedef struct {
  */
 int load_config(const char* filename, vban_config_t* config);
 
+#ifndef VBAN_JACK
 /**
  * Find audio device ID by name
  * @param device_name Name of the device to find
@@ -26,5 +41,6 @@ int load_config(const char* filename, vban_config_t* config);
  * @return Device ID if found, 0 if not found
  */
 AudioDeviceID find_device_by_name(const char* device_name, int is_input);
+#endif
 
 #endif // VBAN4MAC_CONFIG_H 
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef VBAN4MAC_DSP_H
+#define VBAN4MAC_DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+// Work-stealing pool that runs per-stream DSP (resampling, mixing, format
+// conversion...) on received packets across cores, between the network
+// receive stage and the output buffers. Each worker has its own deque and
+// steals from the others when idle. Packets of a stream may be processed
+// in parallel, but are always delivered to its output in arrival order.
+// At most VBAN_DSP_WINDOW packets per stream are in flight; beyond that,
+// packets are dropped rather than queued, which bounds the added latency.
+
+#define VBAN_DSP_WINDOW 32
+
+typedef struct vban_dsp_pool_t vban_dsp_pool_t;
+
+/**
+ * Process one packet of interleaved samples in place, in the build's
+ * vban_sample_t format (float32 unless built with VBAN_SAMPLE_INT16). Called
+ * on a pool thread, possibly concurrently for other packets of the same
+ * stream, so it must not keep state between packets without locking.
+ */
+typedef void (*vban_dsp_fn)(void* user, vban_sample_t* samples, size_t frames, int channels);
+
+/**
+ * Create a pool and start its worker threads
+ * @param threads Worker threads, 0 for one per online CPU
+ * @return Pool or NULL on error
+ */
+vban_dsp_pool_t* vban_dsp_pool_create(int threads);
+
+/**
+ * Stop the workers and free the pool. Packets still queued are processed
+ * and delivered on the calling thread first. Receivers still using the
+ * pool then process their packets on their own receive thread; stop them
+ * receiving before calling this, and destroy them before or after.
+ */
+void vban_dsp_pool_destroy(vban_dsp_pool_t* pool);
+
+#endif /* VBAN4MAC_DSP_H */
@@ -0,0 +1,51 @@
+#ifndef VBAN4MAC_PACER_H
+#define VBAN4MAC_PACER_H
+
+#include <stdint.h>
+
+// Host-wide send scheduler. Capture callbacks of every stream on a host
+// fire on the same device period, so senders pushing straight to the
+// network leave in one synchronized burst per period, which shallow NIC
+// and switch queues drop from. Senders created with a pacer hand their
+// packets to its thread instead, which spreads the streams evenly across
+// each packet interval (every stream gets its own phase slot) and holds
+// each stream and each destination to a token bucket, so neither can send
+// more than its burst back to back.
+
+#define VBAN_PACER_MAX_STREAMS 256
+
+typedef struct vban_pacer_t vban_pacer_t;
+
+typedef struct {
+    int stream_burst;         // Packets one stream may send back to back (0 = 1)
+    int destination_burst;    // Packets one destination may receive back to back (0 = 2)
+} vban_pacer_config_t;
+
+typedef struct {
+    uint64_t packets_paced;   // Packets sent by the scheduler
+    uint64_t delay_total_ns;  // Sum of the time packets waited, for the mean
+    uint64_t delay_max_ns;    // Longest a packet waited
+    uint64_t packets_dropped; // Packets refused because a stream's queue was full
+    uint64_t send_errors;     // Sends that failed
+} vban_pacer_stats_t;
+
+/**
+ * Create a pacer and start its thread
+ * @param config Bucket depths, NULL for the defaults
+ * @return Pacer or NULL on error
+ */
+vban_pacer_t* vban_pacer_create(const vban_pacer_config_t* config);
+
+/**
+ * Pacing statistics of every stream on the pacer
+ * @param pacer The pacer
+ * @param stats Filled with the counters
+ */
+void vban_pacer_get_stats(vban_pacer_t* pacer, vban_pacer_stats_t* stats);
+
+/**
+ * Stop the thread and free the pacer (destroy the senders using it first)
+ */
+void vban_pacer_destroy(vban_pacer_t* pacer);
+
+#endif /* VBAN4MAC_PACER_H */
@@ -0,0 +1,104 @@
+#ifndef VBAN4MAC_PLAYOUT_H
+#define VBAN4MAC_PLAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+// Grouped playout of related streams (e.g. separate mics at one venue).
+// Members share one playout clock and one target latency instead of each
+// buffering independently. Every member's nuFrame progression places its
+// packets on its own sample timeline, and the earliest arrivals seen map
+// that timeline onto the common one, so frames sent at the same moment are
+// pulled together whatever jitter, loss or start time each stream had.
+// Streams are assumed to leave their senders as they are captured and to
+// take the same network path; differences there can't be seen from the
+// receiving side.
+
+#define VBAN_PLAYOUT_MAX_MEMBERS 64
+
+typedef struct vban_playout_group_t vban_playout_group_t;
+
+typedef struct {
+    int sample_rate;          // Hz, shared by all members
+    uint32_t target_frames;   // Common latency over the earliest arrivals, 0 = follow the members' jitter (rises at once, falls after 5 s)
+    size_t buffer_frames;     // Per-member buffer capacity (0 = 8192 frames)
+} vban_playout_group_config_t;
+
+typedef struct {
+    uint32_t target_frames;   // Latency applied to every member
+    int64_t skew_frames;      // How much later this member's audio arrives than the earliest member's
+    uint64_t frames_played;   // Frames pulled from the buffer (gaps of lost or suppressed packets are silence)
+    uint64_t frames_underrun; // Frames pulled before they arrived, played as silence
+    uint64_t packets_late;    // Packets that arrived after their frames were played
+    uint64_t slips;           // Times the read position was corrected to stay aligned
+    uint64_t packets_rejected; // Packets at another sample rate than the group's
+} vban_playout_member_stats_t;
+
+/**
+ * Create a group
+ * @param config Sample rate, target latency and buffering
+ * @return Group or NULL on error
+ */
+vban_playout_group_t* vban_playout_group_create(const vban_playout_group_config_t* config);
+
+/**
+ * Add a stream to the group. Receivers created with the group set in
+ * their config join by themselves.
+ * @param group The group
+ * @param channels Channels of the stream
+ * @param sample_rate Rate of the stream, which must be the group's (0 = not known; packets at another rate are refused)
+ * @return Member index (the lowest free one, removed members' indexes are reused), -1 on error
+ */
+int vban_playout_group_add(vban_playout_group_t* group, int channels, int sample_rate);
+
+/**
+ * Take a stream out of the group and free its buffer. Receivers in the
+ * group leave by themselves when destroyed.
+ * @param group The group
+ * @param member Member index
+ * @return 0 on success, -1 if there is no such member
+ */
+int vban_playout_group_remove(vban_playout_group_t* group, int member);
+
+/**
+ * Hand a received packet to a member (receivers in the group do this for
+ * each accepted packet). Safe to call from any thread.
+ * @param group The group
+ * @param member Member index
+ * @param header The packet's header
+ * @param samples Interleaved host-order samples
+ * @param arrival_ns Receive time on CLOCK_REALTIME, as kernel receive timestamps are
+ * @return 0 on success, -1 if the packet doesn't match the member
+ */
+int vban_playout_group_push(vban_playout_group_t* group, int member, const vban_header_t* header,
+                            const int16_t* samples, int64_t arrival_ns);
+
+/**
+ * Pull the same stretch of the common timeline from every member. The
+ * first pull anchors the timeline at now_ns; every pull then advances it
+ * by num_frames, so the caller's output clock drives playout.
+ * @param group The group
+ * @param now_ns Time the first frame is pulled for on CLOCK_REALTIME, 0 for now
+ * @param out One interleaved destination of num_frames * channels samples per member, by index
+ *            (entries at removed members' indexes are left alone and may be NULL)
+ * @param num_frames Number of frames
+ * @return 0 on success, -1 on error
+ */
+int vban_playout_group_pull(vban_playout_group_t* group, int64_t now_ns, int16_t* const* out, size_t num_frames);
+
+/**
+ * Alignment and playout statistics of one member
+ * @param group The group
+ * @param member Member index
+ * @param stats Filled with the statistics
+ * @return 0 on success, -1 on error
+ */
+int vban_playout_group_get_stats(vban_playout_group_t* group, int member, vban_playout_member_stats_t* stats);
+
+/**
+ * Free a group (destroy receivers using it first)
+ */
+void vban_playout_group_destroy(vban_playout_group_t* group);
+
+#endif /* VBAN4MAC_PLAYOUT_H */
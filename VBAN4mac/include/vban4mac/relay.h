@@ -0,0 +1,82 @@
+#ifndef VBAN4MAC_RELAY_H
+#define VBAN4MAC_RELAY_H
+
+#include <stdint.h>
+#include "types.h"
+
+// Relay that forwards VBAN datagrams between network segments without
+// decoding them. Datagrams are received and sent in batches; each one is
+// forwarded to every matching route with the payload sent straight from
+// the receive buffer. Only the 28-byte header may be rewritten, per route.
+// Like the stream API, a relay owns no threads.
+//
+// Linux builds with URING=1 receive and send through io_uring instead,
+// with datagrams landing in buffers registered with the kernel. Such a
+// relay must be processed from a single thread.
+
+#define VBAN_RELAY_MAX_ROUTES 16
+
+typedef struct vban_relay_t vban_relay_t;
+
+typedef struct {
+    const char* bind_ip;      // Local address, NULL for any (IPv6 binds are dual-stack)
+    uint16_t port;            // Local UDP port (0 = VBAN_DEFAULT_PORT)
+    const char* source_ip;    // Only relay datagrams from this host, NULL for any
+    int use_sockets;          // Use recvmmsg/sendmmsg even when built with io_uring
+} vban_relay_config_t;
+
+typedef struct {
+    const char* stream_name;  // Stream to forward, NULL for every stream
+    const char* remote_ip;    // Destination host
+    uint16_t port;            // Destination port (0 = VBAN_DEFAULT_PORT)
+    const char* rename;       // Replace the stream name, NULL to keep it
+    int renumber;             // Replace nuFrame with a counter of packets sent on this route
+} vban_relay_route_t;
+
+typedef struct {
+    uint64_t received;        // Datagrams received
+    uint64_t forwarded;       // Datagrams sent, counted once per route
+    uint64_t unmatched;       // Datagrams no route wanted (or not VBAN)
+    uint64_t send_errors;     // Datagrams the kernel refused to send
+    int io_uring;             // 1 if the relay runs on io_uring (URING=1 build on Linux 6.1+)
+} vban_relay_stats_t;
+
+/**
+ * Create a relay and bind its socket
+ * @param config Bind address and source filter
+ * @return Relay or NULL on error
+ */
+vban_relay_t* vban_relay_create(const vban_relay_config_t* config);
+
+/**
+ * Add a forwarding rule. A datagram is sent once for every route it matches.
+ * @param relay The relay
+ * @param route Stream to match, destination and header rewrites
+ * @return 0 on success, -1 on error
+ */
+int vban_relay_add_route(vban_relay_t* relay, const vban_relay_route_t* route);
+
+/**
+ * Socket to wait on in the caller's own poll/epoll loop
+ */
+int vban_relay_fd(const vban_relay_t* relay);
+
+/**
+ * Receive and forward every pending datagram
+ * @param relay The relay
+ * @param timeout_ms How long to wait for the first datagram (0 = don't wait, -1 = forever)
+ * @return Number of datagrams received, negative value on error
+ */
+int vban_relay_process(vban_relay_t* relay, int timeout_ms);
+
+/**
+ * Counters since the relay was created
+ */
+void vban_relay_get_stats(const vban_relay_t* relay, vban_relay_stats_t* stats);
+
+/**
+ * Close the socket and free the relay
+ */
+void vban_relay_destroy(vban_relay_t* relay);
+
+#endif /* VBAN4MAC_RELAY_H */
@@ -0,0 +1,121 @@
+#ifndef VBAN4MAC_SHM_RING_H
+#define VBAN4MAC_SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Shared-memory output rings. A receiver publishes decoded audio into a
+// named POSIX shared-memory object (shm_open) holding this header followed
+// by a ring of interleaved host-order int16 frames. Any number of local
+// processes can map it read-only and consume frames in place: the data
+// path involves no copies and no syscalls, only atomic loads of the write
+// cursor. Readers that fall more than a ring behind are resynced.
+
+#define VBAN_SHM_MAGIC 0x5642534D   // 'VBSM'
+#define VBAN_SHM_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t sample_format;         // VBAN_DATATYPE_INT16
+    uint32_t capacity_frames;       // Power of two
+    uint64_t data_offset;           // Byte offset of the ring from the start of the mapping
+    char stream_name[16];
+    _Alignas(64) _Atomic uint64_t write_frames;  // Total frames ever published (write cursor)
+    _Atomic uint64_t reserve_frames;             // Frames the writer may be overwriting
+} vban_shm_header_t;
+
+// Frames readable in place, split in two when they wrap around the ring
+typedef struct {
+    const int16_t* ptr[2];
+    size_t frames[2];
+} vban_shm_span_t;
+
+typedef struct vban_shm_writer_t vban_shm_writer_t;
+typedef struct vban_shm_reader_t vban_shm_reader_t;
+
+/**
+ * Create (or replace) a named ring
+ * @param name POSIX shared memory name, e.g. "/vban-stream1"
+ * @param stream_name VBAN stream name recorded in the header
+ * @param sample_rate Sample rate in Hz
+ * @param channels Channels per frame
+ * @param capacity_frames Ring size, rounded up to a power of two
+ * @return Writer or NULL on error
+ */
+vban_shm_writer_t* vban_shm_writer_create(const char* name, const char* stream_name,
+                                          int sample_rate, int channels, size_t capacity_frames);
+
+/**
+ * Channels per frame of a writer's ring
+ */
+int vban_shm_writer_channels(const vban_shm_writer_t* writer);
+
+/**
+ * Copy samples into the ring without publishing them yet
+ * @param writer The writer
+ * @param samples Interleaved samples
+ * @param num_samples Number of samples (need not be whole frames)
+ */
+void vban_shm_writer_append(vban_shm_writer_t* writer, const int16_t* samples, size_t num_samples);
+
+/**
+ * Publish everything appended so far (must add up to whole frames)
+ */
+void vban_shm_writer_commit(vban_shm_writer_t* writer);
+
+/**
+ * Unmap and unlink the ring. Mapped readers keep their view until they close.
+ */
+void vban_shm_writer_destroy(vban_shm_writer_t* writer);
+
+/**
+ * Map an existing ring read-only, starting at the current write cursor
+ * @param name POSIX shared memory name
+ * @return Reader or NULL on error
+ */
+vban_shm_reader_t* vban_shm_reader_open(const char* name);
+
+/**
+ * Format of the ring
+ */
+const vban_shm_header_t* vban_shm_reader_header(const vban_shm_reader_t* reader);
+
+/**
+ * Get frames available from the reader's cursor without copying them
+ * @param reader The reader
+ * @param span Filled with up to two regions of frames
+ * @param max_frames Most frames to return
+ * @return Number of frames available in span
+ */
+size_t vban_shm_reader_peek(vban_shm_reader_t* reader, vban_shm_span_t* span, size_t max_frames);
+
+/**
+ * Finish with frames returned by vban_shm_reader_peek and advance the cursor
+ * @param reader The reader
+ * @param frames Number of frames consumed
+ * @return 0 if the frames were intact, -1 if the writer overwrote them while
+ *         they were being read (the cursor is resynced to live data)
+ */
+int vban_shm_reader_release(vban_shm_reader_t* reader, size_t frames);
+
+/**
+ * Stream position of the reader's cursor in frames since the ring was
+ * created (after a peek, the position of the first frame in the span)
+ */
+uint64_t vban_shm_reader_position(const vban_shm_reader_t* reader);
+
+/**
+ * Number of times the reader fell a whole ring behind and was resynced
+ */
+uint64_t vban_shm_reader_overruns(const vban_shm_reader_t* reader);
+
+/**
+ * Unmap the ring
+ */
+void vban_shm_reader_close(vban_shm_reader_t* reader);
+
+#endif /* VBAN4MAC_SHM_RING_H */
@@ -0,0 +1,186 @@
+#ifndef VBAN4MAC_STREAM_H
+#define VBAN4MAC_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+#include "dsp.h"
+#include "playout.h"
+#include "pacer.h"
+
+// Device-free streaming API for embedding VBAN in an existing audio engine.
+// Senders and receivers own no threads and open no audio devices: the
+// caller pushes and pulls interleaved host-order int16 frames from buffers
+// it owns, and drives reception from its own thread or poll loop.
+
+typedef struct vban_sender_t vban_sender_t;
+typedef struct vban_receiver_t vban_receiver_t;
+
+// Called from vban_receiver_process for every accepted packet, with its
+// header as delivered (in the receiver's output format)
+typedef void (*vban_packet_callback)(void* user, const vban_header_t* header, size_t frames);
+
+typedef struct {
+    const char* remote_ip;    // IPv4 or IPv6 address of the receiving host
+    uint16_t port;            // Destination UDP port (0 = VBAN_DEFAULT_PORT)
+    const char* stream_name;  // VBAN stream name (max 16 chars)
+    int sample_rate;          // Hz, one of the VBAN rates
+    int channels;             // 1-256
+    int frames_per_packet;    // 1-256, 0 = as many as fit in one datagram
+    vban_dtx_config_t dtx;    // Silence suppression, all zero to always send
+    vban_pacer_t* pacer;      // Spread sends over the packet interval with this host-wide pacer, NULL to send at once
+    vban_adapt_config_t adapt;  // Step down a quality ladder on reported loss, all zero for a fixed format
+    const char* redundant_ip; // Also send every packet here, over a second network path (NULL = one path)
+    uint16_t redundant_port;  // Destination port on the second path (0 = port)
+} vban_sender_config_t;
+
+typedef struct {
+    const char* bind_ip;      // Local address, NULL for any (IPv6 binds are dual-stack)
+    uint16_t port;            // Local UDP port (0 = VBAN_DEFAULT_PORT)
+    const char* remote_ip;    // Only accept this sender, NULL to accept any
+    const char* stream_name;  // VBAN stream name to accept
+    int channels;             // Output channels; packets with more are dropped, fewer are spread over them
+    int sample_rate;          // Output rate; packets at a whole fraction of it are interpolated (0 = take any rate as is)
+    int report_interval_ms;   // Report loss back to the sender this often in stream time, for adaptive senders (0 = never)
+    size_t buffer_frames;     // Receive ring capacity (0 = 4096 frames)
+    const char* shm_name;     // Also publish to this shared-memory ring (see shm_ring.h), NULL for none
+    vban_packet_callback on_packet;  // Optional
+    void* user;               // Passed to on_packet
+    vban_dsp_pool_t* dsp_pool;  // Run dsp on each packet on this pool before buffering, NULL for none
+    vban_dsp_fn dsp;          // Per-packet DSP, required with dsp_pool
+    void* dsp_user;           // Passed to dsp
+    vban_playout_group_t* group;  // Play out on this group's common timeline (see playout.h), NULL for none; set sample_rate to the group's
+    vban_impair_config_t impair;  // Simulated loss, delay, reordering and rate limit on receive, all zero for none
+    uint16_t redundant_port;  // Also receive the stream on this port, a redundant sender's second path (0 = one path)
+    const char* redundant_bind_ip;    // Local address of the second path (NULL = bind_ip)
+    const char* redundant_remote_ip;  // Only accept this sender on the second path (NULL = remote_ip)
+    vban_impair_config_t redundant_impair;  // Simulated impairment of the second path, all zero for none
+    int redundant_hold_ms;    // Longest a packet after a gap waits for the other path to fill it (0 = 40 ms)
+} vban_receiver_config_t;
+
+/**
+ * Create a sender
+ * @param config Destination and stream format
+ * @return Sender or NULL on error
+ */
+vban_sender_t* vban_sender_create(const vban_sender_config_t* config);
+
+/**
+ * Packetize and send frames. Whole packets are sent straight from the
+ * caller's buffer; a trailing partial packet is kept until the next push.
+ * With silence suppression, silent packets may be skipped (nuFrame still
+ * counts them). With a pacer, packets are queued and leave at the stream's
+ * slot instead. An adaptive sender first applies the loss reports that have
+ * come back, and sends in the format of its current rung. A redundant
+ * sender sends each packet on both paths; a send fails only if both do.
+ * @param sender The sender
+ * @param frames Interleaved host-order samples
+ * @param num_frames Number of frames
+ * @return Number of packets sent, negative value on error
+ */
+int vban_sender_push(vban_sender_t* sender, const int16_t* frames, size_t num_frames);
+
+/**
+ * Packets sent and suppressed so far, and the adaptive ladder position
+ * @param sender The sender
+ * @param stats Filled with the counts
+ */
+void vban_sender_get_stats(const vban_sender_t* sender, vban_sender_stats_t* stats);
+
+/**
+ * Destroy a sender (a pending partial packet and packets still waiting in
+ * the pacer are discarded)
+ */
+void vban_sender_destroy(vban_sender_t* sender);
+
+/**
+ * Create a receiver and bind its socket
+ * @param config Bind address, stream filter and buffering
+ * @return Receiver or NULL on error
+ */
+vban_receiver_t* vban_receiver_create(const vban_receiver_config_t* config);
+
+/**
+ * Socket to wait on in the caller's own poll/epoll loop
+ */
+int vban_receiver_fd(const vban_receiver_t* receiver);
+
+/**
+ * Socket of the second path, to wait on as well when the stream is
+ * received twice
+ * @return Socket, -1 for a receiver with one path
+ */
+int vban_receiver_redundant_fd(const vban_receiver_t* receiver);
+
+/**
+ * Receive every pending datagram straight into the receive ring. With a
+ * DSP pool, packets reach the ring once processed, so they may become
+ * available slightly after this returns. Packets in another format than
+ * the output (8-bit, fewer channels, a fraction of the rate) are decoded
+ * to it, so an adaptive sender can change format mid-stream. With two
+ * paths, both sockets are drained and only the first copy of each packet
+ * is taken. The merged packets are played in nuFrame order: one arriving
+ * after a gap is held until the other path fills it, or for at most
+ * redundant_hold_ms, so paths with different delays merge without
+ * reordering the audio.
+ * @param receiver The receiver
+ * @param timeout_ms How long to wait for the first datagram (0 = don't wait, -1 = forever)
+ * @return Number of packets accepted, negative value on error
+ */
+int vban_receiver_process(vban_receiver_t* receiver, int timeout_ms);
+
+/**
+ * Number of frames ready to pull
+ */
+size_t vban_receiver_available(vban_receiver_t* receiver);
+
+/**
+ * Index of the receiver in its playout group, in vban_playout_group_pull's
+ * output order
+ * @return Member index, -1 if the receiver isn't in a group
+ */
+int vban_receiver_group_member(const vban_receiver_t* receiver);
+
+/**
+ * Copy buffered frames into the caller's buffer. Missing frames are
+ * filled with silence. Receivers in a playout group are pulled through
+ * the group instead.
+ * @param receiver The receiver
+ * @param out Interleaved destination of num_frames * channels samples
+ * @param num_frames Number of frames wanted
+ * @return Number of frames that came from the network
+ */
+size_t vban_receiver_pull(vban_receiver_t* receiver, int16_t* out, size_t num_frames);
+
+/**
+ * Receive timing statistics, measured from kernel receive timestamps.
+ * target_frames suggests how much to keep buffered before pulling. Gaps
+ * left by a sender's silence suppression are counted in silent_packets,
+ * not as loss; vban_receiver_pull fills them with silence.
+ * @param receiver The receiver
+ * @param stats Filled with jitter, gap and burst measurements
+ */
+void vban_receiver_get_jitter_stats(const vban_receiver_t* receiver, vban_jitter_stats_t* stats);
+
+/**
+ * What the receiver's simulated network impairment has done to its
+ * packets, over both paths of a redundant stream
+ * @param receiver The receiver
+ * @param stats Filled with the counts, all zero without impairment
+ */
+void vban_receiver_get_impair_stats(const vban_receiver_t* receiver, vban_impair_stats_t* stats);
+
+/**
+ * Packets taken from each path and copies dropped, for a receiver with two
+ * paths. Safe from any thread.
+ * @param receiver The receiver
+ * @param stats Filled with the counts, all zero with one path
+ */
+void vban_receiver_get_redundancy_stats(const vban_receiver_t* receiver, vban_redundancy_stats_t* stats);
+
+/**
+ * Destroy a receiver
+ */
+void vban_receiver_destroy(vban_receiver_t* receiver);
+
+#endif /* VBAN4MAC_STREAM_H */
@@ -7,12 +7,27 @@
 #define VBAN_HEADER_SIZE 28
 #define VBAN_MAX_PACKET_SIZE 1436
 #define VBAN_PROTOCOL_AUDIO 0x00
+#define VBAN_PROTOCOL_TXT 0x40
+#define VBAN_PROTOCOL_MASK 0xE0   // Sub protocol bits of format_SR
+#define VBAN_DATATYPE_BYTE8 0x00
 #define VBAN_DATATYPE_INT16 0x01
+#define VBAN_DATATYPE_MASK 0x07   // Data type bits of format_bit
+#define VBAN_TXT_UTF8 0x10        // Text format in format_bit of text packets
 #define VBAN_DEFAULT_PORT 6980
 #define VBAN_SAMPLE_RATE 48000
 #define VBAN_SAMPLE_RATE_INDEX 3  // Index for 48kHz (corrected according to VBAN protocol spec)
 #define VBAN_PROTOCOL_MAXNBS 256  // Maximum number of samples per packet
 
+// Sample format of the bridge's buffers and DSP stages, fixed when the
+// library is built: float32 in [-1, 1) by default, int16 with
+// -DVBAN_SAMPLE_INT16 (applications must use the same setting). Samples
+// are converted to and from the 16-bit wire format only at encode/decode.
+#ifdef VBAN_SAMPLE_INT16
+typedef int16_t vban_sample_t;
+#else
+typedef float vban_sample_t;
+#endif
+
 // VBAN Packet Header Structure
 typedef struct __attribute__((packed)) {
     uint32_t vban;           // Contains 'VBAN' fourcc
@@ -24,4 +39,163 @@ typedef struct __attribute__((packed)) {
     uint32_t nuFrame;        // Frame counter
 } vban_header_t;
 
+// Receive timing of one stream, measured from kernel receive timestamps
+typedef struct {
+    uint64_t packets;            // Packets measured
+    double jitter_ms;            // RFC 3550 interarrival jitter
+    double max_gap_ms;           // Longest interval between consecutive packets
+    uint32_t bursts;             // Runs of packets that arrived back to back after a stall
+    uint32_t max_burst_packets;  // Longest such run
+    uint32_t target_frames;      // Suggested playout buffer in frames
+    uint64_t lost_packets;       // Counter gaps after audio, taken as loss
+    uint64_t silent_packets;     // Counter gaps after silence, taken as suppressed by the sender
+} vban_jitter_stats_t;
+
+// Sender-side silence suppression (DTX). Packets whose peak stays below
+// the threshold are not sent once the hangover has passed, apart from a
+// periodic keepalive; receivers play the gap as silence.
+typedef struct {
+    int threshold_db;            // Silence level in dBFS (at most -40), 0 = always send
+    int hangover_ms;             // Silence still sent after the signal drops (0 = 100 ms)
+    int keepalive_ms;            // One packet per this interval during silence (0 = 1000 ms)
+} vban_dtx_config_t;
+
+// One rung of an adaptive sender's quality ladder
+typedef struct {
+    int sample_rate;             // Hz, the sender's rate divided by a whole number
+    int channels;                // The sender's channels, the first few of them, or 1 for a mono downmix
+    int bits;                    // 16 or 8
+} vban_format_t;
+
+// Loss-driven format adaptation. Receivers report their loss rate back on
+// a VBAN text packet; the sender steps down its ladder when a report shows
+// too much loss and back up once reports have stayed low for hold_ms.
+// Times are in stream time (packets sent), not wall time.
+typedef struct {
+    const vban_format_t* ladder; // Fallback formats, best first; NULL to always send the configured format
+    int levels;                  // Entries in ladder
+    double degrade_loss_pct;     // Step down above this loss (0 = 5%)
+    double recover_loss_pct;     // Step up after hold_ms below this loss (0 = 0.5%)
+    int hold_ms;                 // Low-loss time before each step up (0 = 5000 ms)
+} vban_adapt_config_t;
+
+// Packets produced by a sender
+typedef struct {
+    uint64_t packets_sent;
+    uint64_t packets_suppressed; // Silent packets not sent (nuFrame still advanced)
+    int quality_level;           // Ladder rung in use, 0 for the configured format
+    uint64_t quality_changes;    // Steps taken down or up the ladder
+    double reported_loss_pct;    // Latest loss reported by the receiver
+    uint64_t path_failures;      // Sends that failed on one path of a redundant sender while the other went out
+    uint64_t packets_torn;       // Bridge packets whose capture samples were overwritten while being sent (ring overflow)
+} vban_sender_stats_t;
+
+// Delay variation of a simulated link
+typedef enum {
+    VBAN_JITTER_UNIFORM,         // Spread evenly over delay_ms +- jitter_ms
+    VBAN_JITTER_NORMAL,          // jitter_ms is the standard deviation
+    VBAN_JITTER_PARETO           // Heavy tail on top of delay_ms, averaging jitter_ms
+} vban_jitter_dist_t;
+
+// Network impairment simulated in a receiver, between its socket and the
+// packet handling, so buffering and loss handling can be tested on one
+// machine. Decisions come from a seeded generator in arrival order: the
+// same seed and traffic give the same losses, delays and duplicates on
+// every run. Jitter larger than the packet interval also reorders packets,
+// as on a real network. All zero for none.
+typedef struct {
+    unsigned seed;
+    double loss_pct;             // Independent random loss
+    double burst_enter_pct;      // Gilbert-Elliott bursts: chance per packet of the link turning bad (0 = no bursts)
+    double burst_exit_pct;       // Chance per packet of a bad link recovering (0 = 25%)
+    double burst_loss_pct;       // Loss while the link is bad (0 = 100%)
+    int delay_ms;                // Added to every packet
+    int jitter_ms;               // Delay variation, shaped by jitter_dist
+    vban_jitter_dist_t jitter_dist;
+    double reorder_pct;          // Packets held back by reorder_ms on top of their delay
+    int reorder_ms;              // (0 = 10 ms)
+    double duplicate_pct;        // Packets delivered twice
+    int rate_kbps;               // Link rate including IP/UDP headers, 0 = unlimited
+    int queue_ms;                // Queueing behind the rate limit beyond which packets drop (0 = 100 ms)
+} vban_impair_config_t;
+
+// What a simulated link did to the packets it received
+typedef struct {
+    uint64_t received;
+    uint64_t delivered;          // Including duplicates
+    uint64_t lost_random;
+    uint64_t lost_burst;
+    uint64_t lost_queue;         // Dropped by the rate limit's queue
+    uint64_t reordered;          // Held back by reorder_pct
+    uint64_t duplicated;
+} vban_impair_stats_t;
+
+// How a receiver merged a stream arriving over two paths
+typedef struct {
+    uint64_t packets[2];         // Packets taken from each path, the first copy to arrive
+    uint64_t duplicates;         // Second copies dropped
+    uint64_t late;               // Copies too far behind the newest packet to check, dropped
+    uint64_t reordered;          // Held until the packets before them were played
+    uint64_t missed;             // Arrived after the stream played on without them, dropped
+} vban_redundancy_stats_t;
+
+// Latency catch-up of the bridge's output. When more audio is buffered
+// than the playout target (after a network stall, say), playback is time
+// compressed without changing pitch until the excess is gone; when less is
+// buffered, it is stretched to rebuild it, at up to half the speed change.
+// Close to the target, audio plays unmodified.
+typedef struct {
+    int max_speed_pct;           // Largest speed-up in percent (at most 25), 0 = off
+    int window_ms;               // Excess is drained at about its size per this time (0 = 1000 ms)
+} vban_catchup_config_t;
+
+#define VBAN_CALLBACK_HISTOGRAM_BUCKETS 16
+
+// Deadline monitoring of one audio callback. Its deadline is the device
+// period, the time its frames last at the sample rate. Durations are
+// binned in eighths of the period, so buckets 8 and up are misses; the last
+// bucket also holds anything slower.
+typedef struct {
+    uint64_t callbacks;
+    uint64_t deadline_misses;    // Callbacks that ran longer than their period
+    uint64_t late_callbacks;     // Started more than half a period after they were due
+    uint64_t early_callbacks;    // Started less than half a period after the previous one
+    double period_us;            // Period of the latest callback
+    uint64_t histogram[VBAN_CALLBACK_HISTOGRAM_BUCKETS];
+} vban_callback_deadline_stats_t;
+
+// Device-side timing of the bridge's audio backend
+typedef struct {
+    int sample_rate;             // Device rate in Hz
+    int period_frames;           // Frames per device callback
+    int input_latency_frames;    // Capture latency reported by the backend
+    int output_latency_frames;   // Playback latency reported by the backend
+    uint64_t callbacks;          // Output callbacks so far
+    double mean_callback_us;     // Time spent in the output callback
+    double max_callback_us;
+    double max_period_jitter_us; // Worst deviation of callback spacing from the period
+    uint64_t frames_compressed;  // Input frames skipped by latency catch-up
+    uint64_t frames_expanded;    // Output frames added by latency catch-up
+    uint64_t device_switches;    // Completed hot swaps of the input or output device
+    uint64_t capture_failures;   // Input callbacks that got no audio from the device (CoreAudio)
+    vban_callback_deadline_stats_t render;   // Output callback
+    vban_callback_deadline_stats_t capture;  // Input callback (zero with JACK, which captures in its one callback)
+} vban_audio_stats_t;
+
+#define VBAN_MAX_LEVEL_CHANNELS 8
+
+// Level of one channel, linear full scale (1.0 = 0 dBFS)
+typedef struct {
+    float peak;                  // Peak with ~20 dB/s fall-off
+    float rms;                   // RMS over a ~300 ms window
+} vban_level_t;
+
+// Levels of the bridge's captured and played channels
+typedef struct {
+    int input_channels;          // Entries of input filled in
+    int output_channels;         // Entries of output filled in
+    vban_level_t input[VBAN_MAX_LEVEL_CHANNELS];
+    vban_level_t output[VBAN_MAX_LEVEL_CHANNELS];
+} vban_levels_t;
+
 #endif /* VBAN4MAC_TYPES_H */ 
\ No newline at end of file
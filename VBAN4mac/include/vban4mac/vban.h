@@ -2,10 +2,31 @@
 #define VBAN4MAC_H
 
 #include <stdint.h>
+#include "types.h"
+#include "dsp.h"
 
 // VBAN Context Structure
 typedef struct vban_context_t* vban_handle_t;
 
+// VBAN initialization options
+typedef struct {
+    const char* remote_ip;    // IPv4 or IPv6 address of the remote VBAN host
+    const char* stream_name;  // VBAN stream name (max 16 chars)
+    uint16_t port;            // UDP port used for sending and receiving
+    const char* bind_ip;      // Local address to bind, NULL for any (IPv6 binds are dual-stack)
+    int rx_workers;           // Receive workers, each with its own SO_REUSEPORT socket (0 = 1)
+    int event_threads;        // Event loop threads shared by all handles, set by the first (0 = 1)
+    const char* shm_name;     // Also publish received audio to this shared-memory ring, NULL for none
+    vban_dsp_pool_t* dsp_pool;  // Run dsp on received packets on this pool (see dsp.h), NULL for none
+    vban_dsp_fn dsp;          // Per-packet DSP, required with dsp_pool
+    void* dsp_user;           // Passed to dsp
+    vban_dtx_config_t dtx;    // Silence suppression of captured audio sent, all zero to always send
+    vban_catchup_config_t catchup;  // Time-stretching of the output toward the playout target, all zero for off
+    vban_impair_config_t impair;  // Simulated loss, delay, reordering and rate limit on receive, all zero for none
+    int input_channels;       // Channels captured and sent (0 = 1; CoreAudio supports only 1)
+    int output_channels;      // Channels played from received audio (0 = 2; CoreAudio supports only 2)
+} vban_options_t;
+
 /**
  * Initialize VBAN with remote IP, stream name, and port
  * @param remote_ip The IP address of the remote VBAN host
@@ -15,6 +36,13 @@ typedef struct vban_context_t* vban_handle_t;
  */
 vban_handle_t vban_init_with_port(const char* remote_ip, const char* stream_name, uint16_t port);
 
+/**
+ * Initialize VBAN from an options structure
+ * @param options Remote host, stream name, port, bind address and receive workers
+ * @return Handle to VBAN context or NULL on error
+ */
+vban_handle_t vban_init_with_options(const vban_options_t* options);
+
 /**
  * Initialize VBAN with remote IP and stream name
  * @param remote_ip The IP address of the remote VBAN host
@@ -30,7 +58,9 @@ vban_handle_t vban_init(const char* remote_ip, const char* stream_name);
 void vban_cleanup(vban_handle_t handle);
 
 /**
- * Send audio data to remote VBAN host
+ * Send audio data to remote VBAN host. Safe while the bridge is sending
+ * captured audio, and never suppressed as silence (dtx only gates the
+ * captured stream); both share the stream's nuFrame counter.
  * @param handle The VBAN handle
  * @param audio_data The audio samples (int16_t)
  * @param num_samples Number of samples per channel
@@ -47,4 +77,62 @@ int vban_send_audio(vban_handle_t handle, const int16_t* audio_data,
  */
 int vban_is_running(vban_handle_t handle);
 
+/**
+ * Get receive timing statistics of the incoming stream
+ * @param handle The VBAN handle
+ * @param stats Filled with jitter, gap and burst measurements
+ * @return 0 on success, -1 on error
+ */
+int vban_get_jitter_stats(vban_handle_t handle, vban_jitter_stats_t* stats);
+
+/**
+ * Get the number of packets sent and suppressed as silence
+ * @param handle The VBAN handle
+ * @param stats Filled with the counts
+ * @return 0 on success, -1 on error
+ */
+int vban_get_sender_stats(vban_handle_t handle, vban_sender_stats_t* stats);
+
+/**
+ * What the simulated network impairment has done to received packets,
+ * summed over the receive workers of the handle's port (which every
+ * handle on that port shares)
+ * @param handle The VBAN handle
+ * @param stats Filled with the counts, all zero without impairment
+ * @return 0 on success, -1 on error
+ */
+int vban_get_impair_stats(vban_handle_t handle, vban_impair_stats_t* stats);
+
+/**
+ * Audio device timing: period, latencies reported by the backend, how
+ * long the output callback takes, and deadline misses and scheduling
+ * anomalies of the render and capture callbacks. Lock-free to read.
+ * @param handle The VBAN handle
+ * @param stats Filled with the figures
+ * @return 0 on success, -1 on error
+ */
+int vban_get_audio_stats(vban_handle_t handle, vban_audio_stats_t* stats);
+
+/**
+ * Peak and RMS level of each captured and played channel, as of the last
+ * audio callback. Lock-free to read, so it can be polled at any rate.
+ * @param handle The VBAN handle
+ * @param levels Filled with the levels, no channels before the audio starts
+ * @return 0 on success, -1 on error
+ */
+int vban_get_levels(vban_handle_t handle, vban_levels_t* levels);
+
+/**
+ * Start exporting pipeline trace events as Chrome trace JSON
+ * (only available when built with TRACE=1)
+ * @param path Output file, viewable in chrome://tracing or ui.perfetto.dev
+ * @return 0 on success, -1 if tracing is compiled out or the file can't be opened
+ */
+int vban_trace_start(const char* path);
+
+/**
+ * Stop the trace export and finish the JSON file
+ */
+void vban_trace_stop(void);
+
 #endif /* VBAN4MAC_H */ 
\ No newline at end of file
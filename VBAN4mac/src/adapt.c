@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "adapt.h"
+#include "packet.h"
+
+#define ADAPT_DEFAULT_DEGRADE_PCT 5.0
+#define ADAPT_DEFAULT_RECOVER_PCT 0.5
+#define ADAPT_DEFAULT_HOLD_MS 5000
+#define ADAPT_DEGRADE_SPACING_MS 1000   // Reports already in flight still show the old rung's loss
+
+void adapt_init(adapt_state_t* state, const vban_adapt_config_t* config) {
+    memset(state, 0, sizeof(*state));
+    state->levels = config->ladder ? config->levels : 0;
+    if (state->levels > ADAPT_MAX_LEVELS) state->levels = ADAPT_MAX_LEVELS;
+    if (state->levels < 0) state->levels = 0;
+    state->degrade_loss_pct = config->degrade_loss_pct > 0 ? config->degrade_loss_pct : ADAPT_DEFAULT_DEGRADE_PCT;
+    state->recover_loss_pct = config->recover_loss_pct > 0 ? config->recover_loss_pct : ADAPT_DEFAULT_RECOVER_PCT;
+    state->hold_ms = config->hold_ms > 0 ? config->hold_ms : ADAPT_DEFAULT_HOLD_MS;
+    state->changed_ms = -ADAPT_DEGRADE_SPACING_MS;
+    state->good_since_ms = -1;
+}
+
+int adapt_on_report(adapt_state_t* state, double loss_pct, int64_t now_ms) {
+    if (loss_pct > state->degrade_loss_pct) {
+        state->good_since_ms = -1;
+        if (state->level < state->levels && now_ms - state->changed_ms >= ADAPT_DEGRADE_SPACING_MS) {
+            state->level++;
+            state->changed_ms = now_ms;
+        }
+    } else if (loss_pct < state->recover_loss_pct) {
+        if (state->good_since_ms < 0) state->good_since_ms = now_ms;
+        if (state->level > 0 && now_ms - state->good_since_ms >= state->hold_ms) {
+            state->level--;
+            state->changed_ms = now_ms;
+            state->good_since_ms = now_ms;  // Hold again before the next step up
+        }
+    } else {
+        state->good_since_ms = -1;  // Between the thresholds: stay, but start the hold over
+    }
+    return state->level;
+}
+
+size_t adapt_build_report(uint8_t* buf, const char* stream_name, double loss_pct) {
+    vban_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.vban = htonl(VBAN_MAGIC);
+    header.format_SR = VBAN_PROTOCOL_TXT;
+    header.format_bit = VBAN_DATATYPE_BYTE8 | VBAN_TXT_UTF8;
+    memcpy(header.streamname, stream_name, strnlen(stream_name, sizeof(header.streamname)));
+    memcpy(buf, &header, VBAN_HEADER_SIZE);
+
+    int len = snprintf((char*)buf + VBAN_HEADER_SIZE, ADAPT_REPORT_SIZE - VBAN_HEADER_SIZE, "loss=%.2f", loss_pct);
+    return VBAN_HEADER_SIZE + (size_t)len;
+}
+
+int adapt_parse_report(const uint8_t* buf, ssize_t len, const char* stream_name, double* loss_pct) {
+    if (len <= VBAN_HEADER_SIZE || len > ADAPT_REPORT_SIZE) return -1;
+
+    vban_header_t header;
+    memcpy(&header, buf, VBAN_HEADER_SIZE);
+    if (ntohl(header.vban) != VBAN_MAGIC || (header.format_SR & VBAN_PROTOCOL_MASK) != VBAN_PROTOCOL_TXT ||
+        strncmp(header.streamname, stream_name, sizeof(header.streamname)) != 0) {
+        return -1;
+    }
+
+    char text[ADAPT_REPORT_SIZE];
+    memcpy(text, buf + VBAN_HEADER_SIZE, len - VBAN_HEADER_SIZE);
+    text[len - VBAN_HEADER_SIZE] = '\0';
+    if (strncmp(text, "loss=", 5) != 0) return -1;
+
+    char* end;
+    double value = strtod(text + 5, &end);
+    if (end == text + 5 || value < 0) return -1;
+    *loss_pct = value;
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef VBAN4MAC_ADAPT_H
+#define VBAN4MAC_ADAPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "../include/vban4mac/types.h"
+
+// Loss reports and the sender's ladder position. A report is a VBAN text
+// packet carrying the receiver's stream name and "loss=<percent>".
+
+#define ADAPT_MAX_LEVELS 8
+#define ADAPT_REPORT_SIZE (VBAN_HEADER_SIZE + 32)
+
+typedef struct {
+    int levels;                     // Fallback rungs below the configured format
+    double degrade_loss_pct;
+    double recover_loss_pct;
+    int64_t hold_ms;
+    int level;                      // 0 = configured format
+    int64_t changed_ms;             // Stream time of the last step
+    int64_t good_since_ms;          // Start of the current run of low-loss reports, -1 if none
+} adapt_state_t;
+
+/**
+ * Set up the ladder position from the configuration (levels are clamped
+ * to ADAPT_MAX_LEVELS)
+ */
+void adapt_init(adapt_state_t* state, const vban_adapt_config_t* config);
+
+/**
+ * Apply one loss report
+ * @param state Ladder position
+ * @param loss_pct Reported loss
+ * @param now_ms Sender's stream time
+ * @return Rung to use from now on
+ */
+int adapt_on_report(adapt_state_t* state, double loss_pct, int64_t now_ms);
+
+/**
+ * Build a loss report
+ * @param buf At least ADAPT_REPORT_SIZE bytes
+ * @param stream_name Stream the report is about
+ * @param loss_pct Loss since the previous report
+ * @return Datagram length
+ */
+size_t adapt_build_report(uint8_t* buf, const char* stream_name, double loss_pct);
+
+/**
+ * Parse a received datagram as a loss report for a stream
+ * @param buf Datagram
+ * @param len Its length
+ * @param stream_name Stream the sender is sending
+ * @param loss_pct Filled with the reported loss
+ * @return 0 if it is a report for the stream, -1 otherwise
+ */
+int adapt_parse_report(const uint8_t* buf, ssize_t len, const char* stream_name, double* loss_pct);
+
+#endif /* VBAN4MAC_ADAPT_H */
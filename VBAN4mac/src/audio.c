@@ -2,80 +2,156 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <libkern/OSByteOrder.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include "audio.h"
+#include "callback_stats.h"
+#include "device_swap.h"
+#include "sample.h"
+#include "stretch.h"
+#include "trace.h"
+#include "../include/vban4mac/config.h"
 #include "../include/vban4mac/types.h"
 
 #define AUDIO_BUFFER_SIZE (VBAN_PROTOCOL_MAXNBS * 16)  // Buffer for ~256ms of audio
+#define AUDIO_MAX_FRAMES 4096           // Largest callback the units may make
+#define AUDIO_SWAP_FADE_MS 10
+#define AUDIO_SWAP_TIMEOUT_MS 500       // For a new device to come up, or an old one to fade out
 
-// Audio Unit globals
-static AudioComponentInstance audio_unit = NULL;
+// Audio Unit globals: two per direction, so a new device can come up while
+// the old one keeps running. The swap says which is current.
+static AudioComponentInstance output_units[2] = { NULL, NULL };
 static AudioComponent output_component = NULL;
-static AudioComponentInstance input_unit = NULL;
+static AudioComponentInstance input_units[2] = { NULL, NULL };
 static AudioComponent input_component = NULL;
+static device_swap_t output_swap;
+static device_swap_t input_swap;
+static vban_sample_t capture_scratch[2][AUDIO_MAX_FRAMES];  // Capture during a swap, per slot
+static float capture_render[2][AUDIO_MAX_FRAMES];           // Each slot's input as the unit renders it
+static atomic_uint_fast64_t capture_failures = 0;           // Input callbacks that got no audio
+
+// Device switching, from the API or the device watcher
+static pthread_mutex_t device_lock = PTHREAD_MUTEX_INITIALIZER;
+static char preferred_device[2][128];   // Output, input: return to these when they reappear
+static int input_started = 0;
+
+static AudioUnit current_unit(int is_input) {
+    return is_input ? input_units[device_swap_active(&input_swap)] : output_units[device_swap_active(&output_swap)];
+}
 
 // Audio buffers
 audio_buffer_t g_audio_buffer = {0};
 audio_buffer_t g_input_buffer = {0};
 
-// Monitoring callbacks
-static audio_monitor_callback input_monitor = NULL;
-static audio_monitor_callback output_monitor = NULL;
+// Frames to buffer before playing, set from the measured network jitter
+static atomic_size_t playout_target = 0;
+static int priming = 1;  // Render callback only: waiting for the playout target
+
+// Latency catch-up, owned by the render callback once the output starts
+static stretch_t stretcher;
+static int catchup = 0;
+
+static callback_stats_t render_stats;
+static callback_stats_t capture_stats;
 
-void audio_set_input_monitor(audio_monitor_callback callback) {
-    input_monitor = callback;
+int audio_set_channels(int input_channels, int output_channels) {
+    // The units are set up for mono capture and stereo playback
+    if (input_channels != 1 || output_channels != 2) {
+        fprintf(stderr, "CoreAudio backend supports 1 input and 2 output channels, not %d and %d\n",
+                input_channels, output_channels);
+        return -1;
+    }
+    return 0;
 }
 
-void audio_set_output_monitor(audio_monitor_callback callback) {
-    output_monitor = callback;
+void audio_set_playout_target(size_t frames) {
+    // Leave room for a callback's worth of frames on top
+    if (frames > AUDIO_BUFFER_SIZE / 4) frames = AUDIO_BUFFER_SIZE / 4;
+    atomic_store_explicit(&playout_target, frames, memory_order_relaxed);
 }
 
-// Audio callbacks
+int audio_set_catchup(const vban_catchup_config_t* config) {
+    if (catchup) {
+        stretch_destroy(&stretcher);
+        catchup = 0;
+    }
+    if (config->max_speed_pct <= 0) return 0;
+
+    if (stretch_init(&stretcher, 2, VBAN_SAMPLE_RATE, config) != 0) {
+        fprintf(stderr, "Failed to set up latency catch-up\n");
+        return -1;
+    }
+    catchup = 1;
+    return 0;
+}
+
+// Level meters, updated by the audio callbacks
+static audio_meter_t input_meter = {0};
+static audio_meter_t output_meter = {0};
+
+int audio_get_input_levels(vban_level_t* levels, int max_channels) {
+    return audio_meter_read(&input_meter, levels, max_channels);
+}
+
+int audio_get_output_levels(vban_level_t* levels, int max_channels) {
+    return audio_meter_read(&output_meter, levels, max_channels);
+}
+
+// Play from the output ring, on whichever device currently owns it
+static size_t render_playout(void* user, vban_sample_t* const* channels, size_t frames_to_copy) {
+    (void)user;
+    size_t target = atomic_load_explicit(&playout_target, memory_order_relaxed);
+    size_t frames_copied = 0;
+
+    // After an underrun, let enough audio build up to ride out the jitter
+    if (priming) {
+        size_t held = catchup ? stretch_buffered(&stretcher) * 2 : 0;
+        if (audio_buffer_available(&g_audio_buffer) + held >= (target + frames_to_copy) * 2) {
+            priming = 0;
+        }
+    }
+
+    if (!priming) {
+        // With catch-up on, what is buffered is also steered toward the target
+        frames_copied = catchup ? stretch_render(&stretcher, &g_audio_buffer, channels, frames_to_copy,
+                                                 target + frames_to_copy)
+                                : audio_buffer_read_planar(&g_audio_buffer, (void* const*)channels, 2, frames_to_copy);
+    }
+    if (frames_copied != frames_to_copy) {
+        // Not enough data: the rest is silence
+        if (!priming) TRACE_INSTANT("underrun");
+        priming = 1;
+    }
+    return frames_copied;
+}
+
+// Audio callbacks, with the unit's slot as inRefCon
 static OSStatus audio_render_callback(void *inRefCon,
                                     AudioUnitRenderActionFlags *ioActionFlags,
                                     const AudioTimeStamp *inTimeStamp,
                                     UInt32 inBusNumber,
                                     UInt32 inNumberFrames,
                                     AudioBufferList *ioData) {
-    pthread_mutex_lock(&g_audio_buffer.mutex);
-    
+    int slot = (int)(intptr_t)inRefCon;
+    int64_t start = callback_stats_now_ns();
+    TRACE_BEGIN("render");
+
     // Get pointers to left and right channel buffers
-    int16_t* left = (int16_t*)ioData->mBuffers[0].mData;
-    int16_t* right = (int16_t*)ioData->mBuffers[1].mData;
-    size_t frames_to_copy = inNumberFrames;
-    
-    if (g_audio_buffer.size >= frames_to_copy * 2) {  // 2 channels
-        // Deinterleave and copy data
-        for (size_t i = 0; i < frames_to_copy; i++) {
-            left[i] = g_audio_buffer.data[i * 2];
-            right[i] = g_audio_buffer.data[i * 2 + 1];
-        }
-        
-        // Call output monitor if set
-        if (output_monitor) {
-            float* monitor_buffer = malloc(frames_to_copy * sizeof(float));
-            if (monitor_buffer) {
-                // Convert int16 to float for monitoring
-                for (size_t i = 0; i < frames_to_copy; i++) {
-                    monitor_buffer[i] = left[i] / 32767.0f;  // Use left channel for monitoring
-                }
-                output_monitor(monitor_buffer, frames_to_copy);
-                free(monitor_buffer);
-            }
-        }
-        
-        // Remove processed data
-        memmove(g_audio_buffer.data,
-                g_audio_buffer.data + frames_to_copy * 2,
-                (g_audio_buffer.size - frames_to_copy * 2) * sizeof(int16_t));
-        g_audio_buffer.size -= frames_to_copy * 2;
-    } else {
-        // Not enough data, output silence
-        memset(left, 0, frames_to_copy * sizeof(int16_t));
-        memset(right, 0, frames_to_copy * sizeof(int16_t));
+    vban_sample_t* left = (vban_sample_t*)ioData->mBuffers[0].mData;
+    vban_sample_t* right = (vban_sample_t*)ioData->mBuffers[1].mData;
+    vban_sample_t* const channels[2] = { left, right };
+
+    // Only the current device plays the stream, except while crossfading
+    // to a new one
+    device_swap_render(&output_swap, slot, channels, inNumberFrames, render_playout, NULL);
+
+    TRACE_END("render");
+    if (slot == device_swap_active(&output_swap)) {
+        // Meter the block while it is still in cache
+        audio_meter_update_samples(&output_meter, (const vban_sample_t* const*)channels, inNumberFrames);
+        callback_stats_record(&render_stats, start, callback_stats_now_ns(),
+                              (int64_t)inNumberFrames * 1000000000LL / VBAN_SAMPLE_RATE);
     }
-    
-    pthread_mutex_unlock(&g_audio_buffer.mutex);
     return noErr;
 }
 
@@ -85,59 +161,68 @@ static OSStatus audio_input_callback(void *inRefCon,
                                    UInt32 inBusNumber,
                                    UInt32 inNumberFrames,
                                    AudioBufferList *ioData) {
+    int slot = (int)(intptr_t)inRefCon;
+    int64_t start = callback_stats_now_ns();
+    TRACE_BEGIN("capture");
     
-    // Create buffer list for rendered audio
+    // Render into the slot's preallocated buffer; the unit was set up for
+    // at most AUDIO_MAX_FRAMES per callback
+    if (inNumberFrames > AUDIO_MAX_FRAMES) {
+        atomic_fetch_add_explicit(&capture_failures, 1, memory_order_relaxed);
+        TRACE_END("capture");
+        return kAudioUnitErr_TooManyFramesToProcess;
+    }
     AudioBufferList buffer_list;
     buffer_list.mNumberBuffers = 1;
     buffer_list.mBuffers[0].mNumberChannels = 1;  // Mono input
     buffer_list.mBuffers[0].mDataByteSize = inNumberFrames * sizeof(float);  // Device uses 32-bit float
-    buffer_list.mBuffers[0].mData = malloc(buffer_list.mBuffers[0].mDataByteSize);
-
-    if (!buffer_list.mBuffers[0].mData) {
-        printf("Failed to allocate buffer for input callback\n");
-        return -1;
-    }
+    buffer_list.mBuffers[0].mData = capture_render[slot];
 
     // Render the audio data
-    OSStatus status = AudioUnitRender(input_unit,
+    OSStatus status = AudioUnitRender(input_units[slot],
                                     ioActionFlags,
                                     inTimeStamp,
                                     inBusNumber,
                                     inNumberFrames,
                                     &buffer_list);
 
-    if (status == noErr) {
-        pthread_mutex_lock(&g_input_buffer.mutex);
-        
-        // Call input monitor if set
-        if (input_monitor) {
-            input_monitor(buffer_list.mBuffers[0].mData, inNumberFrames);
+    const float* input_samples = capture_render[slot];
+    if (status == noErr && device_swap_busy(&input_swap)) {
+        // Switching devices: the old and new capture are crossfaded
+        audio_meter_block_t level = {0};
+        sample_from_float_metered(input_samples, inNumberFrames, capture_scratch[slot], &level);
+        device_swap_capture(&input_swap, slot, capture_scratch[slot], inNumberFrames, &g_input_buffer);
+        if (slot == device_swap_active(&input_swap)) {
+            audio_meter_publish(&input_meter, &level, inNumberFrames);
         }
+    } else if (status == noErr && slot == device_swap_active(&input_swap)) {
+        // Store the mono capture straight into the input ring (a copy,
+        // unless the pipeline was built for int16), metering it on the way
+        audio_buffer_span_t span;
+        audio_meter_block_t level = {0};
+        size_t output_samples = audio_buffer_reserve(&g_input_buffer, inNumberFrames, &span);
         
-        // Convert float mono to int16 mono (no stereo duplication)
-        float* input_samples = (float*)buffer_list.mBuffers[0].mData;
-        size_t output_samples = inNumberFrames; // Mono output
+        sample_from_float_metered(input_samples, span.len[0], span.ptr[0], &level);
+        sample_from_float_metered(input_samples + span.len[0], span.len[1], span.ptr[1], &level);
         
-        if (g_input_buffer.size + output_samples <= g_input_buffer.capacity) {
-            // Convert float to int16 keeping mono
-            for (size_t i = 0; i < inNumberFrames; i++) {
-                g_input_buffer.data[g_input_buffer.size + i] = (int16_t)(input_samples[i] * 32767.0f);
-            }
-            
-            g_input_buffer.size += output_samples;
-        }
-        
-        pthread_mutex_unlock(&g_input_buffer.mutex);
-    } else {
-        printf("AudioUnitRender failed with status: %d\n", (int)status);
+        audio_buffer_commit(&g_input_buffer, output_samples);
+        audio_meter_publish(&input_meter, &level, output_samples);
+    } else if (status != noErr) {
+        // Counted rather than printed, this is the real-time thread
+        atomic_fetch_add_explicit(&capture_failures, 1, memory_order_relaxed);
     }
 
-    free(buffer_list.mBuffers[0].mData);
+    TRACE_END("capture");
+    if (slot == device_swap_active(&input_swap)) {
+        callback_stats_record(&capture_stats, start, callback_stats_now_ns(),
+                              (int64_t)inNumberFrames * 1000000000LL / VBAN_SAMPLE_RATE);
+    }
     return status;
 }
 
-// Audio initialization functions
-OSStatus audio_output_init(void) {
+// Create and initialize the output unit of a slot, on a device (0 for the
+// system default)
+static OSStatus create_output_unit(int slot, AudioDeviceID device) {
     // Describe audio component
     AudioComponentDescription desc = {0};
     desc.componentType = kAudioUnitType_Output;
@@ -152,26 +237,35 @@ OSStatus audio_output_init(void) {
     }
 
     // Create audio unit instance
-    OSStatus status = AudioComponentInstanceNew(output_component, &audio_unit);
+    AudioComponentInstance unit = NULL;
+    OSStatus status = AudioComponentInstanceNew(output_component, &unit);
     if (status != noErr) {
         printf("Failed to create audio unit instance\n");
         return status;
     }
+    output_units[slot] = unit;
 
-    // Set up stream format
+    // Set up stream format, the pipeline's sample format so the render
+    // callback only copies
     AudioStreamBasicDescription format = {0};
     format.mSampleRate = VBAN_SAMPLE_RATE;
     format.mFormatID = kAudioFormatLinearPCM;
+#ifdef VBAN_SAMPLE_INT16
     format.mFormatFlags = kAudioFormatFlagIsSignedInteger | 
                          kAudioFormatFlagIsPacked |
                          kAudioFormatFlagIsNonInterleaved;
+#else
+    format.mFormatFlags = kAudioFormatFlagIsFloat | 
+                         kAudioFormatFlagIsPacked |
+                         kAudioFormatFlagIsNonInterleaved;
+#endif
     format.mFramesPerPacket = 1;
     format.mChannelsPerFrame = 2; // Stereo
-    format.mBitsPerChannel = 16;  // 16-bit PCM
+    format.mBitsPerChannel = 8 * sizeof(vban_sample_t);
     format.mBytesPerPacket = format.mBytesPerFrame = 
         (format.mBitsPerChannel / 8);
 
-    status = AudioUnitSetProperty(audio_unit,
+    status = AudioUnitSetProperty(unit,
                                 kAudioUnitProperty_StreamFormat,
                                 kAudioUnitScope_Input,
                                 0,
@@ -179,12 +273,12 @@ OSStatus audio_output_init(void) {
                                 sizeof(format));
     if (status != noErr) return status;
 
-    // Set up render callback
+    // Set up render callback, telling it which slot it plays for
     AURenderCallbackStruct callback = {0};
     callback.inputProc = audio_render_callback;
-    callback.inputProcRefCon = NULL;
+    callback.inputProcRefCon = (void*)(intptr_t)slot;
 
-    status = AudioUnitSetProperty(audio_unit,
+    status = AudioUnitSetProperty(unit,
                                 kAudioUnitProperty_SetRenderCallback,
                                 kAudioUnitScope_Input,
                                 0,
@@ -194,7 +288,7 @@ OSStatus audio_output_init(void) {
 
     // Enable output on bus 0
     UInt32 enable = 1;
-    status = AudioUnitSetProperty(audio_unit,
+    status = AudioUnitSetProperty(unit,
                                 kAudioOutputUnitProperty_EnableIO,
                                 kAudioUnitScope_Output,
                                 0,
@@ -205,16 +299,63 @@ OSStatus audio_output_init(void) {
         return status;
     }
 
+    // Callbacks must fit the device switch's buffers
+    UInt32 max_frames = AUDIO_MAX_FRAMES;
+    AudioUnitSetProperty(unit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0,
+                         &max_frames, sizeof(max_frames));
+
+    if (device) {
+        status = AudioUnitSetProperty(unit, kAudioOutputUnitProperty_CurrentDevice, kAudioUnitScope_Global, 0,
+                                      &device, sizeof(device));
+        if (status != noErr) {
+            printf("Failed to set output device: %d\n", (int)status);
+            return status;
+        }
+    }
+
     // Initialize audio unit
-    status = AudioUnitInitialize(audio_unit);
+    return AudioUnitInitialize(unit);
+}
+
+static void dispose_unit(AudioComponentInstance* unit) {
+    if (!*unit) return;
+    AudioOutputUnitStop(*unit);
+    AudioUnitUninitialize(*unit);
+    AudioComponentInstanceDispose(*unit);
+    *unit = NULL;
+}
+
+static void watch_devices_start(void);
+static void watch_devices_stop(void);
+
+// Audio initialization functions
+OSStatus audio_output_init(void) {
+    if (device_swap_init(&output_swap, 2, VBAN_SAMPLE_RATE, AUDIO_SWAP_FADE_MS, AUDIO_MAX_FRAMES) != 0) {
+        printf("Failed to allocate the output device switch\n");
+        return -1;
+    }
+
+    callback_stats_init(&render_stats);
+
+    if (audio_meter_init(&output_meter, 2, VBAN_SAMPLE_RATE) != 0) {
+        printf("Failed to allocate output meter\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&device_lock);
+    OSStatus status = create_output_unit(0, 0);
+    if (status == noErr) status = AudioOutputUnitStart(output_units[0]);
+    pthread_mutex_unlock(&device_lock);
     if (status != noErr) return status;
 
-    return AudioOutputUnitStart(audio_unit);
+    // Follow unplugs, replugs and default device changes from now on
+    watch_devices_start();
+    return noErr;
 }
 
-OSStatus audio_input_init(void) {
-    printf("Starting audio input initialization...\n");
-    
+// Create and initialize the input unit of a slot, on a device (0 for the
+// system default)
+static OSStatus create_input_unit(int slot, AudioDeviceID device) {
     // Describe audio component
     AudioComponentDescription desc = {0};
     desc.componentType = kAudioUnitType_Output;
@@ -230,16 +371,18 @@ OSStatus audio_input_init(void) {
     printf("Found input component\n");
 
     // Create audio unit instance
-    OSStatus status = AudioComponentInstanceNew(input_component, &input_unit);
+    AudioComponentInstance unit = NULL;
+    OSStatus status = AudioComponentInstanceNew(input_component, &unit);
     if (status != noErr) {
         printf("Failed to create input unit instance: %d\n", (int)status);
         return status;
     }
+    input_units[slot] = unit;
     printf("Created input unit instance\n");
 
     // Enable input on bus 1
     UInt32 enable = 1;
-    status = AudioUnitSetProperty(input_unit,
+    status = AudioUnitSetProperty(unit,
                                 kAudioOutputUnitProperty_EnableIO,
                                 kAudioUnitScope_Input,
                                 1,
@@ -253,7 +396,7 @@ OSStatus audio_input_init(void) {
 
     // Disable output on bus 0
     enable = 0;
-    status = AudioUnitSetProperty(input_unit,
+    status = AudioUnitSetProperty(unit,
                                 kAudioOutputUnitProperty_EnableIO,
                                 kAudioUnitScope_Output,
                                 0,
@@ -265,6 +408,16 @@ OSStatus audio_input_init(void) {
     }
     printf("Disabled output on bus 0\n");
 
+    // The device goes on once input is enabled, before the format is set
+    if (device) {
+        status = AudioUnitSetProperty(unit, kAudioOutputUnitProperty_CurrentDevice, kAudioUnitScope_Global, 0,
+                                      &device, sizeof(device));
+        if (status != noErr) {
+            printf("Failed to set input device: %d\n", (int)status);
+            return status;
+        }
+    }
+
     // Set up stream format for input
     AudioStreamBasicDescription format = {0};
     format.mSampleRate = VBAN_SAMPLE_RATE;
@@ -278,7 +431,7 @@ OSStatus audio_input_init(void) {
         (format.mBitsPerChannel / 8) * format.mChannelsPerFrame;
 
     // Set format for input scope (recording)
-    status = AudioUnitSetProperty(input_unit,
+    status = AudioUnitSetProperty(unit,
                                 kAudioUnitProperty_StreamFormat,
                                 kAudioUnitScope_Output,  // Output scope for input bus
                                 1,                       // Input bus
@@ -290,12 +443,12 @@ OSStatus audio_input_init(void) {
     }
     printf("Successfully set input scope format\n");
 
-    // Set up input callback
+    // Set up input callback, telling it which slot it captures for
     AURenderCallbackStruct callback = {0};
     callback.inputProc = audio_input_callback;
-    callback.inputProcRefCon = NULL;
+    callback.inputProcRefCon = (void*)(intptr_t)slot;
 
-    status = AudioUnitSetProperty(input_unit,
+    status = AudioUnitSetProperty(unit,
                                 kAudioOutputUnitProperty_SetInputCallback,
                                 kAudioUnitScope_Global,
                                 1,  // Input bus
@@ -307,8 +460,13 @@ OSStatus audio_input_init(void) {
     }
     printf("Input callback registered successfully\n");
 
+    // Callbacks must fit the device switch's buffers
+    UInt32 max_frames = AUDIO_MAX_FRAMES;
+    AudioUnitSetProperty(unit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0,
+                         &max_frames, sizeof(max_frames));
+
     // Initialize audio unit
-    status = AudioUnitInitialize(input_unit);
+    status = AudioUnitInitialize(unit);
     if (status != noErr) {
         printf("Failed to initialize input unit: %d\n", (int)status);
         return status;
@@ -318,80 +476,132 @@ OSStatus audio_input_init(void) {
     return noErr;
 }
 
+OSStatus audio_input_init(void) {
+    printf("Starting audio input initialization...\n");
+
+    if (device_swap_init(&input_swap, 1, VBAN_SAMPLE_RATE, AUDIO_SWAP_FADE_MS, AUDIO_MAX_FRAMES) != 0) {
+        printf("Failed to allocate the input device switch\n");
+        return -1;
+    }
+    callback_stats_init(&capture_stats);
+    if (audio_meter_init(&input_meter, 1, VBAN_SAMPLE_RATE) != 0) {
+        printf("Failed to allocate input meter\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&device_lock);
+    OSStatus status = create_input_unit(0, 0);
+    pthread_mutex_unlock(&device_lock);
+    return status;
+}
+
+// Device latency plus safety offset of the unit's current device, in frames
+static UInt32 get_unit_latency(AudioUnit unit, int is_input) {
+    AudioDeviceID device = 0;
+    UInt32 size = sizeof(device);
+    if (!unit || AudioUnitGetProperty(unit, kAudioOutputUnitProperty_CurrentDevice,
+                                      kAudioUnitScope_Global, 0, &device, &size) != noErr) {
+        return 0;
+    }
+
+    AudioObjectPropertyAddress property = {
+        kAudioDevicePropertyLatency,
+        is_input ? kAudioDevicePropertyScopeInput : kAudioDevicePropertyScopeOutput,
+        kAudioObjectPropertyElementMain
+    };
+    UInt32 latency = 0, offset = 0;
+    size = sizeof(latency);
+    AudioObjectGetPropertyData(device, &property, 0, NULL, &size, &latency);
+    property.mSelector = kAudioDevicePropertySafetyOffset;
+    size = sizeof(offset);
+    AudioObjectGetPropertyData(device, &property, 0, NULL, &size, &offset);
+    return latency + offset;
+}
+
+int audio_get_stats(vban_audio_stats_t* stats) {
+    AudioUnit output_unit = current_unit(0);
+    if (!output_unit) return -1;
+
+    UInt32 period = 0;
+    UInt32 size = sizeof(period);
+    AudioUnitGetProperty(output_unit, kAudioDevicePropertyBufferFrameSize, kAudioUnitScope_Global, 0,
+                         &period, &size);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->sample_rate = VBAN_SAMPLE_RATE;
+    stats->period_frames = (int)period;
+    stats->input_latency_frames = (int)get_unit_latency(current_unit(1), 1);
+    stats->output_latency_frames = (int)get_unit_latency(output_unit, 0);
+    stats->device_switches = atomic_load_explicit(&output_swap.swaps, memory_order_relaxed) +
+                             atomic_load_explicit(&input_swap.swaps, memory_order_relaxed);
+    callback_stats_read(&render_stats, stats);
+    callback_stats_read_deadlines(&render_stats, &stats->render);
+    callback_stats_read_deadlines(&capture_stats, &stats->capture);
+    stats->capture_failures = atomic_load_explicit(&capture_failures, memory_order_relaxed);
+    if (catchup) {
+        stats->frames_compressed = atomic_load_explicit(&stretcher.frames_compressed, memory_order_relaxed);
+        stats->frames_expanded = atomic_load_explicit(&stretcher.frames_expanded, memory_order_relaxed);
+    }
+    return 0;
+}
+
 int audio_buffer_init(void) {
-    // Initialize output buffer
-    g_audio_buffer.capacity = AUDIO_BUFFER_SIZE;
-    g_audio_buffer.data = (int16_t*)calloc(g_audio_buffer.capacity, sizeof(int16_t));
-    if (!g_audio_buffer.data) return -1;
-    g_audio_buffer.size = 0;
-    pthread_mutex_init(&g_audio_buffer.mutex, NULL);
+    // Initialize output buffer, with headroom for one datagram decoded in place
+    if (audio_buffer_create(&g_audio_buffer, AUDIO_BUFFER_SIZE + VBAN_MAX_PACKET_SIZE / sizeof(int16_t),
+                            sizeof(vban_sample_t)) != 0) {
+        return -1;
+    }
 
     // Initialize input buffer
-    g_input_buffer.capacity = AUDIO_BUFFER_SIZE;
-    g_input_buffer.data = (int16_t*)calloc(g_input_buffer.capacity, sizeof(int16_t));
-    if (!g_input_buffer.data) {
-        free(g_audio_buffer.data);
+    if (audio_buffer_create(&g_input_buffer, AUDIO_BUFFER_SIZE, sizeof(vban_sample_t)) != 0) {
+        audio_buffer_destroy(&g_audio_buffer);
         return -1;
     }
-    g_input_buffer.size = 0;
-    pthread_mutex_init(&g_input_buffer.mutex, NULL);
 
     return 0;
 }
 
 void audio_process_input(const int16_t* audio_data, int num_samples, int num_channels) {
-    // Convert endianness and copy to buffer
-    int16_t* converted_buffer = (int16_t*)malloc(num_samples * num_channels * sizeof(int16_t));
-    if (converted_buffer) {
-        for (int i = 0; i < num_samples * num_channels; i++) {
-            converted_buffer[i] = OSSwapLittleToHostInt16(audio_data[i]);
-        }
-        audio_buffer_add(converted_buffer, num_samples, num_channels);
-        free(converted_buffer);
-    }
+    TRACE_BEGIN("decode");
+
+    // Decode straight into the output ring
+    audio_buffer_span_t span;
+    size_t total_samples = audio_buffer_reserve(&g_audio_buffer, num_samples * num_channels, &span);
+
+    sample_from_le16(audio_data, span.len[0], span.ptr[0]);
+    sample_from_le16(audio_data + span.len[0], span.len[1], span.ptr[1]);
+
+    audio_buffer_commit(&g_audio_buffer, total_samples);
+    TRACE_END("decode");
 }
 
 void audio_buffer_add(const int16_t* data, size_t samples, int channels) {
-    pthread_mutex_lock(&g_audio_buffer.mutex);
-    
-    size_t total_samples = samples * channels;
-    if (g_audio_buffer.size + total_samples > g_audio_buffer.capacity) {
-        // Buffer full, remove oldest data
-        memmove(g_audio_buffer.data, 
-                g_audio_buffer.data + total_samples,
-                (g_audio_buffer.size - total_samples) * sizeof(int16_t));
-        g_audio_buffer.size -= total_samples;
-    }
-    
-    // Add new data
-    memcpy(g_audio_buffer.data + g_audio_buffer.size,
-           data,
-           total_samples * sizeof(int16_t));
-    g_audio_buffer.size += total_samples;
-    
-    pthread_mutex_unlock(&g_audio_buffer.mutex);
+    audio_buffer_span_t span;
+    size_t total_samples = audio_buffer_reserve(&g_audio_buffer, samples * channels, &span);
+    sample_from_int16(data, span.len[0], span.ptr[0]);
+    sample_from_int16(data + span.len[0], span.len[1], span.ptr[1]);
+    audio_buffer_commit(&g_audio_buffer, total_samples);
 }
 
 void audio_cleanup(void) {
     printf("Cleaning up audio\n");
-    if (audio_unit) {
-        AudioOutputUnitStop(audio_unit);
-        AudioUnitUninitialize(audio_unit);
-        AudioComponentInstanceDispose(audio_unit);
-        audio_unit = NULL;
+    watch_devices_stop();
+    for (int slot = 0; slot < 2; slot++) {
+        dispose_unit(&output_units[slot]);
+        dispose_unit(&input_units[slot]);
     }
+    input_started = 0;
+    device_swap_destroy(&output_swap);
+    device_swap_destroy(&input_swap);
 
-    if (input_unit) {
-        AudioOutputUnitStop(input_unit);
-        AudioUnitUninitialize(input_unit);
-        AudioComponentInstanceDispose(input_unit);
-        input_unit = NULL;
+    if (catchup) {
+        stretch_destroy(&stretcher);
+        catchup = 0;
     }
-
-    free(g_audio_buffer.data);
-    free(g_input_buffer.data);
-    pthread_mutex_destroy(&g_audio_buffer.mutex);
-    pthread_mutex_destroy(&g_input_buffer.mutex);
+    audio_buffer_destroy(&g_audio_buffer);
+    audio_buffer_destroy(&g_input_buffer);
+    audio_meter_destroy(&input_meter);
+    audio_meter_destroy(&output_meter);
 }
 
 // Function to get device name
@@ -518,73 +728,247 @@ void audio_list_devices(void) {
     printf("\n");
 }
 
-// Function to set input device
-OSStatus audio_set_input_device(AudioDeviceID deviceID) {
-    if (!input_unit) {
-        printf("Audio input unit not initialized\n");
-        return -1;
+// Device switching. A switch brings the new device up on the free slot
+// while the old one keeps running, and the swap crossfades between them.
+
+// Device watcher: CoreAudio's listeners only flag a change, the thread acts on it
+static pthread_t watch_thread;
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t watch_cond = PTHREAD_COND_INITIALIZER;
+static int watch_running = 0;
+static int devices_changed = 0;
+
+static const AudioObjectPropertyAddress watched_properties[] = {
+    { kAudioHardwarePropertyDevices, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain },
+    { kAudioHardwarePropertyDefaultOutputDevice, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain },
+    { kAudioHardwarePropertyDefaultInputDevice, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain }
+};
+
+static AudioDeviceID unit_device(AudioUnit unit) {
+    AudioDeviceID device = 0;
+    UInt32 size = sizeof(device);
+    if (!unit || AudioUnitGetProperty(unit, kAudioOutputUnitProperty_CurrentDevice,
+                                      kAudioUnitScope_Global, 0, &device, &size) != noErr) {
+        return 0;
     }
-    
-    OSStatus status = AudioUnitSetProperty(input_unit,
-                                         kAudioOutputUnitProperty_CurrentDevice,
-                                         kAudioUnitScope_Global,
-                                         0,
-                                         &deviceID,
-                                         sizeof(deviceID));
+    return device;
+}
 
+static int device_alive(AudioDeviceID device) {
+    AudioObjectPropertyAddress property = {
+        kAudioDevicePropertyDeviceIsAlive,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMain
+    };
+    UInt32 alive = 0;
+    UInt32 size = sizeof(alive);
+    if (AudioObjectGetPropertyData(device, &property, 0, NULL, &size, &alive) != noErr) return 0;
+    return alive != 0;
+}
+
+static AudioDeviceID default_device(int is_input) {
+    AudioObjectPropertyAddress property = {
+        is_input ? kAudioHardwarePropertyDefaultInputDevice : kAudioHardwarePropertyDefaultOutputDevice,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMain
+    };
+    AudioDeviceID device = 0;
+    UInt32 size = sizeof(device);
+    AudioObjectGetPropertyData(kAudioObjectSystemObject, &property, 0, NULL, &size, &device);
+    return device;
+}
+
+// Wait for the new device's first callback (pending) or the end of the handover
+static int wait_swap(const device_swap_t* sw, int pending) {
+    for (int ms = 0; ms < AUDIO_SWAP_TIMEOUT_MS; ms++) {
+        int state = atomic_load_explicit(&sw->state, memory_order_acquire);
+        if (pending ? state != DEVICE_SWAP_PENDING : state == DEVICE_SWAP_IDLE) return 0;
+        usleep(1000);
+    }
+    return -1;
+}
+
+// Hand a running stream over to another device. Called with device_lock held.
+static OSStatus switch_device(int is_input, AudioDeviceID device) {
+    device_swap_t* sw = is_input ? &input_swap : &output_swap;
+    AudioComponentInstance* units = is_input ? input_units : output_units;
+    int old = device_swap_active(sw);
+    int slot = 1 - old;
+    int old_alive = device_alive(unit_device(units[old]));
+
+    OSStatus status = is_input ? create_input_unit(slot, device) : create_output_unit(slot, device);
+    if (status == noErr) {
+        if (device_swap_begin(sw) != slot) {
+            status = -1;
+        } else if ((status = AudioOutputUnitStart(units[slot])) != noErr) {
+            device_swap_cancel(sw);
+        }
+    }
     if (status != noErr) {
-        printf("Failed to set input device: %d\n", (int)status);
+        dispose_unit(&units[slot]);
         return status;
     }
-    
-    char* name = get_device_name(deviceID);
-    if (name) {
-        printf("Successfully set input device to: %s\n", name);
-        free(name);
+
+    if (!old_alive) {
+        // Unplugged: nothing more comes from the old device, fade in from
+        // what it left behind
+        AudioOutputUnitStop(units[old]);
+        device_swap_cut(sw);
+    } else if (wait_swap(sw, 1) != 0 && device_swap_cancel(sw) == 0) {
+        printf("New %s device did not start\n", is_input ? "input" : "output");
+        dispose_unit(&units[slot]);
+        return -1;
     }
-    
+
+    if (wait_swap(sw, 0) != 0) {
+        // The old device stalled mid-fade: stop it and finish without it
+        AudioOutputUnitStop(units[old]);
+        device_swap_cut(sw);
+        wait_swap(sw, 0);
+    }
+    dispose_unit(&units[old]);
     return noErr;
 }
 
-// Function to set output device
-OSStatus audio_set_output_device(AudioDeviceID deviceID) {
-    if (!audio_unit) {
-        printf("Audio output unit not initialized\n");
+// Move a direction to a device, remembering it as the one to return to if
+// it comes from the caller rather than the watcher
+static OSStatus set_device(int is_input, AudioDeviceID deviceID, int remember) {
+    const char* direction = is_input ? "input" : "output";
+
+    pthread_mutex_lock(&device_lock);
+    AudioUnit unit = current_unit(is_input);
+    OSStatus status = noErr;
+    if (!unit) {
+        printf("Audio %s unit not initialized\n", direction);
+        pthread_mutex_unlock(&device_lock);
         return -1;
     }
-    
-    OSStatus status = AudioUnitSetProperty(audio_unit,
-                                         kAudioOutputUnitProperty_CurrentDevice,
-                                         kAudioUnitScope_Global,
-                                         0,
-                                         &deviceID,
-                                         sizeof(deviceID));
-                                         
+    if (deviceID != unit_device(unit)) {
+        if (is_input && !input_started) {
+            // Nothing running yet to hand over
+            status = AudioUnitSetProperty(unit,
+                                          kAudioOutputUnitProperty_CurrentDevice,
+                                          kAudioUnitScope_Global,
+                                          0,
+                                          &deviceID,
+                                          sizeof(deviceID));
+        } else {
+            status = switch_device(is_input, deviceID);
+        }
+    }
+
+    char* name = get_device_name(deviceID);
+    if (status == noErr && remember) {
+        preferred_device[is_input][0] = '\0';
+        if (name) strncat(preferred_device[is_input], name, sizeof(preferred_device[is_input]) - 1);
+    }
+    pthread_mutex_unlock(&device_lock);
+
     if (status != noErr) {
-        printf("Failed to set output device: %d\n", (int)status);
+        printf("Failed to set %s device: %d\n", direction, (int)status);
+        free(name);
         return status;
     }
-    
-    char* name = get_device_name(deviceID);
     if (name) {
-        printf("Successfully set output device to: %s\n", name);
+        printf("Successfully set %s device to: %s\n", direction, name);
         free(name);
     }
-    
     return noErr;
 }
 
+// Function to set input device
+OSStatus audio_set_input_device(AudioDeviceID deviceID) {
+    return set_device(1, deviceID, 1);
+}
+
+// Function to set output device
+OSStatus audio_set_output_device(AudioDeviceID deviceID) {
+    return set_device(0, deviceID, 1);
+}
+
+// Move a direction back to its configured device if it is present, or else
+// to the system default, when either has changed
+static void follow_device(int is_input) {
+    pthread_mutex_lock(&device_lock);
+    AudioUnit unit = current_unit(is_input);
+    AudioDeviceID device = 0, current = 0;
+    if (unit && (!is_input || input_started)) {
+        if (preferred_device[is_input][0]) device = find_device_by_name(preferred_device[is_input], is_input);
+        if (!device) device = default_device(is_input);
+        current = unit_device(unit);
+    }
+    pthread_mutex_unlock(&device_lock);
+
+    if (device && device != current) set_device(is_input, device, 0);
+}
+
+static OSStatus devices_listener(AudioObjectID object, UInt32 count,
+                                 const AudioObjectPropertyAddress* addresses, void* user) {
+    (void)object; (void)count; (void)addresses; (void)user;
+    pthread_mutex_lock(&watch_lock);
+    devices_changed = 1;
+    pthread_cond_signal(&watch_cond);
+    pthread_mutex_unlock(&watch_lock);
+    return noErr;
+}
+
+static void* watch_devices(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&watch_lock);
+    while (watch_running) {
+        if (!devices_changed) {
+            pthread_cond_wait(&watch_cond, &watch_lock);
+            continue;
+        }
+        devices_changed = 0;
+        pthread_mutex_unlock(&watch_lock);
+        follow_device(0);
+        follow_device(1);
+        pthread_mutex_lock(&watch_lock);
+    }
+    pthread_mutex_unlock(&watch_lock);
+    return NULL;
+}
+
+static void watch_devices_start(void) {
+    watch_running = 1;
+    if (pthread_create(&watch_thread, NULL, watch_devices, NULL) != 0) {
+        printf("Failed to start the device watcher\n");
+        watch_running = 0;
+        return;
+    }
+    for (size_t i = 0; i < sizeof(watched_properties) / sizeof(watched_properties[0]); i++) {
+        AudioObjectAddPropertyListener(kAudioObjectSystemObject, &watched_properties[i], devices_listener, NULL);
+    }
+}
+
+static void watch_devices_stop(void) {
+    if (!watch_running) return;
+    for (size_t i = 0; i < sizeof(watched_properties) / sizeof(watched_properties[0]); i++) {
+        AudioObjectRemovePropertyListener(kAudioObjectSystemObject, &watched_properties[i], devices_listener, NULL);
+    }
+    pthread_mutex_lock(&watch_lock);
+    watch_running = 0;
+    pthread_cond_signal(&watch_cond);
+    pthread_mutex_unlock(&watch_lock);
+    pthread_join(watch_thread, NULL);
+}
+
 OSStatus audio_start_input(void) {
-    if (!input_unit) {
+    pthread_mutex_lock(&device_lock);
+    AudioUnit unit = current_unit(1);
+    OSStatus status = unit ? AudioOutputUnitStart(unit) : -1;
+    if (status == noErr) input_started = 1;
+    pthread_mutex_unlock(&device_lock);
+
+    if (!unit) {
         printf("Audio input unit not initialized\n");
         return -1;
     }
-
-    OSStatus status = AudioOutputUnitStart(input_unit);
     if (status != noErr) {
         printf("Failed to start input unit: %d\n", (int)status);
         return status;
     }
     printf("Input unit started successfully\n");
     return noErr;
-} 
\ No newline at end of file
+}
@@ -1,18 +1,22 @@
 #ifndef VBAN4MAC_AUDIO_H
 #define VBAN4MAC_AUDIO_H
 
+#ifdef VBAN_JACK
+#include <stdint.h>
+// The JACK backend keeps the CoreAudio-shaped interface: OSStatus values
+// are 0 or negative error codes, and there are no device IDs
+typedef int32_t OSStatus;
+typedef uint32_t AudioDeviceID;
+#define noErr 0
+#else
 #include <AudioToolbox/AudioToolbox.h>
+#endif
 #include <pthread.h>
+#include "buffer.h"
+#include "meter.h"
+#include "../include/vban4mac/types.h"
 
-// Audio buffer structure
-typedef struct {
-    int16_t* data;
-    size_t size;
-    size_t capacity;
-    pthread_mutex_t mutex;
-} audio_buffer_t;
-
-// Global audio buffers
+// Global audio buffers, in the pipeline's vban_sample_t format
 extern audio_buffer_t g_audio_buffer;
 extern audio_buffer_t g_input_buffer;
 
@@ -26,19 +30,80 @@ void audio_cleanup(void);
 
 // Device management functions
 void audio_list_devices(void);
+#ifdef VBAN_JACK
+/**
+ * Connect the capture ports to the first JACK output ports matching a
+ * pattern (the extra ones to the last port if fewer match)
+ * @param pattern Port name or regular expression, e.g. "system:capture_1"
+ * @return noErr on success, -1 if no port matched or the connection failed
+ */
+OSStatus audio_connect_input(const char* pattern);
+
+/**
+ * Connect the playback ports to the first JACK input ports matching a
+ * pattern (the extra ones to the last port if fewer match)
+ * @param pattern Port name or regular expression, e.g. "system:playback_"
+ * @return noErr on success, -1 if no port matched or the connection failed
+ */
+OSStatus audio_connect_output(const char* pattern);
+#else
+/**
+ * Move capture or playback to a device. A running stream is handed over
+ * with a short crossfade, the new device brought up before the old one
+ * stops. The device is remembered: if it is unplugged the stream follows
+ * the system default, and returns to it when it reappears.
+ * @param deviceID Device to use
+ * @return noErr on success, or the error that kept the device from starting
+ */
 OSStatus audio_set_input_device(AudioDeviceID deviceID);
 OSStatus audio_set_output_device(AudioDeviceID deviceID);
+#endif
 
-// Audio processing functions
+// Audio processing functions, taking little-endian (process_input) or
+// host-order (buffer_add) wire int16 and decoding it into the output ring
 void audio_process_input(const int16_t* audio_data, int num_samples, int num_channels);
 void audio_buffer_add(const int16_t* data, size_t samples, int channels);
 
-// Monitoring callbacks
-typedef void (*audio_monitor_callback)(const float* samples, size_t count);
-void audio_set_input_monitor(audio_monitor_callback callback);
-void audio_set_output_monitor(audio_monitor_callback callback);
+/**
+ * Set how many channels are captured into the input ring and played from
+ * the output ring. Call before audio_set_catchup and the init functions.
+ * @param input_channels Channels per captured frame
+ * @param output_channels Channels per played frame
+ * @return 0 on success, -1 if the backend cannot use that layout
+ */
+int audio_set_channels(int input_channels, int output_channels);
+
+/**
+ * Set how many frames the render callback lets build up before it starts
+ * (or, after an underrun, resumes) playing. Safe to call from any thread.
+ * @param frames Frames to prime, clamped to what the output ring can hold
+ */
+void audio_set_playout_target(size_t frames);
+
+/**
+ * Turn on latency catch-up: the render callback time-stretches the output
+ * to hold what is buffered at the playout target, instead of playing any
+ * excess at its full latency. Call before audio_output_init.
+ * @param config Largest speed change and drain window; max_speed_pct 0 turns it off
+ * @return 0 on success, -1 if the stretcher could not be allocated
+ */
+int audio_set_catchup(const vban_catchup_config_t* config);
+
+/**
+ * Device period, reported latencies and callback timing and deadlines
+ * @param stats Filled with the backend's figures
+ * @return 0 on success, -1 if the output is not running
+ */
+int audio_get_stats(vban_audio_stats_t* stats);
+
+// Level metering, lock-free and safe to poll from any thread.
+// Return the number of channels written to levels.
+int audio_get_input_levels(vban_level_t* levels, int max_channels);
+int audio_get_output_levels(vban_level_t* levels, int max_channels);
 
+#ifndef VBAN_JACK
 // Device name utility function
 char* get_device_name(AudioDeviceID deviceID);
+#endif
 
 #endif /* VBAN4MAC_AUDIO_H */ 
\ No newline at end of file
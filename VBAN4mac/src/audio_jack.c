@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+#include "audio.h"
+#include "callback_stats.h"
+#include "sample.h"
+#include "stretch.h"
+#include "trace.h"
+#include "../include/vban4mac/types.h"
+
+// Headless JACK client backend (build with JACK=1). Registers one capture
+// port per input channel and one playback port per output channel, and
+// moves audio between them and the VBAN rings in the JACK process
+// callback. The callback never allocates and never waits: JACK's float32
+// ports are read and written in place (through static scratch buffers in
+// an int16 build), and the rings are lock-free.
+
+#define AUDIO_BUFFER_SIZE (VBAN_PROTOCOL_MAXNBS * 16)  // Buffer for ~256ms of audio
+#define JACK_MAX_FRAMES 8192                           // Largest JACK period handled
+#define JACK_MAX_CHANNELS 8                            // Most ports registered each way
+#define JACK_CLIENT_NAME "vban4mac"
+
+static jack_client_t* client = NULL;
+static int input_channels = 1;
+static int output_channels = 2;
+static jack_port_t* input_ports[JACK_MAX_CHANNELS] = { NULL };
+static jack_port_t* output_ports[JACK_MAX_CHANNELS] = { NULL };
+static jack_nframes_t sample_rate = VBAN_SAMPLE_RATE;
+static atomic_int active = 0;        // Capture feeds the input ring
+static atomic_int server_gone = 0;
+
+// Audio buffers
+audio_buffer_t g_audio_buffer = {0};
+audio_buffer_t g_input_buffer = {0};
+
+#ifdef VBAN_SAMPLE_INT16
+// Process callback scratch, sized for the largest period so it never allocates
+static int16_t capture_scratch[JACK_MAX_CHANNELS][JACK_MAX_FRAMES];
+static int16_t render_scratch[JACK_MAX_CHANNELS][JACK_MAX_FRAMES];
+#endif
+
+// Frames to buffer before playing, set from the measured network jitter
+static atomic_size_t playout_target = 0;
+static int priming = 1;  // Process callback only: waiting for the playout target
+
+// Latency catch-up, owned by the process callback once the client is active
+static stretch_t stretcher;
+static int catchup = 0;
+
+static callback_stats_t process_stats;
+
+int audio_set_channels(int inputs, int outputs) {
+    if (client) {
+        fprintf(stderr, "JACK channels must be set before the client opens\n");
+        return -1;
+    }
+    if (inputs < 1 || inputs > JACK_MAX_CHANNELS || outputs < 1 || outputs > JACK_MAX_CHANNELS) {
+        fprintf(stderr, "JACK backend supports 1 to %d channels each way\n", JACK_MAX_CHANNELS);
+        return -1;
+    }
+    input_channels = inputs;
+    output_channels = outputs;
+    return 0;
+}
+
+void audio_set_playout_target(size_t frames) {
+    // Leave room for a callback's worth of frames on top
+    if (frames > AUDIO_BUFFER_SIZE / 4) frames = AUDIO_BUFFER_SIZE / 4;
+    atomic_store_explicit(&playout_target, frames, memory_order_relaxed);
+}
+
+int audio_set_catchup(const vban_catchup_config_t* config) {
+    if (catchup) {
+        stretch_destroy(&stretcher);
+        catchup = 0;
+    }
+    if (config->max_speed_pct <= 0) return 0;
+
+    // The rings carry VBAN-rate audio whatever the server's rate
+    if (stretch_init(&stretcher, output_channels, VBAN_SAMPLE_RATE, config) != 0) {
+        fprintf(stderr, "Failed to set up latency catch-up\n");
+        return -1;
+    }
+    catchup = 1;
+    return 0;
+}
+
+// Level meters, updated by the process callback
+static audio_meter_t input_meter = {0};
+static audio_meter_t output_meter = {0};
+
+int audio_get_input_levels(vban_level_t* levels, int max_channels) {
+    return audio_meter_read(&input_meter, levels, max_channels);
+}
+
+int audio_get_output_levels(vban_level_t* levels, int max_channels) {
+    return audio_meter_read(&output_meter, levels, max_channels);
+}
+
+static void jack_capture(jack_nframes_t nframes) {
+    TRACE_BEGIN("capture");
+    const float* in[JACK_MAX_CHANNELS];
+    const vban_sample_t* samples[JACK_MAX_CHANNELS];
+#ifdef VBAN_SAMPLE_INT16
+    audio_meter_block_t levels[JACK_MAX_CHANNELS] = {{0}};  // Metered as it is converted
+#endif
+    for (int ch = 0; ch < input_channels; ch++) {
+        in[ch] = (const float*)jack_port_get_buffer(input_ports[ch], nframes);
+#ifdef VBAN_SAMPLE_INT16
+        sample_from_float_metered(in[ch], nframes, capture_scratch[ch], &levels[ch]);
+        samples[ch] = capture_scratch[ch];
+#else
+        samples[ch] = in[ch];  // Already the pipeline's format
+#endif
+    }
+    audio_buffer_write_planar(&g_input_buffer, (const void* const*)samples, input_channels, nframes);
+
+#ifdef VBAN_SAMPLE_INT16
+    audio_meter_publish(&input_meter, levels, nframes);
+#else
+    audio_meter_update_float(&input_meter, in, nframes);  // Nothing converted it to meter on the way
+#endif
+    TRACE_END("capture");
+}
+
+static void jack_render(jack_nframes_t nframes) {
+    TRACE_BEGIN("render");
+    vban_sample_t* channels[JACK_MAX_CHANNELS];
+    for (int ch = 0; ch < output_channels; ch++) {
+#ifdef VBAN_SAMPLE_INT16
+        channels[ch] = render_scratch[ch];
+#else
+        // Read straight into the port buffers
+        channels[ch] = (float*)jack_port_get_buffer(output_ports[ch], nframes);
+#endif
+    }
+
+    size_t target = atomic_load_explicit(&playout_target, memory_order_relaxed);
+    size_t copied = 0;
+
+    // After an underrun, let enough audio build up to ride out the jitter
+    if (priming) {
+        size_t held = catchup ? stretch_buffered(&stretcher) * output_channels : 0;
+        if (audio_buffer_available(&g_audio_buffer) + held >= (target + nframes) * output_channels) {
+            priming = 0;
+        }
+    }
+
+    if (!priming) {
+        // With catch-up on, what is buffered is also steered toward the target
+        copied = catchup ? stretch_render(&stretcher, &g_audio_buffer, channels, nframes, target + nframes)
+                         : audio_buffer_read_planar(&g_audio_buffer, (void* const*)channels, output_channels, nframes);
+    }
+    if (copied != nframes) {
+        if (!priming) TRACE_INSTANT("underrun");
+        priming = 1;
+        for (int ch = 0; ch < output_channels; ch++) {
+            memset(channels[ch] + copied, 0, (nframes - copied) * sizeof(vban_sample_t));
+        }
+    }
+
+#ifdef VBAN_SAMPLE_INT16
+    // Meter the block as it is converted for the ports
+    audio_meter_block_t levels[JACK_MAX_CHANNELS];
+    for (int ch = 0; ch < output_channels; ch++) {
+        levels[ch] = (audio_meter_block_t){0};
+        sample_to_float_metered(channels[ch], nframes, (float*)jack_port_get_buffer(output_ports[ch], nframes),
+                                &levels[ch]);
+    }
+    audio_meter_publish(&output_meter, levels, nframes);
+#else
+    audio_meter_update_samples(&output_meter, (const vban_sample_t* const*)channels, nframes);
+#endif
+    TRACE_END("render");
+}
+
+static int jack_process(jack_nframes_t nframes, void* arg) {
+    (void)arg;
+    int64_t start = callback_stats_now_ns();
+
+    if (nframes > JACK_MAX_FRAMES) {
+        // Periods this large are not supported; keep the graph running silently
+        for (int ch = 0; ch < output_channels; ch++) {
+            if (output_ports[ch]) memset(jack_port_get_buffer(output_ports[ch], nframes), 0, nframes * sizeof(float));
+        }
+        return 0;
+    }
+
+    if (input_ports[0] && atomic_load_explicit(&active, memory_order_relaxed)) jack_capture(nframes);
+    if (output_ports[0]) jack_render(nframes);
+
+    callback_stats_record(&process_stats, start, callback_stats_now_ns(),
+                          (int64_t)nframes * 1000000000LL / sample_rate);
+    return 0;
+}
+
+static void jack_shutdown(void* arg) {
+    (void)arg;
+    // The server went away; JACK must not be called any more
+    printf("JACK server shut down\n");
+    atomic_store(&active, 0);
+    atomic_store(&server_gone, 1);
+}
+
+// Open the client on first use, shared by the output and input setup
+static OSStatus jack_open_client(void) {
+    if (client) return noErr;
+
+    jack_status_t status;
+    client = jack_client_open(JACK_CLIENT_NAME, JackNoStartServer, &status);
+    if (!client) {
+        printf("Failed to connect to the JACK server (status 0x%x)\n", (unsigned)status);
+        return -1;
+    }
+
+    sample_rate = jack_get_sample_rate(client);
+    if (sample_rate != VBAN_SAMPLE_RATE) {
+        // Nothing resamples, so the streams would play pitch-shifted
+        printf("JACK runs at %u Hz, but VBAN streams are %d Hz; restart JACK at %d Hz\n",
+               (unsigned)sample_rate, VBAN_SAMPLE_RATE, VBAN_SAMPLE_RATE);
+        jack_client_close(client);
+        client = NULL;
+        return -1;
+    }
+
+    callback_stats_init(&process_stats);
+    jack_set_process_callback(client, jack_process, NULL);
+    jack_on_shutdown(client, jack_shutdown, NULL);
+    printf("Connected to JACK as '%s' (%u Hz, %u frame period)\n", jack_get_client_name(client),
+           (unsigned)sample_rate, (unsigned)jack_get_buffer_size(client));
+    return noErr;
+}
+
+// Register ports prefix_1 to prefix_count
+static int jack_register_ports(jack_port_t** ports, int count, const char* prefix, unsigned long flags) {
+    for (int ch = 0; ch < count; ch++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%s_%d", prefix, ch + 1);
+        ports[ch] = jack_port_register(client, name, JACK_DEFAULT_AUDIO_TYPE, flags, 0);
+        if (!ports[ch]) return -1;
+    }
+    return 0;
+}
+
+OSStatus audio_output_init(void) {
+    if (jack_open_client() != noErr) return -1;
+
+    if (jack_register_ports(output_ports, output_channels, "out", JackPortIsOutput) != 0) {
+        printf("Failed to register JACK output ports\n");
+        return -1;
+    }
+
+    if (audio_meter_init(&output_meter, output_channels, sample_rate) != 0) {
+        printf("Failed to allocate output meter\n");
+        return -1;
+    }
+
+    // Playback starts with the client; capture only feeds the ring once started
+    if (jack_activate(client) != 0) {
+        printf("Failed to activate JACK client\n");
+        return -1;
+    }
+    return noErr;
+}
+
+OSStatus audio_input_init(void) {
+    if (jack_open_client() != noErr) return -1;
+
+    if (jack_register_ports(input_ports, input_channels, "in", JackPortIsInput) != 0) {
+        printf("Failed to register JACK input ports\n");
+        return -1;
+    }
+
+    if (audio_meter_init(&input_meter, input_channels, sample_rate) != 0) {
+        printf("Failed to allocate input meter\n");
+        return -1;
+    }
+    return noErr;
+}
+
+OSStatus audio_start_input(void) {
+    if (!client || !input_ports[0]) {
+        printf("Audio input not initialized\n");
+        return -1;
+    }
+    atomic_store(&active, 1);
+    return noErr;
+}
+
+static OSStatus jack_connect_ports(const char* pattern, unsigned long flags, jack_port_t* const* ports, int count) {
+    if (!client) return -1;
+
+    const char** matches = jack_get_ports(client, pattern, JACK_DEFAULT_AUDIO_TYPE, flags);
+    if (!matches || !matches[0]) {
+        printf("No JACK port matches '%s'\n", pattern);
+        if (matches) jack_free(matches);
+        return -1;
+    }
+
+    OSStatus status = noErr;
+    int last = 0;
+    while (matches[last + 1]) last++;
+
+    for (int i = 0; i < count; i++) {
+        // Reuse the last match when there are fewer ports than channels
+        const char* other = matches[i <= last ? i : last];
+
+        const char* own = jack_port_name(ports[i]);
+        int result = (flags & JackPortIsOutput) ? jack_connect(client, other, own)
+                                                : jack_connect(client, own, other);
+        if (result != 0 && result != EEXIST) {
+            printf("Failed to connect %s and %s\n", own, other);
+            status = -1;
+        } else {
+            printf("Connected %s and %s\n", own, other);
+        }
+    }
+
+    jack_free(matches);
+    return status;
+}
+
+OSStatus audio_connect_input(const char* pattern) {
+    if (!input_ports[0]) return -1;
+    return jack_connect_ports(pattern, JackPortIsOutput, input_ports, input_channels);
+}
+
+OSStatus audio_connect_output(const char* pattern) {
+    if (!output_ports[0]) return -1;
+    return jack_connect_ports(pattern, JackPortIsInput, output_ports, output_channels);
+}
+
+void audio_list_devices(void) {
+    if (jack_open_client() != noErr) return;
+
+    const char** ports = jack_get_ports(client, NULL, JACK_DEFAULT_AUDIO_TYPE, 0);
+    printf("\nAvailable JACK Ports:\n");
+    printf("---------------------\n");
+    for (int i = 0; ports && ports[i]; i++) {
+        jack_port_t* port = jack_port_by_name(client, ports[i]);
+        int is_output = port && (jack_port_flags(port) & JackPortIsOutput);
+        printf("%s (%s)\n", ports[i], is_output ? "capture" : "playback");
+    }
+    if (ports) jack_free(ports);
+    printf("\n");
+}
+
+int audio_get_stats(vban_audio_stats_t* stats) {
+    if (!client || !output_ports[0] || atomic_load(&server_gone)) return -1;
+
+    jack_latency_range_t capture = { 0, 0 };
+    jack_latency_range_t playback = { 0, 0 };
+    if (input_ports[0]) jack_port_get_latency_range(input_ports[0], JackCaptureLatency, &capture);
+    jack_port_get_latency_range(output_ports[0], JackPlaybackLatency, &playback);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->sample_rate = (int)sample_rate;
+    stats->period_frames = (int)jack_get_buffer_size(client);
+    stats->input_latency_frames = (int)capture.max;
+    stats->output_latency_frames = (int)playback.max;
+    callback_stats_read(&process_stats, stats);
+    callback_stats_read_deadlines(&process_stats, &stats->render);
+    if (catchup) {
+        stats->frames_compressed = atomic_load_explicit(&stretcher.frames_compressed, memory_order_relaxed);
+        stats->frames_expanded = atomic_load_explicit(&stretcher.frames_expanded, memory_order_relaxed);
+    }
+    return 0;
+}
+
+int audio_buffer_init(void) {
+    // Initialize output buffer, with headroom for one datagram decoded in place
+    if (audio_buffer_create(&g_audio_buffer, AUDIO_BUFFER_SIZE + VBAN_MAX_PACKET_SIZE / sizeof(int16_t),
+                            sizeof(vban_sample_t)) != 0) {
+        return -1;
+    }
+
+    // Initialize input buffer
+    if (audio_buffer_create(&g_input_buffer, AUDIO_BUFFER_SIZE, sizeof(vban_sample_t)) != 0) {
+        audio_buffer_destroy(&g_audio_buffer);
+        return -1;
+    }
+
+    return 0;
+}
+
+void audio_process_input(const int16_t* audio_data, int num_samples, int num_channels) {
+    TRACE_BEGIN("decode");
+
+    // Decode straight into the output ring
+    audio_buffer_span_t span;
+    size_t total_samples = audio_buffer_reserve(&g_audio_buffer, num_samples * num_channels, &span);
+    sample_from_le16(audio_data, span.len[0], span.ptr[0]);
+    sample_from_le16(audio_data + span.len[0], span.len[1], span.ptr[1]);
+
+    audio_buffer_commit(&g_audio_buffer, total_samples);
+    TRACE_END("decode");
+}
+
+void audio_buffer_add(const int16_t* data, size_t samples, int channels) {
+    audio_buffer_span_t span;
+    size_t total_samples = audio_buffer_reserve(&g_audio_buffer, samples * channels, &span);
+    sample_from_int16(data, span.len[0], span.ptr[0]);
+    sample_from_int16(data + span.len[0], span.len[1], span.ptr[1]);
+    audio_buffer_commit(&g_audio_buffer, total_samples);
+}
+
+void audio_cleanup(void) {
+    printf("Cleaning up audio\n");
+    atomic_store(&active, 0);
+    if (client) {
+        if (!atomic_load(&server_gone)) jack_deactivate(client);
+        jack_client_close(client);
+        client = NULL;
+    }
+    memset(input_ports, 0, sizeof(input_ports));
+    memset(output_ports, 0, sizeof(output_ports));
+
+    if (catchup) {
+        stretch_destroy(&stretcher);
+        catchup = 0;
+    }
+    audio_buffer_destroy(&g_audio_buffer);
+    audio_buffer_destroy(&g_input_buffer);
+    audio_meter_destroy(&input_meter);
+    audio_meter_destroy(&output_meter);
+}
@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+#include "buffer.h"
+
+int audio_buffer_create(audio_buffer_t* buf, size_t capacity, size_t sample_size) {
+    buf->data = (unsigned char*)calloc(capacity, sample_size);
+    if (!buf->data) return -1;
+    buf->sample_size = sample_size;
+    buf->capacity = capacity;
+    atomic_init(&buf->read, 0);
+    atomic_init(&buf->write, 0);
+    return 0;
+}
+
+void audio_buffer_destroy(audio_buffer_t* buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->capacity = 0;
+}
+
+// Split samples starting at ring position pos into at most two contiguous parts
+static void buffer_span_at(audio_buffer_t* buf, uint64_t pos, size_t samples, audio_buffer_span_t* span) {
+    size_t index = (size_t)(pos % buf->capacity);
+    size_t first = buf->capacity - index;
+    if (first > samples) first = samples;
+    span->ptr[0] = buf->data + index * buf->sample_size;
+    span->len[0] = first;
+    span->ptr[1] = buf->data;
+    span->len[1] = samples - first;
+}
+
+size_t audio_buffer_reserve(audio_buffer_t* buf, size_t samples, audio_buffer_span_t* span) {
+    if (samples > buf->capacity) samples = buf->capacity;
+
+    // Only the producer moves the write position
+    uint64_t write = atomic_load_explicit(&buf->write, memory_order_relaxed);
+    uint64_t read = atomic_load_explicit(&buf->read, memory_order_acquire);
+    while (write + samples - read > buf->capacity) {
+        // Buffer full, drop the oldest data. Success orders the writes that
+        // follow after any read the consumer finished of that space.
+        if (atomic_compare_exchange_weak_explicit(&buf->read, &read, write + samples - buf->capacity,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            break;
+        }
+    }
+
+    buffer_span_at(buf, write, samples, span);
+    return samples;
+}
+
+void audio_buffer_commit(audio_buffer_t* buf, size_t samples) {
+    uint64_t write = atomic_load_explicit(&buf->write, memory_order_relaxed);
+    atomic_store_explicit(&buf->write, write + samples, memory_order_release);
+}
+
+// Copy samples into a region of the ring
+static void buffer_copy_in(audio_buffer_t* buf, const audio_buffer_span_t* span, const void* data) {
+    memcpy(span->ptr[0], data, span->len[0] * buf->sample_size);
+    memcpy(span->ptr[1], (const unsigned char*)data + span->len[0] * buf->sample_size,
+           span->len[1] * buf->sample_size);
+}
+
+void audio_buffer_write(audio_buffer_t* buf, const void* data, size_t samples) {
+    if (samples > buf->capacity) {
+        // Only the newest samples can fit
+        data = (const unsigned char*)data + (samples - buf->capacity) * buf->sample_size;
+        samples = buf->capacity;
+    }
+
+    audio_buffer_span_t span;
+    audio_buffer_reserve(buf, samples, &span);
+    buffer_copy_in(buf, &span, data);
+    audio_buffer_commit(buf, samples);
+}
+
+// Samples between read and the committed write position. Read is loaded
+// first: it never passes write, but both may move between the loads.
+static size_t buffer_buffered(audio_buffer_t* buf, uint64_t read) {
+    uint64_t write = atomic_load_explicit(&buf->write, memory_order_acquire);
+    uint64_t size = write - read;
+    return size < buf->capacity ? (size_t)size : buf->capacity;
+}
+
+size_t audio_buffer_available(audio_buffer_t* buf) {
+    return buffer_buffered(buf, atomic_load_explicit(&buf->read, memory_order_acquire));
+}
+
+// Take samples read at position read off the head of the ring. Fails if
+// the producer dropped them meanwhile, and then read holds the new head.
+static int buffer_release(audio_buffer_t* buf, uint64_t* read, size_t samples) {
+    return atomic_compare_exchange_strong_explicit(&buf->read, read, *read + samples, memory_order_acq_rel,
+                                                   memory_order_acquire);
+}
+
+size_t audio_buffer_read(audio_buffer_t* buf, void* out, size_t samples) {
+    uint64_t read = atomic_load_explicit(&buf->read, memory_order_acquire);
+    do {
+        if (buffer_buffered(buf, read) < samples) return 0;
+
+        audio_buffer_span_t span;
+        buffer_span_at(buf, read, samples, &span);
+        memcpy(out, span.ptr[0], span.len[0] * buf->sample_size);
+        memcpy((unsigned char*)out + span.len[0] * buf->sample_size, span.ptr[1], span.len[1] * buf->sample_size);
+    } while (!buffer_release(buf, &read, samples));
+    return samples;
+}
+
+size_t audio_buffer_peek(audio_buffer_t* buf, size_t samples, audio_buffer_span_t* span, uint64_t* pos) {
+    uint64_t read = atomic_load_explicit(&buf->read, memory_order_acquire);
+    if (buffer_buffered(buf, read) < samples) return 0;
+    buffer_span_at(buf, read, samples, span);
+    *pos = read;
+    return samples;
+}
+
+int audio_buffer_consume(audio_buffer_t* buf, uint64_t pos, size_t samples) {
+    // If the producer overflowed meanwhile, the head moved past the peeked
+    // position (by any amount, whole laps included) and the samples are gone
+    uint64_t read = pos;
+    return buffer_release(buf, &read, samples) ? 0 : -1;
+}
+
+// Deinterleave frames starting at ring index pos into out. The sample
+// sizes in use get their own loops so each copy is a plain load and store.
+#define BUFFER_DEINTERLEAVE(type)                                              \
+    do {                                                                       \
+        const type* src = (const type*)buf->data;                              \
+        for (size_t i = 0; i < frames; i++) {                                  \
+            for (int ch = 0; ch < channels; ch++) {                            \
+                ((type*)out[ch])[i] = src[pos];                                \
+                if (++pos == buf->capacity) pos = 0;                           \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+size_t audio_buffer_read_planar(audio_buffer_t* buf, void* const* out, int channels, size_t frames) {
+    size_t samples = frames * channels;
+    uint64_t read = atomic_load_explicit(&buf->read, memory_order_acquire);
+    do {
+        if (buffer_buffered(buf, read) < samples) return 0;
+
+        size_t pos = (size_t)(read % buf->capacity);
+        if (buf->sample_size == sizeof(int16_t)) {
+            BUFFER_DEINTERLEAVE(int16_t);
+        } else if (buf->sample_size == sizeof(uint32_t)) {
+            BUFFER_DEINTERLEAVE(uint32_t);
+        } else {
+            for (size_t i = 0; i < frames; i++) {
+                for (int ch = 0; ch < channels; ch++) {
+                    memcpy((unsigned char*)out[ch] + i * buf->sample_size, buf->data + pos * buf->sample_size,
+                           buf->sample_size);
+                    if (++pos == buf->capacity) pos = 0;
+                }
+            }
+        }
+    } while (!buffer_release(buf, &read, samples));
+    return frames;
+}
+
+// Interleave frames, starting at frame first of each input, into the ring
+// starting at index pos
+#define BUFFER_INTERLEAVE(type)                                                \
+    do {                                                                       \
+        type* dst = (type*)buf->data;                                          \
+        for (size_t i = first; i < frames; i++) {                              \
+            for (int ch = 0; ch < channels; ch++) {                            \
+                dst[pos] = ((const type*)in[ch])[i];                           \
+                if (++pos == buf->capacity) pos = 0;                           \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+void audio_buffer_write_planar(audio_buffer_t* buf, const void* const* in, int channels, size_t frames) {
+    // Only whole frames of the newest audio can fit
+    size_t max_frames = buf->capacity / channels;
+    size_t first = frames > max_frames ? frames - max_frames : 0;
+    size_t samples = (frames - first) * channels;
+
+    audio_buffer_span_t span;
+    audio_buffer_reserve(buf, samples, &span);
+    size_t pos = (size_t)((unsigned char*)span.ptr[0] - buf->data) / buf->sample_size;
+    if (buf->sample_size == sizeof(int16_t)) {
+        BUFFER_INTERLEAVE(int16_t);
+    } else if (buf->sample_size == sizeof(uint32_t)) {
+        BUFFER_INTERLEAVE(uint32_t);
+    } else {
+        for (size_t i = first; i < frames; i++) {
+            for (int ch = 0; ch < channels; ch++) {
+                memcpy(buf->data + pos * buf->sample_size, (const unsigned char*)in[ch] + i * buf->sample_size,
+                       buf->sample_size);
+                if (++pos == buf->capacity) pos = 0;
+            }
+        }
+    }
+    audio_buffer_commit(buf, samples);
+}
+
+void audio_buffer_span_from_le(const audio_buffer_span_t* span, size_t samples) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (int part = 0; part < 2 && samples > 0; part++) {
+        int16_t* data = (int16_t*)span->ptr[part];
+        size_t count = span->len[part] < samples ? span->len[part] : samples;
+        for (size_t i = 0; i < count; i++) {
+            data[i] = (int16_t)__builtin_bswap16((uint16_t)data[i]);
+        }
+        samples -= count;
+    }
+#else
+    (void)span;
+    (void)samples;
+#endif
+}
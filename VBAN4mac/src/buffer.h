@@ -0,0 +1,141 @@
+#ifndef VBAN4MAC_BUFFER_H
+#define VBAN4MAC_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Ring buffer of interleaved samples of a size fixed at creation: wire
+// int16 for the stream API, vban_sample_t for the bridge's device-side
+// buffers. Positions and lengths are counted in samples.
+//
+// Lock-free for one producer and one consumer, so real-time callbacks can
+// use either end. Positions only ever grow, and index the storage modulo
+// the capacity. When the ring is full the producer drops the oldest
+// samples by moving the read position past them; a consumer that was
+// copying them sees its compare-and-swap fail and reads again from the new
+// position.
+typedef struct {
+    unsigned char* data;
+    size_t sample_size;         // Bytes per sample
+    size_t capacity;            // Total samples the ring can hold
+    _Atomic uint64_t read;      // Samples consumed or dropped so far
+    _Atomic uint64_t write;     // Samples committed so far
+} audio_buffer_t;
+
+// Region of samples, split in two when it wraps around the end of a ring.
+// Also used for int16 payloads handed to the send and publish paths.
+typedef struct {
+    void* ptr[2];
+    size_t len[2];      // Samples in each part
+} audio_buffer_span_t;
+
+/**
+ * Allocate ring storage
+ * @param buf Buffer to initialize
+ * @param capacity Number of samples the ring can hold
+ * @param sample_size Bytes per sample, e.g. sizeof(vban_sample_t)
+ * @return 0 on success, -1 on error
+ */
+int audio_buffer_create(audio_buffer_t* buf, size_t capacity, size_t sample_size);
+
+/**
+ * Free ring storage
+ * @param buf Buffer to destroy
+ */
+void audio_buffer_destroy(audio_buffer_t* buf);
+
+/**
+ * Reserve free space at the tail of the ring for the single producer to
+ * write into directly. The oldest samples are dropped if there is not
+ * enough room. Nothing becomes visible to the consumer until committed.
+ * @param buf The buffer
+ * @param samples Number of samples to reserve (at most the capacity)
+ * @param span Filled with the reserved region
+ * @return Number of samples reserved
+ */
+size_t audio_buffer_reserve(audio_buffer_t* buf, size_t samples, audio_buffer_span_t* span);
+
+/**
+ * Publish samples written into a previously reserved region
+ * @param buf The buffer
+ * @param samples Number of samples to publish (at most the amount reserved)
+ */
+void audio_buffer_commit(audio_buffer_t* buf, size_t samples);
+
+/**
+ * Copy samples into the ring, dropping the oldest samples if it is full
+ * @param buf The buffer
+ * @param data Samples to add
+ * @param samples Number of samples
+ */
+void audio_buffer_write(audio_buffer_t* buf, const void* data, size_t samples);
+
+/**
+ * Number of samples currently buffered
+ * @param buf The buffer
+ * @return Buffered samples
+ */
+size_t audio_buffer_available(audio_buffer_t* buf);
+
+/**
+ * Remove samples from the head of the ring (single consumer)
+ * @param buf The buffer
+ * @param out Destination for the samples
+ * @param samples Number of samples to read
+ * @return samples on success, 0 if fewer than that are buffered
+ */
+size_t audio_buffer_read(audio_buffer_t* buf, void* out, size_t samples);
+
+/**
+ * Locate the oldest samples without removing them, so the single consumer
+ * can hand them on (e.g. to sendmsg) without copying. The region stays
+ * valid until consumed unless the producer overflows the ring: it may then
+ * overwrite the samples while they are being used, which
+ * audio_buffer_consume reports afterwards.
+ * @param buf The buffer
+ * @param samples Number of samples wanted
+ * @param span Filled with the region
+ * @param pos Filled with the ring position the region starts at
+ * @return samples on success, 0 if fewer than that are buffered
+ */
+size_t audio_buffer_peek(audio_buffer_t* buf, size_t samples, audio_buffer_span_t* span, uint64_t* pos);
+
+/**
+ * Remove samples located with audio_buffer_peek
+ * @param buf The buffer
+ * @param pos Position audio_buffer_peek gave for the region
+ * @param samples Number of samples to remove (at most the amount peeked)
+ * @return 0 on success, -1 if the producer dropped them since the peek (what
+ *         was read from the region may have been overwritten partway)
+ */
+int audio_buffer_consume(audio_buffer_t* buf, uint64_t pos, size_t samples);
+
+/**
+ * Remove interleaved frames from the head of the ring and deinterleave them
+ * @param buf The buffer
+ * @param out One destination array per channel, of the ring's sample type
+ * @param channels Number of channels per frame
+ * @param frames Number of frames to read
+ * @return frames on success, 0 if fewer than that are buffered
+ */
+size_t audio_buffer_read_planar(audio_buffer_t* buf, void* const* out, int channels, size_t frames);
+
+/**
+ * Interleave frames into the ring, dropping the oldest samples if it is full
+ * @param buf The buffer
+ * @param in One source array per channel, of the ring's sample type
+ * @param channels Number of channels per frame
+ * @param frames Number of frames to add
+ */
+void audio_buffer_write_planar(audio_buffer_t* buf, const void* const* in, int channels, size_t frames);
+
+/**
+ * Convert little-endian wire samples to host order in place
+ * (a no-op on little-endian hosts)
+ * @param span Region holding int16 samples
+ * @param samples Number of samples to convert
+ */
+void audio_buffer_span_from_le(const audio_buffer_span_t* span, size_t samples);
+
+#endif /* VBAN4MAC_BUFFER_H */
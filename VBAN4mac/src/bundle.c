@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/vban4mac/bundle.h"
+#include "buffer.h"
+
+#define BUNDLE_DEFAULT_MAX_SKEW 1024
+#define BUNDLE_CHUNK_FRAMES 1024        // Frames interleaved, or taken from one push, at a time
+#define BUNDLE_DEFAULT_OUTPUT_FRAMES 4096
+
+// One capture source, a mono ring indexed by frames written and read
+typedef struct {
+    int16_t* data;
+    uint64_t head;                  // Frames taken into the bundle
+    uint64_t tail;                  // Frames pushed (and padded)
+    int padded;                     // Fell behind and was padded, realigned on its next push
+} bundle_source_t;
+
+struct vban_bundler_t {
+    pthread_mutex_t mutex;          // Serializes pushes from the sources' threads
+    vban_sender_t* sender;
+    int num_sources;
+    size_t capacity;                // Frames per source ring
+    size_t max_skew;
+    bundle_source_t* sources;
+    int16_t* interleaved;           // BUNDLE_CHUNK_FRAMES bundled frames
+    vban_bundler_stats_t stats;
+};
+
+struct vban_unbundler_t {
+    vban_receiver_t* receiver;
+    int num_outputs;
+    audio_buffer_t* outputs;        // One mono ring per channel
+    int16_t* interleaved;           // BUNDLE_CHUNK_FRAMES received frames
+    int16_t* planar;                // The same, one BUNDLE_CHUNK_FRAMES run per channel
+};
+
+vban_bundler_t* vban_bundler_create(const vban_bundler_config_t* config) {
+    int num_sources = config->sender.channels;
+    if (num_sources < 1 || num_sources > VBAN_BUNDLE_MAX_SOURCES) {
+        fprintf(stderr, "Invalid number of bundle sources: %d\n", num_sources);
+        return NULL;
+    }
+
+    vban_bundler_t* bundler = calloc(1, sizeof(vban_bundler_t));
+    if (!bundler) return NULL;
+    pthread_mutex_init(&bundler->mutex, NULL);
+    bundler->num_sources = num_sources;
+    bundler->max_skew = config->max_skew_frames ? config->max_skew_frames : BUNDLE_DEFAULT_MAX_SKEW;
+
+    // Before a push no source holds more than max_skew frames, and pushes
+    // are taken a chunk at a time, so the rings never overflow
+    bundler->capacity = bundler->max_skew + BUNDLE_CHUNK_FRAMES;
+    bundler->sources = calloc(num_sources, sizeof(bundle_source_t));
+    bundler->interleaved = malloc((size_t)BUNDLE_CHUNK_FRAMES * num_sources * sizeof(int16_t));
+    if (!bundler->sources || !bundler->interleaved) {
+        vban_bundler_destroy(bundler);
+        return NULL;
+    }
+    for (int s = 0; s < num_sources; s++) {
+        bundler->sources[s].data = malloc(bundler->capacity * sizeof(int16_t));
+        if (!bundler->sources[s].data) {
+            vban_bundler_destroy(bundler);
+            return NULL;
+        }
+    }
+
+    bundler->sender = vban_sender_create(&config->sender);
+    if (!bundler->sender) {
+        vban_bundler_destroy(bundler);
+        return NULL;
+    }
+    return bundler;
+}
+
+static void bundle_source_write(vban_bundler_t* bundler, bundle_source_t* source, const int16_t* frames,
+                                size_t num_frames) {
+    size_t pos = (size_t)(source->tail % bundler->capacity);
+    size_t first = bundler->capacity - pos;
+    if (first > num_frames) first = num_frames;
+    if (frames) {
+        memcpy(source->data + pos, frames, first * sizeof(int16_t));
+        memcpy(source->data, frames + first, (num_frames - first) * sizeof(int16_t));
+    } else {
+        memset(source->data + pos, 0, first * sizeof(int16_t));
+        memset(source->data, 0, (num_frames - first) * sizeof(int16_t));
+    }
+    source->tail += num_frames;
+}
+
+// A padded source that delivers again is padded so the block it delivers
+// ends at the leading source's newest frame: both were just captured. It
+// is then back in phase with the others instead of max_skew frames late.
+static void bundle_realign(vban_bundler_t* bundler, bundle_source_t* source, size_t num_frames) {
+    uint64_t lead = 0;
+    for (int s = 0; s < bundler->num_sources; s++) {
+        uint64_t available = bundler->sources[s].tail - bundler->sources[s].head;
+        if (available > lead) lead = available;
+    }
+    uint64_t resumed = source->tail - source->head + num_frames;
+    if (lead > resumed) {
+        bundle_source_write(bundler, source, NULL, (size_t)(lead - resumed));
+        bundler->stats.frames_padded += lead - resumed;
+        bundler->stats.realignments++;
+    }
+    source->padded = 0;
+}
+
+// Pad sources lagging too far behind the leader, then send every frame all
+// sources have delivered
+// @return Packets sent, negative on error
+static int bundle_flush(vban_bundler_t* bundler) {
+    uint64_t lead = 0, ready = UINT64_MAX;
+    for (int s = 0; s < bundler->num_sources; s++) {
+        bundle_source_t* source = &bundler->sources[s];
+        uint64_t available = source->tail - source->head;
+        if (available > lead) lead = available;
+        if (available < ready) ready = available;
+    }
+
+    if (lead - ready > bundler->max_skew) {
+        ready = lead - bundler->max_skew;
+        for (int s = 0; s < bundler->num_sources; s++) {
+            bundle_source_t* source = &bundler->sources[s];
+            uint64_t available = source->tail - source->head;
+            if (available >= ready) continue;
+            bundle_source_write(bundler, source, NULL, (size_t)(ready - available));
+            bundler->stats.frames_padded += ready - available;
+            source->padded = 1;
+        }
+    }
+
+    int packets = 0;
+    while (ready > 0) {
+        size_t frames = ready < BUNDLE_CHUNK_FRAMES ? (size_t)ready : BUNDLE_CHUNK_FRAMES;
+        int channels = bundler->num_sources;
+        for (int s = 0; s < channels; s++) {
+            bundle_source_t* source = &bundler->sources[s];
+            int16_t* out = bundler->interleaved + s;
+            size_t pos = (size_t)(source->head % bundler->capacity);
+            for (size_t i = 0; i < frames; i++) {
+                out[i * channels] = source->data[pos];
+                if (++pos == bundler->capacity) pos = 0;
+            }
+            source->head += frames;
+        }
+
+        // The sender sends whole packets and keeps the rest for the next chunk
+        int sent = vban_sender_push(bundler->sender, bundler->interleaved, frames);
+        if (sent < 0) return sent;
+        packets += sent;
+        bundler->stats.frames_sent += frames;
+        bundler->stats.packets_sent += sent;
+        ready -= frames;
+    }
+    return packets;
+}
+
+int vban_bundler_push(vban_bundler_t* bundler, int source, const int16_t* frames, size_t num_frames) {
+    if (!bundler || source < 0 || source >= bundler->num_sources || (!frames && num_frames > 0)) return -1;
+
+    pthread_mutex_lock(&bundler->mutex);
+    bundle_source_t* src = &bundler->sources[source];
+    if (src->padded && num_frames > 0) bundle_realign(bundler, src, num_frames);
+    int packets = 0;
+    while (num_frames > 0) {
+        size_t chunk = num_frames < BUNDLE_CHUNK_FRAMES ? num_frames : BUNDLE_CHUNK_FRAMES;
+        bundle_source_write(bundler, src, frames, chunk);
+        int sent = bundle_flush(bundler);
+        if (sent < 0) {
+            packets = sent;
+            break;
+        }
+        packets += sent;
+        frames += chunk;
+        num_frames -= chunk;
+    }
+    pthread_mutex_unlock(&bundler->mutex);
+    return packets;
+}
+
+void vban_bundler_get_stats(vban_bundler_t* bundler, vban_bundler_stats_t* stats) {
+    pthread_mutex_lock(&bundler->mutex);
+    *stats = bundler->stats;
+    pthread_mutex_unlock(&bundler->mutex);
+}
+
+void vban_bundler_destroy(vban_bundler_t* bundler) {
+    if (!bundler) return;
+    vban_sender_destroy(bundler->sender);
+    pthread_mutex_destroy(&bundler->mutex);
+    if (bundler->sources) {
+        for (int s = 0; s < bundler->num_sources; s++) free(bundler->sources[s].data);
+        free(bundler->sources);
+    }
+    free(bundler->interleaved);
+    free(bundler);
+}
+
+vban_unbundler_t* vban_unbundler_create(const vban_receiver_config_t* config) {
+    if (config->channels < 1 || config->channels > VBAN_BUNDLE_MAX_SOURCES) {
+        fprintf(stderr, "Invalid number of bundle outputs: %d\n", config->channels);
+        return NULL;
+    }
+
+    vban_unbundler_t* unbundler = calloc(1, sizeof(vban_unbundler_t));
+    if (!unbundler) return NULL;
+    int num_outputs = config->channels;
+    size_t frames = config->buffer_frames ? config->buffer_frames : BUNDLE_DEFAULT_OUTPUT_FRAMES;
+
+    unbundler->outputs = calloc(num_outputs, sizeof(audio_buffer_t));
+    unbundler->interleaved = malloc((size_t)BUNDLE_CHUNK_FRAMES * num_outputs * sizeof(int16_t));
+    unbundler->planar = malloc((size_t)BUNDLE_CHUNK_FRAMES * num_outputs * sizeof(int16_t));
+    if (!unbundler->outputs || !unbundler->interleaved || !unbundler->planar) {
+        vban_unbundler_destroy(unbundler);
+        return NULL;
+    }
+    for (int o = 0; o < num_outputs; o++) {
+        if (audio_buffer_create(&unbundler->outputs[o], frames, sizeof(int16_t)) != 0) {
+            vban_unbundler_destroy(unbundler);
+            return NULL;
+        }
+        unbundler->num_outputs = o + 1;
+    }
+
+    unbundler->receiver = vban_receiver_create(config);
+    if (!unbundler->receiver) {
+        vban_unbundler_destroy(unbundler);
+        return NULL;
+    }
+    return unbundler;
+}
+
+int vban_unbundler_fd(const vban_unbundler_t* unbundler) {
+    return vban_receiver_fd(unbundler->receiver);
+}
+
+int vban_unbundler_process(vban_unbundler_t* unbundler, int timeout_ms) {
+    int accepted = vban_receiver_process(unbundler->receiver, timeout_ms);
+    int channels = unbundler->num_outputs;
+
+    size_t available;
+    while ((available = vban_receiver_available(unbundler->receiver)) > 0) {
+        size_t frames = available < BUNDLE_CHUNK_FRAMES ? available : BUNDLE_CHUNK_FRAMES;
+        frames = vban_receiver_pull(unbundler->receiver, unbundler->interleaved, frames);
+        if (frames == 0) break;
+
+        for (int o = 0; o < channels; o++) {
+            int16_t* out = unbundler->planar + (size_t)o * BUNDLE_CHUNK_FRAMES;
+            const int16_t* in = unbundler->interleaved + o;
+            for (size_t i = 0; i < frames; i++) out[i] = in[i * channels];
+            audio_buffer_write(&unbundler->outputs[o], out, frames);
+        }
+    }
+    return accepted;
+}
+
+size_t vban_unbundler_available(vban_unbundler_t* unbundler, int output) {
+    if (output < 0 || output >= unbundler->num_outputs) return 0;
+    return audio_buffer_available(&unbundler->outputs[output]);
+}
+
+size_t vban_unbundler_pull(vban_unbundler_t* unbundler, int output, int16_t* out, size_t num_frames) {
+    size_t frames = 0;
+    if (output >= 0 && output < unbundler->num_outputs) {
+        audio_buffer_t* ring = &unbundler->outputs[output];
+        frames = audio_buffer_available(ring);
+        if (frames > num_frames) frames = num_frames;
+        if (frames > 0 && audio_buffer_read(ring, out, frames) != frames) frames = 0;
+    }
+
+    // Fill what the network didn't deliver with silence
+    memset(out + frames, 0, (num_frames - frames) * sizeof(int16_t));
+    return frames;
+}
+
+vban_receiver_t* vban_unbundler_receiver(vban_unbundler_t* unbundler) {
+    return unbundler->receiver;
+}
+
+void vban_unbundler_destroy(vban_unbundler_t* unbundler) {
+    if (!unbundler) return;
+    vban_receiver_destroy(unbundler->receiver);
+    if (unbundler->outputs) {
+        for (int o = 0; o < unbundler->num_outputs; o++) audio_buffer_destroy(&unbundler->outputs[o]);
+        free(unbundler->outputs);
+    }
+    free(unbundler->interleaved);
+    free(unbundler->planar);
+    free(unbundler);
+}
@@ -0,0 +1,87 @@
+#include <time.h>
+#include "callback_stats.h"
+
+#define CALLBACK_BUCKETS_PER_PERIOD 8
+
+int64_t callback_stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void callback_stats_init(callback_stats_t* stats) {
+    stats->last_start_ns = 0;
+    stats->last_period_ns = 0;
+    atomic_init(&stats->callbacks, 0);
+    atomic_init(&stats->total_ns, 0);
+    atomic_init(&stats->max_ns, 0);
+    atomic_init(&stats->max_jitter_ns, 0);
+    atomic_init(&stats->deadline_misses, 0);
+    atomic_init(&stats->late_callbacks, 0);
+    atomic_init(&stats->early_callbacks, 0);
+    atomic_init(&stats->period_ns, 0);
+    for (int i = 0; i < VBAN_CALLBACK_HISTOGRAM_BUCKETS; i++) atomic_init(&stats->histogram[i], 0);
+}
+
+// The callback thread is the only writer, so a plain load and store will do
+static void callback_stats_add(_Atomic uint64_t* counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+static void callback_stats_max(_Atomic uint64_t* counter, uint64_t value) {
+    if (value > atomic_load_explicit(counter, memory_order_relaxed)) {
+        atomic_store_explicit(counter, value, memory_order_relaxed);
+    }
+}
+
+void callback_stats_record(callback_stats_t* stats, int64_t start_ns, int64_t end_ns, int64_t period_ns) {
+    uint64_t duration = (uint64_t)(end_ns - start_ns);
+
+    if (stats->last_start_ns != 0) {
+        // Due one period (the previous callback's) after the previous start
+        int64_t interval = start_ns - stats->last_start_ns;
+        int64_t deviation = interval - stats->last_period_ns;
+        callback_stats_max(&stats->max_jitter_ns, (uint64_t)(deviation < 0 ? -deviation : deviation));
+        if (deviation > stats->last_period_ns / 2) {
+            callback_stats_add(&stats->late_callbacks, 1);
+        } else if (interval < stats->last_period_ns / 2) {
+            callback_stats_add(&stats->early_callbacks, 1);
+        }
+    }
+    stats->last_start_ns = start_ns;
+    stats->last_period_ns = period_ns;
+
+    if (period_ns > 0) {
+        uint64_t bucket = duration * CALLBACK_BUCKETS_PER_PERIOD / (uint64_t)period_ns;
+        if (bucket >= VBAN_CALLBACK_HISTOGRAM_BUCKETS) bucket = VBAN_CALLBACK_HISTOGRAM_BUCKETS - 1;
+        callback_stats_add(&stats->histogram[bucket], 1);
+        if (duration > (uint64_t)period_ns) callback_stats_add(&stats->deadline_misses, 1);
+        atomic_store_explicit(&stats->period_ns, period_ns, memory_order_relaxed);
+    }
+
+    callback_stats_max(&stats->max_ns, duration);
+    callback_stats_add(&stats->total_ns, duration);
+    callback_stats_add(&stats->callbacks, 1);
+}
+
+void callback_stats_read(const callback_stats_t* stats, vban_audio_stats_t* out) {
+    uint64_t callbacks = atomic_load_explicit(&stats->callbacks, memory_order_relaxed);
+    uint64_t total = atomic_load_explicit(&stats->total_ns, memory_order_relaxed);
+
+    out->callbacks = callbacks;
+    out->mean_callback_us = callbacks ? total / 1e3 / callbacks : 0.0;
+    out->max_callback_us = atomic_load_explicit(&stats->max_ns, memory_order_relaxed) / 1e3;
+    out->max_period_jitter_us = atomic_load_explicit(&stats->max_jitter_ns, memory_order_relaxed) / 1e3;
+}
+
+void callback_stats_read_deadlines(const callback_stats_t* stats, vban_callback_deadline_stats_t* out) {
+    out->callbacks = atomic_load_explicit(&stats->callbacks, memory_order_relaxed);
+    out->deadline_misses = atomic_load_explicit(&stats->deadline_misses, memory_order_relaxed);
+    out->late_callbacks = atomic_load_explicit(&stats->late_callbacks, memory_order_relaxed);
+    out->early_callbacks = atomic_load_explicit(&stats->early_callbacks, memory_order_relaxed);
+    out->period_us = atomic_load_explicit(&stats->period_ns, memory_order_relaxed) / 1e3;
+    for (int i = 0; i < VBAN_CALLBACK_HISTOGRAM_BUCKETS; i++) {
+        out->histogram[i] = atomic_load_explicit(&stats->histogram[i], memory_order_relaxed);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef VBAN4MAC_CALLBACK_STATS_H
+#define VBAN4MAC_CALLBACK_STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "../include/vban4mac/types.h"
+
+// Timing of an audio backend's device callback: how long each call takes
+// against its period, how far the spacing between calls strays from the
+// period, and how long the call waited for buffer locks. Written by the
+// callback thread only with relaxed atomics, so recording never blocks and
+// any thread can read the figures.
+typedef struct {
+    int64_t last_start_ns;          // Callback thread only
+    int64_t last_period_ns;         // Callback thread only
+    _Atomic uint64_t callbacks;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t max_jitter_ns;
+    _Atomic uint64_t deadline_misses;
+    _Atomic uint64_t late_callbacks;
+    _Atomic uint64_t early_callbacks;
+    _Atomic int64_t period_ns;
+    _Atomic uint64_t histogram[VBAN_CALLBACK_HISTOGRAM_BUCKETS];
+} callback_stats_t;
+
+/**
+ * Monotonic clock used for callback timing
+ * @return Nanoseconds
+ */
+int64_t callback_stats_now_ns(void);
+
+/**
+ * Reset the statistics
+ */
+void callback_stats_init(callback_stats_t* stats);
+
+/**
+ * Account for one callback. Callback thread only, allocation and lock free.
+ * @param stats The statistics
+ * @param start_ns When the callback was entered
+ * @param end_ns When it returned
+ * @param period_ns The callback's deadline, the time its frames last
+ */
+void callback_stats_record(callback_stats_t* stats, int64_t start_ns, int64_t end_ns, int64_t period_ns);
+
+/**
+ * Copy the callback figures into the callbacks, mean/max_callback_us and
+ * max_period_jitter_us fields of an audio statistics structure
+ */
+void callback_stats_read(const callback_stats_t* stats, vban_audio_stats_t* out);
+
+/**
+ * Copy the deadline figures and duration histogram; safe from any thread
+ */
+void callback_stats_read_deadlines(const callback_stats_t* stats, vban_callback_deadline_stats_t* out);
+
+#endif /* VBAN4MAC_CALLBACK_STATS_H */
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "vban4mac/config.h"
@@ -28,8 +29,19 @@ int load_config(const char* filename, vban_config_t* config) {
     strncpy(config->remote_ip, "127.0.0.1", sizeof(config->remote_ip) - 1);
     strncpy(config->stream_name, "Stream1", sizeof(config->stream_name) - 1);
     config->port = VBAN_DEFAULT_PORT;
+    config->bind_ip[0] = '\0';
+    config->rx_workers = 1;
+    config->event_threads = 1;
+    config->shm_name[0] = '\0';
+    config->silence_threshold_db = 0;
+    config->silence_hangover_ms = 0;
+    config->keepalive_ms = 0;
     config->input_device[0] = '\0';
     config->output_device[0] = '\0';
+    config->catchup_max_pct = 0;
+    config->catchup_window_ms = 0;
+    config->input_channels = 0;
+    config->output_channels = 0;
 
     char line[256];
     char section[64] = "";
@@ -71,12 +83,34 @@ int load_config(const char* filename, vban_config_t* config) {
                 strncpy(config->stream_name, value, sizeof(config->stream_name) - 1);
             else if (strcmp(key, "port") == 0)
                 config->port = (uint16_t)atoi(value);
+            else if (strcmp(key, "bind_ip") == 0)
+                strncpy(config->bind_ip, value, sizeof(config->bind_ip) - 1);
+            else if (strcmp(key, "rx_workers") == 0)
+                config->rx_workers = atoi(value);
+            else if (strcmp(key, "event_threads") == 0)
+                config->event_threads = atoi(value);
+            else if (strcmp(key, "shm_name") == 0)
+                strncpy(config->shm_name, value, sizeof(config->shm_name) - 1);
+            else if (strcmp(key, "silence_threshold_db") == 0)
+                config->silence_threshold_db = atoi(value);
+            else if (strcmp(key, "silence_hangover_ms") == 0)
+                config->silence_hangover_ms = atoi(value);
+            else if (strcmp(key, "keepalive_ms") == 0)
+                config->keepalive_ms = atoi(value);
         }
         else if (strcmp(section, "audio") == 0) {
             if (strcmp(key, "input_device") == 0)
                 strncpy(config->input_device, value, sizeof(config->input_device) - 1);
             else if (strcmp(key, "output_device") == 0)
                 strncpy(config->output_device, value, sizeof(config->output_device) - 1);
+            else if (strcmp(key, "catchup_max_pct") == 0)
+                config->catchup_max_pct = atoi(value);
+            else if (strcmp(key, "catchup_window_ms") == 0)
+                config->catchup_window_ms = atoi(value);
+            else if (strcmp(key, "input_channels") == 0)
+                config->input_channels = atoi(value);
+            else if (strcmp(key, "output_channels") == 0)
+                config->output_channels = atoi(value);
         }
     }
 
@@ -84,6 +118,7 @@ int load_config(const char* filename, vban_config_t* config) {
     return 0;
 }
 
+#ifndef VBAN_JACK
 AudioDeviceID find_device_by_name(const char* device_name, int is_input) {
     AudioObjectPropertyAddress property = {
         kAudioHardwarePropertyDevices,
@@ -137,4 +172,5 @@ AudioDeviceID find_device_by_name(const char* device_name, int is_input) {
 
     free(devices);
     return result;
-} 
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,53 @@
+#include <string.h>
+#include "dedup.h"
+
+#define DEDUP_TAG(index) (((uint64_t)1 << 32) | (index))
+
+void dedup_init(dedup_t* dedup) {
+    memset(dedup, 0, sizeof(*dedup));
+}
+
+// Forget everything and continue from index
+static void dedup_restart(dedup_t* dedup, uint32_t index) {
+    memset(dedup->slots, 0, sizeof(dedup->slots));
+    dedup->started = 1;
+    dedup->newest = index;
+    dedup->stale_run = 0;
+}
+
+int dedup_accept(dedup_t* dedup, uint32_t index, int path) {
+    int32_t step = (int32_t)(index - dedup->newest);
+    uint64_t* slot = &dedup->slots[index % DEDUP_WINDOW];
+
+    if (!dedup->started) {
+        dedup_restart(dedup, index);
+    } else if (step > 0) {
+        // Ahead of both paths so far; slots of skipped packets still hold
+        // older indexes, which never match
+        dedup->newest = index;
+    } else if (step <= -DEDUP_WINDOW) {
+        // Too old to tell whether it was taken. A run of these is a
+        // restarted sender rather than a path lagging behind.
+        if (++dedup->stale_run < DEDUP_RESYNC_PACKETS) {
+            atomic_fetch_add_explicit(&dedup->late, 1, memory_order_relaxed);
+            return 0;
+        }
+        dedup_restart(dedup, index);
+    } else if (*slot == DEDUP_TAG(index)) {
+        atomic_fetch_add_explicit(&dedup->duplicates, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    *slot = DEDUP_TAG(index);
+    dedup->stale_run = 0;
+    atomic_fetch_add_explicit(&dedup->taken[path], 1, memory_order_relaxed);
+    return 1;
+}
+
+void dedup_get_stats(const dedup_t* dedup, vban_redundancy_stats_t* stats) {
+    dedup_t* d = (dedup_t*)dedup;
+    stats->packets[0] = atomic_load_explicit(&d->taken[0], memory_order_relaxed);
+    stats->packets[1] = atomic_load_explicit(&d->taken[1], memory_order_relaxed);
+    stats->duplicates = atomic_load_explicit(&d->duplicates, memory_order_relaxed);
+    stats->late = atomic_load_explicit(&d->late, memory_order_relaxed);
+}
@@ -0,0 +1,47 @@
+#ifndef VBAN4MAC_DEDUP_H
+#define VBAN4MAC_DEDUP_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "../include/vban4mac/types.h"
+
+// Merge of a stream received twice, over two network paths. The first copy
+// of each nuFrame is taken, whichever path it came on, and the second is
+// dropped. Every packet within DEDUP_WINDOW of the newest one is
+// remembered in a slot indexed by nuFrame, so either path can run ahead,
+// lose packets or reorder them and each check is one slot lookup.
+
+#define DEDUP_WINDOW 256            // Packets remembered, about 1.4 s of 256-frame packets at 48 kHz
+#define DEDUP_RESYNC_PACKETS 8      // Consecutive packets older than the window that mean the sender restarted
+
+typedef struct {
+    uint64_t slots[DEDUP_WINDOW];   // (1 << 32) | nuFrame taken in each slot, 0 for none
+    uint32_t newest;
+    int started;
+    uint32_t stale_run;             // Consecutive packets older than the window
+
+    atomic_uint_fast64_t taken[2];
+    atomic_uint_fast64_t duplicates;
+    atomic_uint_fast64_t late;
+} dedup_t;
+
+/**
+ * Set up an empty window
+ */
+void dedup_init(dedup_t* dedup);
+
+/**
+ * Decide whether a received packet is the first copy of its nuFrame
+ * @param dedup The window
+ * @param index The packet's nuFrame
+ * @param path Path it arrived on, 0 or 1
+ * @return 1 to take the packet, 0 to drop it
+ */
+int dedup_accept(dedup_t* dedup, uint32_t index, int path);
+
+/**
+ * Copies taken and dropped so far; safe from any thread
+ */
+void dedup_get_stats(const dedup_t* dedup, vban_redundancy_stats_t* stats);
+
+#endif /* VBAN4MAC_DEDUP_H */
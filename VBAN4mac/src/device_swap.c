@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "device_swap.h"
+
+#define DEVICE_SWAP_MAX_CHANNELS 8
+
+int device_swap_init(device_swap_t* sw, int channels, int sample_rate, int fade_ms, size_t max_frames) {
+    memset(sw, 0, sizeof(*sw));
+    if (channels < 1 || channels > DEVICE_SWAP_MAX_CHANNELS || fade_ms < 1 || max_frames < 1) return -1;
+
+    sw->channels = channels;
+    sw->fade_frames = (size_t)sample_rate * fade_ms / 1000;
+    sw->max_frames = max_frames;
+    atomic_init(&sw->state, DEVICE_SWAP_IDLE);
+    atomic_init(&sw->active, 0);
+    atomic_init(&sw->swaps, 0);
+
+    // The tee only fills during the fade and the callbacks either side of it
+    sw->scratch = malloc(2 * max_frames * channels * sizeof(vban_sample_t));
+    if (!sw->scratch || audio_buffer_create(&sw->tee, (sw->fade_frames + 4 * max_frames) * channels, sizeof(vban_sample_t)) != 0) {
+        free(sw->scratch);
+        sw->scratch = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void device_swap_destroy(device_swap_t* sw) {
+    if (!sw->scratch) return;
+    audio_buffer_destroy(&sw->tee);
+    free(sw->scratch);
+    sw->scratch = NULL;
+}
+
+int device_swap_active(const device_swap_t* sw) {
+    return atomic_load_explicit(&sw->active, memory_order_acquire);
+}
+
+int device_swap_busy(const device_swap_t* sw) {
+    return atomic_load_explicit(&sw->state, memory_order_acquire) != DEVICE_SWAP_IDLE;
+}
+
+int device_swap_begin(device_swap_t* sw) {
+    if (device_swap_busy(sw)) return -1;
+
+    // Published to the callbacks by the state change
+    sw->faded_out = 0;
+    sw->faded_in = 0;
+    sw->started = 0;
+    atomic_store_explicit(&sw->state, DEVICE_SWAP_PENDING, memory_order_release);
+    return 1 - device_swap_active(sw);
+}
+
+// Make the other slot the owner of the ring
+static void swap_hand_over(device_swap_t* sw, int slot) {
+    atomic_store_explicit(&sw->active, 1 - slot, memory_order_release);
+    atomic_store_explicit(&sw->state, DEVICE_SWAP_DRAINING, memory_order_release);
+}
+
+int device_swap_cancel(device_swap_t* sw) {
+    int expected = DEVICE_SWAP_PENDING;
+    return atomic_compare_exchange_strong_explicit(&sw->state, &expected, DEVICE_SWAP_IDLE, memory_order_acq_rel,
+                                                   memory_order_acquire) ? 0 : -1;
+}
+
+void device_swap_cut(device_swap_t* sw) {
+    int state = atomic_load_explicit(&sw->state, memory_order_acquire);
+    if (state == DEVICE_SWAP_IDLE || state == DEVICE_SWAP_DRAINING) return;
+    swap_hand_over(sw, device_swap_active(sw));
+}
+
+// Equal-power gains, so a crossfade between uncorrelated signals (the same
+// audio on two devices, or two microphones) keeps its loudness
+static inline float swap_gain_in(const device_swap_t* sw, size_t pos) {
+    if (pos >= sw->fade_frames) return 1.0f;
+    return sinf((float)M_PI_2 * (float)pos / (float)sw->fade_frames);
+}
+
+static inline float swap_gain_out(const device_swap_t* sw, size_t pos) {
+    if (pos >= sw->fade_frames) return 0.0f;
+    return cosf((float)M_PI_2 * (float)pos / (float)sw->fade_frames);
+}
+
+static inline vban_sample_t swap_store(float v) {
+#ifdef VBAN_SAMPLE_INT16
+    v = v < 32767.0f ? v : 32767.0f;
+    v = v > -32768.0f ? v : -32768.0f;
+    return (vban_sample_t)lrintf(v);
+#else
+    return v;
+#endif
+}
+
+// New device done once the tee is empty and it has faded all the way in
+static void swap_finish_drain(device_swap_t* sw) {
+    if (sw->faded_in < sw->fade_frames || audio_buffer_available(&sw->tee) > 0) return;
+    atomic_fetch_add_explicit(&sw->swaps, 1, memory_order_relaxed);
+    atomic_store_explicit(&sw->state, DEVICE_SWAP_IDLE, memory_order_release);
+}
+
+static void swap_silence(vban_sample_t* const* out, int channels, size_t from, size_t frames) {
+    if (from >= frames) return;
+    for (int c = 0; c < channels; c++) {
+        memset(out[c] + from, 0, (frames - from) * sizeof(vban_sample_t));
+    }
+}
+
+// Read up to frames from the tee into out, deinterleaving through scratch
+static size_t swap_tee_read(device_swap_t* sw, vban_sample_t* scratch, vban_sample_t* const* out, size_t frames) {
+    int ch = sw->channels;
+    size_t n = audio_buffer_available(&sw->tee) / ch;
+    if (n > frames) n = frames;
+    if (n == 0 || audio_buffer_read(&sw->tee, scratch, n * ch) == 0) return 0;
+    for (size_t i = 0; i < n; i++) {
+        for (int c = 0; c < ch; c++) out[c][i] = scratch[i * ch + c];
+    }
+    return n;
+}
+
+static void swap_fade_in(device_swap_t* sw, vban_sample_t* const* out, size_t frames) {
+    for (size_t i = 0; i < frames && sw->faded_in < sw->fade_frames; i++) {
+        float gain = swap_gain_in(sw, sw->faded_in++);
+        for (int c = 0; c < sw->channels; c++) out[c][i] = swap_store((float)out[c][i] * gain);
+    }
+}
+
+size_t device_swap_render(device_swap_t* sw, int slot, vban_sample_t* const* out, size_t frames,
+                          device_swap_render_fn render, void* user) {
+    int state = atomic_load_explicit(&sw->state, memory_order_acquire);
+    int owner = atomic_load_explicit(&sw->active, memory_order_acquire);
+    int ch = sw->channels;
+    vban_sample_t* scratch = sw->scratch + (size_t)slot * sw->max_frames * ch;
+    size_t played = 0;
+
+    if (slot == owner && state == DEVICE_SWAP_DRAINING) {
+        // New device: what the old one played last, then on from the ring
+        played = swap_tee_read(sw, scratch, out, frames);
+        if (played < frames) {
+            vban_sample_t* rest[DEVICE_SWAP_MAX_CHANNELS];
+            for (int c = 0; c < ch; c++) rest[c] = out[c] + played;
+            played += render(user, rest, frames - played);
+        }
+        swap_fade_in(sw, out, played);
+        swap_finish_drain(sw);
+    } else if (slot == owner) {
+        played = render(user, out, frames);
+        if (state == DEVICE_SWAP_FADING) {
+            // Old device: tee what it plays to the new one while fading out
+            for (size_t i = 0; i < played; i++) {
+                for (int c = 0; c < ch; c++) scratch[i * ch + c] = out[c][i];
+            }
+            audio_buffer_write(&sw->tee, scratch, played * ch);
+            for (size_t i = 0; i < played; i++) {
+                float gain = swap_gain_out(sw, sw->faded_out + i);
+                for (int c = 0; c < ch; c++) out[c][i] = swap_store((float)out[c][i] * gain);
+            }
+            sw->faded_out += played;
+            if (sw->faded_out >= sw->fade_frames) swap_hand_over(sw, slot);
+        }
+    } else if (state == DEVICE_SWAP_PENDING) {
+        // First callback of the new device: it is live, start the crossfade
+        int expected = DEVICE_SWAP_PENDING;
+        atomic_compare_exchange_strong_explicit(&sw->state, &expected, DEVICE_SWAP_FADING, memory_order_acq_rel,
+                                                memory_order_acquire);
+    } else if (state == DEVICE_SWAP_FADING) {
+        // New device: fade in what the old one tees, once there is enough
+        // that the two devices' periods don't starve it
+        if (sw->started || audio_buffer_available(&sw->tee) / ch >= 2 * frames) {
+            sw->started = 1;
+            played = swap_tee_read(sw, scratch, out, frames);
+            swap_fade_in(sw, out, played);
+        }
+    }
+
+    swap_silence(out, ch, played, frames);
+    return played;
+}
+
+void device_swap_capture(device_swap_t* sw, int slot, const vban_sample_t* in, size_t frames, audio_buffer_t* ring) {
+    int state = atomic_load_explicit(&sw->state, memory_order_acquire);
+    int owner = atomic_load_explicit(&sw->active, memory_order_acquire);
+    int ch = sw->channels;
+    size_t samples = frames * ch;
+    vban_sample_t* scratch = sw->scratch + (size_t)slot * sw->max_frames * ch;
+
+    if (slot != owner) {
+        // New device: tee to the old one, which mixes it in
+        if (state != DEVICE_SWAP_PENDING && state != DEVICE_SWAP_FADING) return;
+        audio_buffer_write(&sw->tee, in, samples);
+        int expected = DEVICE_SWAP_PENDING;
+        atomic_compare_exchange_strong_explicit(&sw->state, &expected, DEVICE_SWAP_FADING, memory_order_acq_rel,
+                                                memory_order_acquire);
+        return;
+    }
+
+    if (state == DEVICE_SWAP_FADING) {
+        // Old device: fade out while fading in what the new one teed
+        size_t teed = audio_buffer_available(&sw->tee) / ch;
+        if (teed > frames) teed = frames;
+        if (teed > 0 && audio_buffer_read(&sw->tee, scratch, teed * ch) == 0) teed = 0;
+        for (size_t i = 0; i < frames; i++) {
+            float gain_out = swap_gain_out(sw, sw->faded_out + i);
+            float gain_in = i < teed ? swap_gain_in(sw, sw->faded_in + i) : 0.0f;
+            for (int c = 0; c < ch; c++) {
+                float teed_sample = i < teed ? (float)scratch[i * ch + c] : 0.0f;
+                scratch[i * ch + c] = swap_store((float)in[i * ch + c] * gain_out + teed_sample * gain_in);
+            }
+        }
+        audio_buffer_write(ring, scratch, samples);
+        sw->faded_out += frames;
+        sw->faded_in += teed;
+        if (sw->faded_out >= sw->fade_frames) swap_hand_over(sw, slot);
+        return;
+    }
+
+    if (state == DEVICE_SWAP_DRAINING) {
+        // New device: what the old one didn't mix in yet, then its own
+        // capture, finishing the fade-in if the old device was cut off
+        size_t teed;
+        while ((teed = audio_buffer_available(&sw->tee) / ch) > 0) {
+            if (teed > sw->max_frames) teed = sw->max_frames;
+            if (audio_buffer_read(&sw->tee, scratch, teed * ch) == 0) break;
+            for (size_t i = 0; i < teed; i++) {
+                float gain = swap_gain_in(sw, sw->faded_in++);
+                for (int c = 0; c < ch; c++) scratch[i * ch + c] = swap_store((float)scratch[i * ch + c] * gain);
+            }
+            audio_buffer_write(ring, scratch, teed * ch);
+        }
+        for (size_t i = 0; i < frames; i++) {
+            float gain = swap_gain_in(sw, sw->faded_in);
+            if (sw->faded_in < sw->fade_frames) sw->faded_in++;
+            for (int c = 0; c < ch; c++) scratch[i * ch + c] = swap_store((float)in[i * ch + c] * gain);
+        }
+        audio_buffer_write(ring, scratch, samples);
+        swap_finish_drain(sw);
+        return;
+    }
+
+    audio_buffer_write(ring, in, samples);
+}
@@ -0,0 +1,132 @@
+#ifndef VBAN4MAC_DEVICE_SWAP_H
+#define VBAN4MAC_DEVICE_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "buffer.h"
+#include "../include/vban4mac/types.h"
+
+// Handover of a running stream from one audio device to another, shared by
+// the callbacks of both devices (slots 0 and 1). The new device is brought
+// up while the old one keeps running, and nothing changes until its first
+// callback proves it is live. Then the two crossfade over a few
+// milliseconds, with equal-power gains, through a tee between them:
+//
+// - Output: the old device keeps reading the playout ring and tees what it
+//   plays to the new one, which fades the same audio in. Once the old
+//   device has faded out, the new one plays what is left in the tee and
+//   carries on from the ring, so no frame is skipped or repeated.
+// - Capture: the new device tees what it captures to the old one, which
+//   mixes it in while fading itself out, then the new device writes to the
+//   capture ring directly.
+//
+// If the old device dies (unplugged) the control thread stops it and cuts
+// over: the new device fades in from whatever the old one left behind.
+// Nothing here allocates, and the tee is a sample ring like the ones the
+// callbacks already read and write.
+
+typedef enum {
+    DEVICE_SWAP_IDLE,               // Only the active slot runs the stream
+    DEVICE_SWAP_PENDING,            // New device started, waiting for its first callback
+    DEVICE_SWAP_FADING,             // Both devices crossfading through the tee
+    DEVICE_SWAP_DRAINING            // New device active, emptying the tee
+} device_swap_state_t;
+
+typedef struct {
+    int channels;
+    size_t fade_frames;
+    size_t max_frames;              // Largest callback
+    atomic_int state;
+    atomic_int active;              // Slot that owns the ring
+    audio_buffer_t tee;            // Interleaved, from the device that owns the ring to the other
+    vban_sample_t* scratch;         // Per slot, max_frames interleaved, for the tee and mixing
+    size_t faded_out;               // Old device's fade position (its callbacks only)
+    size_t faded_in;                // New device's fade position
+    int started;                    // Output: the new device has started playing the tee
+    atomic_uint_fast64_t swaps;     // Completed handovers
+} device_swap_t;
+
+/**
+ * Render callback of the device that owns the playout ring
+ * @param user Passed through from device_swap_render
+ * @param out One destination array per channel
+ * @param frames Frames wanted
+ * @return Frames written, the rest is silence
+ */
+typedef size_t (*device_swap_render_fn)(void* user, vban_sample_t* const* out, size_t frames);
+
+/**
+ * Set up a swap with slot 0 active
+ * @param sw Swap to initialize
+ * @param channels Channels of the stream
+ * @param sample_rate Sample rate, which sets the fade length
+ * @param fade_ms Crossfade length
+ * @param max_frames Largest callback either device makes
+ * @return 0 on success, -1 on error
+ */
+int device_swap_init(device_swap_t* sw, int channels, int sample_rate, int fade_ms, size_t max_frames);
+
+/**
+ * Free a swap's buffers
+ */
+void device_swap_destroy(device_swap_t* sw);
+
+/**
+ * Slot whose device owns the stream
+ */
+int device_swap_active(const device_swap_t* sw);
+
+/**
+ * Whether a handover is still in progress
+ */
+int device_swap_busy(const device_swap_t* sw);
+
+/**
+ * Start handing the stream over to the inactive slot, whose device should
+ * be started (it is kept silent until then). Control thread only.
+ * @param sw The swap
+ * @return The incoming slot, or -1 if a handover is already in progress
+ */
+int device_swap_begin(device_swap_t* sw);
+
+/**
+ * Call off a handover whose new device never came up. Control thread only.
+ * @param sw The swap
+ * @return 0 if called off, -1 if the new device went live in the meantime
+ */
+int device_swap_cancel(device_swap_t* sw);
+
+/**
+ * Give the stream to the incoming slot without waiting for the old device,
+ * which must be stopped first (its callbacks no longer running).
+ * Control thread only.
+ * @param sw The swap
+ */
+void device_swap_cut(device_swap_t* sw);
+
+/**
+ * Output callback of either device
+ * @param sw The swap
+ * @param slot The calling device's slot
+ * @param out One destination array per channel, filled completely
+ * @param frames Frames wanted (at most max_frames)
+ * @param render Reads the playout ring, called only from the slot that owns it
+ * @param user Passed to render
+ * @return Frames the device played from the stream (0 if it is not taking part)
+ */
+size_t device_swap_render(device_swap_t* sw, int slot, vban_sample_t* const* out, size_t frames,
+                          device_swap_render_fn render, void* user);
+
+/**
+ * Capture callback of either device, once a handover has begun (while idle
+ * the active device can write to the ring itself)
+ * @param sw The swap
+ * @param slot The calling device's slot
+ * @param in Captured frames, interleaved
+ * @param frames Frames captured (at most max_frames)
+ * @param ring Capture ring, interleaved
+ */
+void device_swap_capture(device_swap_t* sw, int slot, const vban_sample_t* in, size_t frames, audio_buffer_t* ring);
+
+#endif /* VBAN4MAC_DEVICE_SWAP_H */
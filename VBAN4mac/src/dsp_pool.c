@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "dsp_pool.h"
+
+#define DSP_DEQUE_SIZE 256              // Per-worker deque slots (power of two)
+#define DSP_INJECT_BATCH 8              // Blocks a worker takes from the injection queue at once
+#define DSP_SPIN_ROUNDS 64              // Empty scans before a worker sleeps
+#define DSP_SLEEP_NS 1000000            // Longest sleep, bounds wakeup latency if a signal is missed
+
+// Chase-Lev work-stealing deque: the owner pushes and pops at the bottom,
+// thieves take from the top
+typedef struct {
+    _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    _Atomic(dsp_block_t*) slots[DSP_DEQUE_SIZE];
+} dsp_deque_t;
+
+typedef struct {
+    vban_dsp_pool_t* pool;
+    int index;
+    pthread_t thread;
+    unsigned rng;                       // Victim selection
+    dsp_deque_t deque;
+} dsp_worker_t;
+
+struct vban_dsp_pool_t {
+    int num_workers;
+    int num_started;                    // Threads to join
+    dsp_worker_t* workers;
+    atomic_int running;
+
+    // Injection queue for blocks submitted from outside the pool
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int sleepers;
+    dsp_block_t** inject;
+    size_t inject_head;
+    size_t inject_count;
+    size_t inject_capacity;
+    atomic_size_t inject_pending;       // inject_count, readable without the lock
+    dsp_stream_t* streams;              // Streams still using the pool, guarded by mutex
+};
+
+struct dsp_stream_t {
+    _Atomic(vban_dsp_pool_t*) pool;     // NULL once the pool is gone: blocks run on the submitter
+    dsp_stream_t* next;                 // In the pool's list
+    vban_dsp_fn process;
+    void* process_user;
+    dsp_deliver_fn deliver;
+    void* deliver_user;
+    dsp_block_t* blocks;
+
+    pthread_mutex_t free_mutex;
+    pthread_cond_t all_free;            // Signalled when the last block in flight comes back
+    dsp_block_t* free_list[VBAN_DSP_WINDOW];
+    int free_count;
+    uint64_t next_seq;                  // Producer only
+
+    // Reorder window: processed blocks wait here until their turn
+    _Atomic(dsp_block_t*) done[VBAN_DSP_WINDOW];
+    uint64_t next_deliver;              // Only touched while delivering is held
+    atomic_int delivering;
+};
+
+static int deque_push(dsp_deque_t* d, dsp_block_t* block) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DSP_DEQUE_SIZE) return -1;
+    atomic_store_explicit(&d->slots[b & (DSP_DEQUE_SIZE - 1)], block, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return 0;
+}
+
+static dsp_block_t* deque_pop(dsp_deque_t* d) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    dsp_block_t* block = atomic_load_explicit(&d->slots[b & (DSP_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Last block: race thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            block = NULL;
+        }
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return block;
+}
+
+static dsp_block_t* deque_steal(dsp_deque_t* d) {
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+
+    dsp_block_t* block = atomic_load_explicit(&d->slots[t & (DSP_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;  // Lost to the owner or another thief
+    }
+    return block;
+}
+
+// Hand processed blocks to the stream's output in order. Whichever thread
+// finds the next block ready delivers it and any that follow. A finished
+// block is stored before the flag is tried, and the flag cleared before
+// the slot is looked at again; both sides need a full fence there, or each
+// could miss the other's store and strand the block.
+static void stream_try_deliver(dsp_stream_t* stream) {
+    for (;;) {
+        if (atomic_exchange_explicit(&stream->delivering, 1, memory_order_acquire)) {
+            return;  // The current deliverer will see our block
+        }
+
+        for (;;) {
+            _Atomic(dsp_block_t*)* slot = &stream->done[stream->next_deliver % VBAN_DSP_WINDOW];
+            dsp_block_t* block = atomic_exchange_explicit(slot, NULL, memory_order_acquire);
+            if (!block) break;
+            stream->deliver(stream->deliver_user, block);
+            stream->next_deliver++;
+            dsp_stream_release(stream, block);
+        }
+
+        atomic_store_explicit(&stream->delivering, 0, memory_order_release);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        // A block may have landed after the scan but before the flag was cleared
+        _Atomic(dsp_block_t*)* slot = &stream->done[stream->next_deliver % VBAN_DSP_WINDOW];
+        if (!atomic_load_explicit(slot, memory_order_acquire)) return;
+    }
+}
+
+static void dsp_run(dsp_block_t* block) {
+    dsp_stream_t* stream = block->stream;
+    int channels = block->header.format_nbc + 1;
+
+    stream->process(stream->process_user, block->data, block->samples / channels, channels);
+
+    atomic_store_explicit(&stream->done[block->seq % VBAN_DSP_WINDOW], block, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);  // Pairs with the one after clearing delivering
+    stream_try_deliver(stream);
+}
+
+// Take a batch from the injection queue, keeping the rest in our deque
+static dsp_block_t* dsp_take_injected(dsp_worker_t* worker) {
+    vban_dsp_pool_t* pool = worker->pool;
+    if (atomic_load_explicit(&pool->inject_pending, memory_order_relaxed) == 0) return NULL;
+
+    dsp_block_t* first = NULL;
+    pthread_mutex_lock(&pool->mutex);
+    for (int i = 0; i < DSP_INJECT_BATCH && pool->inject_count > 0; i++) {
+        dsp_block_t* block = pool->inject[pool->inject_head];
+        if (first && deque_push(&worker->deque, block) != 0) break;
+        if (!first) first = block;
+        pool->inject_head = (pool->inject_head + 1) % pool->inject_capacity;
+        pool->inject_count--;
+    }
+    atomic_store_explicit(&pool->inject_pending, pool->inject_count, memory_order_relaxed);
+
+    // Our deque now has work to steal
+    if (pool->sleepers > 0) pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+    return first;
+}
+
+static dsp_block_t* dsp_steal(dsp_worker_t* worker) {
+    vban_dsp_pool_t* pool = worker->pool;
+    int start = (int)(rand_r(&worker->rng) % pool->num_workers);
+    for (int i = 0; i < pool->num_workers; i++) {
+        dsp_worker_t* victim = &pool->workers[(start + i) % pool->num_workers];
+        if (victim == worker) continue;
+        dsp_block_t* block = deque_steal(&victim->deque);
+        if (block) return block;
+    }
+    return NULL;
+}
+
+static void* dsp_worker_thread(void* arg) {
+    dsp_worker_t* worker = (dsp_worker_t*)arg;
+    vban_dsp_pool_t* pool = worker->pool;
+    int idle_rounds = 0;
+
+    while (atomic_load_explicit(&pool->running, memory_order_acquire)) {
+        dsp_block_t* block = deque_pop(&worker->deque);
+        if (!block) block = dsp_take_injected(worker);
+        if (!block) block = dsp_steal(worker);
+
+        if (block) {
+            dsp_run(block);
+            idle_rounds = 0;
+            continue;
+        }
+
+        if (++idle_rounds < DSP_SPIN_ROUNDS) {
+            sched_yield();
+            continue;
+        }
+
+        // Sleep until new blocks are submitted (or briefly, in case work
+        // appeared in another worker's deque)
+        pthread_mutex_lock(&pool->mutex);
+        if (pool->inject_count == 0 && atomic_load(&pool->running)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += DSP_SLEEP_NS;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pool->sleepers++;
+            pthread_cond_timedwait(&pool->cond, &pool->mutex, &deadline);
+            pool->sleepers--;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+        idle_rounds = 0;
+    }
+
+    return NULL;
+}
+
+vban_dsp_pool_t* vban_dsp_pool_create(int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+
+    vban_dsp_pool_t* pool = calloc(1, sizeof(vban_dsp_pool_t));
+    if (!pool) return NULL;
+    pool->workers = calloc(threads, sizeof(dsp_worker_t));
+    pool->inject_capacity = (size_t)threads * DSP_DEQUE_SIZE;
+    pool->inject = calloc(pool->inject_capacity, sizeof(dsp_block_t*));
+    if (!pool->workers || !pool->inject) {
+        free(pool->workers);
+        free(pool->inject);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    atomic_init(&pool->running, 1);
+    atomic_init(&pool->inject_pending, 0);
+
+    // Workers steal from each other, so all of them must exist before any runs
+    pool->num_workers = threads;
+    for (int i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pool->workers[i].rng = (unsigned)i * 2654435761u + 1;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, dsp_worker_thread, &pool->workers[i]) != 0) {
+            perror("Failed to start DSP worker");
+            pool->num_started = i;
+            vban_dsp_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    pool->num_started = threads;
+    return pool;
+}
+
+void vban_dsp_pool_destroy(vban_dsp_pool_t* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    atomic_store(&pool->running, 0);
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->num_started; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    // Streams outliving the pool get what was still queued processed and
+    // delivered here, and process their later blocks on the submitter
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->inject_count > 0) {
+        dsp_block_t* block = pool->inject[pool->inject_head];
+        pool->inject_head = (pool->inject_head + 1) % pool->inject_capacity;
+        pool->inject_count--;
+        dsp_run(block);
+    }
+    for (int i = 0; i < pool->num_workers; i++) {
+        dsp_block_t* block;
+        while ((block = deque_steal(&pool->workers[i].deque)) != NULL) dsp_run(block);
+    }
+    for (dsp_stream_t* stream = pool->streams; stream; stream = stream->next) {
+        atomic_store(&stream->pool, NULL);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+    free(pool->inject);
+    free(pool->workers);
+    free(pool);
+}
+
+dsp_stream_t* dsp_stream_create(vban_dsp_pool_t* pool, vban_dsp_fn process, void* process_user,
+                                dsp_deliver_fn deliver, void* deliver_user) {
+    dsp_stream_t* stream = calloc(1, sizeof(dsp_stream_t));
+    if (!stream) return NULL;
+    stream->blocks = calloc(VBAN_DSP_WINDOW, sizeof(dsp_block_t));
+    if (!stream->blocks) {
+        free(stream);
+        return NULL;
+    }
+
+    atomic_init(&stream->pool, pool);
+    stream->process = process;
+    stream->process_user = process_user;
+    stream->deliver = deliver;
+    stream->deliver_user = deliver_user;
+    pthread_mutex_init(&stream->free_mutex, NULL);
+    pthread_cond_init(&stream->all_free, NULL);
+    for (int i = 0; i < VBAN_DSP_WINDOW; i++) {
+        stream->blocks[i].stream = stream;
+        stream->free_list[i] = &stream->blocks[i];
+        atomic_init(&stream->done[i], NULL);
+    }
+    stream->free_count = VBAN_DSP_WINDOW;
+    atomic_init(&stream->delivering, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    stream->next = pool->streams;
+    pool->streams = stream;
+    pthread_mutex_unlock(&pool->mutex);
+    return stream;
+}
+
+dsp_block_t* dsp_stream_acquire(dsp_stream_t* stream) {
+    dsp_block_t* block = NULL;
+    pthread_mutex_lock(&stream->free_mutex);
+    if (stream->free_count > 0) {
+        block = stream->free_list[--stream->free_count];
+    }
+    pthread_mutex_unlock(&stream->free_mutex);
+    return block;
+}
+
+void dsp_stream_release(dsp_stream_t* stream, dsp_block_t* block) {
+    pthread_mutex_lock(&stream->free_mutex);
+    stream->free_list[stream->free_count++] = block;
+    if (stream->free_count == VBAN_DSP_WINDOW) pthread_cond_broadcast(&stream->all_free);
+    pthread_mutex_unlock(&stream->free_mutex);
+}
+
+void dsp_stream_submit(dsp_stream_t* stream, dsp_block_t* block) {
+    vban_dsp_pool_t* pool = atomic_load(&stream->pool);
+    block->seq = stream->next_seq++;
+    if (!pool) {
+        dsp_run(block);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->inject_count == pool->inject_capacity) {
+        // Every worker is swamped; process on the caller rather than drop
+        pthread_mutex_unlock(&pool->mutex);
+        dsp_run(block);
+        return;
+    }
+    pool->inject[(pool->inject_head + pool->inject_count) % pool->inject_capacity] = block;
+    pool->inject_count++;
+    atomic_store_explicit(&pool->inject_pending, pool->inject_count, memory_order_relaxed);
+    if (pool->sleepers > 0) pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void dsp_stream_destroy(dsp_stream_t* stream) {
+    if (!stream) return;
+
+    // Wait for every block to come back through delivery. The pool's
+    // workers run until it is destroyed, which drains what they left.
+    pthread_mutex_lock(&stream->free_mutex);
+    while (stream->free_count < VBAN_DSP_WINDOW) {
+        pthread_cond_wait(&stream->all_free, &stream->free_mutex);
+    }
+    pthread_mutex_unlock(&stream->free_mutex);
+
+    vban_dsp_pool_t* pool = atomic_load(&stream->pool);
+    if (pool) {
+        pthread_mutex_lock(&pool->mutex);
+        dsp_stream_t** link = &pool->streams;
+        while (*link != stream) link = &(*link)->next;
+        *link = stream->next;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    pthread_cond_destroy(&stream->all_free);
+    pthread_mutex_destroy(&stream->free_mutex);
+    free(stream->blocks);
+    free(stream);
+}
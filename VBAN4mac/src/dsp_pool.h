@@ -0,0 +1,58 @@
+#ifndef VBAN4MAC_DSP_POOL_H
+#define VBAN4MAC_DSP_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../include/vban4mac/dsp.h"
+#include "../include/vban4mac/types.h"
+
+typedef struct dsp_stream_t dsp_stream_t;
+
+// One packet in flight through the pool
+typedef struct {
+    dsp_stream_t* stream;
+    uint64_t seq;                   // Arrival order within the stream
+    vban_header_t header;
+    int64_t arrival_ns;             // Receive timestamp
+    size_t samples;
+    vban_sample_t data[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];  // Decoded from the wire
+} dsp_block_t;
+
+// Called with processed blocks, one at a time and in arrival order
+typedef void (*dsp_deliver_fn)(void* user, const dsp_block_t* block);
+
+/**
+ * Create a stream on a pool
+ * @param pool The pool
+ * @param process DSP to run on every block
+ * @param process_user Passed to process
+ * @param deliver Receives processed blocks in order
+ * @param deliver_user Passed to deliver
+ * @return Stream or NULL on error
+ */
+dsp_stream_t* dsp_stream_create(vban_dsp_pool_t* pool, vban_dsp_fn process, void* process_user,
+                                dsp_deliver_fn deliver, void* deliver_user);
+
+/**
+ * Take a free block to receive the next packet into (single producer)
+ * @return Block, or NULL if VBAN_DSP_WINDOW packets are already in flight
+ */
+dsp_block_t* dsp_stream_acquire(dsp_stream_t* stream);
+
+/**
+ * Queue a filled block for processing; header and samples must be set
+ */
+void dsp_stream_submit(dsp_stream_t* stream, dsp_block_t* block);
+
+/**
+ * Return an acquired block without submitting it
+ */
+void dsp_stream_release(dsp_stream_t* stream, dsp_block_t* block);
+
+/**
+ * Wait for blocks in flight to be delivered, then free the stream. Also
+ * safe after the pool was destroyed, which delivered them already.
+ */
+void dsp_stream_destroy(dsp_stream_t* stream);
+
+#endif /* VBAN4MAC_DSP_POOL_H */
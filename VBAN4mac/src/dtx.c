@@ -0,0 +1,80 @@
+#include <math.h>
+#include "dtx.h"
+
+#define DTX_DEFAULT_HANGOVER_MS 100
+#define DTX_DEFAULT_KEEPALIVE_MS 1000
+#define DTX_LANES 8                  // Independent maxima so the scan vectorizes
+
+void dtx_init(dtx_gate_t* gate, const vban_dtx_config_t* config, int frames_per_packet, int sample_rate) {
+    gate->threshold = 0;
+    gate->hangover = 1;
+    gate->keepalive = 1;
+    gate->silent_run = 0;
+    if (!config || config->threshold_db >= 0 || frames_per_packet <= 0 || sample_rate <= 0) {
+        return;
+    }
+
+    int db = config->threshold_db > DTX_MAX_THRESHOLD_DB ? DTX_MAX_THRESHOLD_DB : config->threshold_db;
+    gate->threshold = (int32_t)(32768.0 * pow(10.0, db / 20.0));
+    if (gate->threshold < 1) gate->threshold = 1;  // Digital silence only
+
+    double packet_ms = frames_per_packet * 1000.0 / sample_rate;
+    int hangover_ms = config->hangover_ms > 0 ? config->hangover_ms : DTX_DEFAULT_HANGOVER_MS;
+    int keepalive_ms = config->keepalive_ms > 0 ? config->keepalive_ms : DTX_DEFAULT_KEEPALIVE_MS;
+    gate->hangover = (uint32_t)ceil(hangover_ms / packet_ms);
+    gate->keepalive = (uint32_t)ceil(keepalive_ms / packet_ms);
+    if (gate->hangover < 1) gate->hangover = 1;
+    if (gate->keepalive < 1) gate->keepalive = 1;
+}
+
+static int32_t dtx_peak(const int16_t* x, size_t n) {
+    int32_t max_lane[DTX_LANES] = {0};
+    size_t i = 0;
+
+    for (; i + DTX_LANES <= n; i += DTX_LANES) {
+        for (int l = 0; l < DTX_LANES; l++) {
+            int32_t v = x[i + l];
+            int32_t a = v < 0 ? -v : v;
+            max_lane[l] = a > max_lane[l] ? a : max_lane[l];
+        }
+    }
+    for (; i < n; i++) {
+        int32_t v = x[i];
+        int32_t a = v < 0 ? -v : v;
+        max_lane[0] = a > max_lane[0] ? a : max_lane[0];
+    }
+
+    int32_t max = 0;
+    for (int l = 0; l < DTX_LANES; l++) {
+        max = max_lane[l] > max ? max_lane[l] : max;
+    }
+    return max;
+}
+
+static int32_t dtx_span_peak(const audio_buffer_span_t* payload, size_t samples) {
+    size_t first = payload->len[0] < samples ? payload->len[0] : samples;
+    int32_t peak = dtx_peak(payload->ptr[0], first);
+    if (samples > first) {
+        int32_t second = dtx_peak(payload->ptr[1], samples - first);
+        if (second > peak) peak = second;
+    }
+    return peak;
+}
+
+int dtx_should_send(dtx_gate_t* gate, const audio_buffer_span_t* payload) {
+    if (gate->threshold == 0) return 1;
+
+    if (dtx_span_peak(payload, payload->len[0] + payload->len[1]) > gate->threshold) {
+        gate->silent_run = 0;
+        return 1;
+    }
+
+    // Silent: send through the hangover, then one packet per keepalive
+    uint32_t run = ++gate->silent_run;
+    if (run <= gate->hangover) return 1;
+    return (run - gate->hangover) % gate->keepalive == 0;
+}
+
+int dtx_is_silent(const audio_buffer_span_t* payload, size_t samples) {
+    return dtx_span_peak(payload, samples) <= DTX_SILENCE_PEAK;
+}
@@ -0,0 +1,54 @@
+#ifndef VBAN4MAC_DTX_H
+#define VBAN4MAC_DTX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../include/vban4mac/types.h"
+#include "buffer.h"
+
+// Loudest sender threshold, and the level below which a receiver takes the
+// packet before a counter gap to mean the sender went quiet rather than
+// that packets were lost (-40 dBFS)
+#define DTX_MAX_THRESHOLD_DB -40
+#define DTX_SILENCE_PEAK 327
+
+// Sender-side silence suppression (discontinuous transmission) for one
+// stream. Once a signal drops below the threshold, packets are still sent
+// for the hangover and then suppressed, except for a periodic keepalive.
+// Suppressed packets keep their nuFrame, so the counter advances as if
+// they had been sent. The last packet sent before a suppressed run is
+// always silent, which is how receivers tell the gap from loss.
+typedef struct {
+    int32_t threshold;          // Peak amplitude at or below which a packet is silent, 0 = disabled
+    uint32_t hangover;          // Silent packets sent after the signal, at least 1
+    uint32_t keepalive;         // Packets per keepalive during suppression
+    uint32_t silent_run;        // Consecutive silent packets so far
+} dtx_gate_t;
+
+/**
+ * Set up a gate from the stream's DTX configuration
+ * @param gate Gate to initialize
+ * @param config Threshold, hangover and keepalive (NULL or threshold 0 disables suppression)
+ * @param frames_per_packet Frames in each packet of the stream
+ * @param sample_rate Stream sample rate in Hz
+ */
+void dtx_init(dtx_gate_t* gate, const vban_dtx_config_t* config, int frames_per_packet, int sample_rate);
+
+/**
+ * Decide whether the next packet goes out
+ * @param gate The gate
+ * @param payload Interleaved samples of the packet, in up to two parts
+ * @return 1 to send the packet, 0 to suppress it
+ */
+int dtx_should_send(dtx_gate_t* gate, const audio_buffer_span_t* payload);
+
+/**
+ * Whether every sample of a packet is at or below the level receivers
+ * treat as silence
+ * @param payload Interleaved host-order samples, in up to two parts
+ * @param samples Number of samples
+ * @return 1 if silent, 0 otherwise
+ */
+int dtx_is_silent(const audio_buffer_span_t* payload, size_t samples);
+
+#endif /* VBAN4MAC_DTX_H */
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#include "event_loop.h"
+
+#define EVENT_LOOP_MAX_EVENTS 64
+
+struct event_source_t {
+    int fd;                         // -1 for timers
+    event_handler_fn handler;
+    void* user;
+    int64_t interval_ns;
+    int64_t next_ns;                // Next timer deadline
+    atomic_int removed;
+    struct event_source_t* next;
+};
+
+struct event_loop_t {
+    pthread_t thread;
+    atomic_int running;
+    pthread_mutex_t mutex;          // Protects the source list and generation
+    pthread_cond_t cond;
+    event_source_t* sources;
+    event_source_t* retired;        // Removed by handlers, freed at the end of the round
+    uint64_t generation;            // Dispatch rounds completed
+#ifdef __linux__
+    int epoll_fd;
+    int wake_fd;                    // eventfd
+#else
+    int wake_pipe[2];
+    struct pollfd* pollfds;         // Rebuilt each round from the source list
+    event_source_t** pollsrc;
+    size_t poll_capacity;
+#endif
+};
+
+static int64_t loop_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void loop_wake(event_loop_t* loop) {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t ignored = write(loop->wake_fd, &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t ignored = write(loop->wake_pipe[1], &one, sizeof(one));
+#endif
+    (void)ignored;
+}
+
+static void loop_drain_wake(event_loop_t* loop) {
+#ifdef __linux__
+    uint64_t count;
+    ssize_t ignored = read(loop->wake_fd, &count, sizeof(count));
+    (void)ignored;
+#else
+    char buf[64];
+    while (read(loop->wake_pipe[0], buf, sizeof(buf)) > 0) {
+    }
+#endif
+}
+
+// Milliseconds until the earliest timer is due, -1 if there are none
+static int loop_timeout_ms(event_loop_t* loop) {
+    int64_t earliest = INT64_MAX;
+    pthread_mutex_lock(&loop->mutex);
+    for (event_source_t* s = loop->sources; s; s = s->next) {
+        if (s->fd < 0 && s->next_ns < earliest) earliest = s->next_ns;
+    }
+    pthread_mutex_unlock(&loop->mutex);
+
+    if (earliest == INT64_MAX) return -1;
+    int64_t wait_ns = earliest - loop_now_ns();
+    if (wait_ns <= 0) return 0;
+    return (int)((wait_ns + 999999) / 1000000);
+}
+
+static void loop_free_sources(event_source_t* source) {
+    while (source) {
+        event_source_t* next = source->next;
+        free(source);
+        source = next;
+    }
+}
+
+static void loop_dispatch(event_source_t* source) {
+    if (!atomic_load_explicit(&source->removed, memory_order_acquire)) {
+        source->handler(source->user);
+    }
+}
+
+static void loop_run_timers(event_loop_t* loop) {
+    int64_t now = loop_now_ns();
+
+    // Sources are only freed after this round ends, so walking the list
+    // without holding the lock across handlers is safe
+    pthread_mutex_lock(&loop->mutex);
+    event_source_t* s = loop->sources;
+    pthread_mutex_unlock(&loop->mutex);
+
+    while (s) {
+        if (s->fd < 0 && now >= s->next_ns) {
+            s->next_ns += s->interval_ns;
+            if (s->next_ns <= now) s->next_ns = now + s->interval_ns;  // Fell behind, don't catch up
+            loop_dispatch(s);
+        }
+        pthread_mutex_lock(&loop->mutex);
+        s = s->next;
+        pthread_mutex_unlock(&loop->mutex);
+    }
+}
+
+#ifdef __linux__
+static void loop_wait(event_loop_t* loop, int timeout_ms) {
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int count = epoll_wait(loop->epoll_fd, events, EVENT_LOOP_MAX_EVENTS, timeout_ms);
+    for (int i = 0; i < count; i++) {
+        if (events[i].data.ptr == NULL) {
+            loop_drain_wake(loop);
+        } else {
+            loop_dispatch((event_source_t*)events[i].data.ptr);
+        }
+    }
+}
+#else
+static void loop_wait(event_loop_t* loop, int timeout_ms) {
+    size_t count = 1;
+
+    pthread_mutex_lock(&loop->mutex);
+    for (event_source_t* s = loop->sources; s; s = s->next) {
+        if (s->fd < 0) continue;
+        if (count == loop->poll_capacity) {
+            size_t capacity = loop->poll_capacity * 2;
+            struct pollfd* fds = realloc(loop->pollfds, capacity * sizeof(*fds));
+            event_source_t** src = realloc(loop->pollsrc, capacity * sizeof(*src));
+            if (fds) loop->pollfds = fds;
+            if (src) loop->pollsrc = src;
+            if (!fds || !src) break;
+            loop->poll_capacity = capacity;
+        }
+        loop->pollfds[count].fd = s->fd;
+        loop->pollfds[count].events = POLLIN;
+        loop->pollsrc[count] = s;
+        count++;
+    }
+    pthread_mutex_unlock(&loop->mutex);
+
+    loop->pollfds[0].fd = loop->wake_pipe[0];
+    loop->pollfds[0].events = POLLIN;
+
+    if (poll(loop->pollfds, count, timeout_ms) <= 0) return;
+    if (loop->pollfds[0].revents) loop_drain_wake(loop);
+    for (size_t i = 1; i < count; i++) {
+        if (loop->pollfds[i].revents) loop_dispatch(loop->pollsrc[i]);
+    }
+}
+#endif
+
+static void* loop_thread(void* arg) {
+    event_loop_t* loop = (event_loop_t*)arg;
+
+    while (atomic_load_explicit(&loop->running, memory_order_acquire)) {
+        loop_wait(loop, loop_timeout_ms(loop));
+        loop_run_timers(loop);
+
+        // Let removers know no handler from before this point is still running
+        pthread_mutex_lock(&loop->mutex);
+        event_source_t* retired = loop->retired;
+        loop->retired = NULL;
+        loop->generation++;
+        pthread_cond_broadcast(&loop->cond);
+        pthread_mutex_unlock(&loop->mutex);
+
+        loop_free_sources(retired);
+    }
+
+    return NULL;
+}
+
+event_loop_t* event_loop_create(void) {
+    event_loop_t* loop = calloc(1, sizeof(event_loop_t));
+    if (!loop) return NULL;
+
+#ifdef __linux__
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop->epoll_fd < 0 || loop->wake_fd < 0) {
+        perror("Failed to create event loop");
+        if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+        if (loop->wake_fd >= 0) close(loop->wake_fd);
+        free(loop);
+        return NULL;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+#else
+    if (pipe(loop->wake_pipe) != 0) {
+        perror("Failed to create event loop");
+        free(loop);
+        return NULL;
+    }
+    fcntl(loop->wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(loop->wake_pipe[1], F_SETFL, O_NONBLOCK);
+    loop->poll_capacity = 16;
+    loop->pollfds = malloc(loop->poll_capacity * sizeof(*loop->pollfds));
+    loop->pollsrc = malloc(loop->poll_capacity * sizeof(*loop->pollsrc));
+#endif
+
+    pthread_mutex_init(&loop->mutex, NULL);
+    pthread_cond_init(&loop->cond, NULL);
+    atomic_init(&loop->running, 1);
+
+    if (pthread_create(&loop->thread, NULL, loop_thread, loop) != 0) {
+        atomic_store(&loop->running, 0);
+        event_loop_destroy(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+static event_source_t* loop_add(event_loop_t* loop, int fd, int64_t interval_ns,
+                                event_handler_fn handler, void* user) {
+    event_source_t* source = calloc(1, sizeof(event_source_t));
+    if (!source) return NULL;
+    source->fd = fd;
+    source->handler = handler;
+    source->user = user;
+    source->interval_ns = interval_ns;
+    source->next_ns = loop_now_ns() + interval_ns;
+    atomic_init(&source->removed, 0);
+
+#ifdef __linux__
+    if (fd >= 0) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = source };
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("Failed to add socket to event loop");
+            free(source);
+            return NULL;
+        }
+    }
+#endif
+
+    pthread_mutex_lock(&loop->mutex);
+    source->next = loop->sources;
+    loop->sources = source;
+    pthread_mutex_unlock(&loop->mutex);
+
+    // Recompute the wait (new timer deadline or new poll set)
+    loop_wake(loop);
+    return source;
+}
+
+event_source_t* event_loop_add_fd(event_loop_t* loop, int fd, event_handler_fn handler, void* user) {
+    return loop_add(loop, fd, 0, handler, user);
+}
+
+event_source_t* event_loop_add_timer(event_loop_t* loop, int64_t interval_us, event_handler_fn handler, void* user) {
+    if (interval_us <= 0) return NULL;
+    return loop_add(loop, -1, interval_us * 1000, handler, user);
+}
+
+void event_loop_remove(event_loop_t* loop, event_source_t* source) {
+    if (!source) return;
+    atomic_store_explicit(&source->removed, 1, memory_order_release);
+
+#ifdef __linux__
+    if (source->fd >= 0) {
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+    }
+#endif
+
+    pthread_mutex_lock(&loop->mutex);
+    for (event_source_t** p = &loop->sources; *p; p = &(*p)->next) {
+        if (*p == source) {
+            *p = source->next;
+            break;
+        }
+    }
+
+    if (pthread_equal(pthread_self(), loop->thread)) {
+        // Removed by a handler: this round may still reach the source
+        source->next = loop->retired;
+        loop->retired = source;
+        pthread_mutex_unlock(&loop->mutex);
+        return;
+    }
+
+    // Wait out the current dispatch round, which may still use the source
+    if (atomic_load(&loop->running)) {
+        uint64_t generation = loop->generation;
+        loop_wake(loop);
+        while (loop->generation == generation) {
+            pthread_cond_wait(&loop->cond, &loop->mutex);
+        }
+    }
+    pthread_mutex_unlock(&loop->mutex);
+    free(source);
+}
+
+void event_loop_destroy(event_loop_t* loop) {
+    if (!loop) return;
+
+    if (atomic_exchange(&loop->running, 0)) {
+        loop_wake(loop);
+        pthread_join(loop->thread, NULL);
+    }
+
+    loop_free_sources(loop->sources);
+    loop_free_sources(loop->retired);
+
+#ifdef __linux__
+    close(loop->epoll_fd);
+    close(loop->wake_fd);
+#else
+    close(loop->wake_pipe[0]);
+    close(loop->wake_pipe[1]);
+    free(loop->pollfds);
+    free(loop->pollsrc);
+#endif
+    pthread_mutex_destroy(&loop->mutex);
+    pthread_cond_destroy(&loop->cond);
+    free(loop);
+}
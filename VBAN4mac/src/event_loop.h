@@ -0,0 +1,53 @@
+#ifndef VBAN4MAC_EVENT_LOOP_H
+#define VBAN4MAC_EVENT_LOOP_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Event loop thread multiplexing readable sockets and periodic timers
+// (epoll on Linux, poll elsewhere). Handlers run on the loop thread and
+// must not block. A wakeup fd lets other threads interrupt the wait, so
+// removing a source or stopping the loop takes effect promptly.
+
+typedef void (*event_handler_fn)(void* user);
+
+typedef struct event_source_t event_source_t;
+typedef struct event_loop_t event_loop_t;
+
+/**
+ * Create a loop and start its thread
+ * @return Loop or NULL on error
+ */
+event_loop_t* event_loop_create(void);
+
+/**
+ * Call handler on the loop thread whenever fd is readable
+ * @param loop The loop
+ * @param fd Non-blocking file descriptor
+ * @param handler Called until it has drained fd
+ * @param user Passed to handler
+ * @return Source handle or NULL on error
+ */
+event_source_t* event_loop_add_fd(event_loop_t* loop, int fd, event_handler_fn handler, void* user);
+
+/**
+ * Call handler on the loop thread every interval_us microseconds
+ * @return Source handle or NULL on error
+ */
+event_source_t* event_loop_add_timer(event_loop_t* loop, int64_t interval_us, event_handler_fn handler, void* user);
+
+/**
+ * Remove a source. When called from another thread, returns only once
+ * the source's handler can no longer be running.
+ * @param loop The loop the source was added to
+ * @param source Source to remove and free
+ */
+void event_loop_remove(event_loop_t* loop, event_source_t* source);
+
+/**
+ * Stop the loop thread and free the loop (remove all sources first)
+ */
+void event_loop_destroy(event_loop_t* loop);
+
+#endif /* VBAN4MAC_EVENT_LOOP_H */
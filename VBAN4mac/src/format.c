@@ -0,0 +1,69 @@
+#include <string.h>
+#include "format.h"
+#include "packet.h"
+
+static int16_t read_sample(const uint8_t* payload, size_t index, int bytes) {
+    if (bytes == 1) return (int16_t)((int8_t)payload[index] * 256);
+    return (int16_t)(uint16_t)(payload[2 * index] | (payload[2 * index + 1] << 8));
+}
+
+size_t format_encode(const int16_t* in, size_t frames, int in_channels, int decimation, int out_channels,
+                     uint8_t datatype, uint8_t* out) {
+    int downmix = out_channels == 1 && in_channels > 1;
+    size_t out_frames = frames / decimation;
+    size_t bytes = 0;
+
+    for (size_t f = 0; f < out_frames; f++) {
+        const int16_t* block = in + f * decimation * in_channels;
+        for (int c = 0; c < out_channels; c++) {
+            // Average the decimated frames (and the channels for a downmix),
+            // a crude low-pass ahead of the rate reduction
+            int32_t sum = 0;
+            for (int d = 0; d < decimation; d++) {
+                const int16_t* frame = block + d * in_channels;
+                if (downmix) {
+                    for (int i = 0; i < in_channels; i++) sum += frame[i];
+                } else {
+                    sum += frame[c];
+                }
+            }
+            int32_t value = sum / (decimation * (downmix ? in_channels : 1));
+
+            if (datatype == VBAN_DATATYPE_BYTE8) {
+                value = (value + 128) >> 8;
+                out[bytes++] = (uint8_t)(int8_t)(value > 127 ? 127 : value);
+            } else {
+                out[bytes++] = (uint8_t)value;
+                out[bytes++] = (uint8_t)((uint16_t)value >> 8);
+            }
+        }
+    }
+    return bytes;
+}
+
+void format_decoder_init(format_decoder_t* decoder, int channels) {
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->channels = channels;
+}
+
+size_t format_decode(format_decoder_t* decoder, const vban_header_t* header, const uint8_t* payload,
+                     int interpolation, int16_t* out) {
+    int frames = header->format_nbs + 1;
+    int in_channels = header->format_nbc + 1;
+    int bytes = vban_datatype_bytes(header->format_bit);
+    int channels = decoder->channels;
+
+    for (int f = 0; f < frames; f++) {
+        for (int c = 0; c < channels; c++) {
+            int32_t target = read_sample(payload, (size_t)f * in_channels + c % in_channels, bytes);
+            int32_t from = decoder->last[c];
+            // Linear steps from the previous frame, ending on this one
+            for (int j = 1; j <= interpolation; j++) {
+                out[((size_t)f * interpolation + j - 1) * channels + c] =
+                    (int16_t)(from + (target - from) * j / interpolation);
+            }
+            decoder->last[c] = (int16_t)target;
+        }
+    }
+    return (size_t)frames * interpolation;
+}
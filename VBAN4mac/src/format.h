@@ -0,0 +1,54 @@
+#ifndef VBAN4MAC_FORMAT_H
+#define VBAN4MAC_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../include/vban4mac/types.h"
+
+// Conversions between a stream's int16 frames and the reduced formats of
+// an adaptive sender's quality ladder: fewer channels, a whole fraction of
+// the sample rate, 8-bit samples
+
+// Decoder state carried across packets, so a change of format mid-stream
+// continues from the last frame played instead of jumping
+typedef struct {
+    int channels;                   // Channels of the decoded output
+    int16_t last[256];              // Last decoded frame, where interpolation starts
+} format_decoder_t;
+
+/**
+ * Encode one packet of frames into a reduced format
+ * @param in Interleaved host-order frames
+ * @param frames Input frames, a multiple of decimation
+ * @param in_channels Channels of in
+ * @param decimation Input frames averaged into each output frame
+ * @param out_channels The first out_channels channels, or a mono downmix if 1
+ * @param datatype VBAN_DATATYPE_INT16 or VBAN_DATATYPE_BYTE8
+ * @param out Filled with the little-endian payload
+ * @return Payload bytes
+ */
+size_t format_encode(const int16_t* in, size_t frames, int in_channels, int decimation, int out_channels,
+                     uint8_t datatype, uint8_t* out);
+
+/**
+ * Prepare a decoder
+ * @param decoder Decoder to reset
+ * @param channels Channels of the decoded output
+ */
+void format_decoder_init(format_decoder_t* decoder, int channels);
+
+/**
+ * Decode one packet to host-order int16 at the output rate and channels.
+ * Channels missing from the packet repeat the ones it has; a packet at a
+ * fraction of the output rate is interpolated from the previous frame.
+ * @param decoder Decoder state
+ * @param header Header of the packet (frames, channels and data type)
+ * @param payload Little-endian payload
+ * @param interpolation Output frames per packet frame
+ * @param out Interleaved destination of (nbs * interpolation) frames
+ * @return Frames written
+ */
+size_t format_decode(format_decoder_t* decoder, const vban_header_t* header, const uint8_t* payload,
+                     int interpolation, int16_t* out);
+
+#endif /* VBAN4MAC_FORMAT_H */
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sys/uio.h>
+#include "impair.h"
+#include "net_util.h"
+
+#define IMPAIR_HEADER_BYTES 28      // IPv4 and UDP headers, counted against the rate limit
+#define IMPAIR_DEFAULT_BURST_EXIT_PCT 25.0
+#define IMPAIR_DEFAULT_REORDER_MS 10
+#define IMPAIR_DEFAULT_QUEUE_MS 100
+#define IMPAIR_PARETO_SHAPE 3.0
+
+int impair_active(const vban_impair_config_t* config) {
+    return config->loss_pct > 0 || config->burst_enter_pct > 0 || config->delay_ms > 0 ||
+           config->jitter_ms > 0 || config->reorder_pct > 0 || config->duplicate_pct > 0 ||
+           config->rate_kbps > 0;
+}
+
+int impair_init(impair_t* imp, const vban_impair_config_t* config, unsigned seed_offset) {
+    memset(imp, 0, sizeof(*imp));
+    imp->packets = malloc(IMPAIR_MAX_HELD * sizeof(impair_packet_t));
+    if (!imp->packets) return -1;
+
+    imp->config = *config;
+    imp->rng = config->seed + seed_offset;
+    for (int i = 0; i < IMPAIR_MAX_HELD; i++) imp->free_slots[i] = IMPAIR_MAX_HELD - 1 - i;
+    imp->free_count = IMPAIR_MAX_HELD;
+    return 0;
+}
+
+void impair_destroy(impair_t* imp) {
+    free(imp->packets);
+    imp->packets = NULL;
+}
+
+static int64_t impair_now_ns(void) {
+    // The clock kernel receive timestamps are taken on
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Uniform in [0, 1)
+static double impair_uniform(impair_t* imp) {
+    return rand_r(&imp->rng) / ((double)RAND_MAX + 1.0);
+}
+
+static int impair_before(const impair_t* imp, int a, int b) {
+    const impair_packet_t* pa = &imp->packets[a];
+    const impair_packet_t* pb = &imp->packets[b];
+    return pa->release_ns < pb->release_ns || (pa->release_ns == pb->release_ns && pa->order < pb->order);
+}
+
+// Move the next free slot onto the link, due at release_ns
+static void impair_hold(impair_t* imp, int64_t release_ns) {
+    int slot = imp->free_slots[--imp->free_count];
+    imp->packets[slot].release_ns = release_ns;
+    imp->packets[slot].order = imp->order++;
+
+    int i = imp->held++;
+    imp->heap[i] = slot;
+    while (i > 0 && impair_before(imp, imp->heap[i], imp->heap[(i - 1) / 2])) {
+        int parent = (i - 1) / 2;
+        imp->heap[i] = imp->heap[parent];
+        imp->heap[parent] = slot;
+        i = parent;
+    }
+}
+
+static int impair_pop(impair_t* imp) {
+    int slot = imp->heap[0];
+    imp->heap[0] = imp->heap[--imp->held];
+    int i = 0;
+    for (;;) {
+        int least = i;
+        int left = 2 * i + 1, right = left + 1;
+        if (left < imp->held && impair_before(imp, imp->heap[left], imp->heap[least])) least = left;
+        if (right < imp->held && impair_before(imp, imp->heap[right], imp->heap[least])) least = right;
+        if (least == i) break;
+        int tmp = imp->heap[i];
+        imp->heap[i] = imp->heap[least];
+        imp->heap[least] = tmp;
+        i = least;
+    }
+    return slot;
+}
+
+static double impair_jitter_ms(const vban_impair_config_t* c, double u1, double u2) {
+    switch (c->jitter_dist) {
+        case VBAN_JITTER_NORMAL:
+            return c->jitter_ms * sqrt(-2.0 * log(1.0 - u1)) * cos(2.0 * M_PI * u2);
+        case VBAN_JITTER_PARETO: {
+            // Shifted to start at zero, with mean jitter_ms
+            double scale = c->jitter_ms * (IMPAIR_PARETO_SHAPE - 1.0);
+            return scale * (pow(1.0 - u1, -1.0 / IMPAIR_PARETO_SHAPE) - 1.0);
+        }
+        default:
+            return c->jitter_ms * (2.0 * u1 - 1.0);
+    }
+}
+
+// Decide the fate of the datagram in the next free slot, received at arrival_ns
+static void impair_admit(impair_t* imp, int64_t arrival_ns) {
+    const vban_impair_config_t* c = &imp->config;
+    impair_packet_t* packet = &imp->packets[imp->free_slots[imp->free_count - 1]];
+
+    // The same draws for every packet, so changing one impairment leaves
+    // the others' decisions as they were
+    double u_loss = impair_uniform(imp);
+    double u_burst_loss = impair_uniform(imp);
+    double u_burst_move = impair_uniform(imp);
+    double u_jitter1 = impair_uniform(imp);
+    double u_jitter2 = impair_uniform(imp);
+    double u_reorder = impair_uniform(imp);
+    double u_duplicate = impair_uniform(imp);
+    atomic_fetch_add_explicit(&imp->received, 1, memory_order_relaxed);
+
+    // Gilbert-Elliott: the link's state decides this packet, then moves on
+    double burst_loss = c->burst_loss_pct > 0 ? c->burst_loss_pct : 100.0;
+    int lost_burst = imp->burst && u_burst_loss * 100.0 < burst_loss;
+    if (c->burst_enter_pct > 0) {
+        double exit = c->burst_exit_pct > 0 ? c->burst_exit_pct : IMPAIR_DEFAULT_BURST_EXIT_PCT;
+        imp->burst = imp->burst ? u_burst_move * 100.0 >= exit : u_burst_move * 100.0 < c->burst_enter_pct;
+    }
+    if (lost_burst) {
+        atomic_fetch_add_explicit(&imp->lost_burst, 1, memory_order_relaxed);
+        return;
+    }
+    if (u_loss * 100.0 < c->loss_pct) {
+        atomic_fetch_add_explicit(&imp->lost_random, 1, memory_order_relaxed);
+        return;
+    }
+
+    // Rate limit: the packet waits for the link to send what is ahead of it
+    int64_t sent_ns = arrival_ns;
+    if (c->rate_kbps > 0) {
+        int64_t start_ns = imp->link_free_ns > arrival_ns ? imp->link_free_ns : arrival_ns;
+        int64_t queue_ns = (int64_t)(c->queue_ms > 0 ? c->queue_ms : IMPAIR_DEFAULT_QUEUE_MS) * 1000000;
+        if (start_ns - arrival_ns > queue_ns) {
+            atomic_fetch_add_explicit(&imp->lost_queue, 1, memory_order_relaxed);
+            return;
+        }
+        sent_ns = start_ns + (int64_t)(packet->len + IMPAIR_HEADER_BYTES) * 8 * 1000000 / c->rate_kbps;
+        imp->link_free_ns = sent_ns;
+    }
+
+    double delay_ms = c->delay_ms + (c->jitter_ms > 0 ? impair_jitter_ms(c, u_jitter1, u_jitter2) : 0.0);
+    if (delay_ms < 0) delay_ms = 0;
+    if (u_reorder * 100.0 < c->reorder_pct) {
+        delay_ms += c->reorder_ms > 0 ? c->reorder_ms : IMPAIR_DEFAULT_REORDER_MS;
+        atomic_fetch_add_explicit(&imp->reordered, 1, memory_order_relaxed);
+    }
+    int64_t release_ns = sent_ns + (int64_t)(delay_ms * 1e6);
+    impair_hold(imp, release_ns);
+
+    if (u_duplicate * 100.0 < c->duplicate_pct && imp->free_count > 0) {
+        impair_packet_t* copy = &imp->packets[imp->free_slots[imp->free_count - 1]];
+        memcpy(copy, packet, sizeof(*copy));
+        impair_hold(imp, release_ns);
+        atomic_fetch_add_explicit(&imp->duplicated, 1, memory_order_relaxed);
+    }
+}
+
+// Take everything the socket has onto the link, while there is room
+// @return errno of the receive that ended it
+static int impair_drain(impair_t* imp, int socket) {
+    while (imp->free_count > 0) {
+        impair_packet_t* packet = &imp->packets[imp->free_slots[imp->free_count - 1]];
+        union {
+            struct cmsghdr align;
+            char buf[NET_TIMESTAMP_CONTROL_SIZE];
+        } control;
+        struct iovec iov = { packet->data, sizeof(packet->data) };
+        struct msghdr msg = {0};
+        msg.msg_name = &packet->addr;
+        msg.msg_namelen = sizeof(packet->addr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        ssize_t received = recvmsg(socket, &msg, MSG_DONTWAIT);
+        if (received < 0) return errno;
+        packet->len = (size_t)received;
+        packet->addr_len = msg.msg_namelen;
+        impair_admit(imp, net_rx_timestamp_ns(&msg));
+    }
+    return EAGAIN;
+}
+
+// Report the simulated arrival the way the kernel reports a real one
+static void impair_set_timestamp(struct msghdr* msg, int64_t ns) {
+#ifdef SCM_TIMESTAMPNS
+    struct timespec stamp = { (time_t)(ns / 1000000000LL), (long)(ns % 1000000000LL) };
+    int type = SCM_TIMESTAMPNS;
+#else
+    struct timeval stamp = { (time_t)(ns / 1000000000LL), (suseconds_t)(ns % 1000000000LL / 1000) };
+    int type = SCM_TIMESTAMP;
+#endif
+    if (!msg->msg_control || msg->msg_controllen < CMSG_SPACE(sizeof(stamp))) {
+        msg->msg_controllen = 0;
+        return;
+    }
+    struct cmsghdr* cmsg = (struct cmsghdr*)msg->msg_control;
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = type;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(stamp));
+    memcpy(CMSG_DATA(cmsg), &stamp, sizeof(stamp));
+    msg->msg_controllen = CMSG_SPACE(sizeof(stamp));
+}
+
+ssize_t impair_recvmsg(impair_t* imp, int socket, struct msghdr* msg) {
+    int error = impair_drain(imp, socket);
+    if (imp->held == 0 || imp->packets[imp->heap[0]].release_ns > impair_now_ns()) {
+        errno = error;
+        return -1;
+    }
+
+    int slot = impair_pop(imp);
+    impair_packet_t* packet = &imp->packets[slot];
+    size_t copied = 0;
+    for (size_t i = 0; i < (size_t)msg->msg_iovlen && copied < packet->len; i++) {
+        size_t n = packet->len - copied;
+        if (n > msg->msg_iov[i].iov_len) n = msg->msg_iov[i].iov_len;
+        memcpy(msg->msg_iov[i].iov_base, packet->data + copied, n);
+        copied += n;
+    }
+    if (msg->msg_name) {
+        socklen_t len = msg->msg_namelen < packet->addr_len ? msg->msg_namelen : packet->addr_len;
+        memcpy(msg->msg_name, &packet->addr, len);
+        msg->msg_namelen = packet->addr_len;
+    }
+    impair_set_timestamp(msg, packet->release_ns);
+    msg->msg_flags = copied < packet->len ? MSG_TRUNC : 0;
+
+    imp->free_slots[imp->free_count++] = slot;
+    atomic_fetch_add_explicit(&imp->delivered, 1, memory_order_relaxed);
+    return (ssize_t)copied;
+}
+
+int impair_wait_ms(const impair_t* imp, int timeout_ms) {
+    if (imp->held == 0) return timeout_ms;
+    int64_t wait_ns = imp->packets[imp->heap[0]].release_ns - impair_now_ns();
+    int wait_ms = wait_ns > 0 ? (int)((wait_ns + 999999) / 1000000) : 0;
+    return timeout_ms >= 0 && timeout_ms < wait_ms ? timeout_ms : wait_ms;
+}
+
+void impair_get_stats(const impair_t* imp, vban_impair_stats_t* stats) {
+    stats->received = atomic_load_explicit(&imp->received, memory_order_relaxed);
+    stats->delivered = atomic_load_explicit(&imp->delivered, memory_order_relaxed);
+    stats->lost_random = atomic_load_explicit(&imp->lost_random, memory_order_relaxed);
+    stats->lost_burst = atomic_load_explicit(&imp->lost_burst, memory_order_relaxed);
+    stats->lost_queue = atomic_load_explicit(&imp->lost_queue, memory_order_relaxed);
+    stats->reordered = atomic_load_explicit(&imp->reordered, memory_order_relaxed);
+    stats->duplicated = atomic_load_explicit(&imp->duplicated, memory_order_relaxed);
+}
@@ -0,0 +1,92 @@
+#ifndef VBAN4MAC_IMPAIR_H
+#define VBAN4MAC_IMPAIR_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "../include/vban4mac/types.h"
+
+// Simulated bad network between a receive socket and its packet handling.
+// impair_recvmsg() stands in for recvmsg(): it drains the socket into a
+// queue, drops, delays, reorders and duplicates what it took according to
+// the config, and returns the next packet that is due, with its simulated
+// arrival time as the receive timestamp. Every decision is drawn from a
+// seeded generator in arrival order, a fixed number of draws per packet, so
+// a run repeats exactly with the same seed and traffic. One thread only.
+
+#define IMPAIR_MAX_HELD 512         // Packets in flight on the simulated link
+
+typedef struct {
+    int64_t release_ns;             // Simulated arrival
+    uint64_t order;                 // Arrival order, breaks ties
+    size_t len;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint8_t data[VBAN_MAX_PACKET_SIZE];
+} impair_packet_t;
+
+typedef struct {
+    vban_impair_config_t config;
+    unsigned rng;
+    int burst;                      // Gilbert-Elliott state: 1 while the link is bad
+    int64_t link_free_ns;           // Rate limit: when the link has sent what is queued
+    uint64_t order;
+    impair_packet_t* packets;       // IMPAIR_MAX_HELD slots
+    int heap[IMPAIR_MAX_HELD];      // Held slots, earliest release first
+    int held;
+    int free_slots[IMPAIR_MAX_HELD];
+    int free_count;
+
+    atomic_uint_fast64_t received;
+    atomic_uint_fast64_t delivered;
+    atomic_uint_fast64_t lost_random;
+    atomic_uint_fast64_t lost_burst;
+    atomic_uint_fast64_t lost_queue;
+    atomic_uint_fast64_t reordered;
+    atomic_uint_fast64_t duplicated;
+} impair_t;
+
+/**
+ * Whether a config asks for any impairment
+ */
+int impair_active(const vban_impair_config_t* config);
+
+/**
+ * Set up a simulated link
+ * @param imp Link to initialize
+ * @param config Impairments; the seed is offset by seed_offset
+ * @param seed_offset Added to the seed, so several links on one config differ
+ * @return 0 on success, -1 on error
+ */
+int impair_init(impair_t* imp, const vban_impair_config_t* config, unsigned seed_offset);
+
+/**
+ * Free the link, discarding held packets
+ */
+void impair_destroy(impair_t* imp);
+
+/**
+ * recvmsg() through the simulated link, never blocking
+ * @param imp The link
+ * @param socket Socket to drain
+ * @param msg As for recvmsg(); the name, data and (if there is room) an
+ *            SCM_TIMESTAMPNS/SCM_TIMESTAMP control message are filled in
+ * @return Bytes received, or -1 with errno EAGAIN when nothing is due
+ */
+ssize_t impair_recvmsg(impair_t* imp, int socket, struct msghdr* msg);
+
+/**
+ * How long to wait for the socket before a held packet is due
+ * @param imp The link
+ * @param timeout_ms Caller's timeout (-1 = forever)
+ * @return The shorter of the two in milliseconds, -1 for forever
+ */
+int impair_wait_ms(const impair_t* imp, int timeout_ms);
+
+/**
+ * What the link has done so far; safe from any thread
+ */
+void impair_get_stats(const impair_t* imp, vban_impair_stats_t* stats);
+
+#endif /* VBAN4MAC_IMPAIR_H */
@@ -0,0 +1,141 @@
+#include <math.h>
+#include <string.h>
+#include "jitter.h"
+
+#define JITTER_GAIN (1.0 / 16.0)        // RFC 3550 smoothing
+#define JITTER_MAX_JUMP 1000            // Packets of counter jump treated as a restart
+#define JITTER_BURST_FRACTION 4         // Packets closer than interval/4 are back-to-back
+#define JITTER_BURST_MIN 3              // Back-to-back packets that make a burst
+#define JITTER_PEAK_DECAY 0.999         // Per packet, ~1 s time constant at 5 ms packets
+#define JITTER_SPREAD 4.0               // Multiples of J to cover in the playout target
+
+void jitter_init(jitter_estimator_t* jitter) {
+    memset(jitter, 0, sizeof(*jitter));
+    atomic_init(&jitter->seq, 0);
+}
+
+// Restart measurement for a new packet interval, keeping the published
+// snapshot until the next update
+static void jitter_restart(jitter_estimator_t* jitter, int64_t arrival_ns, uint32_t index,
+                           int64_t interval_ns, int sample_rate) {
+    jitter->interval_ns = interval_ns;
+    jitter->sample_rate = sample_rate;
+    jitter->last_arrival_ns = arrival_ns;
+    jitter->last_index = index;
+    jitter->jitter_ns = 0.0;
+    jitter->gap_peak_ns = (double)interval_ns;
+    jitter->run = 0;
+}
+
+static void jitter_end_run(jitter_estimator_t* jitter) {
+    int burst = jitter->run + 1;
+    if (burst >= JITTER_BURST_MIN) {
+        jitter->bursts++;
+        if ((uint32_t)burst > jitter->max_burst) jitter->max_burst = (uint32_t)burst;
+    }
+    jitter->run = 0;
+}
+
+static void jitter_publish(jitter_estimator_t* jitter) {
+    double interval = (double)jitter->interval_ns;
+    double spread = interval + JITTER_SPREAD * jitter->jitter_ns;
+    double target_ns = (jitter->gap_peak_ns > spread ? jitter->gap_peak_ns : spread) + interval;
+    uint32_t target_frames = (uint32_t)ceil(target_ns * jitter->sample_rate / 1e9);
+
+    unsigned seq = atomic_load_explicit(&jitter->seq, memory_order_relaxed);
+    atomic_store_explicit(&jitter->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&jitter->pub_packets, jitter->packets, memory_order_relaxed);
+    atomic_store_explicit(&jitter->pub_jitter_ms, jitter->jitter_ns / 1e6, memory_order_relaxed);
+    atomic_store_explicit(&jitter->pub_max_gap_ms, jitter->max_gap_ns / 1e6, memory_order_relaxed);
+    atomic_store_explicit(&jitter->pub_bursts, jitter->bursts, memory_order_relaxed);
+    atomic_store_explicit(&jitter->pub_max_burst, jitter->max_burst, memory_order_relaxed);
+    atomic_store_explicit(&jitter->pub_target_frames, target_frames, memory_order_relaxed);
+    atomic_store_explicit(&jitter->pub_lost_packets, jitter->lost_packets, memory_order_relaxed);
+    atomic_store_explicit(&jitter->pub_silent_packets, jitter->silent_packets, memory_order_relaxed);
+
+    atomic_store_explicit(&jitter->seq, seq + 2, memory_order_release);
+}
+
+void jitter_update(jitter_estimator_t* jitter, int64_t arrival_ns, uint32_t index, int frames, int sample_rate,
+                   int silent) {
+    if (frames <= 0 || sample_rate <= 0) return;
+
+    int64_t interval_ns = (int64_t)frames * 1000000000LL / sample_rate;
+    int32_t step = (int32_t)(index - jitter->last_index);
+    int after_silence = jitter->last_silent;
+    jitter->packets++;
+
+    // Suppressed silence can last longer than any plausible loss
+    if (interval_ns != jitter->interval_ns || sample_rate != jitter->sample_rate ||
+        step <= -JITTER_MAX_JUMP || (step > JITTER_MAX_JUMP && !after_silence)) {
+        // First packet, format change or sender restart
+        jitter_restart(jitter, arrival_ns, index, interval_ns, sample_rate);
+        jitter->last_silent = silent;
+        jitter_publish(jitter);
+        return;
+    }
+    if (step <= 0) {
+        return;  // Duplicate or reordered packet, already accounted for
+    }
+    jitter->last_silent = silent;
+
+    if (step > 1 && after_silence) {
+        // The sender stopped sending silence: resume timing from here
+        jitter->silent_packets += (uint32_t)(step - 1);
+        jitter_end_run(jitter);
+        jitter->last_arrival_ns = arrival_ns;
+        jitter->last_index = index;
+        jitter_publish(jitter);
+        return;
+    }
+    if (step > 1) {
+        jitter->lost_packets += (uint32_t)(step - 1);
+    }
+
+    // D(i-1,i) = (Rj - Ri) - (Sj - Si), with the send time implied by the counter
+    int64_t gap_ns = arrival_ns - jitter->last_arrival_ns;
+    double d = (double)(gap_ns - (int64_t)step * interval_ns);
+    jitter->jitter_ns += (fabs(d) - jitter->jitter_ns) * JITTER_GAIN;
+
+    // Gap per packet, so a lost packet doesn't look like a stall
+    double gap_per_packet = (double)gap_ns / step;
+    if (gap_per_packet > jitter->max_gap_ns) jitter->max_gap_ns = gap_per_packet;
+    jitter->gap_peak_ns *= JITTER_PEAK_DECAY;
+    if ((double)gap_ns > jitter->gap_peak_ns) jitter->gap_peak_ns = (double)gap_ns;
+
+    // Packets arriving back to back after a stall form a burst
+    if (step == 1 && gap_ns < interval_ns / JITTER_BURST_FRACTION) {
+        jitter->run++;
+    } else {
+        jitter_end_run(jitter);
+    }
+
+    jitter->last_arrival_ns = arrival_ns;
+    jitter->last_index = index;
+    jitter_publish(jitter);
+}
+
+void jitter_get_stats(const jitter_estimator_t* jitter, vban_jitter_stats_t* stats) {
+    jitter_estimator_t* j = (jitter_estimator_t*)jitter;
+    unsigned before, after;
+
+    do {
+        before = atomic_load_explicit(&j->seq, memory_order_acquire);
+        stats->packets = atomic_load_explicit(&j->pub_packets, memory_order_relaxed);
+        stats->jitter_ms = atomic_load_explicit(&j->pub_jitter_ms, memory_order_relaxed);
+        stats->max_gap_ms = atomic_load_explicit(&j->pub_max_gap_ms, memory_order_relaxed);
+        stats->bursts = atomic_load_explicit(&j->pub_bursts, memory_order_relaxed);
+        stats->max_burst_packets = atomic_load_explicit(&j->pub_max_burst, memory_order_relaxed);
+        stats->target_frames = atomic_load_explicit(&j->pub_target_frames, memory_order_relaxed);
+        stats->lost_packets = atomic_load_explicit(&j->pub_lost_packets, memory_order_relaxed);
+        stats->silent_packets = atomic_load_explicit(&j->pub_silent_packets, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&j->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+uint32_t jitter_target_frames(const jitter_estimator_t* jitter) {
+    return atomic_load_explicit(&((jitter_estimator_t*)jitter)->pub_target_frames, memory_order_relaxed);
+}
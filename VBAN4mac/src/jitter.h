@@ -0,0 +1,76 @@
+#ifndef VBAN4MAC_JITTER_H
+#define VBAN4MAC_JITTER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "../include/vban4mac/types.h"
+
+// RFC 3550 interarrival jitter estimator with a burst detector for one
+// stream. Updated by the receiving thread from kernel receive timestamps;
+// the statistics are seqlock-published so any thread can read them.
+typedef struct {
+    // Receiving-thread state
+    int64_t interval_ns;            // Expected packet interval, 0 until the first packet
+    int sample_rate;
+    int64_t last_arrival_ns;
+    uint32_t last_index;
+    double jitter_ns;               // Smoothed |D| (RFC 3550 J)
+    double gap_peak_ns;             // Decaying maximum interarrival gap
+    double max_gap_ns;
+    int run;                        // Packets in the current back-to-back run
+    uint32_t bursts;
+    uint32_t max_burst;
+    uint64_t packets;
+    uint64_t lost_packets;
+    uint64_t silent_packets;
+    int last_silent;                // Last packet's payload was silence
+
+    // Published snapshot
+    atomic_uint seq;                // Odd while a snapshot is being written
+    _Atomic uint64_t pub_packets;
+    _Atomic double pub_jitter_ms;
+    _Atomic double pub_max_gap_ms;
+    _Atomic uint32_t pub_bursts;
+    _Atomic uint32_t pub_max_burst;
+    _Atomic uint32_t pub_target_frames;
+    _Atomic uint64_t pub_lost_packets;
+    _Atomic uint64_t pub_silent_packets;
+} jitter_estimator_t;
+
+/**
+ * Reset an estimator to its initial state
+ * @param jitter Estimator to initialize
+ */
+void jitter_init(jitter_estimator_t* jitter);
+
+/**
+ * Account for one received packet. The estimator restarts when the packet
+ * size or sample rate changes, or the frame counter jumps. A counter gap
+ * right after a silent packet is taken as the sender suppressing silence
+ * (see dtx.h): it is counted separately from loss and timing resumes with
+ * this packet instead of measuring the gap as a stall.
+ * @param jitter The estimator
+ * @param arrival_ns Receive timestamp in nanoseconds
+ * @param index Packet counter from the sender (nuFrame)
+ * @param frames Samples per channel in the packet
+ * @param sample_rate Stream sample rate in Hz
+ * @param silent Whether the packet's payload is silence (dtx_is_silent)
+ */
+void jitter_update(jitter_estimator_t* jitter, int64_t arrival_ns, uint32_t index, int frames, int sample_rate,
+                   int silent);
+
+/**
+ * Read the latest published statistics (any thread)
+ * @param jitter The estimator
+ * @param stats Filled with the statistics
+ */
+void jitter_get_stats(const jitter_estimator_t* jitter, vban_jitter_stats_t* stats);
+
+/**
+ * Playout buffer size that should ride out the measured jitter and bursts
+ * @param jitter The estimator
+ * @return Frames to keep buffered, 0 until packets have been measured
+ */
+uint32_t jitter_target_frames(const jitter_estimator_t* jitter);
+
+#endif /* VBAN4MAC_JITTER_H */
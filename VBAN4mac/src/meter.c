@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <math.h>
+#include "meter.h"
+
+#define METER_RMS_WINDOW 0.3         // Seconds
+#define METER_PEAK_FALL_DB 20.0      // dB per second
+
+int audio_meter_init(audio_meter_t* meter, int channels, double sample_rate) {
+    meter->channels = channels;
+    meter->sample_rate = sample_rate;
+    atomic_init(&meter->seq, 0);
+    meter->published = calloc((size_t)channels * 2, sizeof(*meter->published));
+    meter->peak = calloc(channels, sizeof(float));
+    meter->mean_square = calloc(channels, sizeof(float));
+    if (!meter->published || !meter->peak || !meter->mean_square) {
+        audio_meter_destroy(meter);
+        return -1;
+    }
+    for (int i = 0; i < channels * 2; i++) {
+        atomic_init(&meter->published[i], 0.0f);
+    }
+    return 0;
+}
+
+void audio_meter_destroy(audio_meter_t* meter) {
+    free(meter->published);
+    free(meter->peak);
+    free(meter->mean_square);
+    meter->published = NULL;
+    meter->peak = NULL;
+    meter->mean_square = NULL;
+    meter->channels = 0;
+}
+
+static void meter_reduce_int16(const int16_t* x, size_t n, audio_meter_block_t* block) {
+    int32_t max_lane[METER_LANES] = {0};
+    float sum_lane[METER_LANES] = {0};
+    size_t i = 0;
+
+    for (; i + METER_LANES <= n; i += METER_LANES) {
+        for (int l = 0; l < METER_LANES; l++) {
+            int32_t v = x[i + l];
+            int32_t a = v < 0 ? -v : v;
+            max_lane[l] = a > max_lane[l] ? a : max_lane[l];
+            sum_lane[l] += (float)v * (float)v;
+        }
+    }
+    for (; i < n; i++) {
+        int32_t v = x[i];
+        int32_t a = v < 0 ? -v : v;
+        max_lane[0] = a > max_lane[0] ? a : max_lane[0];
+        sum_lane[0] += (float)v * (float)v;
+    }
+
+    int32_t max = 0;
+    float sum = 0.0f;
+    for (int l = 0; l < METER_LANES; l++) {
+        max = max_lane[l] > max ? max_lane[l] : max;
+        sum += sum_lane[l];
+    }
+    block->peak = max / 32768.0f;
+    block->sum_sq = sum / (32768.0f * 32768.0f);
+}
+
+static void meter_reduce_float(const float* x, size_t n, audio_meter_block_t* block) {
+    float max_lane[METER_LANES] = {0};
+    float sum_lane[METER_LANES] = {0};
+    size_t i = 0;
+
+    for (; i + METER_LANES <= n; i += METER_LANES) {
+        for (int l = 0; l < METER_LANES; l++) {
+            float v = x[i + l];
+            max_lane[l] = fmaxf(max_lane[l], fabsf(v));
+            sum_lane[l] += v * v;
+        }
+    }
+    for (; i < n; i++) {
+        max_lane[0] = fmaxf(max_lane[0], fabsf(x[i]));
+        sum_lane[0] += x[i] * x[i];
+    }
+
+    float max = 0.0f, sum = 0.0f;
+    for (int l = 0; l < METER_LANES; l++) {
+        max = fmaxf(max, max_lane[l]);
+        sum += sum_lane[l];
+    }
+    block->peak = max;
+    block->sum_sq = sum;
+}
+
+void audio_meter_publish(audio_meter_t* meter, const audio_meter_block_t* blocks, size_t frames) {
+    if (!meter->published || frames == 0) return;
+
+    double seconds = frames / meter->sample_rate;
+    float rms_coeff = (float)(1.0 - exp(-seconds / METER_RMS_WINDOW));
+    float peak_fall = (float)pow(10.0, -METER_PEAK_FALL_DB * seconds / 20.0);
+
+    unsigned seq = atomic_load_explicit(&meter->seq, memory_order_relaxed);
+    atomic_store_explicit(&meter->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (int ch = 0; ch < meter->channels; ch++) {
+        float fallen = meter->peak[ch] * peak_fall;
+        meter->peak[ch] = blocks[ch].peak > fallen ? blocks[ch].peak : fallen;
+        meter->mean_square[ch] += rms_coeff * (blocks[ch].sum_sq / frames - meter->mean_square[ch]);
+
+        atomic_store_explicit(&meter->published[ch * 2], meter->peak[ch], memory_order_relaxed);
+        atomic_store_explicit(&meter->published[ch * 2 + 1], sqrtf(meter->mean_square[ch]),
+                              memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&meter->seq, seq + 2, memory_order_release);
+}
+
+void audio_meter_update_int16(audio_meter_t* meter, const int16_t* const* channels, size_t frames) {
+    if (!meter->published || frames == 0) return;
+
+    audio_meter_block_t blocks[meter->channels];
+    for (int ch = 0; ch < meter->channels; ch++) {
+        meter_reduce_int16(channels[ch], frames, &blocks[ch]);
+    }
+    audio_meter_publish(meter, blocks, frames);
+}
+
+void audio_meter_update_float(audio_meter_t* meter, const float* const* channels, size_t frames) {
+    if (!meter->published || frames == 0) return;
+
+    audio_meter_block_t blocks[meter->channels];
+    for (int ch = 0; ch < meter->channels; ch++) {
+        meter_reduce_float(channels[ch], frames, &blocks[ch]);
+    }
+    audio_meter_publish(meter, blocks, frames);
+}
+
+int audio_meter_read(const audio_meter_t* meter, vban_level_t* levels, int max_channels) {
+    if (!meter->published) return 0;
+
+    int channels = meter->channels < max_channels ? meter->channels : max_channels;
+    audio_meter_t* m = (audio_meter_t*)meter;
+    unsigned before, after;
+
+    do {
+        before = atomic_load_explicit(&m->seq, memory_order_acquire);
+        for (int ch = 0; ch < channels; ch++) {
+            levels[ch].peak = atomic_load_explicit(&m->published[ch * 2], memory_order_relaxed);
+            levels[ch].rms = atomic_load_explicit(&m->published[ch * 2 + 1], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    return channels;
+}
@@ -0,0 +1,78 @@
+#ifndef VBAN4MAC_METER_H
+#define VBAN4MAC_METER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "../include/vban4mac/types.h"
+
+#define METER_LANES 8                // Independent accumulators so reductions vectorize
+
+// Peak and sum of squares of one channel's block, full scale 1.0. The
+// conversion loops in sample.c fill these while they touch the samples,
+// so a block that is converted anyway is not read a second time to meter it.
+typedef struct {
+    float peak;
+    float sum_sq;
+} audio_meter_block_t;
+
+// Per-channel level meter, written by one audio thread and readable from
+// any thread without locks (seqlock-published snapshot)
+typedef struct {
+    int channels;
+    double sample_rate;
+    atomic_uint seq;                // Odd while a snapshot is being written
+    _Atomic float* published;       // peak, rms pairs per channel
+    float* peak;                    // Writer-side ballistics state
+    float* mean_square;
+} audio_meter_t;
+
+/**
+ * Allocate a meter
+ * @param meter Meter to initialize
+ * @param channels Number of channels
+ * @param sample_rate Sample rate used for the meter ballistics
+ * @return 0 on success, -1 on error
+ */
+int audio_meter_init(audio_meter_t* meter, int channels, double sample_rate);
+
+/**
+ * Free a meter
+ * @param meter Meter to destroy
+ */
+void audio_meter_destroy(audio_meter_t* meter);
+
+/**
+ * Fold one block per channel, already reduced, into the meter and publish
+ * a new snapshot. Must only be called from the thread that owns the meter.
+ * @param meter The meter
+ * @param blocks One reduction per channel (meter->channels entries)
+ * @param frames Number of samples each block covered
+ */
+void audio_meter_publish(audio_meter_t* meter, const audio_meter_block_t* blocks, size_t frames);
+
+/**
+ * Reduce and publish one block of int16 samples per channel, for blocks no
+ * conversion loop passes over. Must only be called from the thread that
+ * owns the meter.
+ * @param meter The meter
+ * @param channels One sample array per channel (meter->channels entries)
+ * @param frames Number of samples in each array
+ */
+void audio_meter_update_int16(audio_meter_t* meter, const int16_t* const* channels, size_t frames);
+
+/**
+ * Same as audio_meter_update_int16 for float samples
+ */
+void audio_meter_update_float(audio_meter_t* meter, const float* const* channels, size_t frames);
+
+/**
+ * Read the latest snapshot. Safe from any thread at any rate.
+ * @param meter The meter
+ * @param levels Destination, one entry per channel
+ * @param max_channels Capacity of levels
+ * @return Number of channels written
+ */
+int audio_meter_read(const audio_meter_t* meter, vban_level_t* levels, int max_channels);
+
+#endif /* VBAN4MAC_METER_H */
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+#include "net_util.h"
+
+int net_family_of(const char* ip) {
+    return (ip && strchr(ip, ':')) ? AF_INET6 : AF_INET;
+}
+
+// Big-endian word at p, as BPF loads it
+static uint32_t net_load_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+int net_steering_worker(const struct sockaddr_storage* sender, const char* stream_name, int workers) {
+    uint32_t hash = 0;
+
+    // IPv4 senders hash their address whether they reach an IPv4 socket or
+    // a dual-stack IPv6 one, like the program sees their IPv4 header
+    if (sender->ss_family == AF_INET) {
+        hash = net_load_be32((const uint8_t*)&((const struct sockaddr_in*)sender)->sin_addr);
+    } else {
+        const struct in6_addr* addr = &((const struct sockaddr_in6*)sender)->sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(addr)) {
+            hash = net_load_be32(addr->s6_addr + 12);
+        } else {
+            for (int i = 0; i < 16; i += 4) hash ^= net_load_be32(addr->s6_addr + i);
+        }
+    }
+
+    uint8_t name[16] = {0};
+    memcpy(name, stream_name, strnlen(stream_name, sizeof(name)));
+    for (int i = 0; i < 16; i += 4) hash ^= net_load_be32(name + i);
+
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+    return (int)(hash % (uint32_t)workers);
+}
+
+#ifdef __linux__
+// Hash the sender address (from the IP header) and the stream name
+// (payload bytes 8..23) into a socket index, as net_steering_worker does
+int net_attach_steering(int socket, int workers) {
+    struct sock_filter code[] = {
+        // IP version
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 4, 0, 2),
+        // IPv4 source address
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12),
+        BPF_JUMP(BPF_JMP | BPF_JA, 10, 0, 0),
+        // IPv6 source address, its four words folded together
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 8),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 20),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        // Stream name
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 8),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 12),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 20),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        // Fold all four bytes into the low bits
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 8),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)workers),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+
+    if (setsockopt(socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        perror("Failed to attach SO_REUSEPORT steering program");
+        return -1;
+    }
+    return 0;
+}
+
+int net_port_is_free(int family, const struct sockaddr_storage* local_addr, socklen_t local_len) {
+    // Without SO_REUSEPORT the bind fails if any socket holds the port
+    int sock = socket(family, SOCK_DGRAM, 0);
+    if (sock < 0) return 0;
+    if (family == AF_INET6) {
+        int v6only = 0;
+        setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+    }
+    int is_free = bind(sock, (const struct sockaddr*)local_addr, local_len) == 0;
+    close(sock);
+    return is_free;
+}
+#endif
+
+int net_parse_addr(const char* ip, uint16_t port, int family,
+                   struct sockaddr_storage* addr, socklen_t* addr_len) {
+    memset(addr, 0, sizeof(*addr));
+
+    if (family == AF_INET) {
+        struct sockaddr_in* sin = (struct sockaddr_in*)addr;
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        *addr_len = sizeof(*sin);
+        if (!ip || !ip[0]) {
+            sin->sin_addr.s_addr = INADDR_ANY;
+            return 0;
+        }
+        return inet_pton(AF_INET, ip, &sin->sin_addr) == 1 ? 0 : -1;
+    }
+
+    struct sockaddr_in6* sin6 = (struct sockaddr_in6*)addr;
+    sin6->sin6_family = AF_INET6;
+    sin6->sin6_port = htons(port);
+    *addr_len = sizeof(*sin6);
+    if (!ip || !ip[0]) {
+        sin6->sin6_addr = in6addr_any;
+        return 0;
+    }
+    if (inet_pton(AF_INET6, ip, &sin6->sin6_addr) == 1) {
+        return 0;
+    }
+
+    struct in_addr v4;
+    if (inet_pton(AF_INET, ip, &v4) != 1) {
+        return -1;
+    }
+    sin6->sin6_addr.s6_addr[10] = 0xff;
+    sin6->sin6_addr.s6_addr[11] = 0xff;
+    memcpy(&sin6->sin6_addr.s6_addr[12], &v4, sizeof(v4));
+    return 0;
+}
+
+int net_addr_equal(const struct sockaddr_storage* a, const struct sockaddr_storage* b) {
+    if (a->ss_family != b->ss_family) {
+        return 0;
+    }
+    if (a->ss_family == AF_INET) {
+        return ((const struct sockaddr_in*)a)->sin_addr.s_addr ==
+               ((const struct sockaddr_in*)b)->sin_addr.s_addr;
+    }
+    return memcmp(&((const struct sockaddr_in6*)a)->sin6_addr,
+                  &((const struct sockaddr_in6*)b)->sin6_addr, sizeof(struct in6_addr)) == 0;
+}
+
+int net_open_udp_socket(int family, const struct sockaddr_storage* local_addr, socklen_t local_len) {
+    // Create UDP socket
+    int sock = socket(family, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("Failed to create socket");
+        return -1;
+    }
+
+    // Add socket options to reuse address AND port
+    int reuse = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+        perror("Failed to set SO_REUSEADDR");
+        close(sock);
+        return -1;
+    }
+    
+    // Add SO_REUSEPORT option
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        perror("Failed to set SO_REUSEPORT");
+        close(sock);
+        return -1;
+    }
+
+    // Accept IPv4 peers on IPv6 sockets (dual-stack)
+    if (family == AF_INET6) {
+        int v6only = 0;
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) < 0) {
+            perror("Failed to clear IPV6_V6ONLY");
+            close(sock);
+            return -1;
+        }
+    }
+
+    if (bind(sock, (const struct sockaddr*)local_addr, local_len) < 0) {
+        perror("Failed to bind socket");
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+int net_enable_rx_timestamps(int socket) {
+    int on = 1;
+#ifdef SO_TIMESTAMPNS
+    if (setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0) return 0;
+#endif
+    if (setsockopt(socket, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) < 0) {
+        perror("Failed to enable receive timestamps");
+        return -1;
+    }
+    return 0;
+}
+
+int64_t net_rx_timestamp_ns(const struct msghdr* msg) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR((struct msghdr*)msg); cmsg;
+         cmsg = CMSG_NXTHDR((struct msghdr*)msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) continue;
+#ifdef SCM_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        }
+#endif
+        if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+            struct timeval tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            return (int64_t)tv.tv_sec * 1000000000LL + (int64_t)tv.tv_usec * 1000;
+        }
+    }
+
+    // No kernel timestamp (e.g. the control buffer was too small)
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
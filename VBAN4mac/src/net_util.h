@@ -0,0 +1,88 @@
+#ifndef VBAN4MAC_NET_UTIL_H
+#define VBAN4MAC_NET_UTIL_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/**
+ * Address family to use for an IP literal
+ * @param ip IPv4 or IPv6 literal, may be NULL
+ * @return AF_INET6 if ip looks like IPv6, AF_INET otherwise
+ */
+int net_family_of(const char* ip);
+
+/**
+ * Parse an IPv4 or IPv6 literal. IPv4 is mapped into IPv6 for AF_INET6.
+ * @param ip Address literal, NULL or empty for the wildcard address
+ * @param port UDP port
+ * @param family Socket family the address will be used with
+ * @param addr Filled with the address
+ * @param addr_len Filled with the address length
+ * @return 0 on success, -1 on error
+ */
+int net_parse_addr(const char* ip, uint16_t port, int family,
+                   struct sockaddr_storage* addr, socklen_t* addr_len);
+
+/**
+ * Compare the host part of two addresses of the same family
+ * @return 1 if equal, 0 otherwise
+ */
+int net_addr_equal(const struct sockaddr_storage* a, const struct sockaddr_storage* b);
+
+/**
+ * Create a UDP socket with SO_REUSEADDR/SO_REUSEPORT (dual-stack for
+ * AF_INET6) and bind it
+ * @return Socket on success, -1 on error
+ */
+int net_open_udp_socket(int family, const struct sockaddr_storage* local_addr, socklen_t local_len);
+
+// Control buffer size for recvmsg() with receive timestamps enabled
+#define NET_TIMESTAMP_CONTROL_SIZE 64
+
+/**
+ * Ask the kernel to timestamp received datagrams (SO_TIMESTAMPNS on
+ * Linux, SO_TIMESTAMP elsewhere)
+ * @return 0 on success, -1 on error
+ */
+int net_enable_rx_timestamps(int socket);
+
+/**
+ * Receive timestamp of a datagram, from its control messages if the kernel
+ * attached one and the current time otherwise
+ * @param msg Message filled in by recvmsg()
+ * @return Nanoseconds since the epoch
+ */
+int64_t net_rx_timestamp_ns(const struct msghdr* msg);
+
+/**
+ * Socket a steering program attached with net_attach_steering picks for a
+ * sender's stream, computed the same way in user space
+ * @param sender Sender address as received
+ * @param stream_name VBAN stream name (max 16 chars)
+ * @param workers Number of sockets in the group
+ * @return Socket index, 0 to workers - 1
+ */
+int net_steering_worker(const struct sockaddr_storage* sender, const char* stream_name, int workers);
+
+#ifdef __linux__
+/**
+ * Attach a reuseport steering program to a socket's SO_REUSEPORT group so
+ * that every datagram of a (sender address, stream name) pair always lands
+ * on the same socket. Sockets are numbered in the order they joined the
+ * group, so the group must not hold anyone else's sockets.
+ * @param socket Any socket of the group
+ * @param workers Number of sockets in the group
+ * @return 0 on success, -1 on error
+ */
+int net_attach_steering(int socket, int workers);
+
+/**
+ * Whether no socket is bound to an address and port yet, i.e. a reuseport
+ * group created there starts empty
+ * @return 1 if the port is free, 0 otherwise
+ */
+int net_port_is_free(int family, const struct sockaddr_storage* local_addr, socklen_t local_len);
+#endif
+
+#endif /* VBAN4MAC_NET_UTIL_H */
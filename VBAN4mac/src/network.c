@@ -1,154 +1,630 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
-#include <libkern/OSByteOrder.h>
+#include <sys/uio.h>
 #include "../include/vban4mac/vban.h"
 #include "network.h"
-#include "audio.h"
+#include "trace.h"
+#include "net_util.h"
+#include "packet.h"
+#include "sample.h"
+#include "shm_output.h"
+#include "event_loop.h"
 #include "../include/vban4mac/types.h"
 
-// Global audio buffers
-extern audio_buffer_t g_input_buffer;
+#define NETWORK_RX_BURST 64          // Datagrams per readiness callback
+#define NETWORK_SEND_TICK_US 2000    // Send timer period, under one 256-sample packet
+#define NETWORK_IMPAIR_TICK_US 1000  // Release check for packets held by the impairment
 
-int network_init_with_port(vban_context_t* ctx, const char* remote_ip, uint16_t port) {
-    // Create UDP socket
-    ctx->socket = socket(AF_INET, SOCK_DGRAM, 0);
-    if (ctx->socket < 0) {
-        perror("Failed to create socket");
-        return -1;
+// Receive ports and event loops shared by every context in the process
+static pthread_mutex_t loops_mutex = PTHREAD_MUTEX_INITIALIZER;
+static network_rx_port_t* ports = NULL;
+static event_loop_t* loops[VBAN_MAX_EVENT_THREADS];
+static int num_loops = 0;
+static int loop_users = 0;
+static int next_loop = 0;
+
+static void network_on_readable(void* arg);
+
+// Whether two local addresses are the same address and port
+static int network_same_local(const struct sockaddr_storage* a, const struct sockaddr_storage* b) {
+    if (!net_addr_equal(a, b)) return 0;
+    if (a->ss_family == AF_INET) {
+        return ((const struct sockaddr_in*)a)->sin_port == ((const struct sockaddr_in*)b)->sin_port;
     }
+    return ((const struct sockaddr_in6*)a)->sin6_port == ((const struct sockaddr_in6*)b)->sin6_port;
+}
 
-    // Add socket options to reuse address AND port
-    int reuse = 1;
-    if (setsockopt(ctx->socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
-        perror("Failed to set SO_REUSEADDR");
-        close(ctx->socket);
-        return -1;
+static void network_close_port(network_rx_port_t* port) {
+    for (int i = 0; i < port->num_workers; i++) {
+        network_rx_worker_t* worker = &port->workers[i];
+        close(worker->socket);
+        if (worker->impair) {
+            impair_destroy(worker->impair);
+            free(worker->impair);
+        }
     }
-    
-    // Add SO_REUSEPORT option
-    if (setsockopt(ctx->socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
-        perror("Failed to set SO_REUSEPORT");
-        close(ctx->socket);
-        return -1;
+    free(port);
+}
+
+// Bind a port's worker sockets (called with loops_mutex held)
+static network_rx_port_t* network_open_port(int family, const struct sockaddr_storage* local_addr,
+                                            socklen_t local_len, uint16_t number, int workers) {
+#ifdef __linux__
+    // Steering numbers sockets by the order they joined the reuseport
+    // group, so nobody else's socket may be in it
+    if (workers > 1 && !net_port_is_free(family, local_addr, local_len)) {
+        fprintf(stderr, "Port %u is already in use; multiple receive workers need it to themselves\n", number);
+        return NULL;
+    }
+#else
+    (void)number;
+#endif
+
+    network_rx_port_t* port = calloc(1, sizeof(network_rx_port_t));
+    if (!port) return NULL;
+    port->local_addr = *local_addr;
+    port->local_len = local_len;
+
+    for (int i = 0; i < workers; i++) {
+        int sock = net_open_udp_socket(family, local_addr, local_len);
+        if (sock < 0) {
+            network_close_port(port);
+            return NULL;
+        }
+        network_rx_worker_t* worker = &port->workers[i];
+        worker->port = port;
+        worker->index = i;
+        worker->socket = sock;
+        for (int j = 0; j < NETWORK_MAX_WORKER_STREAMS; j++) atomic_init(&worker->streams[j], NULL);
+        atomic_init(&worker->packets, 0);
+        net_enable_rx_timestamps(sock);  // Optional, jitter falls back to user-space time
+        port->num_workers = i + 1;
+    }
+
+#ifdef __linux__
+    if (workers > 1 && net_attach_steering(port->workers[0].socket, workers) != 0) {
+        network_close_port(port);
+        return NULL;
     }
+#endif
+
+    port->next = ports;
+    ports = port;
+    return port;
+}
+
+int network_init_with_options(vban_context_t* ctx, const char* remote_ip, const char* bind_ip,
+                              uint16_t port, int rx_workers) {
+    if (rx_workers < 1) rx_workers = 1;
+    if (rx_workers > VBAN_MAX_RX_WORKERS) rx_workers = VBAN_MAX_RX_WORKERS;
+#ifndef __linux__
+    if (rx_workers > 1) {
+        // Without a steering program a stream could hop between workers
+        printf("Multiple receive workers are only supported on Linux, using 1\n");
+        rx_workers = 1;
+    }
+#endif
+
+    // Bind family follows the bind address, or the remote address if none given
+    const char* family_ip = (bind_ip && bind_ip[0]) ? bind_ip : remote_ip;
+    int family = net_family_of(family_ip);
 
     // Configure remote address (VoiceMeeter)
-    ctx->remote_addr.sin_family = AF_INET;
-    ctx->remote_addr.sin_port = htons(port);
-    if (inet_pton(AF_INET, remote_ip, &ctx->remote_addr.sin_addr) != 1) {
-        perror("Failed to set remote IP");
-        close(ctx->socket);
+    if (net_parse_addr(remote_ip, port, family, &ctx->remote_addr, &ctx->remote_addr_len) != 0) {
+        fprintf(stderr, "Failed to set remote IP: %s\n", remote_ip);
         return -1;
     }
 
     // Configure local address for receiving
-    struct sockaddr_in local_addr = {0};
-    local_addr.sin_family = AF_INET;
-    local_addr.sin_port = htons(port);
-    local_addr.sin_addr.s_addr = INADDR_ANY;
-
-    if (bind(ctx->socket, (struct sockaddr*)&local_addr, sizeof(local_addr)) < 0) {
-        perror("Failed to bind socket");
-        close(ctx->socket);
+    struct sockaddr_storage local_addr;
+    socklen_t local_len;
+    if (net_parse_addr(bind_ip, port, family, &local_addr, &local_len) != 0) {
+        fprintf(stderr, "Failed to set bind IP: %s\n", bind_ip);
         return -1;
     }
 
+    // Contexts on one port share its sockets; the first to open it decides
+    // how many workers it has
+    pthread_mutex_lock(&loops_mutex);
+    network_rx_port_t* rx_port = ports;
+    while (rx_port && (rx_port->local_addr.ss_family != family ||
+                       !network_same_local(&rx_port->local_addr, &local_addr))) {
+        rx_port = rx_port->next;
+    }
+    if (rx_port) {
+        if (rx_port->num_workers != rx_workers) {
+            printf("Port %u already receives with %d workers, using them\n", port, rx_port->num_workers);
+        }
+    } else {
+        rx_port = network_open_port(family, &local_addr, local_len, port, rx_workers);
+    }
+    if (rx_port) rx_port->users++;
+    pthread_mutex_unlock(&loops_mutex);
+    if (!rx_port) return -1;
+
+    ctx->rx_port = rx_port;
+    ctx->socket = rx_port->workers[0].socket;
+    atomic_init(&ctx->packets_received, 0);
+    jitter_init(&ctx->jitter);
+
     return 0;
 }
 
+int network_init_with_port(vban_context_t* ctx, const char* remote_ip, uint16_t port) {
+    return network_init_with_options(ctx, remote_ip, NULL, port, 1);
+}
+
 int network_init(vban_context_t* ctx, const char* remote_ip) {
     return network_init_with_port(ctx, remote_ip, VBAN_DEFAULT_PORT);
 }
 
-void* network_receive_thread(void* arg) {
-    vban_context_t* ctx = (vban_context_t*)arg;
-    uint8_t packet[VBAN_HEADER_SIZE + VBAN_MAX_PACKET_SIZE];
+// Check a received datagram belongs to this context's stream
+// @return Number of samples in the payload, or -1 if it must be ignored
+static ssize_t network_validate_packet(vban_context_t* ctx, const vban_header_t* header,
+                                       const struct sockaddr_storage* sender_addr, ssize_t received) {
+    ssize_t total_samples = vban_header_check_audio(header, received);
+    if (total_samples < 0) {
+        return -1;
+    }
+
+    // Validate sender's IP address
+    if (!net_addr_equal(sender_addr, &ctx->remote_addr)) {
+        return -1;  // Ignore packets from unauthorized senders
+    }
 
-    while (ctx->is_running) {
-        struct sockaddr_in sender_addr;
-        socklen_t sender_len = sizeof(sender_addr);
+    // Validate stream name
+    if (strncmp(header->streamname, ctx->streamname, 16) != 0) {
+        return -1;  // Wrong stream name
+    }
 
-        ssize_t received = recvfrom(ctx->socket, packet, sizeof(packet), 0,
-                                  (struct sockaddr*)&sender_addr, &sender_len);
+    return total_samples;
+}
 
-        if (received > VBAN_HEADER_SIZE) {
-            // First validate sender's IP address
-            if (sender_addr.sin_addr.s_addr != ctx->remote_addr.sin_addr.s_addr) {
-                continue;  // Ignore packets from unauthorized senders
-            }
+// The worker's context for a datagram's sender and stream, NULL if none
+static vban_context_t* network_match_stream(network_rx_worker_t* worker, const vban_header_t* header,
+                                            const struct sockaddr_storage* sender_addr) {
+    for (int i = 0; i < NETWORK_MAX_WORKER_STREAMS; i++) {
+        vban_context_t* ctx = atomic_load_explicit(&worker->streams[i], memory_order_acquire);
+        if (ctx && net_addr_equal(sender_addr, &ctx->remote_addr) &&
+            strncmp(header->streamname, ctx->streamname, 16) == 0) {
+            return ctx;
+        }
+    }
+    return NULL;
+}
 
-            vban_header_t* header = (vban_header_t*)packet;
-            
-            // Validate VBAN magic number
-            if (ntohl(header->vban) != (('V' << 24) | ('B' << 16) | ('A' << 8) | 'N')) {
-                continue;  // Not a VBAN packet
+// The worker's context if it decodes for exactly one, NULL otherwise
+static vban_context_t* network_sole_stream(network_rx_worker_t* worker) {
+    vban_context_t* sole = NULL;
+    for (int i = 0; i < NETWORK_MAX_WORKER_STREAMS; i++) {
+        vban_context_t* ctx = atomic_load_explicit(&worker->streams[i], memory_order_acquire);
+        if (!ctx) continue;
+        if (sole) return NULL;
+        sole = ctx;
+    }
+    return sole;
+}
+
+// Where a context's next payload lands: a DSP block, or free ring storage,
+// which only becomes visible to the render callback once committed. Each
+// part of a ring region takes as many wire samples as it has room for
+// decoded ones, so they are decoded where they land. A full DSP window
+// leaves block NULL and the payload goes to scratch, to be dropped.
+static void network_rx_destination(vban_context_t* ctx, int16_t* scratch, audio_buffer_span_t* span,
+                                   dsp_block_t** block) {
+    const size_t max_samples = VBAN_MAX_PACKET_SIZE / sizeof(int16_t);
+    *block = NULL;
+    if (!ctx->dsp) {
+        audio_buffer_reserve(ctx->rx_ring, max_samples, span);
+        return;
+    }
+    *block = dsp_stream_acquire(ctx->dsp);
+    span->ptr[0] = *block ? (void*)(*block)->data : (void*)scratch;
+    span->len[0] = max_samples;
+    span->ptr[1] = NULL;
+    span->len[1] = 0;
+}
+
+// Decode a validated packet for its context, on the worker it is steered to
+static void network_rx_decode(vban_context_t* ctx, const vban_header_t* header, const struct msghdr* msg,
+                              const audio_buffer_span_t* span, dsp_block_t* block, ssize_t total_samples) {
+    audio_buffer_span_from_le(span, total_samples);
+    atomic_fetch_add_explicit(&ctx->packets_received, 1, memory_order_relaxed);
+
+    // Track arrival jitter and size the playout buffer from it; gaps
+    // after silence are the sender suppressing it, not loss
+    jitter_update(&ctx->jitter, net_rx_timestamp_ns(msg), vban_header_frame(header),
+                  header->format_nbs + 1, vban_sample_rate_from_index(header->format_SR),
+                  dtx_is_silent(span, total_samples));
+    if (ctx->set_playout_target) ctx->set_playout_target(jitter_target_frames(&ctx->jitter));
+
+    if (ctx->dsp) {
+        // Output happens in order once the pool has run the DSP
+        if (block) {
+            TRACE_BEGIN("decode");
+            sample_from_int16_in_place(block->data, total_samples);
+            TRACE_END("decode");
+            block->header = *header;
+            block->samples = total_samples;
+            dsp_stream_submit(ctx->dsp, block);
+        } else {
+            TRACE_INSTANT("dsp window full");
+        }
+        return;
+    }
+
+    // Mirror the stream for local readers in its wire format, while the
+    // ring region still holds it
+    if (ctx->shm_name[0] &&
+        shm_output_publish(&ctx->shm_writer, ctx->shm_name, header, span, total_samples) != 0) {
+        ctx->shm_name[0] = '\0';  // Don't retry on every packet
+    }
+
+    // Decode each part where it landed, then publish the decoded audio
+    TRACE_BEGIN("decode");
+    size_t first = span->len[0] < (size_t)total_samples ? span->len[0] : (size_t)total_samples;
+    sample_from_int16_in_place(span->ptr[0], first);
+    sample_from_int16_in_place(span->ptr[1], total_samples - first);
+    audio_buffer_commit(ctx->rx_ring, total_samples);
+    TRACE_END("decode");
+    TRACE_COUNTER("buffered samples", audio_buffer_available(ctx->rx_ring));
+}
+
+// Receive handler, called on an event loop thread when a worker's socket
+// is readable. Only this worker decodes for the contexts steered to it.
+static void network_on_readable(void* arg) {
+    network_rx_worker_t* worker = (network_rx_worker_t*)arg;
+    const size_t max_samples = VBAN_MAX_PACKET_SIZE / sizeof(int16_t);
+    int16_t scratch[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];
+
+    // Bounded so one busy stream can't starve the others on this loop
+    for (int burst = 0; burst < NETWORK_RX_BURST; burst++) {
+        struct sockaddr_storage sender_addr;
+        vban_header_t header;
+        audio_buffer_span_t span = { { scratch, NULL }, { max_samples, 0 } };
+        dsp_block_t* block = NULL;
+        union {
+            struct cmsghdr align;
+            char buf[NET_TIMESTAMP_CONTROL_SIZE];
+        } control;
+
+        struct iovec iov[3] = { { &header, VBAN_HEADER_SIZE } };
+        struct msghdr msg = {0};
+        msg.msg_name = &sender_addr;
+        msg.msg_namelen = sizeof(sender_addr);
+        msg.msg_iov = iov;
+
+        // Find the destination before the payload arrives, so it lands in
+        // place: a worker with one stream assumes it, one with several
+        // peeks at the header. An impaired socket can't be peeked, so its
+        // datagrams are received into scratch and matched afterwards.
+        vban_context_t* ctx = NULL;
+        if (!worker->impair) {
+            ctx = network_sole_stream(worker);
+            if (!ctx) {
+                msg.msg_iovlen = 1;
+                if (recvmsg(worker->socket, &msg, MSG_PEEK | MSG_DONTWAIT) < 0) break;
+                ctx = network_match_stream(worker, &header, &sender_addr);
+                if (!ctx) {
+                    recv(worker->socket, NULL, 0, MSG_DONTWAIT);  // Not ours, discard
+                    continue;
+                }
+                msg.msg_namelen = sizeof(sender_addr);
             }
+            network_rx_destination(ctx, scratch, &span, &block);
+        }
+
+        iov[1].iov_base = span.ptr[0];
+        iov[1].iov_len = span.len[0] * sizeof(int16_t);
+        iov[2].iov_base = span.ptr[1];
+        iov[2].iov_len = span.len[1] * sizeof(int16_t);
+        msg.msg_iovlen = 3;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
 
-            // Validate stream name
-            if (strncmp(header->streamname, ctx->streamname, 16) != 0) {
-                continue;  // Wrong stream name
+        ssize_t received = worker->impair ? impair_recvmsg(worker->impair, worker->socket, &msg)
+                                          : recvmsg(worker->socket, &msg, MSG_DONTWAIT);
+        if (received < 0) {
+            if (block) dsp_stream_release(ctx->dsp, block);
+            break;  // Drained (or failed; the loop reports readiness again)
+        }
+        TRACE_BEGIN("receive");
+        if (!ctx) {
+            ctx = network_match_stream(worker, &header, &sender_addr);
+            if (ctx) {
+                network_rx_destination(ctx, scratch, &span, &block);
+                if (block || !ctx->dsp) {
+                    size_t bytes = (size_t)received > VBAN_HEADER_SIZE ? (size_t)received - VBAN_HEADER_SIZE : 0;
+                    size_t first = span.len[0] * sizeof(int16_t) < bytes ? span.len[0] * sizeof(int16_t) : bytes;
+                    memcpy(span.ptr[0], scratch, first);
+                    memcpy(span.ptr[1], (const char*)scratch + first, bytes - first);
+                }
             }
+        }
+        ssize_t total_samples = ctx ? network_validate_packet(ctx, &header, &sender_addr, received) : -1;
+        if (total_samples < 0) {
+            if (block) dsp_stream_release(ctx->dsp, block);
+            TRACE_END("receive");
+            continue;
+        }
+
+        atomic_fetch_add_explicit(&worker->packets, 1, memory_order_relaxed);
+        network_rx_decode(ctx, &header, &msg, &span, block, total_samples);
+        TRACE_END("receive");
+    }
+}
+
+// DSP pool output, called with each stream's blocks one at a time in order
+static void network_on_dsp_block(void* user, const dsp_block_t* block) {
+    vban_context_t* ctx = (vban_context_t*)user;
+    audio_buffer_write(ctx->rx_ring, block->data, block->samples);
 
-            int num_samples = (header->format_nbs + 1);
-            int num_channels = (header->format_nbc + 1);
-            
-            // Process received audio data
-            const int16_t* audio_data = (const int16_t*)(packet + VBAN_HEADER_SIZE);
-            audio_process_input(audio_data, num_samples, num_channels);
+    if (ctx->shm_name[0]) {
+#ifdef VBAN_SAMPLE_INT16
+        audio_buffer_span_t span = { { (void*)block->data, NULL }, { block->samples, 0 } };
+#else
+        // The DSP output is float; readers get the wire format
+        int16_t wire[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];
+        sample_to_int16(block->data, block->samples, wire);
+        audio_buffer_span_t span = { { wire, NULL }, { block->samples, 0 } };
+#endif
+        if (shm_output_publish(&ctx->shm_writer, ctx->shm_name, &block->header, &span, block->samples) != 0) {
+            ctx->shm_name[0] = '\0';
         }
     }
+    TRACE_COUNTER("buffered samples", audio_buffer_available(ctx->rx_ring));
+}
 
-    return NULL;
+int network_enable_dsp(vban_context_t* ctx, vban_dsp_pool_t* pool, vban_dsp_fn process, void* user) {
+    ctx->dsp = dsp_stream_create(pool, process, user, network_on_dsp_block, ctx);
+    if (!ctx->dsp) {
+        fprintf(stderr, "Failed to create DSP stream\n");
+        return -1;
+    }
+    return 0;
 }
 
-void* network_send_thread(void* arg) {
-    vban_context_t* ctx = (vban_context_t*)arg;
-    const int samples_per_packet = 256;  // VBAN standard packet size
-    int16_t send_buffer[samples_per_packet];  // Mono audio
-    uint64_t total_samples_sent = 0;
-    uint32_t packets_sent = 0;
-
-    printf("VBAN Send Thread Started\n");
-
-    while (ctx->is_running) {
-        pthread_mutex_lock(&g_input_buffer.mutex);
-        
-        // Check if we have enough data to send
-        if (g_input_buffer.size >= samples_per_packet) {  // Mono audio
-            // Copy data to send buffer
-            memcpy(send_buffer, g_input_buffer.data, samples_per_packet * sizeof(int16_t));
-            
-            // Remove the data we're about to send
-            memmove(g_input_buffer.data, 
-                   g_input_buffer.data + samples_per_packet,
-                   (g_input_buffer.size - samples_per_packet) * sizeof(int16_t));
-            g_input_buffer.size -= samples_per_packet;
-            
-            pthread_mutex_unlock(&g_input_buffer.mutex);
-            
-            // Send the audio data as mono
-            if (vban_send_audio((vban_handle_t)ctx, send_buffer, samples_per_packet, 1) == 0) {
-                packets_sent++;
-                total_samples_sent += samples_per_packet;
+int network_enable_impair(vban_context_t* ctx, const vban_impair_config_t* config) {
+    if (!impair_active(config)) return 0;
+    network_rx_port_t* port = ctx->rx_port;
+    int status = 0;
+
+    pthread_mutex_lock(&loops_mutex);
+    if (port->workers[0].impair) {
+        // The link sits in front of the shared sockets; the first setup stays
+    } else if (port->running) {
+        fprintf(stderr, "Network impairment must be set up before the port's workers start\n");
+        status = -1;
+    } else {
+        for (int i = 0; i < port->num_workers; i++) {
+            network_rx_worker_t* worker = &port->workers[i];
+            worker->impair = malloc(sizeof(impair_t));
+            if (!worker->impair || impair_init(worker->impair, config, (unsigned)i) != 0) {
+                fprintf(stderr, "Failed to set up network impairment\n");
+                free(worker->impair);
+                worker->impair = NULL;
+                status = -1;
+                break;
             }
-        } else {
-            pthread_mutex_unlock(&g_input_buffer.mutex);
-            // Sleep a bit if we don't have enough data
-            usleep(1000);  // 1ms
         }
     }
+    pthread_mutex_unlock(&loops_mutex);
+    return status;
+}
 
-    printf("VBAN Send Thread Stopped\n");
-    return NULL;
+int network_send_span(vban_context_t* ctx, const audio_buffer_span_t* payload, int num_samples, int num_channels,
+                      int suppress) {
+    size_t data_size = (payload->len[0] + payload->len[1]) * sizeof(int16_t);
+    if (data_size > VBAN_MAX_PACKET_SIZE || num_samples > VBAN_PROTOCOL_MAXNBS || num_channels > 256) {
+        return -2;
+    }
+
+    if (suppress && !dtx_should_send(&ctx->dtx, payload)) {
+        // The receiver sees the gap as silence
+        atomic_fetch_add_explicit(&ctx->frame_counter, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ctx->packets_suppressed, 1, memory_order_relaxed);
+        TRACE_INSTANT("suppress");
+        return 1;
+    }
+
+    // Patch a copy: another thread may be sending from the template too
+    TRACE_BEGIN("send");
+    vban_header_t header = ctx->send_header;
+    header.format_nbs = (uint8_t)(num_samples - 1);
+    header.format_nbc = (uint8_t)(num_channels - 1);
+    vban_header_set_frame(&header, atomic_fetch_add_explicit(&ctx->frame_counter, 1, memory_order_relaxed));
+
+    struct iovec iov[3] = {
+        { &header, VBAN_HEADER_SIZE },
+        { payload->ptr[0], payload->len[0] * sizeof(int16_t) },
+        { payload->ptr[1], payload->len[1] * sizeof(int16_t) }
+    };
+    struct msghdr msg = {0};
+    msg.msg_name = &ctx->remote_addr;
+    msg.msg_namelen = ctx->remote_addr_len;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = payload->len[1] > 0 ? 3 : 2;
+
+    ssize_t sent = sendmsg(ctx->socket, &msg, 0);
+    TRACE_END("send");
+    if (sent != (ssize_t)(VBAN_HEADER_SIZE + data_size)) return -3;
+    atomic_fetch_add_explicit(&ctx->packets_sent, 1, memory_order_relaxed);
+    return 0;
+}
+
+// Send timer, called on an event loop thread
+static void network_on_send_timer(void* arg) {
+    vban_context_t* ctx = (vban_context_t*)arg;
+    const int samples_per_packet = ctx->send_frames * ctx->send_channels;
+    audio_buffer_span_t span;
+    uint64_t pos;
+#ifndef VBAN_SAMPLE_INT16
+    int16_t wire[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];
+    audio_buffer_span_t payload = { { wire, NULL }, { (size_t)samples_per_packet, 0 } };
+#endif
+
+    // Send every complete packet captured since the last tick
+    while (audio_buffer_peek(ctx->tx_ring, samples_per_packet, &span, &pos) == (size_t)samples_per_packet) {
+        TRACE_INSTANT("packetize");
+#ifdef VBAN_SAMPLE_INT16
+        // The ring holds wire samples, sent straight from its storage
+        network_send_span(ctx, &span, ctx->send_frames, ctx->send_channels, 1);
+#else
+        // Float samples are encoded to int16 (once, with saturation) on
+        // the way out of the capture ring
+        sample_to_int16(span.ptr[0], span.len[0], wire);
+        sample_to_int16(span.ptr[1], span.len[1], wire + span.len[0]);
+        network_send_span(ctx, &payload, ctx->send_frames, ctx->send_channels, 1);
+#endif
+        // Capture overflowing the ring meanwhile may have overwritten what
+        // went out; the packet can't be taken back, only counted
+        if (audio_buffer_consume(ctx->tx_ring, pos, samples_per_packet) != 0) {
+            atomic_fetch_add_explicit(&ctx->packets_torn, 1, memory_order_relaxed);
+        }
+    }
+}
+
+// Put a worker's socket (and impairment timer) on its loop
+static int network_worker_add(network_rx_worker_t* worker) {
+    worker->source = event_loop_add_fd(worker->loop, worker->socket, network_on_readable, worker);
+    if (worker->impair) {
+        worker->impair_timer = event_loop_add_timer(worker->loop, NETWORK_IMPAIR_TICK_US,
+                                                    network_on_readable, worker);
+    }
+    return worker->source && (!worker->impair || worker->impair_timer) ? 0 : -1;
+}
+
+// Take a worker off its loop; returns once its handler is not running
+static void network_worker_remove(network_rx_worker_t* worker) {
+    if (worker->source) {
+        event_loop_remove(worker->loop, worker->source);
+        worker->source = NULL;
+    }
+    if (worker->impair_timer) {
+        event_loop_remove(worker->loop, worker->impair_timer);
+        worker->impair_timer = NULL;
+    }
+}
+
+int network_start(vban_context_t* ctx, int event_threads) {
+    if (event_threads < 1) event_threads = 1;
+    if (event_threads > VBAN_MAX_EVENT_THREADS) event_threads = VBAN_MAX_EVENT_THREADS;
+    network_rx_port_t* port = ctx->rx_port;
+
+    // The stream is decoded on the worker the kernel steers it to
+    network_rx_worker_t* worker = &port->workers[net_steering_worker(&ctx->remote_addr, ctx->streamname,
+                                                                     port->num_workers)];
+
+    pthread_mutex_lock(&loops_mutex);
+    int slot = 0;
+    while (slot < NETWORK_MAX_WORKER_STREAMS && atomic_load(&worker->streams[slot])) slot++;
+    if (slot == NETWORK_MAX_WORKER_STREAMS) {
+        pthread_mutex_unlock(&loops_mutex);
+        fprintf(stderr, "Receive worker %d already decodes %d streams\n", worker->index, slot);
+        return -1;
+    }
+
+    // The first context decides how many loop threads there are
+    while (num_loops < event_threads && loop_users == 0) {
+        loops[num_loops] = event_loop_create();
+        if (!loops[num_loops]) break;
+        num_loops++;
+    }
+    if (num_loops == 0) {
+        pthread_mutex_unlock(&loops_mutex);
+        return -1;
+    }
+    loop_users++;
+
+    // The first context on the port spreads its workers over the loops
+    int failed = 0;
+    if (port->running++ == 0) {
+        for (int i = 0; i < port->num_workers; i++) {
+            port->workers[i].loop = loops[next_loop];
+            next_loop = (next_loop + 1) % num_loops;
+            if (network_worker_add(&port->workers[i]) != 0) failed = 1;
+        }
+    }
+    atomic_store_explicit(&worker->streams[slot], ctx, memory_order_release);
+    ctx->rx_worker = worker;
+
+    if (ctx->tx_ring) {
+        ctx->send_loop = loops[next_loop];
+        next_loop = (next_loop + 1) % num_loops;
+        ctx->send_timer = event_loop_add_timer(ctx->send_loop, NETWORK_SEND_TICK_US, network_on_send_timer, ctx);
+        if (!ctx->send_timer) failed = 1;
+    }
+    pthread_mutex_unlock(&loops_mutex);
+
+    if (failed) {
+        network_stop(ctx);
+        return -1;
+    }
+    return 0;
+}
+
+void network_stop(vban_context_t* ctx) {
+    network_rx_worker_t* worker = ctx->rx_worker;
+    if (!worker) return;
+
+    // Removal waits for running handlers, so nothing touches ctx afterwards
+    if (ctx->send_timer) {
+        event_loop_remove(ctx->send_loop, ctx->send_timer);
+        ctx->send_timer = NULL;
+    }
+    ctx->send_loop = NULL;
+
+    pthread_mutex_lock(&loops_mutex);
+    for (int i = 0; i < NETWORK_MAX_WORKER_STREAMS; i++) {
+        if (atomic_load(&worker->streams[i]) == ctx) atomic_store(&worker->streams[i], NULL);
+    }
+    network_rx_port_t* port = ctx->rx_port;
+    if (--port->running == 0) {
+        // Last context on the port: take its sockets off the loops
+        for (int i = 0; i < port->num_workers; i++) network_worker_remove(&port->workers[i]);
+    } else {
+        // Wait out a handler that may still be decoding for ctx; putting
+        // the socket back keeps the worker serving the other contexts
+        network_worker_remove(worker);
+        if (network_worker_add(worker) != 0) {
+            fprintf(stderr, "Failed to restart receive worker %d\n", worker->index);
+        }
+    }
+    ctx->rx_worker = NULL;
+
+    if (--loop_users == 0) {
+        while (num_loops > 0) {
+            event_loop_destroy(loops[--num_loops]);
+        }
+        next_loop = 0;
+    }
+    pthread_mutex_unlock(&loops_mutex);
 }
 
 void network_cleanup(vban_context_t* ctx) {
     printf("Cleaning up network\n");
-    if (ctx && ctx->socket >= 0) {
-        close(ctx->socket);
+    if (ctx) {
+        if (ctx->rx_port) {
+            // The port's last context closes its sockets
+            pthread_mutex_lock(&loops_mutex);
+            network_rx_port_t* port = ctx->rx_port;
+            if (--port->users == 0) {
+                network_rx_port_t** link = &ports;
+                while (*link != port) link = &(*link)->next;
+                *link = port->next;
+                network_close_port(port);
+            }
+            pthread_mutex_unlock(&loops_mutex);
+            ctx->rx_port = NULL;
+        }
         ctx->socket = -1;
+        dsp_stream_destroy(ctx->dsp);  // Delivers what is still in flight
+        ctx->dsp = NULL;
+        vban_shm_writer_destroy(ctx->shm_writer);
+        ctx->shm_writer = NULL;
     }
-} 
\ No newline at end of file
+}
@@ -2,29 +2,157 @@
 #define VBAN4MAC_NETWORK_H
 
 #include <netinet/in.h>
+#include <sys/socket.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include "../include/vban4mac/types.h"
+#include "../include/vban4mac/shm_ring.h"
+#include "buffer.h"
+#include "jitter.h"
+#include "event_loop.h"
+#include "dsp_pool.h"
+#include "dtx.h"
+#include "impair.h"
+
+#define VBAN_MAX_RX_WORKERS 16
+#define VBAN_MAX_EVENT_THREADS 16
+#define NETWORK_MAX_WORKER_STREAMS 16    // Contexts one receive worker decodes for
+
+struct vban_context_t;
+struct network_rx_port_t;
+
+// Receive worker with its own SO_REUSEPORT socket. The kernel steers each
+// (sender, stream) to one worker, which decodes for every context on the
+// port whose stream is steered to it.
+typedef struct {
+    struct network_rx_port_t* port;
+    int index;
+    int socket;
+    event_loop_t* loop;                  // Loop the socket is registered with
+    event_source_t* source;
+    impair_t* impair;                    // Simulated network in front of the socket, NULL for none
+    event_source_t* impair_timer;        // Releases held packets when the socket is quiet
+    _Atomic(struct vban_context_t*) streams[NETWORK_MAX_WORKER_STREAMS];  // NULL slots are free
+    _Atomic uint64_t packets;            // Packets decoded for its streams
+} network_rx_worker_t;
+
+// Receive sockets bound to one local address and port, shared by every
+// context in the process receiving there. The port owns its reuseport
+// group, so socket indices are the steering program's worker indices.
+typedef struct network_rx_port_t {
+    struct sockaddr_storage local_addr;
+    socklen_t local_len;
+    int num_workers;
+    int users;                           // Contexts holding the port
+    int running;                         // Started contexts; workers are on the loops while nonzero
+    network_rx_worker_t workers[VBAN_MAX_RX_WORKERS];
+    struct network_rx_port_t* next;
+} network_rx_port_t;
 
 // Internal VBAN context structure
 typedef struct vban_context_t {
-    int socket;
-    struct sockaddr_in remote_addr;
+    int socket;                          // Send socket, the port's first receive socket
+    struct sockaddr_storage remote_addr;
+    socklen_t remote_addr_len;
     char streamname[16];
-    uint32_t frame_counter;
+    vban_header_t send_header;           // Prebuilt template, copied for each packet
+    _Atomic uint32_t frame_counter;      // nuFrame of the next packet, from the send timer or vban_send_audio
+    int send_channels;                   // Channels per captured frame
+    int send_frames;                     // Frames per sent packet
+    dtx_gate_t dtx;                      // Silence suppression of sent packets
+    _Atomic uint64_t packets_sent;
+    _Atomic uint64_t packets_suppressed;
+    _Atomic uint64_t packets_torn;       // Sent while capture overflowed onto their samples
+    _Atomic uint64_t packets_received;
     int is_running;
-    pthread_t receive_thread;
-    pthread_t send_thread;
+    network_rx_port_t* rx_port;          // Receive sockets, shared with other contexts on the port
+    network_rx_worker_t* rx_worker;      // Worker the stream is steered to, the only one touching the fields below
+    audio_buffer_t* rx_ring;             // Decoded audio goes here
+    audio_buffer_t* tx_ring;             // Captured audio to send, NULL for none
+    void (*set_playout_target)(size_t frames);  // Told the jitter-based target, NULL for none
+    jitter_estimator_t jitter;           // Receive timing
+    char shm_name[64];                   // Shared-memory output ring, empty for none
+    vban_shm_writer_t* shm_writer;       // Created from the first packet
+    dsp_stream_t* dsp;                   // DSP stage between receive and the ring, NULL for none
+    event_loop_t* send_loop;
+    event_source_t* send_timer;          // Drains the input ring into packets
 } vban_context_t;
 
-// Network thread functions
-void* network_receive_thread(void* arg);
-void* network_send_thread(void* arg);
-
 // Network initialization
 int network_init(vban_context_t* ctx, const char* remote_ip);
 int network_init_with_port(vban_context_t* ctx, const char* remote_ip, uint16_t port);
 
-// Network cleanup
+/**
+ * Attach the context to the receive port for its local address, binding
+ * the port's worker sockets if it is the first there. Set rx_ring (and
+ * tx_ring to send) before network_start.
+ * @param ctx Context to initialize
+ * @param remote_ip IPv4 or IPv6 address of the remote VBAN host
+ * @param bind_ip Local address to bind, NULL or empty for any
+ * @param port UDP port used for sending and receiving
+ * @param rx_workers Number of receive workers (clamped to 1..VBAN_MAX_RX_WORKERS),
+ *                   ignored if another context already opened the port
+ * @return 0 on success, -1 on error
+ */
+int network_init_with_options(vban_context_t* ctx, const char* remote_ip, const char* bind_ip,
+                              uint16_t port, int rx_workers);
+
+/**
+ * Send one packet with a copy of the prebuilt header, straight from the
+ * caller's memory (e.g. both parts of a ring region). Safe to call from
+ * the send timer and vban_send_audio at once.
+ * @param ctx Initialized context with send_header filled
+ * @param payload Interleaved host-order samples, in up to two parts
+ * @param num_samples Samples per channel
+ * @param num_channels Channels per frame
+ * @param suppress Let ctx->dtx skip silent packets, which still advances the frame counter
+ *                 (only the send timer, the gate's one caller)
+ * @return 0 if sent, 1 if suppressed, -2 if too large for one packet, -3 if the send failed
+ */
+int network_send_span(vban_context_t* ctx, const audio_buffer_span_t* payload, int num_samples, int num_channels,
+                      int suppress);
+
+/**
+ * Run received packets through a DSP pool before they reach the output
+ * ring (call before network_start)
+ * @param ctx Initialized context
+ * @param pool Pool to process on
+ * @param process DSP applied to every packet
+ * @param user Passed to process
+ * @return 0 on success, -1 on error
+ */
+int network_enable_dsp(vban_context_t* ctx, vban_dsp_pool_t* pool, vban_dsp_fn process, void* user);
+
+/**
+ * Simulate a bad network in front of every receive worker's socket (call
+ * before network_start). Each worker draws from the seed plus its index.
+ * The port's first context to ask sets it for every context on the port.
+ * @param ctx Initialized context
+ * @param config Impairments, ignored if all zero
+ * @return 0 on success, -1 on error
+ */
+int network_enable_impair(vban_context_t* ctx, const vban_impair_config_t* config);
+
+/**
+ * Start receiving the context's stream on the worker it is steered to,
+ * and register its send timer with the process-wide event loops. The
+ * first context to start creates the loops, and the first on a port puts
+ * the port's sockets on them.
+ * @param ctx Initialized context
+ * @param event_threads Loop threads to create (ignored once they exist)
+ * @return 0 on success, -1 on error
+ */
+int network_start(vban_context_t* ctx, int event_threads);
+
+/**
+ * Unregister the context; returns once no handler is using it. The last
+ * context on a port takes its sockets off the loops, and the last context
+ * to stop also stops the loop threads.
+ * @param ctx Started context
+ */
+void network_stop(vban_context_t* ctx);
+
+// Network cleanup, closing the port's sockets with its last context
 void network_cleanup(vban_context_t* ctx);
 
-#endif /* VBAN4MAC_NETWORK_H */ 
\ No newline at end of file
+#endif /* VBAN4MAC_NETWORK_H */
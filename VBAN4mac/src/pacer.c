@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "pacer_stream.h"
+#include "../include/vban4mac/types.h"
+
+#define PACER_DEFAULT_STREAM_BURST 1
+#define PACER_DEFAULT_DESTINATION_BURST 2
+
+// Buckets refill at 9/8 of the nominal packet rate, so a sender whose
+// device clock runs slightly fast, or a backlog after a late callback,
+// still drains instead of queueing up
+#define PACER_COST_NUM 8
+#define PACER_COST_DEN 9
+
+// Token bucket holding credit in nanoseconds: it fills at one ns per ns up
+// to depth, and sending a packet takes cost
+typedef struct {
+    int64_t cost_ns;
+    int64_t depth_ns;
+    int64_t credit_ns;
+    int64_t updated_ns;
+} pacer_bucket_t;
+
+typedef struct {
+    int64_t enqueue_ns;
+    size_t size;
+    uint8_t data[VBAN_HEADER_SIZE + VBAN_MAX_PACKET_SIZE];
+} pacer_packet_t;
+
+// Streams to one address share its bucket
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    int streams;                    // 0 when the slot is free
+    double packets_per_ns;          // Sum of its streams' nominal rates
+    pacer_bucket_t bucket;
+} pacer_destination_t;
+
+struct pacer_stream_t {
+    vban_pacer_t* pacer;
+    int socket;
+    int dest;                       // Index in pacer->dests
+    int64_t interval_ns;
+    int64_t phase_ns;               // Slot within the interval
+    pacer_bucket_t bucket;
+    size_t head;                    // Oldest queued packet
+    size_t count;
+    pacer_packet_t queue[PACER_QUEUE_PACKETS];
+};
+
+struct vban_pacer_t {
+    pthread_t thread;
+    int running;
+    pthread_mutex_t mutex;          // Protects everything below
+    pthread_cond_t cond;            // Wakes the thread for new packets or to stop
+    pthread_cond_t sent_cond;       // Signalled after a send while a stream is being removed
+    int sleeping;
+    int removing;
+    const pacer_stream_t* sending;  // Stream whose packet is being sent without the lock
+    int stream_burst;
+    int destination_burst;
+    int64_t epoch_ns;               // Origin of every stream's phase slots
+    pacer_stream_t* streams[VBAN_PACER_MAX_STREAMS];
+    int num_streams;
+    pacer_destination_t dests[VBAN_PACER_MAX_STREAMS];
+    vban_pacer_stats_t stats;
+};
+
+static int64_t pacer_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t bucket_credit(const pacer_bucket_t* bucket, int64_t now_ns) {
+    int64_t credit = bucket->credit_ns + (now_ns - bucket->updated_ns);
+    return credit < bucket->depth_ns ? credit : bucket->depth_ns;
+}
+
+// Earliest time from now_ns at which the bucket allows a packet
+static int64_t bucket_conform_ns(const pacer_bucket_t* bucket, int64_t now_ns) {
+    int64_t credit = bucket_credit(bucket, now_ns);
+    return credit >= bucket->cost_ns ? now_ns : now_ns + (bucket->cost_ns - credit);
+}
+
+static void bucket_take(pacer_bucket_t* bucket, int64_t now_ns) {
+    bucket->credit_ns = bucket_credit(bucket, now_ns) - bucket->cost_ns;
+    bucket->updated_ns = now_ns;
+}
+
+static void bucket_set_cost(pacer_bucket_t* bucket, int64_t cost_ns, int burst, int64_t now_ns) {
+    bucket->credit_ns = bucket_credit(bucket, now_ns);
+    bucket->updated_ns = now_ns;
+    bucket->cost_ns = cost_ns;
+    bucket->depth_ns = cost_ns * burst;
+    if (bucket->credit_ns > bucket->depth_ns) bucket->credit_ns = bucket->depth_ns;
+}
+
+// Give every stream its own slot, evenly spaced over its interval, and
+// resize the destination buckets to the rates of the streams they carry
+static void pacer_respread(vban_pacer_t* pacer, int64_t now_ns) {
+    for (int i = 0; i < pacer->num_streams; i++) {
+        pacer_stream_t* stream = pacer->streams[i];
+        stream->phase_ns = stream->interval_ns * i / pacer->num_streams;
+    }
+    for (int d = 0; d < VBAN_PACER_MAX_STREAMS; d++) {
+        pacer_destination_t* dest = &pacer->dests[d];
+        if (dest->streams == 0) continue;
+        int64_t cost = (int64_t)(PACER_COST_NUM / (PACER_COST_DEN * dest->packets_per_ns));
+        bucket_set_cost(&dest->bucket, cost, pacer->destination_burst, now_ns);
+    }
+}
+
+// When the oldest packet of a stream may leave: at its phase slot, once
+// both the stream's and the destination's buckets allow it
+static int64_t pacer_departure_ns(const vban_pacer_t* pacer, const pacer_stream_t* stream, int64_t now_ns) {
+    const pacer_packet_t* packet = &stream->queue[stream->head];
+    int64_t origin = pacer->epoch_ns + stream->phase_ns;
+    int64_t departure = origin;
+    if (packet->enqueue_ns > origin) {
+        int64_t slots = (packet->enqueue_ns - origin + stream->interval_ns - 1) / stream->interval_ns;
+        departure = origin + slots * stream->interval_ns;
+    }
+
+    int64_t conform = bucket_conform_ns(&stream->bucket, now_ns);
+    if (conform > departure) departure = conform;
+    conform = bucket_conform_ns(&pacer->dests[stream->dest].bucket, now_ns);
+    if (conform > departure) departure = conform;
+    return departure;
+}
+
+static void pacer_wait_until(vban_pacer_t* pacer, int64_t deadline_ns, int64_t now_ns) {
+    // Condition variables time out on CLOCK_REALTIME
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    int64_t ns = deadline.tv_nsec + (deadline_ns - now_ns);
+    deadline.tv_sec += ns / 1000000000LL;
+    deadline.tv_nsec = ns % 1000000000LL;
+
+    pacer->sleeping = 1;
+    pthread_cond_timedwait(&pacer->cond, &pacer->mutex, &deadline);
+    pacer->sleeping = 0;
+}
+
+static void* pacer_thread(void* arg) {
+    vban_pacer_t* pacer = (vban_pacer_t*)arg;
+
+    pthread_mutex_lock(&pacer->mutex);
+    while (pacer->running) {
+        int64_t now = pacer_now_ns();
+        pacer_stream_t* next = NULL;
+        int64_t earliest = INT64_MAX;
+        for (int i = 0; i < pacer->num_streams; i++) {
+            pacer_stream_t* stream = pacer->streams[i];
+            if (stream->count == 0) continue;
+            int64_t departure = pacer_departure_ns(pacer, stream, now);
+            if (departure < earliest) {
+                earliest = departure;
+                next = stream;
+            }
+        }
+
+        if (!next) {
+            pacer->sleeping = 1;
+            pthread_cond_wait(&pacer->cond, &pacer->mutex);
+            pacer->sleeping = 0;
+            continue;
+        }
+        if (earliest > now) {
+            pacer_wait_until(pacer, earliest, now);
+            continue;
+        }
+
+        bucket_take(&next->bucket, now);
+        bucket_take(&pacer->dests[next->dest].bucket, now);
+        pacer_packet_t* packet = &next->queue[next->head];
+        int64_t delay = now - packet->enqueue_ns;
+        pacer->stats.packets_paced++;
+        pacer->stats.delay_total_ns += (uint64_t)delay;
+        if ((uint64_t)delay > pacer->stats.delay_max_ns) pacer->stats.delay_max_ns = (uint64_t)delay;
+
+        // Producers only write behind the head, so the packet can be sent
+        // without holding them up
+        const pacer_destination_t* dest = &pacer->dests[next->dest];
+        pacer->sending = next;
+        pthread_mutex_unlock(&pacer->mutex);
+        ssize_t sent = sendto(next->socket, packet->data, packet->size, 0,
+                              (const struct sockaddr*)&dest->addr, dest->addr_len);
+        pthread_mutex_lock(&pacer->mutex);
+        pacer->sending = NULL;
+
+        if (sent != (ssize_t)packet->size) pacer->stats.send_errors++;
+        next->head = (next->head + 1) & (PACER_QUEUE_PACKETS - 1);
+        next->count--;
+        if (pacer->removing) pthread_cond_broadcast(&pacer->sent_cond);
+    }
+    pthread_mutex_unlock(&pacer->mutex);
+    return NULL;
+}
+
+vban_pacer_t* vban_pacer_create(const vban_pacer_config_t* config) {
+    vban_pacer_t* pacer = calloc(1, sizeof(vban_pacer_t));
+    if (!pacer) return NULL;
+
+    pacer->stream_burst = config && config->stream_burst > 0 ? config->stream_burst
+                                                             : PACER_DEFAULT_STREAM_BURST;
+    pacer->destination_burst = config && config->destination_burst > 0 ? config->destination_burst
+                                                                       : PACER_DEFAULT_DESTINATION_BURST;
+    pacer->epoch_ns = pacer_now_ns();
+    pacer->running = 1;
+    pthread_mutex_init(&pacer->mutex, NULL);
+    pthread_cond_init(&pacer->cond, NULL);
+    pthread_cond_init(&pacer->sent_cond, NULL);
+
+    if (pthread_create(&pacer->thread, NULL, pacer_thread, pacer) != 0) {
+        perror("Failed to create pacer thread");
+        pthread_cond_destroy(&pacer->sent_cond);
+        pthread_cond_destroy(&pacer->cond);
+        pthread_mutex_destroy(&pacer->mutex);
+        free(pacer);
+        return NULL;
+    }
+    return pacer;
+}
+
+void vban_pacer_get_stats(vban_pacer_t* pacer, vban_pacer_stats_t* stats) {
+    pthread_mutex_lock(&pacer->mutex);
+    *stats = pacer->stats;
+    pthread_mutex_unlock(&pacer->mutex);
+}
+
+void vban_pacer_destroy(vban_pacer_t* pacer) {
+    if (!pacer) return;
+
+    pthread_mutex_lock(&pacer->mutex);
+    pacer->running = 0;
+    pthread_cond_signal(&pacer->cond);
+    pthread_mutex_unlock(&pacer->mutex);
+    pthread_join(pacer->thread, NULL);
+
+    for (int i = 0; i < pacer->num_streams; i++) {
+        free(pacer->streams[i]);  // Senders should have been destroyed first
+    }
+    pthread_cond_destroy(&pacer->sent_cond);
+    pthread_cond_destroy(&pacer->cond);
+    pthread_mutex_destroy(&pacer->mutex);
+    free(pacer);
+}
+
+pacer_stream_t* pacer_stream_add(vban_pacer_t* pacer, int socket, const struct sockaddr_storage* addr,
+                                 socklen_t addr_len, int64_t interval_ns) {
+    if (!pacer || interval_ns <= 0) return NULL;
+    pacer_stream_t* stream = calloc(1, sizeof(pacer_stream_t));
+    if (!stream) return NULL;
+    stream->pacer = pacer;
+    stream->socket = socket;
+    stream->interval_ns = interval_ns;
+
+    pthread_mutex_lock(&pacer->mutex);
+    if (pacer->num_streams == VBAN_PACER_MAX_STREAMS) {
+        pthread_mutex_unlock(&pacer->mutex);
+        fprintf(stderr, "Pacer already has %d streams\n", VBAN_PACER_MAX_STREAMS);
+        free(stream);
+        return NULL;
+    }
+
+    // Join the destination's bucket, or open one
+    int dest = -1, free_slot = -1;
+    for (int d = 0; d < VBAN_PACER_MAX_STREAMS && dest < 0; d++) {
+        const pacer_destination_t* candidate = &pacer->dests[d];
+        if (candidate->streams == 0) {
+            if (free_slot < 0) free_slot = d;
+        } else if (candidate->addr_len == addr_len && memcmp(&candidate->addr, addr, addr_len) == 0) {
+            dest = d;
+        }
+    }
+    int64_t now = pacer_now_ns();
+    if (dest < 0) {
+        dest = free_slot;
+        pacer_destination_t* opened = &pacer->dests[dest];
+        memset(opened, 0, sizeof(*opened));
+        memcpy(&opened->addr, addr, addr_len);
+        opened->addr_len = addr_len;
+        opened->bucket.updated_ns = now;
+    }
+    pacer->dests[dest].streams++;
+    pacer->dests[dest].packets_per_ns += 1.0 / interval_ns;
+    stream->dest = dest;
+
+    stream->bucket.updated_ns = now;
+    bucket_set_cost(&stream->bucket, interval_ns * PACER_COST_NUM / PACER_COST_DEN, pacer->stream_burst, now);
+    stream->bucket.credit_ns = stream->bucket.depth_ns;
+    pacer->streams[pacer->num_streams++] = stream;
+    pacer_respread(pacer, now);
+    pthread_mutex_unlock(&pacer->mutex);
+    return stream;
+}
+
+int pacer_stream_enqueue(pacer_stream_t* stream, const struct iovec* iov, int iovcnt) {
+    vban_pacer_t* pacer = stream->pacer;
+    int64_t now = pacer_now_ns();
+
+    pthread_mutex_lock(&pacer->mutex);
+    if (stream->count == PACER_QUEUE_PACKETS) {
+        pacer->stats.packets_dropped++;
+        pthread_mutex_unlock(&pacer->mutex);
+        return -1;
+    }
+    pacer_packet_t* packet = &stream->queue[(stream->head + stream->count) & (PACER_QUEUE_PACKETS - 1)];
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (size + iov[i].iov_len > sizeof(packet->data)) {
+            pthread_mutex_unlock(&pacer->mutex);
+            return -1;
+        }
+        memcpy(packet->data + size, iov[i].iov_base, iov[i].iov_len);
+        size += iov[i].iov_len;
+    }
+    packet->size = size;
+    packet->enqueue_ns = now;
+    stream->count++;
+    if (pacer->sleeping) pthread_cond_signal(&pacer->cond);
+    pthread_mutex_unlock(&pacer->mutex);
+    return 0;
+}
+
+void pacer_stream_remove(pacer_stream_t* stream) {
+    if (!stream) return;
+    vban_pacer_t* pacer = stream->pacer;
+
+    pthread_mutex_lock(&pacer->mutex);
+    pacer->removing++;
+    while (pacer->sending == stream) {
+        pthread_cond_wait(&pacer->sent_cond, &pacer->mutex);
+    }
+    pacer->removing--;
+
+    // Keep the order of the others so their slots move as little as possible
+    int i = 0;
+    while (pacer->streams[i] != stream) i++;
+    memmove(&pacer->streams[i], &pacer->streams[i + 1], (pacer->num_streams - i - 1) * sizeof(pacer_stream_t*));
+    pacer->num_streams--;
+
+    pacer_destination_t* dest = &pacer->dests[stream->dest];
+    dest->streams--;
+    dest->packets_per_ns -= 1.0 / stream->interval_ns;
+    if (pacer->num_streams > 0) pacer_respread(pacer, pacer_now_ns());
+    pthread_mutex_unlock(&pacer->mutex);
+    free(stream);
+}
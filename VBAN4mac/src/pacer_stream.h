@@ -0,0 +1,40 @@
+#ifndef VBAN4MAC_PACER_STREAM_H
+#define VBAN4MAC_PACER_STREAM_H
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../include/vban4mac/pacer.h"
+
+#define PACER_QUEUE_PACKETS 32          // Packets a stream may have waiting (power of two)
+
+typedef struct pacer_stream_t pacer_stream_t;
+
+/**
+ * Register a stream. Phase slots of all streams are spread again.
+ * @param pacer The pacer
+ * @param socket Socket to send from (must outlive the stream)
+ * @param addr Destination; streams to the same address share its bucket
+ * @param addr_len Length of addr
+ * @param interval_ns Nominal time between two packets of the stream
+ * @return Stream or NULL on error
+ */
+pacer_stream_t* pacer_stream_add(vban_pacer_t* pacer, int socket, const struct sockaddr_storage* addr,
+                                 socklen_t addr_len, int64_t interval_ns);
+
+/**
+ * Queue one packet, gathered from iov into the stream's queue
+ * @param stream The stream
+ * @param iov Packet parts
+ * @param iovcnt Number of parts
+ * @return 0 if queued, -1 if the queue is full or the packet too large
+ */
+int pacer_stream_enqueue(pacer_stream_t* stream, const struct iovec* iov, int iovcnt);
+
+/**
+ * Unregister a stream; returns once the pacer no longer uses its socket.
+ * Packets still queued are discarded.
+ */
+void pacer_stream_remove(pacer_stream_t* stream);
+
+#endif /* VBAN4MAC_PACER_STREAM_H */
@@ -0,0 +1,80 @@
+#include <string.h>
+#include <arpa/inet.h>
+#include "packet.h"
+
+// Sample rates by format_SR index (VBAN specification)
+static const int vban_sample_rates[] = {
+    6000, 12000, 24000, 48000, 96000, 192000, 384000,
+    8000, 16000, 32000, 64000, 128000, 256000, 512000,
+    11025, 22050, 44100, 88200, 176400, 352800, 705600
+};
+
+#define VBAN_SR_COUNT (int)(sizeof(vban_sample_rates) / sizeof(vban_sample_rates[0]))
+#define VBAN_SR_MASK 0x1F
+
+int vban_sample_rate_index(int sample_rate) {
+    for (int i = 0; i < VBAN_SR_COUNT; i++) {
+        if (vban_sample_rates[i] == sample_rate) return i;
+    }
+    return -1;
+}
+
+int vban_sample_rate_from_index(uint8_t format_SR) {
+    int index = format_SR & VBAN_SR_MASK;
+    return index < VBAN_SR_COUNT ? vban_sample_rates[index] : 0;
+}
+
+void vban_header_init(vban_header_t* header, const char* stream_name, int sr_index,
+                      int frames, int channels, uint8_t datatype) {
+    memset(header, 0, sizeof(*header));
+    header->vban = htonl(VBAN_MAGIC);
+    header->format_SR = (uint8_t)(sr_index | VBAN_PROTOCOL_AUDIO);
+    header->format_nbs = (uint8_t)(frames - 1);
+    header->format_nbc = (uint8_t)(channels - 1);
+    header->format_bit = datatype;
+    memcpy(header->streamname, stream_name, strnlen(stream_name, sizeof(header->streamname)));
+}
+
+int vban_datatype_bytes(uint8_t format_bit) {
+    switch (format_bit & VBAN_DATATYPE_MASK) {
+        case VBAN_DATATYPE_BYTE8:
+            return 1;
+        case VBAN_DATATYPE_INT16:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+static ssize_t vban_header_check(const vban_header_t* header, ssize_t received, int int16_only) {
+    if (received <= VBAN_HEADER_SIZE) {
+        return -1;
+    }
+
+    // Validate VBAN magic number
+    if (ntohl(header->vban) != VBAN_MAGIC) {
+        return -1;  // Not a VBAN packet
+    }
+
+    int bytes = vban_datatype_bytes(header->format_bit);
+    if ((header->format_SR & VBAN_PROTOCOL_MASK) != VBAN_PROTOCOL_AUDIO || bytes == 0 ||
+        (int16_only && bytes != sizeof(int16_t))) {
+        return -1;
+    }
+
+    // Payload must match what the header announces
+    size_t total_samples = (size_t)(header->format_nbs + 1) * (header->format_nbc + 1);
+    if ((size_t)(received - VBAN_HEADER_SIZE) != total_samples * bytes) {
+        return -1;
+    }
+
+    return (ssize_t)total_samples;
+}
+
+ssize_t vban_header_check_audio(const vban_header_t* header, ssize_t received) {
+    return vban_header_check(header, received, 1);
+}
+
+ssize_t vban_header_check_pcm(const vban_header_t* header, ssize_t received) {
+    return vban_header_check(header, received, 0);
+}
@@ -0,0 +1,74 @@
+#ifndef VBAN4MAC_PACKET_H
+#define VBAN4MAC_PACKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "../include/vban4mac/types.h"
+
+#define VBAN_MAGIC (('V' << 24) | ('B' << 16) | ('A' << 8) | 'N')
+
+/**
+ * Look up the VBAN sample rate index of a rate in Hz
+ * @return Index for format_SR, or -1 if VBAN has no such rate
+ */
+int vban_sample_rate_index(int sample_rate);
+
+/**
+ * Sample rate in Hz of a format_SR value (sub protocol bits are ignored)
+ * @return Rate in Hz, or 0 for an unknown index
+ */
+int vban_sample_rate_from_index(uint8_t format_SR);
+
+/**
+ * Fill an audio header
+ * @param header Header to fill
+ * @param stream_name Stream name (truncated to 16 chars)
+ * @param sr_index Sample rate index
+ * @param frames Samples per channel in each packet (1-256)
+ * @param channels Channels per frame (1-256)
+ * @param datatype VBAN_DATATYPE_* value
+ */
+void vban_header_init(vban_header_t* header, const char* stream_name, int sr_index,
+                      int frames, int channels, uint8_t datatype);
+
+/**
+ * Validate the common parts of a received 16-bit PCM audio datagram:
+ * magic, sub protocol, data type and payload length
+ * @param header Received header
+ * @param received Datagram length including the header
+ * @return Number of samples in the payload, or -1 if invalid
+ */
+ssize_t vban_header_check_audio(const vban_header_t* header, ssize_t received);
+
+/**
+ * Validate a received PCM audio datagram of any format the adaptive
+ * streams use (8 or 16-bit): magic, sub protocol, data type and payload
+ * length
+ * @param header Received header
+ * @param received Datagram length including the header
+ * @return Number of samples in the payload, or -1 if invalid
+ */
+ssize_t vban_header_check_pcm(const vban_header_t* header, ssize_t received);
+
+/**
+ * Bytes per sample of a PCM data type
+ * @return 1 or 2, 0 for other data types
+ */
+int vban_datatype_bytes(uint8_t format_bit);
+
+// nuFrame is little-endian on the wire
+static inline void vban_header_set_frame(vban_header_t* header, uint32_t frame) {
+    uint8_t* p = (uint8_t*)&header->nuFrame;
+    p[0] = (uint8_t)frame;
+    p[1] = (uint8_t)(frame >> 8);
+    p[2] = (uint8_t)(frame >> 16);
+    p[3] = (uint8_t)(frame >> 24);
+}
+
+static inline uint32_t vban_header_frame(const vban_header_t* header) {
+    const uint8_t* p = (const uint8_t*)&header->nuFrame;
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#endif /* VBAN4MAC_PACKET_H */
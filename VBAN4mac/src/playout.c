@@ -0,0 +1,423 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../include/vban4mac/playout.h"
+#include "buffer.h"
+#include "dtx.h"
+#include "jitter.h"
+#include "packet.h"
+
+#define PLAYOUT_DEFAULT_BUFFER_FRAMES 8192
+#define PLAYOUT_WINDOW_PACKETS 512      // Arrival offset is the minimum over one to two windows
+#define PLAYOUT_SLIP_TOLERANCE 1        // Frames a member may be off before its read position moves
+#define PLAYOUT_TARGET_STEP 256         // Automatic latency moves in steps of this many frames
+#define PLAYOUT_TARGET_HOLD_SECONDS 5   // Members must need less for this long before it steps down
+
+// One stream of the group. Its buffer is indexed by stream position
+// (nuFrame * packet frames), so gaps stay gaps and late packets still land
+// in the right place if they arrive before being played.
+typedef struct {
+    pthread_mutex_t mutex;
+    int active;                     // Slot holds a member; removed members leave it free for the next add
+    int channels;
+    int16_t* data;                  // capacity frames, frame p at (p mod capacity)
+    int64_t head_pos;               // Oldest buffered position
+    int64_t tail_pos;               // One past the newest buffered position
+    int started;                    // A packet has placed the stream on its timeline
+    int frames_per_packet;
+    int64_t last_index;             // Newest unwrapped nuFrame
+
+    // Arrival offset: common-clock frame minus stream position, minimum
+    // over the current and previous window of packets (the least delayed)
+    double window_min;
+    double prev_min;
+    int window_count;
+    double offset;
+
+    int64_t read_pos;               // Next position to pull
+    int reading;
+    jitter_estimator_t jitter;
+    vban_playout_member_stats_t stats;
+} playout_member_t;
+
+struct vban_playout_group_t {
+    int sample_rate;
+    uint32_t fixed_target;
+    size_t capacity;                // Frames per member buffer
+    pthread_mutex_t mutex;          // Serializes joins
+    atomic_int num_members;
+    _Atomic int64_t epoch_ns;       // First arrival in the group, frame 0 of the common clock
+    _Atomic uint32_t target;        // Latency currently applied
+    int anchored;                   // Pull side: timeline_pos is valid
+    int64_t timeline_pos;           // Common-clock frame of the next pull
+    int64_t target_met_pos;         // Pull side: last timeline_pos the members needed the whole target
+    playout_member_t members[VBAN_PLAYOUT_MAX_MEMBERS];
+};
+
+vban_playout_group_t* vban_playout_group_create(const vban_playout_group_config_t* config) {
+    if (!config || vban_sample_rate_index(config->sample_rate) < 0) {
+        return NULL;
+    }
+
+    vban_playout_group_t* group = calloc(1, sizeof(vban_playout_group_t));
+    if (!group) return NULL;
+
+    group->sample_rate = config->sample_rate;
+    group->fixed_target = config->target_frames;
+    group->capacity = config->buffer_frames ? config->buffer_frames : PLAYOUT_DEFAULT_BUFFER_FRAMES;
+    pthread_mutex_init(&group->mutex, NULL);
+    for (int i = 0; i < VBAN_PLAYOUT_MAX_MEMBERS; i++) {
+        pthread_mutex_init(&group->members[i].mutex, NULL);
+    }
+    atomic_init(&group->num_members, 0);
+    atomic_init(&group->epoch_ns, 0);
+    atomic_init(&group->target, config->target_frames);
+    return group;
+}
+
+int vban_playout_group_add(vban_playout_group_t* group, int channels, int sample_rate) {
+    if (!group || channels < 1 || channels > 256) return -1;
+    if (sample_rate != 0 && sample_rate != group->sample_rate) return -1;
+
+    // Reuse the first slot a removed member left
+    pthread_mutex_lock(&group->mutex);
+    int count = atomic_load(&group->num_members);
+    int index = 0;
+    while (index < count && group->members[index].active) index++;
+    if (index >= VBAN_PLAYOUT_MAX_MEMBERS) {
+        pthread_mutex_unlock(&group->mutex);
+        return -1;
+    }
+
+    playout_member_t* member = &group->members[index];
+    int16_t* data = calloc(group->capacity * channels, sizeof(int16_t));
+    if (!data) {
+        pthread_mutex_unlock(&group->mutex);
+        return -1;
+    }
+    pthread_mutex_lock(&member->mutex);
+    member->data = data;
+    member->channels = channels;
+    member->started = 0;
+    member->reading = 0;
+    member->last_index = 0;
+    jitter_init(&member->jitter);
+    memset(&member->stats, 0, sizeof(member->stats));
+    member->active = 1;
+    pthread_mutex_unlock(&member->mutex);
+
+    // Pushes and pulls only look at members below the published count
+    if (index == count) atomic_store(&group->num_members, index + 1);
+    pthread_mutex_unlock(&group->mutex);
+    return index;
+}
+
+int vban_playout_group_remove(vban_playout_group_t* group, int member_index) {
+    if (!group || member_index < 0 ||
+        member_index >= atomic_load_explicit(&group->num_members, memory_order_acquire)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&group->mutex);
+    playout_member_t* member = &group->members[member_index];
+    pthread_mutex_lock(&member->mutex);
+    int removed = member->active;
+    if (removed) {
+        member->active = 0;
+        member->started = 0;
+        free(member->data);
+        member->data = NULL;
+    }
+    pthread_mutex_unlock(&member->mutex);
+    pthread_mutex_unlock(&group->mutex);
+    return removed ? 0 : -1;
+}
+
+static int64_t floor_mod(int64_t pos, size_t capacity) {
+    int64_t index = pos % (int64_t)capacity;
+    return index < 0 ? index + (int64_t)capacity : index;
+}
+
+// Copy frames into the member buffer at a stream position, handling the
+// wrap; a NULL source writes silence
+static void member_copy_in(playout_member_t* member, size_t capacity, int64_t pos,
+                           const int16_t* src, int64_t frames) {
+    while (frames > 0) {
+        int64_t index = floor_mod(pos, capacity);
+        int64_t chunk = (int64_t)capacity - index;
+        if (chunk > frames) chunk = frames;
+        int16_t* dst = member->data + index * member->channels;
+        size_t bytes = (size_t)chunk * member->channels * sizeof(int16_t);
+        if (src) {
+            memcpy(dst, src, bytes);
+            src += chunk * member->channels;
+        } else {
+            memset(dst, 0, bytes);
+        }
+        pos += chunk;
+        frames -= chunk;
+    }
+}
+
+static void member_copy_out(const playout_member_t* member, size_t capacity, int64_t pos,
+                            int16_t* dst, int64_t frames) {
+    while (frames > 0) {
+        int64_t index = floor_mod(pos, capacity);
+        int64_t chunk = (int64_t)capacity - index;
+        if (chunk > frames) chunk = frames;
+        memcpy(dst, member->data + index * member->channels, (size_t)chunk * member->channels * sizeof(int16_t));
+        dst += chunk * member->channels;
+        pos += chunk;
+        frames -= chunk;
+    }
+}
+
+// Start the member's timeline afresh from a packet
+static void member_restart(playout_member_t* member, int64_t pos, int frames, double offset) {
+    member->started = 1;
+    member->frames_per_packet = frames;
+    member->head_pos = pos;
+    member->tail_pos = pos;
+    member->window_min = offset;
+    member->prev_min = INFINITY;
+    member->window_count = 0;
+    member->offset = offset;
+    member->reading = 0;
+}
+
+// Place a packet's frames at their stream position, with silence for any
+// gap (lost or suppressed packets) before them
+static void member_store(playout_member_t* member, size_t capacity, int64_t pos,
+                         const int16_t* samples, int frames) {
+    int64_t end = pos + frames;
+    if (end <= member->head_pos) {
+        member->stats.packets_late++;
+        return;
+    }
+
+    if (pos > member->tail_pos) {
+        int64_t gap_start = member->tail_pos;
+        if (pos - gap_start > (int64_t)capacity) gap_start = pos - (int64_t)capacity;
+        member_copy_in(member, capacity, gap_start, NULL, pos - gap_start);
+    }
+
+    // Frames already played can't be taken back
+    int64_t start = pos < member->head_pos ? member->head_pos : pos;
+    if (end - start > (int64_t)capacity) start = end - (int64_t)capacity;
+    member_copy_in(member, capacity, start, samples + (start - pos) * member->channels, end - start);
+
+    if (end > member->tail_pos) member->tail_pos = end;
+    if (member->tail_pos - member->head_pos > (int64_t)capacity) {
+        member->head_pos = member->tail_pos - (int64_t)capacity;
+    }
+}
+
+int vban_playout_group_push(vban_playout_group_t* group, int member_index, const vban_header_t* header,
+                            const int16_t* samples, int64_t arrival_ns) {
+    if (!group || !header || !samples || member_index < 0 ||
+        member_index >= atomic_load_explicit(&group->num_members, memory_order_acquire)) {
+        return -1;
+    }
+    playout_member_t* member = &group->members[member_index];
+    int frames = header->format_nbs + 1;
+
+    // The first arrival anywhere in the group is frame 0 of the common clock
+    int64_t epoch = atomic_load_explicit(&group->epoch_ns, memory_order_acquire);
+    if (epoch == 0) {
+        atomic_compare_exchange_strong(&group->epoch_ns, &epoch, arrival_ns);
+        epoch = atomic_load(&group->epoch_ns);
+    }
+    double arrival = (double)(arrival_ns - epoch) * group->sample_rate / 1e9;
+
+    uint32_t index = vban_header_frame(header);
+    size_t num_samples = (size_t)frames * (header->format_nbc + 1);
+    audio_buffer_span_t span = { { (int16_t*)samples, NULL }, { num_samples, 0 } };
+    int silent = dtx_is_silent(&span, num_samples);
+
+    pthread_mutex_lock(&member->mutex);
+    if (!member->active || header->format_nbc + 1 != member->channels) {
+        pthread_mutex_unlock(&member->mutex);
+        return -1;
+    }
+    // Positions count frames at the group's rate, so another rate can't be placed
+    if (vban_sample_rate_from_index(header->format_SR) != group->sample_rate) {
+        member->stats.packets_rejected++;
+        pthread_mutex_unlock(&member->mutex);
+        return -1;
+    }
+    jitter_update(&member->jitter, arrival_ns, index, frames, group->sample_rate, silent);
+
+    int64_t unwrapped = member->started ? member->last_index + (int32_t)(index - (uint32_t)member->last_index)
+                                        : (int64_t)index;
+    int64_t pos = unwrapped * frames;
+    double offset = arrival - (double)(pos + frames);
+
+    // Loss and suppressed silence keep the offset; a jump of more than the
+    // buffer means the sender restarted or the packet size changed
+    if (!member->started || frames != member->frames_per_packet ||
+        fabs(offset - member->offset) > (double)group->capacity) {
+        member_restart(member, pos, frames, offset);
+        member->last_index = unwrapped;
+    } else {
+        if (offset < member->window_min) member->window_min = offset;
+        if (++member->window_count == PLAYOUT_WINDOW_PACKETS) {
+            member->prev_min = member->window_min;
+            member->window_min = INFINITY;
+            member->window_count = 0;
+        }
+        member->offset = fmin(member->prev_min, member->window_min);
+        if (!isfinite(member->offset)) member->offset = offset;
+    }
+    if (unwrapped > member->last_index) member->last_index = unwrapped;
+
+    member_store(member, group->capacity, pos, samples, frames);
+    pthread_mutex_unlock(&member->mutex);
+    return 0;
+}
+
+// Pull one member's frames for the common-clock position timeline
+static void member_pull(playout_member_t* member, size_t capacity, int64_t timeline, uint32_t target,
+                        int16_t* out, size_t num_frames) {
+    size_t frame_bytes = member->channels * sizeof(int16_t);
+
+    pthread_mutex_lock(&member->mutex);
+    if (!member->active) {
+        pthread_mutex_unlock(&member->mutex);
+        return;  // A free slot: out is the caller's placeholder
+    }
+    if (!member->started) {
+        pthread_mutex_unlock(&member->mutex);
+        memset(out, 0, num_frames * frame_bytes);
+        return;
+    }
+
+    // Frames sent together are due together: shift by the member's offset
+    int64_t desired = timeline - (int64_t)target - llround(member->offset);
+    if (!member->reading) {
+        member->read_pos = desired;
+        member->reading = 1;
+    } else if (llabs(desired - member->read_pos) > PLAYOUT_SLIP_TOLERANCE) {
+        member->read_pos = desired;
+        member->stats.slips++;
+    }
+
+    int64_t start = member->read_pos;
+    int64_t end = start + (int64_t)num_frames;
+    int64_t from = start > member->head_pos ? start : member->head_pos;
+    int64_t to = end < member->tail_pos ? end : member->tail_pos;
+    if (from >= to) {
+        from = to = end;
+    }
+
+    memset(out, 0, (size_t)(from - start) * frame_bytes);
+    member_copy_out(member, capacity, from, out + (from - start) * member->channels, to - from);
+    memset(out + (to - start) * member->channels, 0, (size_t)(end - to) * frame_bytes);
+    member->stats.frames_played += (uint64_t)(to - from);
+    member->stats.frames_underrun += num_frames - (uint64_t)(to - from);
+
+    // What was skipped or played is gone
+    member->read_pos = end;
+    if (member->head_pos < end) member->head_pos = end;
+    if (member->tail_pos < member->head_pos) member->tail_pos = member->head_pos;
+    pthread_mutex_unlock(&member->mutex);
+}
+
+int vban_playout_group_pull(vban_playout_group_t* group, int64_t now_ns, int16_t* const* out, size_t num_frames) {
+    if (!group || !out) return -1;
+
+    int count = atomic_load_explicit(&group->num_members, memory_order_acquire);
+    int64_t epoch = atomic_load_explicit(&group->epoch_ns, memory_order_acquire);
+    if (epoch == 0) {
+        // Nothing has arrived yet, so no member has started and all pull silence
+        for (int i = 0; i < count; i++) {
+            member_pull(&group->members[i], group->capacity, 0, 0, out[i], num_frames);
+        }
+        return 0;
+    }
+
+    if (!group->anchored) {
+        if (now_ns == 0) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            now_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        }
+        group->timeline_pos = llround((double)(now_ns - epoch) * group->sample_rate / 1e9);
+        group->anchored = 1;
+        group->target_met_pos = group->timeline_pos;
+    }
+
+    // One latency for everyone, enough for the member with the worst jitter.
+    // Every change moves all members at once, so it moves in coarse steps:
+    // up as soon as a member needs more, and down one step at a time once
+    // every member has needed less for the hold time.
+    uint32_t target = atomic_load_explicit(&group->target, memory_order_relaxed);
+    if (group->fixed_target == 0) {
+        uint32_t needed = 0;
+        for (int i = 0; i < count; i++) {
+            playout_member_t* member = &group->members[i];
+            pthread_mutex_lock(&member->mutex);
+            uint32_t member_target = member->active ? jitter_target_frames(&member->jitter) : 0;
+            pthread_mutex_unlock(&member->mutex);
+            if (member_target > needed) needed = member_target;
+        }
+        needed = (needed + PLAYOUT_TARGET_STEP - 1) / PLAYOUT_TARGET_STEP * PLAYOUT_TARGET_STEP;
+
+        if (needed >= target) {
+            target = needed;
+            group->target_met_pos = group->timeline_pos;
+        } else if (group->timeline_pos - group->target_met_pos >=
+                   (int64_t)PLAYOUT_TARGET_HOLD_SECONDS * group->sample_rate) {
+            target -= PLAYOUT_TARGET_STEP;
+            group->target_met_pos = group->timeline_pos;
+        }
+        atomic_store_explicit(&group->target, target, memory_order_relaxed);
+    }
+
+    for (int i = 0; i < count; i++) {
+        member_pull(&group->members[i], group->capacity, group->timeline_pos, target, out[i], num_frames);
+    }
+    group->timeline_pos += (int64_t)num_frames;
+    return 0;
+}
+
+int vban_playout_group_get_stats(vban_playout_group_t* group, int member_index, vban_playout_member_stats_t* stats) {
+    if (!group || !stats || member_index < 0 ||
+        member_index >= atomic_load_explicit(&group->num_members, memory_order_acquire)) {
+        return -1;
+    }
+
+    // Skew is relative to the member whose audio arrives earliest
+    int count = atomic_load(&group->num_members);
+    double earliest = INFINITY;
+    double offset = 0.0;
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        playout_member_t* member = &group->members[i];
+        pthread_mutex_lock(&member->mutex);
+        if (member->active && member->started && member->offset < earliest) earliest = member->offset;
+        if (i == member_index && member->active) {
+            *stats = member->stats;
+            offset = member->started ? member->offset : NAN;
+            found = 1;
+        }
+        pthread_mutex_unlock(&member->mutex);
+    }
+    if (!found) return -1;
+
+    stats->target_frames = atomic_load_explicit(&group->target, memory_order_relaxed);
+    stats->skew_frames = isfinite(offset) && isfinite(earliest) ? llround(offset - earliest) : 0;
+    return 0;
+}
+
+void vban_playout_group_destroy(vban_playout_group_t* group) {
+    if (!group) return;
+    for (int i = 0; i < VBAN_PLAYOUT_MAX_MEMBERS; i++) {
+        pthread_mutex_destroy(&group->members[i].mutex);
+        free(group->members[i].data);
+    }
+    pthread_mutex_destroy(&group->mutex);
+    free(group);
+}
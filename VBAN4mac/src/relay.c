@@ -0,0 +1,514 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../include/vban4mac/relay.h"
+#include "net_util.h"
+#include "packet.h"
+#ifdef VBAN_URING
+#include "uring.h"
+#endif
+
+#define RELAY_BATCH 32
+#define RELAY_MAX_OUT (RELAY_BATCH * VBAN_RELAY_MAX_ROUTES)
+
+#ifdef VBAN_URING
+#define RELAY_URING_ENTRIES 256
+#define RELAY_URING_BUFFERS 256
+#define RELAY_URING_BUFFER_SIZE 2048    // Receive header, source address and a whole datagram
+#define RELAY_URING_SENDS (RELAY_URING_BUFFERS * VBAN_RELAY_MAX_ROUTES)
+#define RELAY_URING_RECV UINT64_MAX     // user_data of the receive; sends carry their slot
+#define RELAY_URING_CANCEL (UINT64_MAX - 1)
+
+// A send in flight, pointing into the receive buffer it forwards
+typedef struct {
+    struct msghdr msg;
+    struct iovec iov[2];
+    vban_header_t header;               // Rewritten copy, if the route changes the header
+    int buffer;
+} relay_send_t;
+#endif
+
+#ifdef __linux__
+typedef struct mmsghdr relay_msg_t;
+#else
+// Same layout as Linux's mmsghdr so the batch code is shared
+typedef struct {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+} relay_msg_t;
+#endif
+
+typedef struct {
+    char stream_name[16];
+    int match_all;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    char rename[16];
+    int do_rename;
+    int renumber;
+    uint32_t frame_counter;
+} relay_route_t;
+
+struct vban_relay_t {
+    int socket;
+    int family;
+    struct sockaddr_storage source_addr;
+    int filter_source;
+    relay_route_t routes[VBAN_RELAY_MAX_ROUTES];
+    int num_routes;
+    vban_relay_stats_t stats;
+
+    // Receive batch: header and payload land in separate buffers so the
+    // payload can be sent on as is
+    vban_header_t rx_header[RELAY_BATCH];
+    uint8_t rx_payload[RELAY_BATCH][VBAN_MAX_PACKET_SIZE];
+    struct sockaddr_storage rx_addr[RELAY_BATCH];
+    struct iovec rx_iov[RELAY_BATCH][2];
+    relay_msg_t rx_msgs[RELAY_BATCH];
+
+    // Send batch: one message per datagram and matching route
+    vban_header_t tx_header[RELAY_MAX_OUT];  // Rewritten headers
+    struct iovec tx_iov[RELAY_MAX_OUT][2];
+    relay_msg_t tx_msgs[RELAY_MAX_OUT];
+
+#ifdef VBAN_URING
+    // io_uring path, used instead of the batches above when ring is set
+    uring_t* ring;
+    int ring_enabled;
+    relay_send_t* sends;
+    uint32_t* free_sends;                   // Stack of free send slots
+    int num_free_sends;
+    uint16_t buffer_refs[RELAY_URING_BUFFERS];  // Routing plus sends in flight, per receive buffer
+#endif
+};
+
+#ifdef VBAN_URING
+static void relay_uring_free(vban_relay_t* relay) {
+    if (relay->ring) {
+        uring_destroy(relay->ring);
+        free(relay->ring);
+    }
+    free(relay->sends);
+    free(relay->free_sends);
+    relay->ring = NULL;
+    relay->sends = NULL;
+    relay->free_sends = NULL;
+}
+
+// Switch the relay to io_uring, or leave it on the socket batches if the
+// kernel doesn't support what is needed
+static void relay_uring_init(vban_relay_t* relay) {
+    relay->ring = malloc(sizeof(uring_t));
+    relay->sends = calloc(RELAY_URING_SENDS, sizeof(relay_send_t));
+    relay->free_sends = malloc(RELAY_URING_SENDS * sizeof(uint32_t));
+    if (!relay->ring || !relay->sends || !relay->free_sends) {
+        free(relay->ring);
+        relay->ring = NULL;
+        relay_uring_free(relay);
+        return;
+    }
+    // A ring that failed to initialize is left safe to destroy
+    if (uring_init(relay->ring, relay->socket, RELAY_URING_ENTRIES, RELAY_URING_BUFFERS,
+                   RELAY_URING_BUFFER_SIZE) != 0) {
+        perror("io_uring unavailable, relaying with recvmmsg/sendmmsg");
+        relay_uring_free(relay);
+        return;
+    }
+
+    for (int i = 0; i < RELAY_URING_SENDS; i++) {
+        relay->sends[i].msg.msg_iov = relay->sends[i].iov;
+        relay->sends[i].msg.msg_iovlen = 2;
+        relay->free_sends[i] = (uint32_t)(RELAY_URING_SENDS - 1 - i);
+    }
+    relay->num_free_sends = RELAY_URING_SENDS;
+}
+#endif
+
+vban_relay_t* vban_relay_create(const vban_relay_config_t* config) {
+    vban_relay_t* relay = calloc(1, sizeof(vban_relay_t));
+    if (!relay) return NULL;
+
+    uint16_t port = config->port ? config->port : VBAN_DEFAULT_PORT;
+    const char* family_ip = (config->bind_ip && config->bind_ip[0]) ? config->bind_ip : config->source_ip;
+    relay->family = net_family_of(family_ip);
+
+    struct sockaddr_storage local_addr;
+    socklen_t local_len, source_len;
+    if (net_parse_addr(config->bind_ip, port, relay->family, &local_addr, &local_len) != 0 ||
+        (config->source_ip && net_parse_addr(config->source_ip, port, relay->family,
+                                             &relay->source_addr, &source_len) != 0)) {
+        fprintf(stderr, "Invalid relay address\n");
+        free(relay);
+        return NULL;
+    }
+    relay->filter_source = config->source_ip != NULL;
+
+    relay->socket = net_open_udp_socket(relay->family, &local_addr, local_len);
+    if (relay->socket < 0) {
+        free(relay);
+        return NULL;
+    }
+
+    for (int i = 0; i < RELAY_BATCH; i++) {
+        relay->rx_iov[i][0].iov_base = &relay->rx_header[i];
+        relay->rx_iov[i][0].iov_len = VBAN_HEADER_SIZE;
+        relay->rx_iov[i][1].iov_base = relay->rx_payload[i];
+        relay->rx_iov[i][1].iov_len = VBAN_MAX_PACKET_SIZE;
+        relay->rx_msgs[i].msg_hdr.msg_iov = relay->rx_iov[i];
+        relay->rx_msgs[i].msg_hdr.msg_iovlen = 2;
+        relay->rx_msgs[i].msg_hdr.msg_name = &relay->rx_addr[i];
+    }
+    for (int i = 0; i < RELAY_MAX_OUT; i++) {
+        relay->tx_msgs[i].msg_hdr.msg_iov = relay->tx_iov[i];
+        relay->tx_msgs[i].msg_hdr.msg_iovlen = 2;
+    }
+
+#ifdef VBAN_URING
+    if (!config->use_sockets) relay_uring_init(relay);
+#endif
+    return relay;
+}
+
+int vban_relay_add_route(vban_relay_t* relay, const vban_relay_route_t* route) {
+    if (relay->num_routes >= VBAN_RELAY_MAX_ROUTES || !route->remote_ip) {
+        fprintf(stderr, "Invalid relay route\n");
+        return -1;
+    }
+
+    relay_route_t* r = &relay->routes[relay->num_routes];
+    memset(r, 0, sizeof(*r));
+
+    uint16_t port = route->port ? route->port : VBAN_DEFAULT_PORT;
+    if (net_parse_addr(route->remote_ip, port, relay->family, &r->addr, &r->addr_len) != 0) {
+        fprintf(stderr, "Failed to set relay destination: %s\n", route->remote_ip);
+        return -1;
+    }
+
+    r->match_all = route->stream_name == NULL;
+    if (route->stream_name) {
+        memcpy(r->stream_name, route->stream_name, strnlen(route->stream_name, sizeof(r->stream_name)));
+    }
+    r->do_rename = route->rename != NULL;
+    if (route->rename) {
+        memcpy(r->rename, route->rename, strnlen(route->rename, sizeof(r->rename)));
+    }
+    r->renumber = route->renumber;
+
+    relay->num_routes++;
+    return 0;
+}
+
+int vban_relay_fd(const vban_relay_t* relay) {
+    return relay->socket;
+}
+
+// Receive up to RELAY_BATCH datagrams without blocking
+// @return Number received, 0 if none are pending, -1 on error
+static int relay_receive_batch(vban_relay_t* relay) {
+    for (int i = 0; i < RELAY_BATCH; i++) {
+        relay->rx_msgs[i].msg_hdr.msg_namelen = sizeof(relay->rx_addr[i]);
+        relay->rx_msgs[i].msg_hdr.msg_flags = 0;
+    }
+
+#ifdef __linux__
+    int count = recvmmsg(relay->socket, relay->rx_msgs, RELAY_BATCH, MSG_DONTWAIT, NULL);
+#else
+    int count = 0;
+    while (count < RELAY_BATCH) {
+        ssize_t received = recvmsg(relay->socket, &relay->rx_msgs[count].msg_hdr, MSG_DONTWAIT);
+        if (received < 0) break;
+        relay->rx_msgs[count++].msg_len = (unsigned int)received;
+    }
+    if (count == 0) count = -1;
+#endif
+
+    if (count < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    return count;
+}
+
+// Send a batch of prepared messages, skipping any the kernel refuses
+static void relay_send_batch(vban_relay_t* relay, int count) {
+    int next = 0;
+    while (next < count) {
+#ifdef __linux__
+        int sent = sendmmsg(relay->socket, relay->tx_msgs + next, count - next, 0);
+#else
+        int sent = 0;
+        while (next + sent < count && sendmsg(relay->socket, &relay->tx_msgs[next + sent].msg_hdr, 0) >= 0) {
+            sent++;
+        }
+        if (sent == 0) sent = -1;
+#endif
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            relay->stats.send_errors++;
+            next++;
+            continue;
+        }
+        relay->stats.forwarded += sent;
+        next += sent;
+    }
+}
+
+static int relay_route_matches(const relay_route_t* route, const vban_header_t* header) {
+    return route->match_all || strncmp(header->streamname, route->stream_name, sizeof(header->streamname)) == 0;
+}
+
+// Header to send on a route: the received one, or a rewritten copy so
+// routes sharing the datagram don't see each other's changes
+static const vban_header_t* relay_route_header(relay_route_t* route, const vban_header_t* header,
+                                               vban_header_t* copy) {
+    if (!route->do_rename && !route->renumber) return header;
+
+    *copy = *header;
+    if (route->do_rename) {
+        memcpy(copy->streamname, route->rename, sizeof(copy->streamname));
+    }
+    if (route->renumber) {
+        vban_header_set_frame(copy, route->frame_counter++);
+    }
+    return copy;
+}
+
+// Whether a received datagram is VBAN from the configured source
+static int relay_accept(const vban_relay_t* relay, const vban_header_t* header,
+                        const struct sockaddr_storage* from) {
+    return ntohl(header->vban) == VBAN_MAGIC && (!relay->filter_source || net_addr_equal(from, &relay->source_addr));
+}
+
+// Queue one outgoing message per route that wants datagram i
+// @return Number of messages queued
+static int relay_route_datagram(vban_relay_t* relay, int i, int out) {
+    const vban_header_t* header = &relay->rx_header[i];
+    size_t payload_len = relay->rx_msgs[i].msg_len - VBAN_HEADER_SIZE;
+    int queued = 0;
+
+    for (int r = 0; r < relay->num_routes; r++) {
+        relay_route_t* route = &relay->routes[r];
+        if (!relay_route_matches(route, header)) continue;
+
+        int o = out + queued++;
+        const vban_header_t* out_header = relay_route_header(route, header, &relay->tx_header[o]);
+
+        relay->tx_iov[o][0].iov_base = (void*)out_header;
+        relay->tx_iov[o][0].iov_len = VBAN_HEADER_SIZE;
+        relay->tx_iov[o][1].iov_base = relay->rx_payload[i];
+        relay->tx_iov[o][1].iov_len = payload_len;
+        relay->tx_msgs[o].msg_hdr.msg_name = &route->addr;
+        relay->tx_msgs[o].msg_hdr.msg_namelen = route->addr_len;
+    }
+
+    return queued;
+}
+
+#ifdef VBAN_URING
+static void relay_uring_release(vban_relay_t* relay, int buffer) {
+    if (--relay->buffer_refs[buffer] == 0) uring_recycle(relay->ring, buffer);
+}
+
+// Queue a send per matching route straight from the buffer a datagram landed in
+static void relay_uring_received(vban_relay_t* relay, const struct io_uring_cqe* cqe) {
+    uring_datagram_t datagram;
+    int buffer = uring_datagram(relay->ring, cqe, &datagram);
+    if (buffer < 0) return;
+    relay->stats.received++;
+
+    // Held while routing, so a send completing early can't recycle the buffer
+    relay->buffer_refs[buffer] = 1;
+    const vban_header_t* header = (const vban_header_t*)datagram.data;
+    int queued = 0;
+
+    if (!datagram.truncated && datagram.len >= VBAN_HEADER_SIZE &&
+        datagram.len <= VBAN_HEADER_SIZE + VBAN_MAX_PACKET_SIZE && relay_accept(relay, header, datagram.addr)) {
+        for (int r = 0; r < relay->num_routes; r++) {
+            relay_route_t* route = &relay->routes[r];
+            if (!relay_route_matches(route, header)) continue;
+
+            struct io_uring_sqe* sqe = relay->num_free_sends > 0 ? uring_get_sqe(relay->ring) : NULL;
+            if (!sqe) {
+                relay->stats.send_errors++;
+                continue;
+            }
+            uint32_t slot = relay->free_sends[--relay->num_free_sends];
+            relay_send_t* send = &relay->sends[slot];
+            send->iov[0].iov_base = (void*)relay_route_header(route, header, &send->header);
+            send->iov[0].iov_len = VBAN_HEADER_SIZE;
+            send->iov[1].iov_base = datagram.data + VBAN_HEADER_SIZE;
+            send->iov[1].iov_len = datagram.len - VBAN_HEADER_SIZE;
+            send->msg.msg_name = &route->addr;
+            send->msg.msg_namelen = route->addr_len;
+            send->buffer = buffer;
+
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = relay->socket;
+            sqe->addr = (uint64_t)(uintptr_t)&send->msg;
+            sqe->len = 1;
+            sqe->user_data = slot;
+            relay->buffer_refs[buffer]++;
+            queued++;
+        }
+    }
+
+    if (queued == 0) relay->stats.unmatched++;
+    relay_uring_release(relay, buffer);
+}
+
+static void relay_uring_sent(vban_relay_t* relay, const struct io_uring_cqe* cqe) {
+    uint32_t slot = (uint32_t)cqe->user_data;
+    if (cqe->res < 0) {
+        relay->stats.send_errors++;
+    } else {
+        relay->stats.forwarded++;
+    }
+    relay_uring_release(relay, relay->sends[slot].buffer);
+    relay->free_sends[relay->num_free_sends++] = slot;
+}
+
+// Reap every completion that is ready
+// @return Completions handled, -1 if the receive failed
+static int relay_uring_reap(vban_relay_t* relay, int route) {
+    uring_t* ring = relay->ring;
+    struct io_uring_cqe* next;
+    int handled = 0, failed = 0;
+
+    while ((next = uring_peek_cqe(ring)) != NULL) {
+        struct io_uring_cqe cqe = *next;
+        uring_cqe_seen(ring);
+        handled++;
+
+        if (cqe.user_data == RELAY_URING_CANCEL) continue;
+        if (cqe.user_data != RELAY_URING_RECV) {
+            relay_uring_sent(relay, &cqe);
+            continue;
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE)) ring->recv_armed = 0;
+        if (cqe.res < 0) {
+            // Out of buffers just means the sends are behind; anything else is fatal
+            if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) failed = 1;
+            continue;
+        }
+        if (route) {
+            relay_uring_received(relay, &cqe);
+        } else {
+            uring_datagram_t datagram;
+            int buffer = uring_datagram(ring, &cqe, &datagram);
+            if (buffer >= 0) uring_recycle(ring, buffer);
+        }
+    }
+    return failed ? -1 : handled;
+}
+
+static int relay_process_uring(vban_relay_t* relay) {
+    uring_t* ring = relay->ring;
+    uint64_t received = relay->stats.received;
+
+    if (!relay->ring_enabled) {
+        if (uring_enable(ring) != 0) return -1;
+        relay->ring_enabled = 1;
+    }
+
+    // Submitting runs the deferred receives, whose sends are submitted on
+    // the next pass, until a pass finds nothing more to do
+    for (;;) {
+        if (!ring->recv_armed && uring_arm_recv(ring, RELAY_URING_RECV) != 0) break;
+        if (uring_submit(ring, 0) != 0) return -1;
+        int handled = relay_uring_reap(relay, 1);
+        if (handled < 0) {
+            return relay->stats.received > received ? (int)(relay->stats.received - received) : -1;
+        }
+        if (handled == 0 || !ring->recv_armed) break;
+    }
+
+    return (int)(relay->stats.received - received);
+}
+
+// Cancel the receive and wait for the sends in flight, which read from
+// the buffers about to be freed
+static void relay_uring_drain(vban_relay_t* relay) {
+    uring_t* ring = relay->ring;
+    if (!relay->ring_enabled) return;
+
+    if (ring->recv_armed) {
+        struct io_uring_sqe* sqe = uring_get_sqe(ring);
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = RELAY_URING_RECV;
+        sqe->user_data = RELAY_URING_CANCEL;
+    }
+    while (ring->recv_armed || relay->num_free_sends < RELAY_URING_SENDS) {
+        if (uring_submit(ring, 1) != 0 || relay_uring_reap(relay, 0) < 0) return;
+    }
+}
+#endif
+
+int vban_relay_process(vban_relay_t* relay, int timeout_ms) {
+    int total = 0;
+
+    if (timeout_ms != 0) {
+        struct pollfd pfd = { relay->socket, POLLIN, 0 };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready <= 0) {
+            return (ready < 0 && errno != EINTR) ? -1 : 0;
+        }
+    }
+
+#ifdef VBAN_URING
+    if (relay->ring) return relay_process_uring(relay);
+#endif
+
+    for (;;) {
+        int count = relay_receive_batch(relay);
+        if (count < 0) {
+            return total > 0 ? total : -1;
+        }
+        if (count == 0) break;
+
+        int out = 0;
+        for (int i = 0; i < count; i++) {
+            const relay_msg_t* msg = &relay->rx_msgs[i];
+            int queued = 0;
+
+            if (msg->msg_len >= VBAN_HEADER_SIZE && !(msg->msg_hdr.msg_flags & MSG_TRUNC) &&
+                relay_accept(relay, &relay->rx_header[i], &relay->rx_addr[i])) {
+                queued = relay_route_datagram(relay, i, out);
+            }
+            if (queued == 0) relay->stats.unmatched++;
+            out += queued;
+        }
+
+        relay->stats.received += count;
+        total += count;
+        relay_send_batch(relay, out);
+
+        if (count < RELAY_BATCH) break;
+    }
+
+    return total;
+}
+
+void vban_relay_get_stats(const vban_relay_t* relay, vban_relay_stats_t* stats) {
+    *stats = relay->stats;
+#ifdef VBAN_URING
+    stats->io_uring = relay->ring != NULL;
+#endif
+}
+
+void vban_relay_destroy(vban_relay_t* relay) {
+    if (!relay) return;
+#ifdef VBAN_URING
+    if (relay->ring) {
+        relay_uring_drain(relay);
+        relay_uring_free(relay);
+    }
+#endif
+    close(relay->socket);
+    free(relay);
+}
@@ -0,0 +1,98 @@
+#include <string.h>
+#include <time.h>
+#include "reorder.h"
+
+static int64_t reorder_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void reorder_init(reorder_t* reorder, int hold_ms) {
+    memset(reorder, 0, sizeof(*reorder));
+    reorder->hold_ns = (int64_t)(hold_ms > 0 ? hold_ms : REORDER_DEFAULT_HOLD_MS) * 1000000;
+}
+
+int reorder_check(reorder_t* reorder, uint32_t index) {
+    if (!reorder->started) {
+        reorder->started = 1;
+        reorder->next = index + 1;
+        return REORDER_PLAY;
+    }
+
+    int32_t step = (int32_t)(index - reorder->next);
+    if (step >= 0) {
+        reorder->stale_run = 0;
+        if (step == 0) {
+            reorder->next++;
+            return REORDER_PLAY;
+        }
+        return step < REORDER_WINDOW ? REORDER_HOLD : REORDER_FLUSH;
+    }
+
+    // Played on without it. A run of packets far behind is a restarted
+    // sender rather than a path lagging behind.
+    if (step <= -REORDER_WINDOW && ++reorder->stale_run >= REORDER_RESYNC_PACKETS) {
+        return REORDER_FLUSH;
+    }
+    atomic_fetch_add_explicit(&reorder->missed, 1, memory_order_relaxed);
+    return REORDER_LATE;
+}
+
+reorder_slot_t* reorder_hold(reorder_t* reorder, uint32_t index) {
+    // Held packets all lie within the window after next, so never share a slot
+    reorder_slot_t* slot = &reorder->slots[index % REORDER_WINDOW];
+    if (!slot->held) reorder->held++;
+    slot->held = 1;
+    slot->index = index;
+    slot->held_ns = reorder_now_ns();
+    return slot;
+}
+
+// Held packet with the lowest nuFrame
+static reorder_slot_t* reorder_first_held(const reorder_t* reorder) {
+    for (uint32_t i = 0; i < REORDER_WINDOW; i++) {
+        const reorder_slot_t* slot = &reorder->slots[(reorder->next + i) % REORDER_WINDOW];
+        if (slot->held && slot->index == reorder->next + i) return (reorder_slot_t*)slot;
+    }
+    return NULL;
+}
+
+reorder_slot_t* reorder_release(reorder_t* reorder, int flush) {
+    if (reorder->held == 0) return NULL;
+
+    reorder_slot_t* slot = reorder_first_held(reorder);
+    if (!slot) return NULL;
+    if (slot->index != reorder->next && !flush && reorder_now_ns() - slot->held_ns < reorder->hold_ns) {
+        return NULL;  // Still waiting for the packets before it
+    }
+
+    slot->held = 0;
+    reorder->held--;
+    reorder->next = slot->index + 1;
+    atomic_fetch_add_explicit(&reorder->reordered, 1, memory_order_relaxed);
+    return slot;
+}
+
+void reorder_restart(reorder_t* reorder, uint32_t index) {
+    for (int i = 0; i < REORDER_WINDOW; i++) {
+        reorder->slots[i].held = 0;
+    }
+    reorder->held = 0;
+    reorder->stale_run = 0;
+    reorder->next = index + 1;
+}
+
+int reorder_wait_ms(const reorder_t* reorder, int timeout_ms) {
+    const reorder_slot_t* slot = reorder->held ? reorder_first_held(reorder) : NULL;
+    if (!slot) return timeout_ms;
+    int64_t wait_ns = slot->held_ns + reorder->hold_ns - reorder_now_ns();
+    int wait_ms = wait_ns > 0 ? (int)((wait_ns + 999999) / 1000000) : 0;
+    return timeout_ms >= 0 && timeout_ms < wait_ms ? timeout_ms : wait_ms;
+}
+
+void reorder_get_stats(const reorder_t* reorder, vban_redundancy_stats_t* stats) {
+    reorder_t* r = (reorder_t*)reorder;
+    stats->reordered = atomic_load_explicit(&r->reordered, memory_order_relaxed);
+    stats->missed = atomic_load_explicit(&r->missed, memory_order_relaxed);
+}
@@ -0,0 +1,108 @@
+#ifndef VBAN4MAC_REORDER_H
+#define VBAN4MAC_REORDER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "../include/vban4mac/types.h"
+
+// Playout order of a stream merged from two network paths. Packets are
+// played in nuFrame order: one that arrives after a gap is held until the
+// missing packet's copy turns up on the slower path, or until it has
+// waited the hold time, when the gap is given up as lost. A copy that
+// turns up after that is too late and dropped. In-order packets pass
+// straight through, so the stage only costs latency while a gap is open.
+
+#define REORDER_WINDOW 32           // Packets held at most, about 170 ms of 256-frame packets at 48 kHz
+#define REORDER_RESYNC_PACKETS 8    // Consecutive packets far behind the window that mean the sender restarted
+#define REORDER_DEFAULT_HOLD_MS 40
+
+enum {
+    REORDER_PLAY,                   // The next packet: play it now, then the held ones reorder_release gives
+    REORDER_HOLD,                   // After a gap: store it in the slot reorder_hold gives
+    REORDER_LATE,                   // Behind packets already played: drop it
+    REORDER_FLUSH                   // Out of reach of the window: play everything held, then reorder_restart
+};
+
+// A held packet, as received
+typedef struct {
+    vban_header_t header;
+    int16_t payload[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];
+    size_t payload_bytes;
+    int64_t arrival_ns;
+    int path;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint32_t index;
+    int held;
+    int64_t held_ns;                // When it was stored
+} reorder_slot_t;
+
+typedef struct {
+    reorder_slot_t slots[REORDER_WINDOW];
+    uint32_t next;                  // nuFrame to play next
+    int started;
+    int held;
+    uint32_t stale_run;
+    int64_t hold_ns;
+
+    atomic_uint_fast64_t reordered;
+    atomic_uint_fast64_t missed;
+} reorder_t;
+
+/**
+ * Set up an empty stage
+ * @param reorder The stage
+ * @param hold_ms Longest a packet waits for the gap before it (0 = REORDER_DEFAULT_HOLD_MS)
+ */
+void reorder_init(reorder_t* reorder, int hold_ms);
+
+/**
+ * Decide what to do with a packet taken from either path
+ * @param reorder The stage
+ * @param index The packet's nuFrame
+ * @return One of REORDER_PLAY, REORDER_HOLD, REORDER_LATE, REORDER_FLUSH
+ */
+int reorder_check(reorder_t* reorder, uint32_t index);
+
+/**
+ * Take a slot for a packet reorder_check said to hold; the caller fills
+ * in everything but the index and timing
+ * @param reorder The stage
+ * @param index The packet's nuFrame
+ * @return The slot
+ */
+reorder_slot_t* reorder_hold(reorder_t* reorder, uint32_t index);
+
+/**
+ * Next held packet due to play: the one at the head of the stream, or once
+ * the packet after a gap has waited the hold time, that one
+ * @param reorder The stage
+ * @param flush Nonzero to give up on every gap now
+ * @return Slot, valid until the next reorder_hold, or NULL if none is due
+ */
+reorder_slot_t* reorder_release(reorder_t* reorder, int flush);
+
+/**
+ * Continue the stream after index, once a flush released everything held
+ * @param reorder The stage
+ * @param index nuFrame of the packet played after the flush
+ */
+void reorder_restart(reorder_t* reorder, uint32_t index);
+
+/**
+ * Shorten a poll timeout so a held packet is released when due
+ * @param reorder The stage
+ * @param timeout_ms Caller's timeout (-1 = forever)
+ * @return Timeout to use
+ */
+int reorder_wait_ms(const reorder_t* reorder, int timeout_ms);
+
+/**
+ * Packets held for order and copies that came too late so far; safe from
+ * any thread
+ */
+void reorder_get_stats(const reorder_t* reorder, vban_redundancy_stats_t* stats);
+
+#endif /* VBAN4MAC_REORDER_H */
@@ -0,0 +1,123 @@
+#include <math.h>
+#include "sample.h"
+
+static inline int16_t sample_round_int16(float in) {
+    float x = in * 32768.0f;
+    // Clamp first so overs clip at full scale (a NaN fails the first
+    // test and lands on the positive rail instead of an undefined cast)
+    x = x < 32767.0f ? x : 32767.0f;
+    x = x > -32768.0f ? x : -32768.0f;
+    // Round half away from zero, kept branch-free so the loop vectorizes
+    return (int16_t)(x + (x < 0.0f ? -0.5f : 0.5f));
+}
+
+void sample_float_to_int16(const float* in, size_t samples, int16_t* out) {
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = sample_round_int16(in[i]);
+    }
+}
+
+void sample_int16_to_float(const int16_t* in, size_t samples, float* out) {
+    const float scale = 1.0f / 32768.0f;
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = in[i] * scale;
+    }
+}
+
+void sample_int16_to_float_in_place(void* data, size_t samples) {
+    const float scale = 1.0f / 32768.0f;
+    unsigned char* bytes = (unsigned char*)data;
+    // Back to front, so each float only covers int16 samples already
+    // converted; memcpy keeps the two views of the bytes from aliasing
+    for (size_t i = samples; i-- > 0;) {
+        int16_t in;
+        memcpy(&in, bytes + i * sizeof(int16_t), sizeof(in));
+        float out = in * scale;
+        memcpy(bytes + i * sizeof(float), &out, sizeof(out));
+    }
+}
+
+void sample_from_le16(const int16_t* in, size_t samples, vban_sample_t* out) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < samples; i++) {
+        int16_t host = (int16_t)__builtin_bswap16((uint16_t)in[i]);
+        sample_from_int16(&host, 1, &out[i]);
+    }
+#else
+    sample_from_int16(in, samples, out);
+#endif
+}
+
+// The metered conversions keep METER_LANES independent peak and sum
+// accumulators, like the meter's own reductions, so they still vectorize
+static void sample_meter_fold(const float* max_lane, const float* sum_lane, audio_meter_block_t* block) {
+    for (int l = 0; l < METER_LANES; l++) {
+        block->peak = fmaxf(block->peak, max_lane[l]);
+        block->sum_sq += sum_lane[l];
+    }
+}
+
+void sample_float_to_int16_metered(const float* in, size_t samples, int16_t* out, audio_meter_block_t* block) {
+    float max_lane[METER_LANES] = {0};
+    float sum_lane[METER_LANES] = {0};
+    size_t i = 0;
+
+    for (; i + METER_LANES <= samples; i += METER_LANES) {
+        for (int l = 0; l < METER_LANES; l++) {
+            float v = in[i + l];
+            max_lane[l] = fmaxf(max_lane[l], fabsf(v));
+            sum_lane[l] += v * v;
+            out[i + l] = sample_round_int16(v);
+        }
+    }
+    for (; i < samples; i++) {
+        max_lane[0] = fmaxf(max_lane[0], fabsf(in[i]));
+        sum_lane[0] += in[i] * in[i];
+        out[i] = sample_round_int16(in[i]);
+    }
+    sample_meter_fold(max_lane, sum_lane, block);
+}
+
+void sample_int16_to_float_metered(const int16_t* in, size_t samples, float* out, audio_meter_block_t* block) {
+    const float scale = 1.0f / 32768.0f;
+    float max_lane[METER_LANES] = {0};
+    float sum_lane[METER_LANES] = {0};
+    size_t i = 0;
+
+    for (; i + METER_LANES <= samples; i += METER_LANES) {
+        for (int l = 0; l < METER_LANES; l++) {
+            float v = in[i + l] * scale;
+            max_lane[l] = fmaxf(max_lane[l], fabsf(v));
+            sum_lane[l] += v * v;
+            out[i + l] = v;
+        }
+    }
+    for (; i < samples; i++) {
+        float v = in[i] * scale;
+        max_lane[0] = fmaxf(max_lane[0], fabsf(v));
+        sum_lane[0] += v * v;
+        out[i] = v;
+    }
+    sample_meter_fold(max_lane, sum_lane, block);
+}
+
+void sample_copy_float_metered(const float* in, size_t samples, float* out, audio_meter_block_t* block) {
+    float max_lane[METER_LANES] = {0};
+    float sum_lane[METER_LANES] = {0};
+    size_t i = 0;
+
+    for (; i + METER_LANES <= samples; i += METER_LANES) {
+        for (int l = 0; l < METER_LANES; l++) {
+            float v = in[i + l];
+            max_lane[l] = fmaxf(max_lane[l], fabsf(v));
+            sum_lane[l] += v * v;
+            out[i + l] = v;
+        }
+    }
+    for (; i < samples; i++) {
+        max_lane[0] = fmaxf(max_lane[0], fabsf(in[i]));
+        sum_lane[0] += in[i] * in[i];
+        out[i] = in[i];
+    }
+    sample_meter_fold(max_lane, sum_lane, block);
+}
@@ -0,0 +1,157 @@
+#ifndef VBAN4MAC_SAMPLE_H
+#define VBAN4MAC_SAMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "meter.h"
+#include "../include/vban4mac/types.h"
+
+// Conversions at the edges of the bridge pipeline: between the 16-bit wire
+// format and vban_sample_t at encode/decode, and between vban_sample_t and
+// the float32 devices. Float full scale is 1.0 = 32768; float to int16
+// rounds to nearest and saturates instead of wrapping on overs.
+
+/**
+ * Convert float samples to int16, rounding and saturating
+ * @param in Float samples
+ * @param samples Number of samples
+ * @param out Destination
+ */
+void sample_float_to_int16(const float* in, size_t samples, int16_t* out);
+
+/**
+ * Convert int16 samples to float (exact)
+ * @param in Int16 samples
+ * @param samples Number of samples
+ * @param out Destination
+ */
+void sample_int16_to_float(const int16_t* in, size_t samples, float* out);
+
+/**
+ * Widen int16 samples at the start of a buffer into floats filling it
+ * @param data Storage for samples floats
+ * @param samples Number of samples
+ */
+void sample_int16_to_float_in_place(void* data, size_t samples);
+
+/**
+ * Encode samples to host-order int16 for the wire
+ */
+static inline void sample_to_int16(const vban_sample_t* in, size_t samples, int16_t* out) {
+#ifdef VBAN_SAMPLE_INT16
+    memcpy(out, in, samples * sizeof(int16_t));
+#else
+    sample_float_to_int16(in, samples, out);
+#endif
+}
+
+/**
+ * Decode host-order int16 samples from the wire
+ */
+static inline void sample_from_int16(const int16_t* in, size_t samples, vban_sample_t* out) {
+#ifdef VBAN_SAMPLE_INT16
+    memcpy(out, in, samples * sizeof(int16_t));
+#else
+    sample_int16_to_float(in, samples, out);
+#endif
+}
+
+/**
+ * Decode host-order int16 samples where they were received: the int16
+ * samples sit at the start of the storage for as many vban_sample_t, and
+ * are widened into it (nothing to do in int16 builds)
+ * @param data Storage for samples vban_sample_t
+ * @param samples Number of samples
+ */
+static inline void sample_from_int16_in_place(void* data, size_t samples) {
+#ifdef VBAN_SAMPLE_INT16
+    (void)data;
+    (void)samples;
+#else
+    sample_int16_to_float_in_place(data, samples);
+#endif
+}
+
+/**
+ * Decode little-endian int16 samples straight off the wire
+ */
+void sample_from_le16(const int16_t* in, size_t samples, vban_sample_t* out);
+
+/**
+ * Take samples from a float32 device
+ */
+static inline void sample_from_float(const float* in, size_t samples, vban_sample_t* out) {
+#ifdef VBAN_SAMPLE_INT16
+    sample_float_to_int16(in, samples, out);
+#else
+    memcpy(out, in, samples * sizeof(float));
+#endif
+}
+
+/**
+ * Hand samples to a float32 device
+ */
+static inline void sample_to_float(const vban_sample_t* in, size_t samples, float* out) {
+#ifdef VBAN_SAMPLE_INT16
+    sample_int16_to_float(in, samples, out);
+#else
+    memcpy(out, in, samples * sizeof(float));
+#endif
+}
+
+/**
+ * sample_float_to_int16, also adding the input's peak and sum of squares
+ * to block (which the caller zeroes before a block's first part)
+ */
+void sample_float_to_int16_metered(const float* in, size_t samples, int16_t* out, audio_meter_block_t* block);
+
+/**
+ * sample_int16_to_float, also adding the output's peak and sum of squares
+ * to block
+ */
+void sample_int16_to_float_metered(const int16_t* in, size_t samples, float* out, audio_meter_block_t* block);
+
+/**
+ * Copy float samples, also adding their peak and sum of squares to block
+ */
+void sample_copy_float_metered(const float* in, size_t samples, float* out, audio_meter_block_t* block);
+
+/**
+ * sample_from_float, metering the samples in the same pass
+ */
+static inline void sample_from_float_metered(const float* in, size_t samples, vban_sample_t* out,
+                                             audio_meter_block_t* block) {
+#ifdef VBAN_SAMPLE_INT16
+    sample_float_to_int16_metered(in, samples, out, block);
+#else
+    sample_copy_float_metered(in, samples, out, block);
+#endif
+}
+
+/**
+ * sample_to_float, metering the samples in the same pass
+ */
+static inline void sample_to_float_metered(const vban_sample_t* in, size_t samples, float* out,
+                                           audio_meter_block_t* block) {
+#ifdef VBAN_SAMPLE_INT16
+    sample_int16_to_float_metered(in, samples, out, block);
+#else
+    sample_copy_float_metered(in, samples, out, block);
+#endif
+}
+
+/**
+ * audio_meter_update_int16 or audio_meter_update_float, whichever fits
+ * the build's sample format
+ */
+static inline void audio_meter_update_samples(audio_meter_t* meter, const vban_sample_t* const* channels,
+                                              size_t frames) {
+#ifdef VBAN_SAMPLE_INT16
+    audio_meter_update_int16(meter, channels, frames);
+#else
+    audio_meter_update_float(meter, channels, frames);
+#endif
+}
+
+#endif /* VBAN4MAC_SAMPLE_H */
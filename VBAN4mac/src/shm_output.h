@@ -0,0 +1,24 @@
+#ifndef VBAN4MAC_SHM_OUTPUT_H
+#define VBAN4MAC_SHM_OUTPUT_H
+
+#include "../include/vban4mac/shm_ring.h"
+#include "../include/vban4mac/types.h"
+#include "buffer.h"
+
+// Default shared-memory ring size (about 340 ms at 48 kHz)
+#define SHM_OUTPUT_FRAMES 16384
+
+/**
+ * Mirror a committed receive ring region into a shared-memory ring,
+ * creating the ring from the first packet's format
+ * @param writer Ring writer, created on first use
+ * @param name Shared memory name
+ * @param header Header of the packet the samples came from
+ * @param span Region of the receive ring holding host-order samples
+ * @param samples Number of samples in the region
+ * @return 0 on success (packets in another format are skipped), -1 if the ring can't be created
+ */
+int shm_output_publish(vban_shm_writer_t** writer, const char* name, const vban_header_t* header,
+                       const audio_buffer_span_t* span, size_t samples);
+
+#endif /* VBAN4MAC_SHM_OUTPUT_H */
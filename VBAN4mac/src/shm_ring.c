@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/vban4mac/shm_ring.h"
+#include "../include/vban4mac/types.h"
+#include "shm_output.h"
+#include "packet.h"
+
+#define SHM_DATA_OFFSET 4096
+
+struct vban_shm_writer_t {
+    char name[64];
+    int fd;
+    void* map;
+    size_t map_size;
+    vban_shm_header_t* header;
+    int16_t* data;
+    size_t capacity_samples;
+    int channels;
+    uint64_t published_frames;
+    uint64_t pending_samples;       // Appended but not yet published
+};
+
+struct vban_shm_reader_t {
+    int fd;
+    void* map;
+    size_t map_size;
+    const vban_shm_header_t* header;
+    const int16_t* data;
+    uint64_t cursor;                // Next frame to read
+    uint64_t overruns;
+};
+
+vban_shm_writer_t* vban_shm_writer_create(const char* name, const char* stream_name,
+                                          int sample_rate, int channels, size_t capacity_frames) {
+    size_t capacity = 1;
+    while (capacity < capacity_frames) capacity <<= 1;
+
+    vban_shm_writer_t* writer = calloc(1, sizeof(vban_shm_writer_t));
+    if (!writer) return NULL;
+    memcpy(writer->name, name, strnlen(name, sizeof(writer->name) - 1));
+
+    // Replace any stale ring of the same name so it can be resized
+    shm_unlink(name);
+    writer->fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (writer->fd < 0) {
+        perror("Failed to create shared memory ring");
+        free(writer);
+        return NULL;
+    }
+
+    writer->map_size = SHM_DATA_OFFSET + capacity * channels * sizeof(int16_t);
+    if (ftruncate(writer->fd, (off_t)writer->map_size) != 0) {
+        perror("Failed to size shared memory ring");
+        close(writer->fd);
+        shm_unlink(name);
+        free(writer);
+        return NULL;
+    }
+
+    writer->map = mmap(NULL, writer->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, 0);
+    if (writer->map == MAP_FAILED) {
+        perror("Failed to map shared memory ring");
+        close(writer->fd);
+        shm_unlink(name);
+        free(writer);
+        return NULL;
+    }
+
+    writer->header = (vban_shm_header_t*)writer->map;
+    writer->data = (int16_t*)((uint8_t*)writer->map + SHM_DATA_OFFSET);
+    writer->capacity_samples = capacity * channels;
+    writer->channels = channels;
+
+    vban_shm_header_t* header = writer->header;
+    header->version = VBAN_SHM_VERSION;
+    header->sample_rate = (uint32_t)sample_rate;
+    header->channels = (uint32_t)channels;
+    header->sample_format = VBAN_DATATYPE_INT16;
+    header->capacity_frames = (uint32_t)capacity;
+    header->data_offset = SHM_DATA_OFFSET;
+    memcpy(header->stream_name, stream_name, strnlen(stream_name, sizeof(header->stream_name)));
+    atomic_store_explicit(&header->write_frames, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->reserve_frames, 0, memory_order_relaxed);
+
+    // Readers only trust the header once the magic is visible
+    atomic_thread_fence(memory_order_release);
+    header->magic = VBAN_SHM_MAGIC;
+
+    return writer;
+}
+
+int vban_shm_writer_channels(const vban_shm_writer_t* writer) {
+    return writer->channels;
+}
+
+void vban_shm_writer_append(vban_shm_writer_t* writer, const int16_t* samples, size_t num_samples) {
+    if (num_samples == 0) return;
+    if (num_samples > writer->capacity_samples) {
+        samples += num_samples - writer->capacity_samples;
+        num_samples = writer->capacity_samples;
+    }
+
+    // Tell readers which frames are about to be overwritten before touching them
+    uint64_t end = writer->published_frames * writer->channels + writer->pending_samples + num_samples;
+    uint64_t end_frames = (end + writer->channels - 1) / writer->channels;
+    atomic_store_explicit(&writer->header->reserve_frames, end_frames, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    size_t pos = (size_t)((end - num_samples) % writer->capacity_samples);
+    size_t first = writer->capacity_samples - pos;
+    if (first > num_samples) first = num_samples;
+    memcpy(writer->data + pos, samples, first * sizeof(int16_t));
+    memcpy(writer->data, samples + first, (num_samples - first) * sizeof(int16_t));
+
+    writer->pending_samples += num_samples;
+}
+
+void vban_shm_writer_commit(vban_shm_writer_t* writer) {
+    writer->published_frames += writer->pending_samples / writer->channels;
+    writer->pending_samples %= writer->channels;
+    atomic_store_explicit(&writer->header->write_frames, writer->published_frames, memory_order_release);
+}
+
+void vban_shm_writer_destroy(vban_shm_writer_t* writer) {
+    if (!writer) return;
+    munmap(writer->map, writer->map_size);
+    close(writer->fd);
+    shm_unlink(writer->name);
+    free(writer);
+}
+
+vban_shm_reader_t* vban_shm_reader_open(const char* name) {
+    vban_shm_reader_t* reader = calloc(1, sizeof(vban_shm_reader_t));
+    if (!reader) return NULL;
+
+    reader->fd = shm_open(name, O_RDONLY, 0);
+    if (reader->fd < 0) {
+        perror("Failed to open shared memory ring");
+        free(reader);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(reader->fd, &st) != 0 || (size_t)st.st_size < SHM_DATA_OFFSET) {
+        fprintf(stderr, "Shared memory ring %s is not initialized\n", name);
+        close(reader->fd);
+        free(reader);
+        return NULL;
+    }
+
+    reader->map_size = (size_t)st.st_size;
+    reader->map = mmap(NULL, reader->map_size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (reader->map == MAP_FAILED) {
+        perror("Failed to map shared memory ring");
+        close(reader->fd);
+        free(reader);
+        return NULL;
+    }
+
+    const vban_shm_header_t* header = (const vban_shm_header_t*)reader->map;
+    uint32_t magic = header->magic;
+    atomic_thread_fence(memory_order_acquire);
+    if (magic != VBAN_SHM_MAGIC || header->version != VBAN_SHM_VERSION ||
+        header->data_offset + (uint64_t)header->capacity_frames * header->channels * sizeof(int16_t) >
+            reader->map_size) {
+        fprintf(stderr, "Shared memory ring %s has an unknown format\n", name);
+        vban_shm_reader_close(reader);
+        return NULL;
+    }
+
+    reader->header = header;
+    reader->data = (const int16_t*)((const uint8_t*)reader->map + header->data_offset);
+    reader->cursor = atomic_load_explicit(&((vban_shm_header_t*)header)->write_frames, memory_order_acquire);
+    return reader;
+}
+
+const vban_shm_header_t* vban_shm_reader_header(const vban_shm_reader_t* reader) {
+    return reader->header;
+}
+
+size_t vban_shm_reader_peek(vban_shm_reader_t* reader, vban_shm_span_t* span, size_t max_frames) {
+    vban_shm_header_t* header = (vban_shm_header_t*)reader->header;
+    uint64_t capacity = header->capacity_frames;
+    uint64_t write = atomic_load_explicit(&header->write_frames, memory_order_acquire);
+
+    if (write - reader->cursor > capacity) {
+        // Fell a whole ring behind, skip to live data
+        reader->overruns++;
+        reader->cursor = write;
+    }
+
+    size_t frames = (size_t)(write - reader->cursor);
+    if (frames > max_frames) frames = max_frames;
+
+    size_t channels = header->channels;
+    size_t pos = (size_t)(reader->cursor & (capacity - 1));
+    size_t first = (size_t)capacity - pos;
+    if (first > frames) first = frames;
+
+    span->ptr[0] = reader->data + pos * channels;
+    span->frames[0] = first;
+    span->ptr[1] = reader->data;
+    span->frames[1] = frames - first;
+    return frames;
+}
+
+int vban_shm_reader_release(vban_shm_reader_t* reader, size_t frames) {
+    vban_shm_header_t* header = (vban_shm_header_t*)reader->header;
+
+    // Check the writer hadn't started overwriting the frames while they were read
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t reserve = atomic_load_explicit(&header->reserve_frames, memory_order_relaxed);
+    if (reserve - reader->cursor > header->capacity_frames) {
+        reader->overruns++;
+        reader->cursor = atomic_load_explicit(&header->write_frames, memory_order_acquire);
+        return -1;
+    }
+
+    reader->cursor += frames;
+    return 0;
+}
+
+uint64_t vban_shm_reader_position(const vban_shm_reader_t* reader) {
+    return reader->cursor;
+}
+
+uint64_t vban_shm_reader_overruns(const vban_shm_reader_t* reader) {
+    return reader->overruns;
+}
+
+void vban_shm_reader_close(vban_shm_reader_t* reader) {
+    if (!reader) return;
+    munmap(reader->map, reader->map_size);
+    close(reader->fd);
+    free(reader);
+}
+
+int shm_output_publish(vban_shm_writer_t** writer, const char* name, const vban_header_t* header,
+                       const audio_buffer_span_t* span, size_t samples) {
+    int channels = header->format_nbc + 1;
+
+    if (!*writer) {
+        *writer = vban_shm_writer_create(name, header->streamname,
+                                         vban_sample_rate_from_index(header->format_SR),
+                                         channels, SHM_OUTPUT_FRAMES);
+        if (!*writer) return -1;
+    }
+    if ((*writer)->channels != channels) {
+        return 0;  // The ring's format is fixed once created
+    }
+
+    size_t first = span->len[0] < samples ? span->len[0] : samples;
+    vban_shm_writer_append(*writer, span->ptr[0], first);
+    vban_shm_writer_append(*writer, span->ptr[1], samples - first);
+    vban_shm_writer_commit(*writer);
+    return 0;
+}
@@ -0,0 +1,884 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../include/vban4mac/stream.h"
+#include "adapt.h"
+#include "buffer.h"
+#include "dedup.h"
+#include "dsp_pool.h"
+#include "dtx.h"
+#include "format.h"
+#include "impair.h"
+#include "jitter.h"
+#include "net_util.h"
+#include "packet.h"
+#include "pacer_stream.h"
+#include "reorder.h"
+#include "sample.h"
+#include "shm_output.h"
+
+#define STREAM_DEFAULT_BUFFER_FRAMES 4096
+
+struct vban_sender_t {
+    int socket;
+    struct sockaddr_storage remote_addr;
+    socklen_t remote_addr_len;
+    vban_header_t header;           // Prebuilt, only nuFrame changes per packet
+    char streamname[16];
+    int sample_rate;
+    int channels;
+    int frames_per_packet;
+    uint32_t frame_counter;
+    vban_format_t ladder[ADAPT_MAX_LEVELS + 1];  // Rung 0 is the configured format
+    adapt_state_t adapt;
+    dtx_gate_t dtx;
+    pacer_stream_t* paced;          // Packets go through this pacer, NULL to send immediately
+    int redundant_socket;           // Second path, -1 for none
+    struct sockaddr_storage redundant_addr;
+    socklen_t redundant_addr_len;
+    pacer_stream_t* redundant_paced;
+    vban_sender_stats_t stats;
+    int16_t pending[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];  // Partial packet
+    size_t pending_frames;
+};
+
+// One network path the stream arrives on
+typedef struct {
+    int socket;
+    struct sockaddr_storage remote_addr;
+    int filter_sender;
+    impair_t* impair;               // Simulated network between the socket and the handling, NULL for none
+} receiver_path_t;
+
+struct vban_receiver_t {
+    receiver_path_t paths[2];
+    int num_paths;                  // 2 for a redundant stream
+    dedup_t* dedup;                 // Merge of the two paths, NULL for one
+    reorder_t* reorder;             // Puts the merged packets back in order, NULL for one path
+    char streamname[16];
+    int channels;
+    int sample_rate;                // Output rate, 0 to take packets at their own rate
+    format_decoder_t decoder;       // Packets not already in the output format
+    int16_t* decoded;               // VBAN_PROTOCOL_MAXNBS output frames, allocated on first use
+    int report_interval_ms;         // Loss reports to the sender, 0 for none
+    int report_started;
+    uint32_t report_index;          // nuFrame at the last report
+    uint64_t report_received;       // Packets accepted since the last report
+    uint64_t report_lost;           // lost_packets at the last report
+    audio_buffer_t ring;
+    jitter_estimator_t jitter;
+    vban_packet_callback on_packet;
+    void* user;
+    char shm_name[64];
+    vban_shm_writer_t* shm_writer;
+    dsp_stream_t* dsp;              // NULL unless a DSP pool was configured
+    vban_playout_group_t* group;    // Packets go to this group instead of the ring, NULL for none
+    int member;                     // Index in the group
+};
+
+// A rung must divide the sender's rate and packet, and keep to its channels
+static int sender_check_rung(const vban_format_t* rung, int sample_rate, int channels, int frames) {
+    if (rung->sample_rate <= 0 || vban_sample_rate_index(rung->sample_rate) < 0 ||
+        rung->channels < 1 || rung->channels > channels || (rung->bits != 8 && rung->bits != 16)) {
+        return -1;
+    }
+    int decimation = sample_rate / rung->sample_rate;
+    return decimation * rung->sample_rate == sample_rate && frames % decimation == 0 ? 0 : -1;
+}
+
+// Rebuild the header for a rung; every packet still covers the same time
+static void sender_set_level(vban_sender_t* sender, int level) {
+    const vban_format_t* rung = &sender->ladder[level];
+    int decimation = sender->sample_rate / rung->sample_rate;
+    vban_header_init(&sender->header, sender->streamname, vban_sample_rate_index(rung->sample_rate),
+                     sender->frames_per_packet / decimation, rung->channels,
+                     rung->bits == 8 ? VBAN_DATATYPE_BYTE8 : VBAN_DATATYPE_INT16);
+    sender->stats.quality_level = level;
+}
+
+vban_sender_t* vban_sender_create(const vban_sender_config_t* config) {
+    int sr_index = vban_sample_rate_index(config->sample_rate);
+    if (sr_index < 0 || config->channels < 1 || config->channels > 256 || !config->stream_name) {
+        fprintf(stderr, "Invalid VBAN sender configuration\n");
+        return NULL;
+    }
+
+    // Largest packet that fits the VBAN payload limit
+    int frames = VBAN_MAX_PACKET_SIZE / (config->channels * (int)sizeof(int16_t));
+    if (frames > VBAN_PROTOCOL_MAXNBS) frames = VBAN_PROTOCOL_MAXNBS;
+    if (frames < 1) {
+        fprintf(stderr, "Too many channels for one VBAN packet\n");
+        return NULL;
+    }
+    if (config->frames_per_packet > 0 && config->frames_per_packet < frames) {
+        frames = config->frames_per_packet;
+    }
+
+    vban_sender_t* sender = calloc(1, sizeof(vban_sender_t));
+    if (!sender) return NULL;
+
+    uint16_t port = config->port ? config->port : VBAN_DEFAULT_PORT;
+    int family = net_family_of(config->remote_ip);
+    if (net_parse_addr(config->remote_ip, port, family, &sender->remote_addr, &sender->remote_addr_len) != 0) {
+        fprintf(stderr, "Failed to set remote IP: %s\n", config->remote_ip);
+        free(sender);
+        return NULL;
+    }
+
+    sender->socket = socket(family, SOCK_DGRAM, 0);
+    if (sender->socket < 0) {
+        perror("Failed to create socket");
+        free(sender);
+        return NULL;
+    }
+
+    memcpy(sender->streamname, config->stream_name, strnlen(config->stream_name, sizeof(sender->streamname)));
+    sender->sample_rate = config->sample_rate;
+    sender->channels = config->channels;
+    sender->frames_per_packet = frames;
+    vban_header_init(&sender->header, config->stream_name, sr_index, frames, config->channels,
+                     VBAN_DATATYPE_INT16);
+    dtx_init(&sender->dtx, &config->dtx, frames, config->sample_rate);
+
+    adapt_init(&sender->adapt, &config->adapt);
+    sender->ladder[0].sample_rate = config->sample_rate;
+    sender->ladder[0].channels = config->channels;
+    sender->ladder[0].bits = 16;
+    for (int i = 0; i < sender->adapt.levels; i++) {
+        sender->ladder[i + 1] = config->adapt.ladder[i];
+        if (sender_check_rung(&sender->ladder[i + 1], config->sample_rate, config->channels, frames) != 0) {
+            fprintf(stderr, "Invalid quality ladder format %d\n", i);
+            close(sender->socket);
+            free(sender);
+            return NULL;
+        }
+    }
+
+    sender->redundant_socket = -1;
+    if (config->redundant_ip) {
+        // Its own socket, so the route (and interface) is chosen for the second destination
+        uint16_t redundant_port = config->redundant_port ? config->redundant_port : port;
+        int redundant_family = net_family_of(config->redundant_ip);
+        if (net_parse_addr(config->redundant_ip, redundant_port, redundant_family, &sender->redundant_addr,
+                           &sender->redundant_addr_len) != 0 ||
+            (sender->redundant_socket = socket(redundant_family, SOCK_DGRAM, 0)) < 0) {
+            fprintf(stderr, "Failed to set up redundant path to %s\n", config->redundant_ip);
+            close(sender->socket);
+            free(sender);
+            return NULL;
+        }
+    }
+
+    if (config->pacer) {
+        int64_t interval_ns = (int64_t)frames * 1000000000LL / config->sample_rate;
+        sender->paced = pacer_stream_add(config->pacer, sender->socket, &sender->remote_addr,
+                                         sender->remote_addr_len, interval_ns);
+        if (sender->paced && sender->redundant_socket >= 0) {
+            sender->redundant_paced = pacer_stream_add(config->pacer, sender->redundant_socket,
+                                                       &sender->redundant_addr, sender->redundant_addr_len,
+                                                       interval_ns);
+        }
+        if (!sender->paced || (sender->redundant_socket >= 0 && !sender->redundant_paced)) {
+            fprintf(stderr, "Failed to register sender with the pacer\n");
+            pacer_stream_remove(sender->paced);
+            if (sender->redundant_socket >= 0) close(sender->redundant_socket);
+            close(sender->socket);
+            free(sender);
+            return NULL;
+        }
+    }
+    return sender;
+}
+
+// Send one packet of frames_per_packet frames
+// @return 0 if sent (or queued on the pacer), 1 if suppressed as silence, -3 if the send failed
+static int sender_send_packet(vban_sender_t* sender, const int16_t* samples) {
+    size_t data_size = (size_t)sender->frames_per_packet * sender->channels * sizeof(int16_t);
+
+    audio_buffer_span_t payload = { { (int16_t*)samples, NULL }, { data_size / sizeof(int16_t), 0 } };
+    if (!dtx_should_send(&sender->dtx, &payload)) {
+        sender->frame_counter++;  // The receiver sees the gap as silence
+        sender->stats.packets_suppressed++;
+        return 1;
+    }
+
+    const void* data = samples;
+    uint8_t encoded[VBAN_MAX_PACKET_SIZE];
+    if (sender->adapt.level > 0) {
+        // A lower rung: fewer channels, rate or bits, already little-endian
+        const vban_format_t* rung = &sender->ladder[sender->adapt.level];
+        data_size = format_encode(samples, sender->frames_per_packet, sender->channels,
+                                  sender->sample_rate / rung->sample_rate, rung->channels,
+                                  rung->bits == 8 ? VBAN_DATATYPE_BYTE8 : VBAN_DATATYPE_INT16, encoded);
+        data = encoded;
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    // The wire is little-endian, so big-endian hosts need a swapped copy
+    int16_t swapped[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];
+    if (data == samples) {
+        for (size_t i = 0; i < data_size / sizeof(int16_t); i++) {
+            swapped[i] = (int16_t)__builtin_bswap16((uint16_t)samples[i]);
+        }
+        data = swapped;
+    }
+#endif
+
+    vban_header_set_frame(&sender->header, sender->frame_counter++);
+
+    struct iovec iov[2] = {
+        { &sender->header, VBAN_HEADER_SIZE },
+        { (void*)data, data_size }
+    };
+    if (sender->paced) {
+        // A full queue means the pacer has fallen behind; it counts the drop
+        int queued = pacer_stream_enqueue(sender->paced, iov, 2) == 0;
+        if (sender->redundant_paced) queued |= pacer_stream_enqueue(sender->redundant_paced, iov, 2) == 0;
+        if (queued) sender->stats.packets_sent++;
+        return 0;
+    }
+
+    struct msghdr msg = {0};
+    msg.msg_name = &sender->remote_addr;
+    msg.msg_namelen = sender->remote_addr_len;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    const ssize_t expected = (ssize_t)(VBAN_HEADER_SIZE + data_size);
+    int sent = sendmsg(sender->socket, &msg, 0) == expected;
+    if (sender->redundant_socket >= 0) {
+        // Either path getting it out is enough; the receiver takes whichever copy arrives
+        msg.msg_name = &sender->redundant_addr;
+        msg.msg_namelen = sender->redundant_addr_len;
+        int sent_redundant = sendmsg(sender->redundant_socket, &msg, 0) == expected;
+        if (sent != sent_redundant) sender->stats.path_failures++;
+        sent |= sent_redundant;
+    }
+    if (!sent) return -3;
+    sender->stats.packets_sent++;
+    return 0;
+}
+
+// Apply the loss reports that came back on one socket
+static void sender_poll_socket(vban_sender_t* sender, int socket) {
+    uint8_t buf[ADAPT_REPORT_SIZE + 1];
+    ssize_t len;
+    while ((len = recv(socket, buf, sizeof(buf), MSG_DONTWAIT)) >= 0) {
+        double loss_pct;
+        if (adapt_parse_report(buf, len, sender->streamname, &loss_pct) != 0) continue;
+
+        int64_t now_ms = (int64_t)sender->frame_counter * sender->frames_per_packet * 1000 / sender->sample_rate;
+        sender->stats.reported_loss_pct = loss_pct;
+        int level = adapt_on_report(&sender->adapt, loss_pct, now_ms);
+        if (level != sender->stats.quality_level) {
+            sender_set_level(sender, level);
+            sender->stats.quality_changes++;
+        }
+    }
+}
+
+// Apply the loss reports the receiver sent back since the last push, on
+// whichever path it heard from
+static void sender_poll_reports(vban_sender_t* sender) {
+    sender_poll_socket(sender, sender->socket);
+    if (sender->redundant_socket >= 0) sender_poll_socket(sender, sender->redundant_socket);
+}
+
+int vban_sender_push(vban_sender_t* sender, const int16_t* frames, size_t num_frames) {
+    if (!sender || (!frames && num_frames > 0)) {
+        return -1;
+    }
+    if (sender->adapt.levels > 0) sender_poll_reports(sender);
+
+    const size_t fpp = sender->frames_per_packet;
+    const int channels = sender->channels;
+    int packets = 0;
+
+    // Complete a partial packet left over from the previous push
+    if (sender->pending_frames > 0) {
+        size_t take = fpp - sender->pending_frames;
+        if (take > num_frames) take = num_frames;
+        memcpy(sender->pending + sender->pending_frames * channels, frames,
+               take * channels * sizeof(int16_t));
+        sender->pending_frames += take;
+        frames += take * channels;
+        num_frames -= take;
+
+        if (sender->pending_frames < fpp) {
+            return 0;
+        }
+        sender->pending_frames = 0;
+        int status = sender_send_packet(sender, sender->pending);
+        if (status < 0) return status;
+        packets += status == 0;
+    }
+
+    // Whole packets go straight from the caller's buffer to the kernel
+    while (num_frames >= fpp) {
+        int status = sender_send_packet(sender, frames);
+        if (status < 0) return status;
+        frames += fpp * channels;
+        num_frames -= fpp;
+        packets += status == 0;
+    }
+
+    // Keep the remainder for the next push
+    if (num_frames > 0) {
+        memcpy(sender->pending, frames, num_frames * channels * sizeof(int16_t));
+        sender->pending_frames = num_frames;
+    }
+
+    return packets;
+}
+
+void vban_sender_get_stats(const vban_sender_t* sender, vban_sender_stats_t* stats) {
+    *stats = sender->stats;
+}
+
+void vban_sender_destroy(vban_sender_t* sender) {
+    if (!sender) return;
+    pacer_stream_remove(sender->paced);
+    pacer_stream_remove(sender->redundant_paced);
+    close(sender->socket);
+    if (sender->redundant_socket >= 0) close(sender->redundant_socket);
+    free(sender);
+}
+
+// DSP pool output, called with blocks one at a time in arrival order
+static void receiver_on_dsp_block(void* user, const dsp_block_t* block) {
+    vban_receiver_t* receiver = (vban_receiver_t*)user;
+    int16_t frames[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];
+
+    // Back from the DSP's sample format to the stream's int16 frames
+    sample_to_int16(block->data, block->samples, frames);
+    if (receiver->group) {
+        vban_playout_group_push(receiver->group, receiver->member, &block->header, frames, block->arrival_ns);
+    } else {
+        audio_buffer_write(&receiver->ring, frames, block->samples);
+    }
+
+    if (receiver->shm_name[0]) {
+        audio_buffer_span_t span = { { frames, NULL }, { block->samples, 0 } };
+        if (shm_output_publish(&receiver->shm_writer, receiver->shm_name, &block->header, &span,
+                               block->samples) != 0) {
+            receiver->shm_name[0] = '\0';
+        }
+    }
+}
+
+// Bind one path's socket and set up its sender filter and impairment
+// @return 0 on success, -1 on error (the path is left for receiver_close_path)
+static int receiver_open_path(receiver_path_t* path, const char* bind_ip, uint16_t port, const char* remote_ip,
+                              const vban_impair_config_t* impair, unsigned seed_offset) {
+    const char* family_ip = (bind_ip && bind_ip[0]) ? bind_ip : remote_ip;
+    int family = net_family_of(family_ip);
+
+    struct sockaddr_storage local_addr;
+    socklen_t local_len, remote_len;
+    if (net_parse_addr(bind_ip, port, family, &local_addr, &local_len) != 0 ||
+        (remote_ip && net_parse_addr(remote_ip, port, family, &path->remote_addr, &remote_len) != 0)) {
+        fprintf(stderr, "Invalid receiver address\n");
+        return -1;
+    }
+    path->filter_sender = remote_ip != NULL;
+
+    path->socket = net_open_udp_socket(family, &local_addr, local_len);
+    if (path->socket < 0) return -1;
+
+    if (impair_active(impair)) {
+        path->impair = malloc(sizeof(impair_t));
+        if (!path->impair || impair_init(path->impair, impair, seed_offset) != 0) {
+            fprintf(stderr, "Failed to set up network impairment\n");
+            free(path->impair);
+            path->impair = NULL;
+            return -1;
+        }
+    }
+
+    net_enable_rx_timestamps(path->socket);
+    return 0;
+}
+
+static void receiver_close_paths(vban_receiver_t* receiver) {
+    for (int i = 0; i < 2; i++) {
+        receiver_path_t* path = &receiver->paths[i];
+        if (path->socket >= 0) close(path->socket);
+        if (path->impair) {
+            impair_destroy(path->impair);
+            free(path->impair);
+        }
+    }
+    free(receiver->dedup);
+    free(receiver->reorder);
+}
+
+vban_receiver_t* vban_receiver_create(const vban_receiver_config_t* config) {
+    if (config->channels < 1 || config->channels > 256 || !config->stream_name ||
+        (config->dsp_pool && !config->dsp)) {
+        fprintf(stderr, "Invalid VBAN receiver configuration\n");
+        return NULL;
+    }
+
+    vban_receiver_t* receiver = calloc(1, sizeof(vban_receiver_t));
+    if (!receiver) return NULL;
+    receiver->paths[0].socket = -1;
+    receiver->paths[1].socket = -1;
+
+    // A redundant stream arrives a second time on its own socket; the
+    // second path's impairment draws from its own seed
+    uint16_t port = config->port ? config->port : VBAN_DEFAULT_PORT;
+    receiver->num_paths = 1;
+    int status = receiver_open_path(&receiver->paths[0], config->bind_ip, port, config->remote_ip,
+                                    &config->impair, 0);
+    if (status == 0 && config->redundant_port) {
+        receiver->num_paths = 2;
+        receiver->dedup = malloc(sizeof(dedup_t));
+        receiver->reorder = malloc(sizeof(reorder_t));
+        if (receiver->dedup) dedup_init(receiver->dedup);
+        if (receiver->reorder) reorder_init(receiver->reorder, config->redundant_hold_ms);
+        status = !receiver->dedup || !receiver->reorder ? -1 :
+                 receiver_open_path(&receiver->paths[1],
+                                    config->redundant_bind_ip ? config->redundant_bind_ip : config->bind_ip,
+                                    config->redundant_port,
+                                    config->redundant_remote_ip ? config->redundant_remote_ip : config->remote_ip,
+                                    &config->redundant_impair, 1);
+    }
+    if (status != 0) {
+        receiver_close_paths(receiver);
+        free(receiver);
+        return NULL;
+    }
+
+    // Ring keeps one datagram of headroom so a packet can be received in place
+    size_t frames = config->buffer_frames ? config->buffer_frames : STREAM_DEFAULT_BUFFER_FRAMES;
+    if (audio_buffer_create(&receiver->ring, frames * config->channels +
+                            VBAN_MAX_PACKET_SIZE / sizeof(int16_t), sizeof(int16_t)) != 0) {
+        receiver_close_paths(receiver);
+        free(receiver);
+        return NULL;
+    }
+
+    if (config->group) {
+        receiver->group = config->group;
+        receiver->member = vban_playout_group_add(config->group, config->channels, config->sample_rate);
+        if (receiver->member < 0) {
+            fprintf(stderr, "Failed to join playout group (full, or at another sample rate)\n");
+            receiver_close_paths(receiver);
+            audio_buffer_destroy(&receiver->ring);
+            free(receiver);
+            return NULL;
+        }
+    }
+
+    if (config->dsp_pool) {
+        receiver->dsp = dsp_stream_create(config->dsp_pool, config->dsp, config->dsp_user,
+                                          receiver_on_dsp_block, receiver);
+        if (!receiver->dsp) {
+            receiver_close_paths(receiver);
+            audio_buffer_destroy(&receiver->ring);
+            free(receiver);
+            return NULL;
+        }
+    }
+
+    jitter_init(&receiver->jitter);
+
+    memcpy(receiver->streamname, config->stream_name,
+           strnlen(config->stream_name, sizeof(receiver->streamname)));
+    receiver->channels = config->channels;
+    receiver->sample_rate = config->sample_rate;
+    receiver->report_interval_ms = config->report_interval_ms;
+    format_decoder_init(&receiver->decoder, config->channels);
+    receiver->on_packet = config->on_packet;
+    receiver->user = config->user;
+    if (config->shm_name) {
+        memcpy(receiver->shm_name, config->shm_name,
+               strnlen(config->shm_name, sizeof(receiver->shm_name) - 1));
+    }
+    return receiver;
+}
+
+int vban_receiver_fd(const vban_receiver_t* receiver) {
+    return receiver->paths[0].socket;
+}
+
+int vban_receiver_redundant_fd(const vban_receiver_t* receiver) {
+    return receiver->num_paths == 2 ? receiver->paths[1].socket : -1;
+}
+
+// Output frames per packet frame, 0 if the packet's rate can't be played at the output rate
+static int receiver_interpolation(const vban_receiver_t* receiver, const vban_header_t* header) {
+    if (!receiver->sample_rate) return 1;
+    int rate = vban_sample_rate_from_index(header->format_SR);
+    if (rate <= 0 || receiver->sample_rate % rate != 0) return 0;
+    int interpolation = receiver->sample_rate / rate;
+    return (header->format_nbs + 1) * interpolation <= VBAN_PROTOCOL_MAXNBS ? interpolation : 0;
+}
+
+// Copy a received payload out of its span, which may wrap around the end of the ring
+static void receiver_copy_payload(void* out, const audio_buffer_span_t* span, size_t payload_bytes) {
+    size_t first = span->len[0] * sizeof(int16_t);
+    if (first > payload_bytes) first = payload_bytes;
+    memcpy(out, span->ptr[0], first);
+    if (payload_bytes > first) memcpy((uint8_t*)out + first, span->ptr[1], payload_bytes - first);
+}
+
+// Decode a packet an adaptive sender sent in a reduced format to the
+// output format, and rewrite its header to describe the result
+// @return Output samples, -1 on error
+static ssize_t receiver_decode(vban_receiver_t* receiver, vban_header_t* header, audio_buffer_span_t* span,
+                               size_t payload_bytes, int interpolation) {
+    if (!receiver->decoded) {
+        receiver->decoded = malloc((size_t)VBAN_PROTOCOL_MAXNBS * receiver->channels * sizeof(int16_t));
+        if (!receiver->decoded) return -1;
+    }
+
+    uint8_t raw[VBAN_MAX_PACKET_SIZE];
+    receiver_copy_payload(raw, span, payload_bytes);
+
+    size_t frames = format_decode(&receiver->decoder, header, raw, interpolation, receiver->decoded);
+    if (receiver->sample_rate) {
+        header->format_SR = (uint8_t)(vban_sample_rate_index(receiver->sample_rate) | VBAN_PROTOCOL_AUDIO);
+    }
+    header->format_nbs = (uint8_t)(frames - 1);
+    header->format_nbc = (uint8_t)(receiver->channels - 1);
+    header->format_bit = VBAN_DATATYPE_INT16;
+
+    size_t samples = frames * receiver->channels;
+    span->ptr[0] = receiver->decoded;
+    span->len[0] = samples;
+    span->ptr[1] = NULL;
+    span->len[1] = 0;
+    return (ssize_t)samples;
+}
+
+// Remember the last frame of a packet in the output format, so a switch to
+// a reduced format interpolates from it
+static void receiver_note_last_frame(vban_receiver_t* receiver, const audio_buffer_span_t* span, size_t samples) {
+    for (int c = 0; c < receiver->channels; c++) {
+        size_t i = samples - receiver->channels + c;
+        receiver->decoder.last[c] = i < span->len[0] ? ((const int16_t*)span->ptr[0])[i]
+                                                      : ((const int16_t*)span->ptr[1])[i - span->len[0]];
+    }
+}
+
+// Every report_interval_ms of stream time, tell the sender how much of the
+// stream was lost since the previous report
+static void receiver_report_loss(vban_receiver_t* receiver, int socket, const vban_header_t* header,
+                                 const struct sockaddr_storage* addr, socklen_t addr_len) {
+    uint32_t index = vban_header_frame(header);
+    vban_jitter_stats_t stats;
+
+    receiver->report_received++;
+    if (!receiver->report_started) {
+        jitter_get_stats(&receiver->jitter, &stats);
+        receiver->report_started = 1;
+        receiver->report_index = index;
+        receiver->report_received = 0;
+        receiver->report_lost = stats.lost_packets;
+        return;
+    }
+
+    int64_t frames = (int64_t)receiver->report_interval_ms * vban_sample_rate_from_index(header->format_SR) / 1000;
+    uint32_t packets = (uint32_t)(frames / (header->format_nbs + 1));
+    if ((uint32_t)(index - receiver->report_index) < (packets > 0 ? packets : 1)) return;
+
+    jitter_get_stats(&receiver->jitter, &stats);
+    uint64_t lost = stats.lost_packets >= receiver->report_lost ? stats.lost_packets - receiver->report_lost : 0;
+    double loss_pct = 100.0 * lost / (lost + receiver->report_received);
+
+    uint8_t report[ADAPT_REPORT_SIZE];
+    size_t len = adapt_build_report(report, receiver->streamname, loss_pct);
+    sendto(socket, report, len, 0, (const struct sockaddr*)addr, addr_len);
+
+    receiver->report_index = index;
+    receiver->report_received = 0;
+    receiver->report_lost = stats.lost_packets;
+}
+
+// Play a packet that was received and accepted: bring it to the output
+// format, note its timing and hand it to the DSP pool, the playout group or
+// the ring. The payload is in the ring storage reserved for it if in_ring;
+// with a DSP pool, block is the block to process it in.
+// @return 1 if played, 0 if dropped
+static int receiver_play(vban_receiver_t* receiver, int socket, vban_header_t* header, audio_buffer_span_t* span,
+                         size_t payload_bytes, int in_ring, dsp_block_t* block, int64_t arrival_ns,
+                         const struct sockaddr_storage* addr, socklen_t addr_len) {
+    const size_t max_samples = VBAN_MAX_PACKET_SIZE / sizeof(int16_t);
+    ssize_t total_samples = vban_header_check_pcm(header, VBAN_HEADER_SIZE + payload_bytes);
+    int interpolation = receiver_interpolation(receiver, header);
+
+    // Packets in the output format are used in place; others (from an
+    // adaptive sender's lower rungs) are decoded to it
+    int native = interpolation == 1 && header->format_nbc + 1 == receiver->channels &&
+                 (header->format_bit & VBAN_DATATYPE_MASK) == VBAN_DATATYPE_INT16;
+    if (native) {
+        audio_buffer_span_from_le(span, total_samples);
+        receiver_note_last_frame(receiver, span, total_samples);
+    } else {
+        total_samples = receiver_decode(receiver, header, span, payload_bytes, interpolation);
+        if (total_samples < 0 || (block && (size_t)total_samples > max_samples)) {
+            if (block) dsp_stream_release(receiver->dsp, block);
+            return 0;
+        }
+    }
+
+    jitter_update(&receiver->jitter, arrival_ns, vban_header_frame(header),
+                  header->format_nbs + 1, vban_sample_rate_from_index(header->format_SR),
+                  dtx_is_silent(span, total_samples));
+
+    if (block) {
+        // The pool writes the ring (and shared memory) once the DSP has run
+        sample_from_int16(span->ptr[0], total_samples, block->data);
+        block->header = *header;
+        block->arrival_ns = arrival_ns;
+        block->samples = total_samples;
+        dsp_stream_submit(receiver->dsp, block);
+    } else {
+        if (receiver->group) {
+            vban_playout_group_push(receiver->group, receiver->member, header, span->ptr[0], arrival_ns);
+        } else if (native && in_ring) {
+            audio_buffer_commit(&receiver->ring, total_samples);
+        } else {
+            audio_buffer_write(&receiver->ring, span->ptr[0], total_samples);
+        }
+        if (receiver->shm_name[0] &&
+            shm_output_publish(&receiver->shm_writer, receiver->shm_name, header, span, total_samples) != 0) {
+            receiver->shm_name[0] = '\0';
+        }
+    }
+
+    if (receiver->report_interval_ms > 0) {
+        receiver_report_loss(receiver, socket, header, addr, addr_len);
+    }
+    if (receiver->on_packet) {
+        receiver->on_packet(receiver->user, header, header->format_nbs + 1);
+    }
+    return 1;
+}
+
+// Play the packets held for order that are due, in nuFrame order
+// @return Packets played
+static int receiver_play_held(vban_receiver_t* receiver, int flush) {
+    int played = 0;
+    reorder_slot_t* slot;
+    while ((slot = reorder_release(receiver->reorder, flush)) != NULL) {
+        dsp_block_t* block = NULL;
+        if (receiver->dsp && !(block = dsp_stream_acquire(receiver->dsp))) continue;
+        audio_buffer_span_t span = { { slot->payload, NULL }, { sizeof(slot->payload) / sizeof(int16_t), 0 } };
+        played += receiver_play(receiver, receiver->paths[slot->path].socket, &slot->header, &span,
+                                slot->payload_bytes, 0, block, slot->arrival_ns, &slot->addr, slot->addr_len);
+    }
+    return played;
+}
+
+int vban_receiver_process(vban_receiver_t* receiver, int timeout_ms) {
+    const size_t max_samples = VBAN_MAX_PACKET_SIZE / sizeof(int16_t);
+    int16_t scratch[VBAN_MAX_PACKET_SIZE / sizeof(int16_t)];
+    int accepted = 0, failed = 0;
+
+    if (timeout_ms != 0) {
+        // Packets held by the impairment or for order become due without a
+        // socket waking
+        struct pollfd pfds[2];
+        int wait_ms = timeout_ms, held = 0;
+        for (int p = 0; p < receiver->num_paths; p++) {
+            pfds[p].fd = receiver->paths[p].socket;
+            pfds[p].events = POLLIN;
+            pfds[p].revents = 0;
+            if (receiver->paths[p].impair) {
+                wait_ms = impair_wait_ms(receiver->paths[p].impair, wait_ms);
+                held = 1;
+            }
+        }
+        if (receiver->reorder && receiver->reorder->held > 0) {
+            wait_ms = reorder_wait_ms(receiver->reorder, wait_ms);
+            held = 1;
+        }
+        int ready = poll(pfds, receiver->num_paths, wait_ms);
+        if (ready < 0 && errno != EINTR) return -1;
+        if (ready <= 0 && !held) return 0;
+    }
+
+    // Drain every path; a path that fails doesn't stop the other
+    for (int p = 0; p < receiver->num_paths; p++) {
+        receiver_path_t* path = &receiver->paths[p];
+        for (;;) {
+            struct sockaddr_storage sender_addr;
+            vban_header_t header;
+            audio_buffer_span_t span;
+            union {
+                struct cmsghdr align;
+                char buf[NET_TIMESTAMP_CONTROL_SIZE];
+            } control;
+
+            dsp_block_t* block = NULL;
+            if (receiver->dsp) {
+                // Take a DSP block to decode into, or drop the packet if the
+                // window is full
+                block = dsp_stream_acquire(receiver->dsp);
+                span.ptr[0] = scratch;
+                span.len[0] = max_samples;
+                span.ptr[1] = NULL;
+                span.len[1] = 0;
+            } else if (receiver->group) {
+                // The group places the packet on its timeline
+                span.ptr[0] = scratch;
+                span.len[0] = max_samples;
+                span.ptr[1] = NULL;
+                span.len[1] = 0;
+            } else {
+                // Receive the payload straight into free ring storage
+                audio_buffer_reserve(&receiver->ring, max_samples, &span);
+            }
+
+            struct iovec iov[3] = {
+                { &header, VBAN_HEADER_SIZE },
+                { span.ptr[0], span.len[0] * sizeof(int16_t) },
+                { span.ptr[1], span.len[1] * sizeof(int16_t) }
+            };
+            struct msghdr msg = {0};
+            msg.msg_name = &sender_addr;
+            msg.msg_namelen = sizeof(sender_addr);
+            msg.msg_iov = iov;
+            msg.msg_iovlen = 3;
+            msg.msg_control = control.buf;
+            msg.msg_controllen = sizeof(control.buf);
+
+            ssize_t received = path->impair ? impair_recvmsg(path->impair, path->socket, &msg)
+                                            : recvmsg(path->socket, &msg, MSG_DONTWAIT);
+            if (received < 0) {
+                if (block) dsp_stream_release(receiver->dsp, block);
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) failed++;
+                break;
+            }
+
+            ssize_t total_samples = vban_header_check_pcm(&header, received);
+            int interpolation = total_samples < 0 ? 0 : receiver_interpolation(receiver, &header);
+            if (interpolation == 0 ||
+                (path->filter_sender && !net_addr_equal(&sender_addr, &path->remote_addr)) ||
+                strncmp(header.streamname, receiver->streamname, sizeof(header.streamname)) != 0 ||
+                header.format_nbc + 1 > receiver->channels ||
+                (receiver->dsp && !block)) {
+                if (block) dsp_stream_release(receiver->dsp, block);
+                continue;
+            }
+
+            // The copy from the other path may have been taken already
+            if (receiver->dedup && !dedup_accept(receiver->dedup, vban_header_frame(&header), p)) {
+                if (block) dsp_stream_release(receiver->dsp, block);
+                continue;
+            }
+
+            int64_t arrival_ns = net_rx_timestamp_ns(&msg);
+            size_t payload_bytes = (size_t)received - VBAN_HEADER_SIZE;
+            int in_ring = !receiver->dsp && !receiver->group;
+            if (receiver->reorder) {
+                uint32_t index = vban_header_frame(&header);
+                int verdict = reorder_check(receiver->reorder, index);
+                if (verdict == REORDER_HOLD) {
+                    // After a gap the other path may still fill
+                    reorder_slot_t* slot = reorder_hold(receiver->reorder, index);
+                    slot->header = header;
+                    receiver_copy_payload(slot->payload, &span, payload_bytes);
+                    slot->payload_bytes = payload_bytes;
+                    slot->arrival_ns = arrival_ns;
+                    slot->path = p;
+                    slot->addr = sender_addr;
+                    slot->addr_len = msg.msg_namelen;
+                }
+                if (verdict == REORDER_HOLD || verdict == REORDER_LATE) {
+                    if (block) dsp_stream_release(receiver->dsp, block);
+                    continue;
+                }
+                if (verdict == REORDER_FLUSH) {
+                    // The held packets play first, and may need the ring
+                    // space this one was received into
+                    if (in_ring) {
+                        receiver_copy_payload(scratch, &span, payload_bytes);
+                        span.ptr[0] = scratch;
+                        span.len[0] = max_samples;
+                        span.ptr[1] = NULL;
+                        span.len[1] = 0;
+                        in_ring = 0;
+                    }
+                    accepted += receiver_play_held(receiver, 1);
+                    reorder_restart(receiver->reorder, index);
+                }
+            }
+
+            accepted += receiver_play(receiver, path->socket, &header, &span, payload_bytes, in_ring, block,
+                                      arrival_ns, &sender_addr, msg.msg_namelen);
+            if (receiver->reorder) accepted += receiver_play_held(receiver, 0);
+        }
+    }
+
+    // Packets held for order whose wait is over
+    if (receiver->reorder) accepted += receiver_play_held(receiver, 0);
+    return accepted == 0 && failed == receiver->num_paths ? -1 : accepted;
+}
+
+int vban_receiver_group_member(const vban_receiver_t* receiver) {
+    return receiver->group ? receiver->member : -1;
+}
+
+size_t vban_receiver_available(vban_receiver_t* receiver) {
+    return audio_buffer_available(&receiver->ring) / receiver->channels;
+}
+
+size_t vban_receiver_pull(vban_receiver_t* receiver, int16_t* out, size_t num_frames) {
+    size_t frames = vban_receiver_available(receiver);
+    if (frames > num_frames) frames = num_frames;
+
+    size_t samples = frames * receiver->channels;
+    if (frames > 0 && audio_buffer_read(&receiver->ring, out, samples) != samples) {
+        // The receive side dropped old frames in the meantime
+        frames = 0;
+        samples = 0;
+    }
+
+    // Fill what the network didn't deliver with silence
+    memset(out + samples, 0, (num_frames - frames) * receiver->channels * sizeof(int16_t));
+    return frames;
+}
+
+void vban_receiver_get_jitter_stats(const vban_receiver_t* receiver, vban_jitter_stats_t* stats) {
+    jitter_get_stats(&receiver->jitter, stats);
+}
+
+void vban_receiver_get_impair_stats(const vban_receiver_t* receiver, vban_impair_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int p = 0; p < receiver->num_paths; p++) {
+        if (!receiver->paths[p].impair) continue;
+        vban_impair_stats_t path;
+        impair_get_stats(receiver->paths[p].impair, &path);
+        stats->received += path.received;
+        stats->delivered += path.delivered;
+        stats->lost_random += path.lost_random;
+        stats->lost_burst += path.lost_burst;
+        stats->lost_queue += path.lost_queue;
+        stats->reordered += path.reordered;
+        stats->duplicated += path.duplicated;
+    }
+}
+
+void vban_receiver_get_redundancy_stats(const vban_receiver_t* receiver, vban_redundancy_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (receiver->dedup) dedup_get_stats(receiver->dedup, stats);
+    if (receiver->reorder) reorder_get_stats(receiver->reorder, stats);
+}
+
+void vban_receiver_destroy(vban_receiver_t* receiver) {
+    if (!receiver) return;
+    receiver_close_paths(receiver);
+    dsp_stream_destroy(receiver->dsp);  // Delivers what is still in flight
+    if (receiver->group) vban_playout_group_remove(receiver->group, receiver->member);
+    vban_shm_writer_destroy(receiver->shm_writer);
+    audio_buffer_destroy(&receiver->ring);
+    free(receiver->decoded);
+    free(receiver);
+}
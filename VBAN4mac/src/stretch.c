@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stretch.h"
+
+#define STRETCH_HOP_MS 8                // Half a segment; segments are 16 ms
+#define STRETCH_CHUNK 1024              // Frames copied per step while playing input as is
+#define STRETCH_DEFAULT_WINDOW_MS 1000
+#define STRETCH_MAX_SPEED_PCT 25
+#define STRETCH_COARSE_STEP 4           // Decimation of the first search pass
+
+int stretch_init(stretch_t* st, int channels, int sample_rate, const vban_catchup_config_t* config) {
+    memset(st, 0, sizeof(*st));
+    int pct = config->max_speed_pct;
+    if (pct > STRETCH_MAX_SPEED_PCT) pct = STRETCH_MAX_SPEED_PCT;
+    if (channels < 1 || pct < 1) return -1;
+
+    st->channels = channels;
+    st->hop = sample_rate * STRETCH_HOP_MS / 1000;
+    st->tolerance = st->hop;
+    st->max_change = pct / 100.0;
+    st->window_frames = (double)sample_rate * (config->window_ms > 0 ? config->window_ms : STRETCH_DEFAULT_WINDOW_MS) / 1000.0;
+
+    // History the search can reach back to, plus the most a hop or a chunk looks ahead
+    st->capacity = 2 * (size_t)(st->hop + 2 * st->tolerance) + (size_t)st->hop + STRETCH_CHUNK;
+    st->window = malloc(2 * (size_t)st->hop * sizeof(float));
+    st->in = calloc(st->capacity * channels, sizeof(vban_sample_t));
+    st->pending = calloc((size_t)st->hop * channels, sizeof(vban_sample_t));
+    if (!st->window || !st->in || !st->pending) {
+        stretch_destroy(st);
+        return -1;
+    }
+
+    // Periodic Hann: the halves of overlapping windows sum to exactly 1
+    for (int i = 0; i < 2 * st->hop; i++) {
+        st->window[i] = (float)(0.5 - 0.5 * cos(M_PI * i / st->hop));
+    }
+    atomic_init(&st->frames_compressed, 0);
+    atomic_init(&st->frames_expanded, 0);
+    return 0;
+}
+
+void stretch_destroy(stretch_t* st) {
+    free(st->window);
+    free(st->in);
+    free(st->pending);
+    st->window = NULL;
+    st->in = NULL;
+    st->pending = NULL;
+}
+
+size_t stretch_buffered(const stretch_t* st) {
+    return (st->length - st->cursor) + (st->pending_len - st->pending_pos);
+}
+
+static inline vban_sample_t stretch_store(float v) {
+#ifdef VBAN_SAMPLE_INT16
+    v = v < 32767.0f ? v : 32767.0f;
+    v = v > -32768.0f ? v : -32768.0f;
+    return (vban_sample_t)(v + (v < 0.0f ? -0.5f : 0.5f));
+#else
+    return v;
+#endif
+}
+
+// Hold input frames up to end, reading the rest from the ring
+static int stretch_fill(stretch_t* st, audio_buffer_t* ring, size_t end) {
+    if (end <= st->length) return 0;
+
+    if (end > st->capacity) {
+        // Drop what the search can no longer reach
+        size_t history = (size_t)(st->hop + 2 * st->tolerance);
+        size_t keep = st->cursor > history ? st->cursor - history : 0;
+        memmove(st->in, st->in + keep * st->channels, (st->length - keep) * st->channels * sizeof(vban_sample_t));
+        st->length -= keep;
+        st->cursor -= keep;
+        st->ideal -= (double)keep;
+        end -= keep;
+        if (end > st->capacity) return -1;
+    }
+
+    size_t samples = (end - st->length) * st->channels;
+    vban_sample_t* dst = st->in + st->length * st->channels;
+    if (audio_buffer_read(ring, dst, samples) != samples) return -1;
+    st->length = end;
+    return 0;
+}
+
+// Similarity of the hop of input at start to the one at ref, summed over
+// channels, normalized by the candidate's energy
+static float stretch_score(const stretch_t* st, size_t start, size_t ref, int step) {
+    const vban_sample_t* a = st->in + start * st->channels;
+    const vban_sample_t* b = st->in + ref * st->channels;
+    float dot = 0.0f, energy = 1e-9f;
+    for (int j = 0; j < st->hop; j += step) {
+        float x = 0.0f, y = 0.0f;
+        for (int c = 0; c < st->channels; c++) {
+            x += (float)a[j * st->channels + c];
+            y += (float)b[j * st->channels + c];
+        }
+        dot += x * y;
+        energy += x * x;
+    }
+    return dot / sqrtf(energy);
+}
+
+// Synthesize the next hop into pending
+static int stretch_hop(stretch_t* st, audio_buffer_t* ring, double rate, long excess) {
+    // Segments are nominally hop * rate apart; the actual start is searched
+    // within a tolerance of that, so the input is consumed at rate on average
+    // (relative to the cursor, which moves if the input buffer is compacted)
+    double ahead = st->ideal + st->hop * rate - (double)st->cursor;
+    long reach = lround(ahead) + st->tolerance;
+    if (stretch_fill(st, ring, st->cursor + (size_t)(reach > 0 ? reach : 0) + st->hop) != 0) return -1;
+    st->ideal = (double)st->cursor + ahead;
+
+    long nominal = lround(st->ideal);
+    long lo = nominal - st->tolerance, hi = nominal + st->tolerance;
+    // Never skip or repeat more than the excess, so the last hop can't overshoot
+    long limit = (long)st->cursor + excess;
+    if (excess > 0 && hi > limit) hi = limit;
+    if (excess < 0 && lo < limit) lo = limit;
+    if (lo < 0) lo = 0;
+    if (lo > hi) lo = hi;
+
+    // Keep the unmodified continuation while it is in range (and the
+    // nominal start after that) unless something matches better: a
+    // coarse pass on every few frames and offsets, then a refinement
+    long continuation = (long)st->cursor;
+    long best = continuation >= lo && continuation <= hi ? continuation : (nominal < lo ? lo : nominal > hi ? hi : nominal);
+    float best_score = stretch_score(st, (size_t)best, st->cursor, STRETCH_COARSE_STEP);
+    for (long s = lo; s <= hi; s += STRETCH_COARSE_STEP) {
+        float score = stretch_score(st, (size_t)s, st->cursor, STRETCH_COARSE_STEP);
+        if (score > best_score) {
+            best_score = score;
+            best = s;
+        }
+    }
+    long coarse = best;
+    best_score = stretch_score(st, (size_t)best, st->cursor, 1);
+    for (long s = coarse - STRETCH_COARSE_STEP + 1; s < coarse + STRETCH_COARSE_STEP; s++) {
+        if (s < lo || s > hi || s == coarse) continue;
+        float score = stretch_score(st, (size_t)s, st->cursor, 1);
+        if (score > best_score) {
+            best_score = score;
+            best = s;
+        }
+    }
+
+    // Fade the previous segment's continuation out and the new segment in
+    int ch = st->channels;
+    const vban_sample_t* tail = st->in + st->cursor * ch;
+    const vban_sample_t* head = st->in + (size_t)best * ch;
+    for (int j = 0; j < st->hop; j++) {
+        float fade_out = st->window[st->hop + j], fade_in = st->window[j];
+        for (int c = 0; c < ch; c++) {
+            st->pending[j * ch + c] = stretch_store(fade_out * (float)tail[j * ch + c] + fade_in * (float)head[j * ch + c]);
+        }
+    }
+    st->pending_pos = 0;
+    st->pending_len = st->hop;
+
+    long skipped = best - (long)st->cursor;
+    if (skipped > 0) {
+        atomic_fetch_add_explicit(&st->frames_compressed, (uint64_t)skipped, memory_order_relaxed);
+    } else if (skipped < 0) {
+        atomic_fetch_add_explicit(&st->frames_expanded, (uint64_t)-skipped, memory_order_relaxed);
+    }
+    st->cursor = (size_t)best + st->hop;
+    return 0;
+}
+
+// Speed for the next hop, with hysteresis so jitter around the target
+// doesn't keep engaging it
+static double stretch_rate(stretch_t* st, long excess) {
+    long magnitude = excess < 0 ? -excess : excess;
+    if (magnitude < (st->stretching ? st->hop / 2 : 2 * st->hop)) return 1.0;
+
+    // Proportional to the excess, with a floor so the last of it still drains
+    double change = magnitude / st->window_frames;
+    if (change > st->max_change) change = st->max_change;
+    if (change < st->max_change / 4) change = st->max_change / 4;
+    // Slowing down stretches the waveform further from what a search can
+    // match, so rebuilding goes at half the pace of catching up
+    return excess > 0 ? 1.0 + change : 1.0 - change / 2;
+}
+
+static void stretch_deinterleave(const vban_sample_t* src, int channels, vban_sample_t* const* out, size_t offset,
+                                 size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        for (int c = 0; c < channels; c++) {
+            out[c][offset + i] = src[i * channels + c];
+        }
+    }
+}
+
+size_t stretch_render(stretch_t* st, audio_buffer_t* ring, vban_sample_t* const* out, size_t frames,
+                      size_t target_frames) {
+    long ring_frames = (long)(audio_buffer_available(ring) / st->channels);
+    long excess = ring_frames + (long)stretch_buffered(st) - (long)target_frames;
+    size_t done = 0;
+
+    while (done < frames) {
+        if (st->pending_pos < st->pending_len) {
+            size_t n = st->pending_len - st->pending_pos;
+            if (n > frames - done) n = frames - done;
+            stretch_deinterleave(st->pending + st->pending_pos * st->channels, st->channels, out, done, n);
+            st->pending_pos += n;
+            done += n;
+            continue;
+        }
+
+        double rate = stretch_rate(st, excess);
+        if (rate != 1.0) {
+            if (!st->stretching) st->ideal = (double)st->cursor - st->hop;
+            size_t cursor = st->cursor;
+            if (stretch_hop(st, ring, rate, excess) == 0) {
+                st->stretching = 1;
+                // Input consumed minus output produced
+                excess -= (long)(st->cursor - cursor) - st->hop;
+                continue;
+            }
+            // Too little buffered to search: play on as is
+        }
+        st->stretching = 0;
+
+        size_t n = frames - done;
+        if (n > STRETCH_CHUNK) n = STRETCH_CHUNK;
+        if (stretch_fill(st, ring, st->cursor + n) != 0) {
+            n = st->length - st->cursor;  // Play what is left, then report the underrun
+            if (n == 0) break;
+            if (n > frames - done) n = frames - done;
+        }
+        stretch_deinterleave(st->in + st->cursor * st->channels, st->channels, out, done, n);
+        st->cursor += n;
+        done += n;
+    }
+
+    if (done < frames) st->stretching = 0;
+    return done;
+}
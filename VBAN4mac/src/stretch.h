@@ -0,0 +1,75 @@
+#ifndef VBAN4MAC_STRETCH_H
+#define VBAN4MAC_STRETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "buffer.h"
+#include "../include/vban4mac/types.h"
+
+// WSOLA time-stretching between an output ring and the render callback,
+// steering how much audio is buffered toward a target without pitch change
+// or discontinuities. Output is built one hop at a time from Hann-windowed
+// segments overlapping by half. Segments nominally start hop * rate input
+// frames apart. Within a small tolerance of that, the start is chosen where
+// the input best matches how the previous segment would have continued, so
+// the overlap adds up to a seamless waveform. Close to
+// the target, input is played as is (bit-exact) with no added latency. The
+// work per hop is fixed (a decimated search, then a short refinement), so
+// the cost of a callback is bounded by its length.
+
+typedef struct {
+    int channels;
+    int hop;                        // Output frames per step, half the segment length
+    int tolerance;                  // Search range around the nominal segment start
+    double max_change;              // Largest rate deviation from 1
+    double window_frames;           // Rate deviation is excess / window_frames
+    float* window;                  // Hann window of 2 * hop
+    vban_sample_t* in;              // Interleaved input frames [0, length), history before cursor
+    size_t capacity;                // Frames in can hold
+    size_t length;
+    size_t cursor;                  // Next input frame of the unmodified continuation
+    vban_sample_t* pending;         // Last synthesized hop, played from pending_pos
+    size_t pending_pos;
+    size_t pending_len;
+    int stretching;                 // Engaged, as opposed to playing input as is
+    double ideal;                   // Nominal start of the last segment, advancing hop * rate per hop
+    atomic_uint_fast64_t frames_compressed;
+    atomic_uint_fast64_t frames_expanded;
+} stretch_t;
+
+/**
+ * Set up a stretcher
+ * @param st Stretcher to initialize
+ * @param channels Interleaved channels of the ring
+ * @param sample_rate Sample rate, which sets the segment length
+ * @param config Largest speed change and drain window (max_speed_pct must be above 0)
+ * @return 0 on success, -1 on error
+ */
+int stretch_init(stretch_t* st, int channels, int sample_rate, const vban_catchup_config_t* config);
+
+/**
+ * Free a stretcher's buffers
+ */
+void stretch_destroy(stretch_t* st);
+
+/**
+ * Frames taken from the ring but not yet played
+ * @param st The stretcher
+ * @return Frames held
+ */
+size_t stretch_buffered(const stretch_t* st);
+
+/**
+ * Produce output frames, reading input from the ring as needed
+ * @param st The stretcher
+ * @param ring Interleaved input frames
+ * @param out One destination array per channel
+ * @param frames Frames wanted
+ * @param target_frames Frames that should be buffered (ring plus stretcher) at the start of a call
+ * @return Frames written; fewer than frames means the input ran out
+ */
+size_t stretch_render(stretch_t* st, audio_buffer_t* ring, vban_sample_t* const* out, size_t frames,
+                      size_t target_frames);
+
+#endif /* VBAN4MAC_STRETCH_H */
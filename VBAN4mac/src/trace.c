@@ -0,0 +1,250 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  // pthread_getname_np
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "trace.h"
+#include "../include/vban4mac/vban.h"
+
+#ifdef VBAN_TRACE
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+#define TRACE_RING_SIZE 8192          // Events per thread, power of two
+#define TRACE_MAX_THREADS 16          // Rings allocated up front, one per tracing thread
+#define TRACE_EXPORT_INTERVAL_US 50000
+
+typedef struct {
+    uint64_t ticks;
+    const char* name;
+    int64_t value;
+    char phase;
+} trace_record_t;
+
+// Single-producer (owning thread) / single-consumer (exporter) ring
+typedef struct trace_ring {
+    trace_record_t records[TRACE_RING_SIZE];
+    atomic_uint_fast64_t head;        // Written by the owning thread
+    atomic_uint_fast64_t tail;        // Written by the exporter
+    atomic_uint_fast64_t dropped;
+    int tid;
+    int named;                        // Thread name emitted in the current export
+    char thread_name[32];
+    struct trace_ring* next;
+} trace_ring_t;
+
+// Rings are allocated by vban_trace_start, off the audio threads, and a
+// thread claims one on its first event. They live for the rest of the
+// process so exiting threads never race the exporter.
+static _Thread_local trace_ring_t* tls_ring = NULL;
+static trace_ring_t* rings[TRACE_MAX_THREADS];
+static atomic_int rings_claimed = 0;
+static _Atomic(trace_ring_t*) ring_list = NULL;
+static atomic_uint_fast64_t unclaimed_dropped = 0;  // Events of threads beyond TRACE_MAX_THREADS
+static atomic_int tracing = 0;
+
+static FILE* trace_file = NULL;
+static pthread_t export_thread;
+static int first_record = 1;
+
+static inline uint64_t trace_ticks(void) {
+#ifdef __APPLE__
+    return mach_absolute_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static double trace_ticks_to_us(uint64_t ticks) {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) mach_timebase_info(&timebase);
+    return (double)ticks * timebase.numer / timebase.denom / 1000.0;
+#else
+    return ticks / 1000.0;
+#endif
+}
+
+// Claim a preallocated ring for the calling thread. Never allocates: this
+// runs on whatever thread traces first, which may be a real-time callback.
+// Reading the own thread's name is a prctl on Linux and a copy on macOS.
+static trace_ring_t* trace_register_thread(void) {
+    int index = atomic_fetch_add(&rings_claimed, 1);
+    if (index >= TRACE_MAX_THREADS) {
+        atomic_fetch_sub(&rings_claimed, 1);
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);  // Pairs with vban_trace_start setting tracing
+    trace_ring_t* ring = rings[index];
+
+    ring->tid = index + 1;
+    if (pthread_getname_np(pthread_self(), ring->thread_name, sizeof(ring->thread_name)) != 0 ||
+        ring->thread_name[0] == '\0') {
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "thread-%d", ring->tid);
+    }
+
+    // Lock-free push onto the global list
+    trace_ring_t* head = atomic_load(&ring_list);
+    do {
+        ring->next = head;
+    } while (!atomic_compare_exchange_weak(&ring_list, &head, ring));
+
+    tls_ring = ring;
+    return ring;
+}
+
+void trace_event(const char* name, char phase, int64_t value) {
+    if (!atomic_load_explicit(&tracing, memory_order_relaxed)) return;
+
+    trace_ring_t* ring = tls_ring;
+    if (!ring && !(ring = trace_register_thread())) {
+        atomic_fetch_add_explicit(&unclaimed_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint_fast64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint_fast64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= TRACE_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    trace_record_t* record = &ring->records[head & (TRACE_RING_SIZE - 1)];
+    record->ticks = trace_ticks();
+    record->name = name;
+    record->value = value;
+    record->phase = phase;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void trace_write_separator(void) {
+    if (!first_record) fputs(",\n", trace_file);
+    first_record = 0;
+}
+
+// Drain every thread's ring into the trace file
+static void trace_drain(void) {
+    for (trace_ring_t* ring = atomic_load(&ring_list); ring; ring = ring->next) {
+        uint_fast64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint_fast64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        if (!ring->named && head > tail) {
+            ring->named = 1;
+            trace_write_separator();
+            fprintf(trace_file,
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    ring->tid, ring->thread_name);
+        }
+
+        for (; tail < head; tail++) {
+            const trace_record_t* record = &ring->records[tail & (TRACE_RING_SIZE - 1)];
+            trace_write_separator();
+            if (record->phase == 'C') {
+                fprintf(trace_file,
+                        "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lld}}",
+                        record->name, trace_ticks_to_us(record->ticks), ring->tid, (long long)record->value);
+            } else {
+                fprintf(trace_file, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d%s}",
+                        record->name, record->phase, trace_ticks_to_us(record->ticks), ring->tid,
+                        record->phase == 'i' ? ",\"s\":\"t\"" : "");
+            }
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    fflush(trace_file);
+}
+
+static void* trace_export_thread(void* arg) {
+    (void)arg;
+    while (atomic_load(&tracing)) {
+        usleep(TRACE_EXPORT_INTERVAL_US);
+        trace_drain();
+    }
+    return NULL;
+}
+
+int vban_trace_start(const char* path) {
+    if (atomic_load(&tracing)) return -1;
+
+    // Allocate every ring now so threads never allocate on their first event
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        if (!rings[i] && !(rings[i] = calloc(1, sizeof(trace_ring_t)))) {
+            fprintf(stderr, "Failed to allocate trace rings\n");
+            return -1;
+        }
+    }
+
+    trace_file = fopen(path, "w");
+    if (!trace_file) {
+        perror("Failed to open trace file");
+        return -1;
+    }
+    fputs("[\n", trace_file);
+    first_record = 1;
+
+    // Start from empty rings
+    for (trace_ring_t* ring = atomic_load(&ring_list); ring; ring = ring->next) {
+        atomic_store(&ring->tail, atomic_load(&ring->head));
+        ring->named = 0;
+    }
+
+    atomic_store(&tracing, 1);
+    if (pthread_create(&export_thread, NULL, trace_export_thread, NULL) != 0) {
+        atomic_store(&tracing, 0);
+        fclose(trace_file);
+        trace_file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void vban_trace_stop(void) {
+    if (!atomic_load(&tracing)) return;
+
+    atomic_store(&tracing, 0);
+    pthread_join(export_thread, NULL);
+    trace_drain();
+
+    uint64_t dropped = atomic_exchange(&unclaimed_dropped, 0);
+    for (trace_ring_t* ring = atomic_load(&ring_list); ring; ring = ring->next) {
+        dropped += atomic_exchange(&ring->dropped, 0);
+    }
+    if (dropped > 0) {
+        printf("Trace dropped %llu events (ring full or more than %d threads)\n", (unsigned long long)dropped,
+               TRACE_MAX_THREADS);
+    }
+
+    fputs("\n]\n", trace_file);
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+#else
+
+void trace_event(const char* name, char phase, int64_t value) {
+    (void)name;
+    (void)phase;
+    (void)value;
+}
+
+int vban_trace_start(const char* path) {
+    (void)path;
+    printf("Tracing not compiled in, rebuild with TRACE=1\n");
+    return -1;
+}
+
+void vban_trace_stop(void) {
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef VBAN4MAC_TRACE_H
+#define VBAN4MAC_TRACE_H
+
+#include <stdint.h>
+
+// Pipeline trace points. Built only with -DVBAN_TRACE (make TRACE=1);
+// otherwise every macro compiles to nothing.
+//
+// Events go into a lock-free ring owned by the calling thread and are
+// exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) by a
+// background thread started with vban_trace_start(). That call also
+// allocates the rings, so the first event on an audio callback thread only
+// claims one. Names must be string literals.
+#ifdef VBAN_TRACE
+#define TRACE_BEGIN(name) trace_event((name), 'B', 0)
+#define TRACE_END(name) trace_event((name), 'E', 0)
+#define TRACE_INSTANT(name) trace_event((name), 'i', 0)
+#define TRACE_COUNTER(name, value) trace_event((name), 'C', (int64_t)(value))
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#endif
+
+/**
+ * Record an event on the calling thread's ring. Never blocks or allocates;
+ * events are dropped if the ring is full, every ring is claimed or no
+ * export is running.
+ * @param name Event name (string literal)
+ * @param phase Chrome trace phase: 'B' begin, 'E' end, 'i' instant, 'C' counter
+ * @param value Counter value for 'C' events
+ */
+void trace_event(const char* name, char phase, int64_t value);
+
+#endif /* VBAN4MAC_TRACE_H */
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "uring.h"
+
+#define URING_CQ_FACTOR 16          // Completion queue size relative to the submission queue
+#define URING_BUFFER_GROUP 0
+
+static int uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// Hand buffer bid to the kernel's ring of free buffers (published by the caller)
+static void uring_add_buffer(uring_t* ring, unsigned bid) {
+    struct io_uring_buf* buf = &ring->buf_ring->bufs[ring->buf_tail & (ring->buf_count - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(ring->buffers + (size_t)bid * ring->buf_size);
+    buf->len = ring->buf_size;
+    buf->bid = (uint16_t)bid;
+    ring->buf_tail++;
+}
+
+static int uring_map(uring_t* ring, const struct io_uring_params* p) {
+    ring->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    int single = (p->features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                         IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        return -1;
+    }
+    if (single) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            return -1;
+        }
+    }
+    ring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                      IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        return -1;
+    }
+
+    uint8_t* sq = ring->sq_ring;
+    uint8_t* cq = ring->cq_ring;
+    ring->sq_head = (unsigned*)(sq + p->sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + p->sq_off.tail);
+    ring->sq_mask = *(unsigned*)(sq + p->sq_off.ring_mask);
+    ring->sq_entries = p->sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+    ring->cq_head = (unsigned*)(cq + p->cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + p->cq_off.tail);
+    ring->cq_mask = *(unsigned*)(cq + p->cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + p->cq_off.cqes);
+
+    // Submission entries are always used in order
+    unsigned* array = (unsigned*)(sq + p->sq_off.array);
+    for (unsigned i = 0; i < p->sq_entries; i++) array[i] = i;
+    return 0;
+}
+
+int uring_init(uring_t* ring, int socket, unsigned entries, unsigned buffers, unsigned buffer_size) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    ring->socket = socket;
+
+    // Completions are only reaped from io_uring_enter() on one thread, and
+    // the thread is chosen when the ring is enabled
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER |
+                   IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_R_DISABLED;
+    params.cq_entries = entries * URING_CQ_FACTOR;
+    ring->fd = uring_setup(entries, &params);
+    if (ring->fd < 0) return -1;
+    if (uring_map(ring, &params) != 0) goto fail;
+
+    // The kernel picks receive buffers from this ring of free ones
+    ring->buf_count = buffers;
+    ring->buf_size = buffer_size;
+    ring->buf_ring_size = buffers * sizeof(struct io_uring_buf);
+    ring->buf_ring = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_ring == MAP_FAILED) {
+        ring->buf_ring = NULL;
+        goto fail;
+    }
+    if (posix_memalign((void**)&ring->buffers, 4096, (size_t)buffers * buffer_size) != 0) {
+        ring->buffers = NULL;
+        errno = ENOMEM;
+        goto fail;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = buffers;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) goto fail;
+
+    for (unsigned i = 0; i < buffers; i++) uring_add_buffer(ring, i);
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+
+    // Received buffers start with io_uring_recvmsg_out, then room for the
+    // source address, then the datagram
+    ring->recv_msg.msg_namelen = sizeof(struct sockaddr_storage);
+    return 0;
+
+fail: {
+        int saved = errno;
+        uring_destroy(ring);
+        errno = saved;
+        return -1;
+    }
+}
+
+void uring_destroy(uring_t* ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring) munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->fd >= 0) close(ring->fd);
+    if (ring->buf_ring) munmap(ring->buf_ring, ring->buf_ring_size);
+    free(ring->buffers);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+int uring_enable(uring_t* ring) {
+    if (uring_register(ring->fd, IORING_REGISTER_ENABLE_RINGS, NULL, 0) < 0) return -1;
+    return 0;
+}
+
+struct io_uring_sqe* uring_get_sqe(uring_t* ring) {
+    if (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        if (uring_submit(ring, 0) != 0 ||
+            ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+            return NULL;
+        }
+    }
+    struct io_uring_sqe* sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+    ring->sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uring_arm_recv(uring_t* ring, uint64_t user_data) {
+    struct io_uring_sqe* sqe = uring_get_sqe(ring);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = ring->socket;
+    sqe->addr = (uint64_t)(uintptr_t)&ring->recv_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = user_data;
+    ring->recv_armed = 1;
+    return 0;
+}
+
+int uring_submit(uring_t* ring, unsigned wait_for) {
+    unsigned to_submit = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+
+    for (;;) {
+        int ret = uring_enter(ring->fd, to_submit, wait_for, IORING_ENTER_GETEVENTS);
+        if (ret >= 0) return 0;
+        if (errno == EINTR) continue;
+        // Completion queue overflowing: the caller has to reap first
+        if (errno == EBUSY || errno == EAGAIN) return 0;
+        return -1;
+    }
+}
+
+int uring_datagram(uring_t* ring, const struct io_uring_cqe* cqe, uring_datagram_t* datagram) {
+    if (!(cqe->flags & IORING_CQE_F_BUFFER)) return -1;
+    int bid = (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    if (bid >= (int)ring->buf_count) return -1;
+
+    uint8_t* buf = ring->buffers + (size_t)bid * ring->buf_size;
+    const struct io_uring_recvmsg_out* out = (const struct io_uring_recvmsg_out*)buf;
+    size_t offset = sizeof(*out) + ring->recv_msg.msg_namelen + ring->recv_msg.msg_controllen;
+    if (cqe->res < (int)offset) {
+        datagram->len = 0;
+    } else {
+        datagram->len = (size_t)cqe->res - offset;
+    }
+    datagram->addr = (const struct sockaddr_storage*)(buf + sizeof(*out));
+    datagram->data = buf + offset;
+    datagram->truncated = (out->flags & MSG_TRUNC) != 0 || out->payloadlen > datagram->len;
+    return bid;
+}
+
+void uring_recycle(uring_t* ring, int buffer_id) {
+    uring_add_buffer(ring, (unsigned)buffer_id);
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,140 @@
+#ifndef VBAN4MAC_URING_H
+#define VBAN4MAC_URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+// Minimal io_uring for one datagram socket, on the raw system calls (no
+// liburing). A single multishot recvmsg keeps receiving into a ring of
+// provided buffers registered with the kernel: each completion names the
+// buffer the datagram landed in, which the caller reads in place and hands
+// back with uring_recycle() once it is done with it (after any sends from
+// it have completed). Sends are submitted on the same ring.
+//
+// The ring defers completion work to io_uring_enter() on the thread that
+// enabled it, so the socket stays readable for an outside poll() until
+// then, and every call after uring_enable() must come from that thread.
+// Linux 6.1 or later, built with URING=1.
+
+typedef struct {
+    int fd;
+
+    // Submission queue
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;              // Next free SQE; published to sq_tail on submit
+    struct io_uring_sqe* sqes;
+
+    // Completion queue
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;                  // Same mapping as sq_ring with IORING_FEAT_SINGLE_MMAP
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    // Provided buffers, group 0
+    struct io_uring_buf_ring* buf_ring;
+    size_t buf_ring_size;
+    uint8_t* buffers;
+    unsigned buf_count;
+    unsigned buf_size;
+    uint16_t buf_tail;
+
+    // The multishot receive
+    int socket;
+    struct msghdr recv_msg;         // Only the name and control lengths are used
+    int recv_armed;
+} uring_t;
+
+// Layout of a received datagram in its buffer
+typedef struct {
+    const struct sockaddr_storage* addr;
+    uint8_t* data;                  // Datagram bytes, writable in place
+    size_t len;                     // Bytes in the buffer (less than the datagram if truncated)
+    int truncated;
+} uring_datagram_t;
+
+/**
+ * Set up a ring for a socket, disabled until uring_enable()
+ * @param ring Ring to initialize
+ * @param socket Bound UDP socket
+ * @param entries Submission queue size (power of two)
+ * @param buffers Provided buffers to register (power of two, at most 32768)
+ * @param buffer_size Bytes per buffer, including the receive header and source address
+ * @return 0 on success, -1 if io_uring is unavailable or setup failed (errno set)
+ */
+int uring_init(uring_t* ring, int socket, unsigned entries, unsigned buffers, unsigned buffer_size);
+
+/**
+ * Unmap and close the ring
+ */
+void uring_destroy(uring_t* ring);
+
+/**
+ * Enable the ring, binding it to the calling thread
+ * @return 0 on success, -1 on error
+ */
+int uring_enable(uring_t* ring);
+
+/**
+ * Next free submission entry, submitting what is queued first if the
+ * queue is full
+ * @return Zeroed entry, or NULL if the queue stays full
+ */
+struct io_uring_sqe* uring_get_sqe(uring_t* ring);
+
+/**
+ * Queue the multishot receive again, after a completion without
+ * IORING_CQE_F_MORE
+ * @return 0 on success, -1 if the submission queue is full
+ */
+int uring_arm_recv(uring_t* ring, uint64_t user_data);
+
+/**
+ * Submit queued entries and run deferred completion work
+ * @param ring The ring
+ * @param wait_for Completions to wait for (0 = don't wait)
+ * @return 0 on success, -1 on error
+ */
+int uring_submit(uring_t* ring, unsigned wait_for);
+
+/**
+ * Oldest unread completion, or NULL
+ */
+static inline struct io_uring_cqe* uring_peek_cqe(uring_t* ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+/**
+ * Mark the completion returned by uring_peek_cqe() as read
+ */
+static inline void uring_cqe_seen(uring_t* ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Locate a received datagram in its buffer
+ * @param ring The ring
+ * @param cqe Receive completion with a buffer (res > 0, IORING_CQE_F_BUFFER set)
+ * @param datagram Filled with the source address and data
+ * @return Buffer ID to pass to uring_recycle(), or -1 if the completion is malformed
+ */
+int uring_datagram(uring_t* ring, const struct io_uring_cqe* cqe, uring_datagram_t* datagram);
+
+/**
+ * Give a buffer back to the kernel for further receives
+ */
+void uring_recycle(uring_t* ring, int buffer_id);
+
+#endif /* VBAN4MAC_URING_H */
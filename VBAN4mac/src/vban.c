@@ -1,34 +1,71 @@
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "../include/vban4mac/vban.h"
 #include "../include/vban4mac/types.h"
 #include "network.h"
+#include "packet.h"
 #include "audio.h"
+#include "trace.h"
 
 vban_handle_t vban_init(const char* remote_ip, const char* stream_name) {
     return vban_init_with_port(remote_ip, stream_name, VBAN_DEFAULT_PORT);
 }
 
 vban_handle_t vban_init_with_port(const char* remote_ip, const char* stream_name, uint16_t port) {
+    vban_options_t options = {0};
+    options.remote_ip = remote_ip;
+    options.stream_name = stream_name;
+    options.port = port;
+    return vban_init_with_options(&options);
+}
+
+vban_handle_t vban_init_with_options(const vban_options_t* options) {
     // Allocate context
     vban_context_t* ctx = calloc(1, sizeof(vban_context_t));
     if (!ctx) {
         return NULL;
     }
 
-    // Initialize network with custom port
-    if (network_init_with_port(ctx, remote_ip, port) != 0) {
+    // Initialize network with custom port, bind address and workers
+    if (network_init_with_options(ctx, options->remote_ip, options->bind_ip,
+                                  options->port, options->rx_workers) != 0) {
         free(ctx);
         return NULL;
     }
 
+    // The bridge plays and captures through the audio backend's rings
+    ctx->rx_ring = &g_audio_buffer;
+    ctx->tx_ring = &g_input_buffer;
+    ctx->set_playout_target = audio_set_playout_target;
+
     // Copy stream name
-    strncpy(ctx->streamname, stream_name, sizeof(ctx->streamname) - 1);
-    ctx->frame_counter = 0;
+    strncpy(ctx->streamname, options->stream_name, sizeof(ctx->streamname) - 1);
+    int input_channels = options->input_channels > 0 ? options->input_channels : 1;
+    int output_channels = options->output_channels > 0 ? options->output_channels : 2;
+
+    // Standard 256-frame packets, fewer frames when that many channels don't fit
+    ctx->send_channels = input_channels;
+    ctx->send_frames = VBAN_MAX_PACKET_SIZE / (int)sizeof(int16_t) / input_channels;
+    if (ctx->send_frames > 256) ctx->send_frames = 256;
+    vban_header_init(&ctx->send_header, ctx->streamname, VBAN_SAMPLE_RATE_INDEX, ctx->send_frames,
+                     input_channels, VBAN_DATATYPE_INT16);
+    if (options->shm_name) {
+        strncpy(ctx->shm_name, options->shm_name, sizeof(ctx->shm_name) - 1);
+    }
+    atomic_init(&ctx->frame_counter, 0);
+    dtx_init(&ctx->dtx, &options->dtx, ctx->send_frames, VBAN_SAMPLE_RATE);
+    atomic_init(&ctx->packets_sent, 0);
+    atomic_init(&ctx->packets_suppressed, 0);
+    atomic_init(&ctx->packets_torn, 0);
     ctx->is_running = 1;
 
     // Initialize audio
     if (audio_buffer_init() != 0 ||
+        audio_set_channels(input_channels, output_channels) != 0 ||
+        audio_set_catchup(&options->catchup) != 0 ||
+        (options->dsp_pool && network_enable_dsp(ctx, options->dsp_pool, options->dsp, options->dsp_user) != 0) ||
+        network_enable_impair(ctx, &options->impair) != 0 ||
         audio_output_init() != noErr ||
         audio_input_init() != noErr ||
         audio_start_input() != noErr) {
@@ -37,11 +74,9 @@ vban_handle_t vban_init_with_port(const char* remote_ip, const char* stream_name
         return NULL;
     }
 
-    // Start network threads
-    if (pthread_create(&ctx->receive_thread, NULL, network_receive_thread, ctx) != 0 ||
-        pthread_create(&ctx->send_thread, NULL, network_send_thread, ctx) != 0) {
+    // Hand the sockets and send timer to the shared event loops
+    if (network_start(ctx, options->event_threads) != 0) {
         ctx->is_running = 0;
-        pthread_join(ctx->receive_thread, NULL);
         network_cleanup(ctx);
         audio_cleanup();
         free(ctx);
@@ -56,8 +91,7 @@ void vban_cleanup(vban_handle_t handle) {
     vban_context_t* ctx = (vban_context_t*)handle;
     if (ctx) {
         ctx->is_running = 0;
-        pthread_join(ctx->receive_thread, NULL);
-        pthread_join(ctx->send_thread, NULL);
+        network_stop(ctx);
         network_cleanup(ctx);
         audio_cleanup();
         free(ctx);
@@ -71,30 +105,70 @@ int vban_send_audio(vban_handle_t handle, const int16_t* audio_data,
         return -1;
     }
 
-    uint8_t packet[VBAN_HEADER_SIZE + VBAN_MAX_PACKET_SIZE];
-    vban_header_t* header = (vban_header_t*)packet;
-
-    // Fill header
-    header->vban = htonl(('V' << 24) | ('B' << 16) | ('A' << 8) | 'N');
-    header->format_SR = VBAN_SAMPLE_RATE_INDEX;
-    header->format_nbs = num_samples - 1;
-    header->format_nbc = num_channels - 1;
-    header->format_bit = VBAN_DATATYPE_INT16;
-    strncpy(header->streamname, ctx->streamname, 16);
-    header->nuFrame = ctx->frame_counter++;
-
-    // Copy audio data
-    size_t data_size = num_samples * num_channels * sizeof(int16_t);
-    if (data_size > VBAN_MAX_PACKET_SIZE) {
-        return -2;
+    // Header comes from the stream's template, payload straight from the
+    // caller. An explicit send always goes out: silence suppression is the
+    // send timer's.
+    audio_buffer_span_t payload = { { (int16_t*)audio_data, NULL },
+                                    { (size_t)num_samples * num_channels, 0 } };
+    return network_send_span(ctx, &payload, num_samples, num_channels, 0);
+}
+
+int vban_get_jitter_stats(vban_handle_t handle, vban_jitter_stats_t* stats) {
+    vban_context_t* ctx = (vban_context_t*)handle;
+    if (!ctx || !stats) {
+        return -1;
     }
-    memcpy(packet + VBAN_HEADER_SIZE, audio_data, data_size);
+    jitter_get_stats(&ctx->jitter, stats);
+    return 0;
+}
 
-    // Send packet
-    ssize_t sent = sendto(ctx->socket, packet, VBAN_HEADER_SIZE + data_size, 0,
-                         (struct sockaddr*)&ctx->remote_addr, sizeof(ctx->remote_addr));
-    
-    return (sent == VBAN_HEADER_SIZE + data_size) ? 0 : -3;
+int vban_get_sender_stats(vban_handle_t handle, vban_sender_stats_t* stats) {
+    vban_context_t* ctx = (vban_context_t*)handle;
+    if (!ctx || !stats) {
+        return -1;
+    }
+    stats->packets_sent = atomic_load_explicit(&ctx->packets_sent, memory_order_relaxed);
+    stats->packets_suppressed = atomic_load_explicit(&ctx->packets_suppressed, memory_order_relaxed);
+    stats->packets_torn = atomic_load_explicit(&ctx->packets_torn, memory_order_relaxed);
+    return 0;
+}
+
+int vban_get_impair_stats(vban_handle_t handle, vban_impair_stats_t* stats) {
+    vban_context_t* ctx = (vban_context_t*)handle;
+    if (!ctx || !stats) {
+        return -1;
+    }
+    memset(stats, 0, sizeof(*stats));
+    network_rx_port_t* port = ctx->rx_port;
+    for (int i = 0; i < port->num_workers; i++) {
+        if (!port->workers[i].impair) continue;
+        vban_impair_stats_t worker;
+        impair_get_stats(port->workers[i].impair, &worker);
+        stats->received += worker.received;
+        stats->delivered += worker.delivered;
+        stats->lost_random += worker.lost_random;
+        stats->lost_burst += worker.lost_burst;
+        stats->lost_queue += worker.lost_queue;
+        stats->reordered += worker.reordered;
+        stats->duplicated += worker.duplicated;
+    }
+    return 0;
+}
+
+int vban_get_audio_stats(vban_handle_t handle, vban_audio_stats_t* stats) {
+    if (!handle || !stats) {
+        return -1;
+    }
+    return audio_get_stats(stats);
+}
+
+int vban_get_levels(vban_handle_t handle, vban_levels_t* levels) {
+    if (!handle || !levels) {
+        return -1;
+    }
+    levels->input_channels = audio_get_input_levels(levels->input, VBAN_MAX_LEVEL_CHANNELS);
+    levels->output_channels = audio_get_output_levels(levels->output, VBAN_MAX_LEVEL_CHANNELS);
+    return 0;
 }
 
 int vban_is_running(vban_handle_t handle) {